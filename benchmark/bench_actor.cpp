@@ -7,11 +7,15 @@
 #include "td/utils/benchmark.h"
 
 #include "td/actor/actor.h"
+#include "td/actor/impl2/Scheduler.h"
 #include "td/actor/PromiseFuture.h"
 
 #include "td/utils/logging.h"
 
 #include <algorithm>
+#include <atomic>
+#include <memory>
+#include <vector>
 
 #if TD_MSVC
 #pragma comment(linker, "/STACK:16777216")
@@ -266,7 +270,163 @@ class QueryBench : public td::Benchmark {
   td::ActorOwn<ServerActor> server_;
 };
 
-int main() {
+static std::atomic<int> hot_actors_left;
+
+static td::uint32 hot_work(td::uint32 x) {
+  for (int i = 0; i < 1000; i++) {
+    x = x * 1664525 + 1013904223;
+  }
+  return x;
+}
+
+// all actors live on one scheduler, while other schedulers have nothing to do
+class HotSchedulerBench : public td::Benchmark {
+ public:
+  struct WorkActor : public td::Actor {
+    explicit WorkActor(int n) : n_(n) {
+    }
+    void start_up() override {
+      yield();
+    }
+    void wakeup() override {
+      work();
+    }
+    void work() {
+      x_ = hot_work(x_);
+      td::do_not_optimize_away(x_);
+      if (--n_ <= 0) {
+        if (--hot_actors_left == 0) {
+          td::Scheduler::instance()->finish();
+        }
+        stop();
+        return;
+      }
+      send_closure_later(actor_id(this), &WorkActor::work);
+    }
+
+   private:
+    int n_;
+    td::uint32 x_ = 0;
+  };
+
+  HotSchedulerBench(int actor_n, int thread_n) : actor_n_(actor_n), thread_n_(thread_n) {
+  }
+
+  std::string get_description() const override {
+    return PSTRING() << "HotScheduler (impl) (actor_n = " << actor_n_ << ", threads_n = " << thread_n_ << ")";
+  }
+
+  void start_up_n(int n) override {
+    scheduler_ = std::make_unique<td::ConcurrentScheduler>();
+    scheduler_->init(thread_n_);
+    hot_actors_left = actor_n_;
+    for (int i = 0; i < actor_n_; i++) {
+      scheduler_->create_actor_unsafe<WorkActor>(thread_n_ ? 1 : 0, "WorkActor", std::max(n / actor_n_, 1)).release();
+    }
+    scheduler_->start();
+  }
+
+  void run(int n) override {
+    while (scheduler_->run_main(10)) {
+      // empty
+    }
+  }
+
+  void tear_down() override {
+    scheduler_->finish();
+    scheduler_.reset();
+  }
+
+ private:
+  int actor_n_;
+  int thread_n_;
+  std::unique_ptr<td::ConcurrentScheduler> scheduler_;
+};
+
+// the same load for impl2::Scheduler, with or without work stealing between schedulers
+class HotScheduler2Bench : public td::Benchmark {
+ public:
+  class WorkActor : public td::actor2::Actor {
+   public:
+    explicit WorkActor(int n) : n_(n) {
+    }
+    void work() {
+      x_ = hot_work(x_);
+      td::do_not_optimize_away(x_);
+      if (--n_ <= 0) {
+        if (--hot_actors_left == 0) {
+          td::actor2::SchedulerContext::get()->stop();
+        }
+        stop();
+        return;
+      }
+      td::actor2::send_closure_later(td::actor2::actor_id(this), &WorkActor::work);
+    }
+
+   private:
+    int n_;
+    td::uint32 x_ = 0;
+  };
+
+  HotScheduler2Bench(int actor_n, int scheduler_n, bool with_work_stealing)
+      : actor_n_(actor_n), scheduler_n_(scheduler_n), with_work_stealing_(with_work_stealing) {
+  }
+
+  std::string get_description() const override {
+    return PSTRING() << "HotScheduler (impl2" << (with_work_stealing_ ? ", work stealing" : "")
+                     << ") (actor_n = " << actor_n_ << ", schedulers_n = " << scheduler_n_ << ")";
+  }
+
+  void start_up_n(int n) override {
+    group_info_ = std::make_shared<td::actor2::SchedulerGroupInfo>(scheduler_n_, with_work_stealing_);
+    for (int i = 0; i < scheduler_n_; i++) {
+      schedulers_.push_back(std::make_unique<td::actor2::Scheduler>(
+          group_info_, td::actor2::SchedulerId{static_cast<td::uint8>(i)}, 1));
+    }
+    for (auto &scheduler : schedulers_) {
+      scheduler->start();
+    }
+    hot_actors_left = actor_n_;
+    schedulers_[0]->run_in_context([&] {
+      for (int i = 0; i < actor_n_; i++) {
+        auto actor_id = td::actor2::create_actor<WorkActor>(td::actor2::ActorOptions().with_name("WorkActor").on_scheduler(
+                                                                td::actor2::SchedulerId{0}),
+                                                            std::max(n / actor_n_, 1))
+                            .release();
+        td::actor2::send_closure_later(actor_id, &WorkActor::work);
+      }
+    });
+  }
+
+  void run(int n) override {
+    std::vector<bool> is_running(schedulers_.size(), true);
+    bool is_any_running = true;
+    while (is_any_running) {
+      is_any_running = false;
+      for (size_t i = 0; i < schedulers_.size(); i++) {
+        if (is_running[i]) {
+          is_running[i] = schedulers_[i]->run(0.001);
+          is_any_running |= is_running[i];
+        }
+      }
+    }
+  }
+
+  void tear_down() override {
+    td::actor2::Scheduler::close_scheduler_group(*group_info_);
+    schedulers_.clear();
+    group_info_.reset();
+  }
+
+ private:
+  int actor_n_;
+  int scheduler_n_;
+  bool with_work_stealing_;
+  std::shared_ptr<td::actor2::SchedulerGroupInfo> group_info_;
+  std::vector<std::unique_ptr<td::actor2::Scheduler>> schedulers_;
+};
+
+BENCHMARK_SUITE(actor) {
   SET_VERBOSITY_LEVEL(VERBOSITY_NAME(DEBUG));
   bench(RingBench<4>(504, 0));
   bench(RingBench<3>(504, 0));
@@ -286,5 +446,7 @@ int main() {
   bench(RingBench<0>(504, 2));
   bench(RingBench<1>(504, 2));
   bench(RingBench<2>(504, 2));
-  return 0;
+  bench(HotSchedulerBench(64, 3));
+  bench(HotScheduler2Bench(64, 4, false));
+  bench(HotScheduler2Bench(64, 4, true));
 }
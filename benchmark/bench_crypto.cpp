@@ -13,6 +13,7 @@
 #include "td/utils/Random.h"
 #include "td/utils/Slice.h"
 
+#include <openssl/aes.h>
 #include <openssl/sha.h>
 
 #include <array>
@@ -74,6 +75,55 @@ class AESBench : public td::Benchmark {
   }
 };
 
+class AesIgeBench : public td::Benchmark {
+ public:
+  enum class Type { OpenSsl, Function, State };
+
+  AesIgeBench(Type type, size_t size) : type_(type), data_(size, '\0') {
+  }
+
+  std::string get_description() const override {
+    const char *name = type_ == Type::OpenSsl ? "OpenSSL" : type_ == Type::Function ? "aes_ige_decrypt" : "AesIgeState";
+    return PSTRING("AES IGE decrypt %s [%dKB]", name, static_cast<int>(data_.size() >> 10));
+  }
+
+  void start_up() override {
+    for (auto &c : data_) {
+      c = 123;
+    }
+    td::Random::secure_bytes(key_.raw, sizeof(key_));
+    td::Random::secure_bytes(iv_.raw, sizeof(iv_));
+    state_.init(key_, false);
+  }
+
+  void run(int n) override {
+    td::MutableSlice data_slice(&data_[0], data_.size());
+    for (int i = 0; i < n; i++) {
+      switch (type_) {
+        case Type::OpenSsl: {
+          AES_KEY aes_key;
+          AES_set_decrypt_key(key_.raw, 256, &aes_key);
+          AES_ige_encrypt(data_slice.ubegin(), data_slice.ubegin(), data_slice.size(), &aes_key, iv_.raw, AES_DECRYPT);
+          break;
+        }
+        case Type::Function:
+          td::aes_ige_decrypt(key_, &iv_, data_slice, data_slice);
+          break;
+        case Type::State:
+          state_.decrypt(&iv_, data_slice, data_slice);
+          break;
+      }
+    }
+  }
+
+ private:
+  Type type_;
+  std::string data_;
+  td::UInt256 key_;
+  td::UInt256 iv_;
+  td::AesIgeState state_;
+};
+
 BENCH(Rand, "std_rand") {
   int res = 0;
   for (int i = 0; i < n; i++) {
@@ -195,7 +245,30 @@ class Crc64Bench : public td::Benchmark {
   }
 };
 
-int main() {
+class Crc32cBench : public td::Benchmark {
+ public:
+  alignas(64) unsigned char data[DATA_SIZE];
+
+  std::string get_description() const override {
+    return PSTRING("Crc32c [%dKB]", DATA_SIZE >> 10);
+  }
+
+  void start_up() override {
+    for (int i = 0; i < DATA_SIZE; i++) {
+      data[i] = 0;
+    }
+  }
+
+  void run(int n) override {
+    td::uint64 res = 0;
+    for (int i = 0; i < n; i++) {
+      res += td::crc32c(td::Slice(data, DATA_SIZE));
+    }
+    td::do_not_optimize_away(res);
+  }
+};
+
+BENCHMARK_SUITE(crypto) {
   td::bench(Pbkdf2Bench());
   td::bench(RandBench());
   td::bench(CppRandBench());
@@ -207,7 +280,12 @@ int main() {
   td::bench(SslRandBufBench());
   td::bench(SHA1Bench());
   td::bench(AESBench());
+  for (size_t size : {1 << 10, 512 << 10}) {
+    for (auto type : {AesIgeBench::Type::OpenSsl, AesIgeBench::Type::Function, AesIgeBench::Type::State}) {
+      td::bench(AesIgeBench(type, size));
+    }
+  }
   td::bench(Crc32Bench());
+  td::bench(Crc32cBench());
   td::bench(Crc64Bench());
-  return 0;
 }
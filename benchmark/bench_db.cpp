@@ -223,7 +223,7 @@ class BinlogKeyValueBench : public td::Benchmark {
   }
 };
 
-int main() {
+BENCHMARK_SUITE(db) {
   SET_VERBOSITY_LEVEL(VERBOSITY_NAME(WARNING));
   bench(BinlogKeyValueBench<true>());
   bench(BinlogKeyValueBench<false>());
@@ -233,5 +233,4 @@ int main() {
   bench(TdKvBench<td::BinlogKeyValue<td::Binlog>>("BinlogKeyValue<Binlog>"));
   bench(TdKvBench<td::BinlogKeyValue<td::ConcurrentBinlog>>("BinlogKeyValue<ConcurrentBinlog>"));
   bench(SeqKvBench());
-  return 0;
 }
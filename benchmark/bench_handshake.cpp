@@ -69,8 +69,7 @@ class HandshakeBench : public Benchmark {
 };
 }  // namespace td
 
-int main() {
+BENCHMARK_SUITE(handshake) {
   SET_VERBOSITY_LEVEL(VERBOSITY_NAME(DEBUG));
   td::bench(td::HandshakeBench());
-  return 0;
 }
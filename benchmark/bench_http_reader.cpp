@@ -110,7 +110,7 @@ class FindBoundaryBench : public td::Benchmark {
   }
 };
 
-int main() {
+BENCHMARK_SUITE(http_reader) {
   SET_VERBOSITY_LEVEL(VERBOSITY_NAME(WARNING));
   td::bench(BufferBench());
   td::bench(FindBoundaryBench());
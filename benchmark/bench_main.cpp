@@ -0,0 +1,124 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2017
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/utils/benchmark.h"
+
+#include "td/utils/common.h"
+#include "td/utils/logging.h"
+#include "td/utils/misc.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+static std::atomic<bool> is_allocation_count_enabled{false};
+static std::atomic<td::uint64> allocation_count{0};
+
+static td::uint64 get_allocation_count() {
+  return allocation_count.load(std::memory_order_relaxed);
+}
+
+static void *allocate(std::size_t size) {
+  if (is_allocation_count_enabled.load(std::memory_order_relaxed)) {
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+  }
+  void *ptr = std::malloc(size == 0 ? 1 : size);
+  if (ptr == nullptr) {
+    // exceptions are disabled
+    std::abort();
+  }
+  return ptr;
+}
+
+void *operator new(std::size_t size) {
+  return allocate(size);
+}
+
+void *operator new[](std::size_t size) {
+  return allocate(size);
+}
+
+void operator delete(void *ptr) noexcept {
+  std::free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept {
+  std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept {
+  std::free(ptr);
+}
+
+void operator delete[](void *ptr, std::size_t) noexcept {
+  std::free(ptr);
+}
+
+static void print_usage(const char *name) {
+  std::printf(
+      "Usage: %s [options]\n"
+      "  --suite <name>         run only benchmarks from the given suite; can be repeated\n"
+      "  --filter <[+-]substr>  run only benchmarks, which description contains (or not) the substring\n"
+      "  --runs <n>             number of measured runs of each benchmark, default is 5\n"
+      "  --warmup <n>           number of additional unmeasured runs before the measured runs\n"
+      "  --time <seconds>       target duration of one run\n"
+      "  --format <format>      output format: text (default), json or csv\n"
+      "  --count-allocations    count memory allocations made through operator new\n"
+      "  --list                 print descriptions of the benchmarks without running them\n"
+      "\n"
+      "Run median and run max (run_median_ns and run_max_ns in json and csv) are the median and the maximum\n"
+      "of the average operation times of the measured runs. Operations aren't timed individually, so these\n"
+      "are statistics across runs, not percentiles of single operation times.\n",
+      name);
+}
+
+int main(int argc, char **argv) {
+  auto &options = td::get_benchmark_options();
+  for (int i = 1; i < argc; i++) {
+    auto need_arg = [&] {
+      if (i + 1 >= argc) {
+        print_usage(argv[0]);
+        std::exit(2);
+      }
+      return td::CSlice(argv[++i]);
+    };
+    if (!std::strcmp(argv[i], "--suite")) {
+      td::BenchmarkSuite::add_suite_filter(need_arg().str());
+    } else if (!std::strcmp(argv[i], "--filter")) {
+      td::BenchmarkSuite::add_substr_filter(need_arg().str());
+    } else if (!std::strcmp(argv[i], "--runs")) {
+      options.run_count = td::to_integer<td::int32>(need_arg());
+    } else if (!std::strcmp(argv[i], "--warmup")) {
+      options.warmup_count = td::to_integer<td::int32>(need_arg());
+    } else if (!std::strcmp(argv[i], "--time")) {
+      options.max_time = td::to_double(need_arg());
+    } else if (!std::strcmp(argv[i], "--format")) {
+      auto format = need_arg();
+      if (format == "text") {
+        options.output_format = td::BenchmarkOptions::OutputFormat::Text;
+      } else if (format == "json") {
+        options.output_format = td::BenchmarkOptions::OutputFormat::Json;
+      } else if (format == "csv") {
+        options.output_format = td::BenchmarkOptions::OutputFormat::Csv;
+      } else {
+        print_usage(argv[0]);
+        return 2;
+      }
+    } else if (!std::strcmp(argv[i], "--count-allocations")) {
+      is_allocation_count_enabled = true;
+      options.get_allocation_count = get_allocation_count;
+    } else if (!std::strcmp(argv[i], "--list")) {
+      options.list_only = true;
+    } else {
+      print_usage(argv[0]);
+      return 2;
+    }
+  }
+
+  td::BenchmarkSuite::run_all();
+  return 0;
+}
@@ -4,7 +4,12 @@
 // Distributed under the Boost Software License, Version 1.0. (See accompanying
 // file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
 //
+#include "td/actor/actor.h"
+#include "td/actor/PromiseFuture.h"
+
 #include "td/utils/benchmark.h"
+#include "td/utils/buffer.h"
+#include "td/utils/ChunkedSortedMap.h"
 #include "td/utils/common.h"
 #include "td/utils/logging.h"
 #include "td/utils/port/Clocks.h"
@@ -14,8 +19,13 @@
 #include "td/utils/port/RwMutex.h"
 #include "td/utils/port/Stat.h"
 #include "td/utils/port/thread.h"
+#include "td/utils/Random.h"
+#include "td/utils/SlabMap.h"
 #include "td/utils/Slice.h"
 
+#include "td/telegram/files/FileIoWorker.h"
+#include "td/telegram/net/DcId.h"
+#include "td/telegram/net/InitedDcCache.h"
 #include "td/telegram/telegram_api.h"
 #include "td/telegram/telegram_api.hpp"
 
@@ -28,8 +38,12 @@
 #include <semaphore.h>
 #endif
 
+#include <algorithm>
+#include <array>
 #include <atomic>
 #include <cstdint>
+#include <map>
+#include <memory>
 
 namespace td {
 
@@ -232,6 +246,103 @@ class CreateFileBench : public Benchmark {
     });
   }
 };
+// parts are written by a loader actor on the main scheduler, either inline or through FileIoWorker on its own thread
+template <bool use_worker>
+class FilePartWriteBench : public Benchmark {
+ public:
+  static constexpr size_t PART_SIZE = 1 << 14;
+  static constexpr int PART_COUNT = 64;
+  static constexpr int MAX_PARTS_IN_FLIGHT = 16;
+
+  string get_description() const override {
+    return PSTRING() << "Write 16KB file parts " << (use_worker ? "through FileIoWorker" : "in loader actor");
+  }
+
+  void start_up() override {
+    fd_ = std::make_shared<FileFd>(
+        FileFd::open("test", FileFd::Flags::Create | FileFd::Flags::Truncate | FileFd::Flags::Read |
+                                 FileFd::Flags::Write)
+            .move_as_ok());
+    scheduler_ = std::make_unique<ConcurrentScheduler>();
+    scheduler_->init(1);
+    worker_ = scheduler_->create_actor_unsafe<FileIoWorker>(1, "FileIoWorker").release();
+    scheduler_->start();
+  }
+
+  void run(int n) override {
+    {
+      auto guard = scheduler_->get_current_guard();
+      create_actor<Loader>("Loader", n, fd_, worker_).release();
+    }
+    while (scheduler_->run_main(10)) {
+      // empty
+    }
+  }
+
+  void tear_down() override {
+    scheduler_->finish();
+    scheduler_.reset();
+
+    string part(PART_SIZE, '\0');
+    CHECK(fd_->pread(part, 0).move_as_ok() == PART_SIZE);
+    CHECK(part == string(PART_SIZE, 'a'));
+    fd_->close();
+    fd_.reset();
+    unlink("test").ignore();
+  }
+
+ private:
+  class Loader : public Actor {
+   public:
+    Loader(int n, std::shared_ptr<FileFd> fd, ActorId<FileIoWorker> worker)
+        : n_(n), fd_(std::move(fd)), worker_(worker), part_(string(PART_SIZE, 'a')) {
+    }
+
+    void start_up() override {
+      loop();
+    }
+
+    void loop() override {
+      while (sent_ < n_ && sent_ - done_ < MAX_PARTS_IN_FLIGHT) {
+        auto offset = static_cast<int64>(sent_ % PART_COUNT) * static_cast<int64>(PART_SIZE);
+        sent_++;
+        if (use_worker) {
+          send_closure(worker_, &FileIoWorker::pwrite, fd_, offset, part_.clone(),
+                       PromiseCreator::lambda([actor_id = actor_id(this)](Result<size_t> r_written) {
+                         send_closure(actor_id, &Loader::on_part_written, r_written.move_as_ok());
+                       }));
+        } else {
+          on_part_written(fd_->pwrite(part_.as_slice(), offset).move_as_ok());
+        }
+      }
+      if (done_ == n_) {
+        Scheduler::instance()->finish();
+        stop();
+      }
+    }
+
+    void on_part_written(size_t size) {
+      CHECK(size == PART_SIZE);
+      done_++;
+      if (use_worker) {
+        loop();
+      }
+    }
+
+   private:
+    int n_;
+    int sent_ = 0;
+    int done_ = 0;
+    std::shared_ptr<FileFd> fd_;
+    ActorId<FileIoWorker> worker_;
+    BufferSlice part_;
+  };
+
+  std::shared_ptr<FileFd> fd_;
+  std::unique_ptr<ConcurrentScheduler> scheduler_;
+  ActorId<FileIoWorker> worker_;
+};
+
 class WalkPathBench : public Benchmark {
   string get_description() const override {
     return "walk_path";
@@ -311,6 +422,92 @@ class AtomicReleaseCasIncBench : public Benchmark {
 template <int ThreadN>
 std::atomic<uint64> AtomicReleaseCasIncBench<ThreadN>::a_;
 
+// emulates NetQueryDispatcher::wait_dc_init for already inited DCs from many schedulers
+class DcInitAtomicChecker {
+ public:
+  static string get_name() {
+    return "atomic";
+  }
+  explicit DcInitAtomicChecker(int thread_count) {
+    for (auto &dc : dcs_) {
+      dc.is_valid_ = true;
+      dc.is_inited_ = true;
+    }
+  }
+  bool check(int thread_id, int32 raw_dc_id) {
+    size_t pos = static_cast<size_t>(raw_dc_id - 1);
+    if (pos >= dcs_.size()) {
+      return false;
+    }
+    auto &dc = dcs_[pos];
+    if (!dc.is_valid_) {
+      bool expected = false;
+      dc.is_valid_.compare_exchange_strong(expected, true, std::memory_order_seq_cst, std::memory_order_seq_cst);
+    }
+    while (!dc.is_inited_) {
+    }
+    return true;
+  }
+
+ protected:
+  struct Dc {
+    std::atomic<bool> is_valid_{false};
+    std::atomic<bool> is_inited_{false};
+  };
+  std::array<Dc, InitedDcCache::MAX_DC_COUNT> dcs_;
+};
+
+// checks the same per-scheduler cache as NetQueryDispatcher::is_dc_inited_locally before the atomics
+class DcInitLocalChecker : public DcInitAtomicChecker {
+ public:
+  static string get_name() {
+    return "scheduler local";
+  }
+  explicit DcInitLocalChecker(int thread_count) : DcInitAtomicChecker(thread_count), inited_dcs_(thread_count) {
+  }
+  bool check(int thread_id, int32 raw_dc_id) {
+    auto dc_id = DcId::internal(raw_dc_id);
+    auto &inited_dcs = inited_dcs_[thread_id];
+    if (inited_dcs.is_inited(dc_id)) {
+      return true;
+    }
+    if (!DcInitAtomicChecker::check(thread_id, raw_dc_id)) {
+      return false;
+    }
+    inited_dcs.on_dc_inited(dc_id);
+    return true;
+  }
+
+ private:
+  std::vector<InitedDcCache> inited_dcs_;
+};
+
+template <class CheckerT, int ThreadN = 4>
+class DcInitCheckBench : public Benchmark {
+  string get_description() const override {
+    return PSTRING() << "DcInitCheck " << CheckerT::get_name() << " " << ThreadN;
+  }
+
+  void run(int n) override {
+    CheckerT checker(ThreadN);
+    std::atomic<uint64> checked_count{0};
+    std::vector<thread> threads;
+    for (int thread_id = 0; thread_id < ThreadN; thread_id++) {
+      threads.emplace_back([&, thread_id] {
+        uint64 count = 0;
+        for (int i = 0; i < n / ThreadN; i++) {
+          count += checker.check(thread_id, (i & 3) + 1);
+        }
+        checked_count += count;
+      });
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+    CHECK(checked_count == static_cast<uint64>(n / ThreadN * ThreadN));
+  }
+};
+
 template <int ThreadN = 2>
 class RwMutexReadBench : public Benchmark {
   string get_description() const override {
@@ -352,15 +549,347 @@ class RwMutexWriteBench : public Benchmark {
   }
 };
 #endif
+
+struct MessageStub {
+  int64 message_id = 0;
+  int32 random_y = 0;
+  unique_ptr<MessageStub> left;
+  unique_ptr<MessageStub> right;
+};
+
+// treap, which was used to store messages in MessagesManager before
+class MessagesTreap {
+ public:
+  static string get_name() {
+    return "Treap";
+  }
+
+  void insert(unique_ptr<MessageStub> message) {
+    message->random_y = static_cast<int32>(static_cast<uint32>(message->message_id * 2101234567u));
+    unique_ptr<MessageStub> *v = &root_;
+    while (*v != nullptr && (*v)->random_y >= message->random_y) {
+      v = (*v)->message_id < message->message_id ? &(*v)->right : &(*v)->left;
+    }
+    unique_ptr<MessageStub> *left = &message->left;
+    unique_ptr<MessageStub> *right = &message->right;
+    unique_ptr<MessageStub> cur = std::move(*v);
+    while (cur != nullptr) {
+      if (cur->message_id < message->message_id) {
+        *left = std::move(cur);
+        left = &((*left)->right);
+        cur = std::move(*left);
+      } else {
+        *right = std::move(cur);
+        right = &((*right)->left);
+        cur = std::move(*right);
+      }
+    }
+    *v = std::move(message);
+  }
+
+  unique_ptr<MessageStub> extract(int64 message_id) {
+    unique_ptr<MessageStub> *v = &root_;
+    while (*v != nullptr && (*v)->message_id != message_id) {
+      v = (*v)->message_id < message_id ? &(*v)->right : &(*v)->left;
+    }
+    if (*v == nullptr) {
+      return nullptr;
+    }
+    unique_ptr<MessageStub> result = std::move(*v);
+    unique_ptr<MessageStub> left = std::move(result->left);
+    unique_ptr<MessageStub> right = std::move(result->right);
+    while (left != nullptr || right != nullptr) {
+      if (left == nullptr || (right != nullptr && right->random_y > left->random_y)) {
+        *v = std::move(right);
+        v = &((*v)->left);
+        right = std::move(*v);
+      } else {
+        *v = std::move(left);
+        v = &((*v)->right);
+        left = std::move(*v);
+      }
+    }
+    return result;
+  }
+
+  // sums identifiers of count messages starting from the greatest message with identifier not greater than from
+  int64 scan(int64 from, int count) const {
+    std::vector<const MessageStub *> stack;
+    size_t last_right_pos = 0;
+    const MessageStub *cur = root_.get();
+    while (cur != nullptr) {
+      stack.push_back(cur);
+      if (cur->message_id <= from) {
+        last_right_pos = stack.size();
+        cur = cur->right.get();
+      } else {
+        cur = cur->left.get();
+      }
+    }
+    stack.resize(last_right_pos);
+
+    int64 sum = 0;
+    while (!stack.empty() && count-- > 0) {
+      cur = stack.back();
+      sum += cur->message_id;
+      if (cur->right == nullptr) {
+        while (true) {
+          stack.pop_back();
+          if (stack.empty() || stack.back()->left.get() == cur) {
+            break;
+          }
+          cur = stack.back();
+        }
+        continue;
+      }
+      cur = cur->right.get();
+      while (cur != nullptr) {
+        stack.push_back(cur);
+        cur = cur->left.get();
+      }
+    }
+    return sum;
+  }
+
+ private:
+  unique_ptr<MessageStub> root_;
+};
+
+class MessagesChunkedMap {
+ public:
+  static string get_name() {
+    return "ChunkedSortedMap";
+  }
+
+  void insert(unique_ptr<MessageStub> message) {
+    auto message_id = message->message_id;
+    map_.insert(message_id, std::move(message));
+  }
+
+  unique_ptr<MessageStub> extract(int64 message_id) {
+    return map_.extract(message_id);
+  }
+
+  int64 scan(int64 from, int count) const {
+    int64 sum = 0;
+    for (auto it = map_.find_less_or_equal(from); it && count-- > 0; ++it) {
+      sum += it.value()->message_id;
+    }
+    return sum;
+  }
+
+ private:
+  ChunkedSortedMap<int64, unique_ptr<MessageStub>> map_;
+};
+
+// new messages are mostly appended to the end of history, but sometimes older messages are loaded too
+static std::vector<int64> get_message_ids(int n) {
+  std::vector<int64> message_ids(n);
+  for (int i = 0; i < n; i++) {
+    message_ids[i] = (static_cast<int64>(i) + 1) << 20;
+  }
+  for (int i = 0; i + 1 < n; i++) {
+    if (Random::fast(0, 9) == 0) {
+      std::swap(message_ids[i], message_ids[Random::fast(i + 1, n - 1)]);
+    }
+  }
+  return message_ids;
+}
+
+template <class MessagesT>
+class MessagesInsertBench : public Benchmark {
+  std::vector<int64> message_ids_;
+
+  string get_description() const override {
+    return PSTRING() << MessagesT::get_name() << " insert";
+  }
+  void start_up_n(int n) override {
+    message_ids_ = get_message_ids(n);
+  }
+  void run(int n) override {
+    MessagesT messages;
+    for (auto message_id : message_ids_) {
+      auto message = make_unique<MessageStub>();
+      message->message_id = message_id;
+      messages.insert(std::move(message));
+    }
+  }
+};
+
+template <class MessagesT>
+class MessagesScanBench : public Benchmark {
+  static constexpr int MESSAGE_COUNT = 1000000;
+  static constexpr int SCAN_LENGTH = 100;
+  MessagesT messages_;
+
+  string get_description() const override {
+    return PSTRING() << MessagesT::get_name() << " scan of " << SCAN_LENGTH << " messages";
+  }
+  void start_up() override {
+    for (auto message_id : get_message_ids(MESSAGE_COUNT)) {
+      auto message = make_unique<MessageStub>();
+      message->message_id = message_id;
+      messages_.insert(std::move(message));
+    }
+  }
+  void run(int n) override {
+    int64 sum = 0;
+    for (int i = 0; i < n; i++) {
+      sum += messages_.scan(static_cast<int64>(Random::fast(1, MESSAGE_COUNT)) << 20, SCAN_LENGTH);
+    }
+    do_not_optimize_away(sum);
+  }
+  void tear_down() override {
+    messages_ = MessagesT();
+  }
+};
+template <class MessagesT>
+constexpr int MessagesScanBench<MessagesT>::SCAN_LENGTH;
+
+template <class MessagesT>
+class MessagesDeleteBench : public Benchmark {
+  std::vector<int64> message_ids_;
+  MessagesT messages_;
+
+  string get_description() const override {
+    return PSTRING() << MessagesT::get_name() << " delete";
+  }
+  void start_up_n(int n) override {
+    message_ids_ = get_message_ids(n);
+    for (auto message_id : message_ids_) {
+      auto message = make_unique<MessageStub>();
+      message->message_id = message_id;
+      messages_.insert(std::move(message));
+    }
+    std::random_shuffle(message_ids_.begin(), message_ids_.end());
+  }
+  void run(int n) override {
+    for (auto message_id : message_ids_) {
+      CHECK(messages_.extract(message_id) != nullptr);
+    }
+  }
+};
+
+struct SentQueryStub {
+  uint64 container_id = 0;
+  uint64 net_query_id = 0;
+  bool ack = false;
+  bool unknown = false;
+  double sent_at = 0;
+
+  SentQueryStub(uint64 container_id, uint64 net_query_id) : container_id(container_id), net_query_id(net_query_id) {
+  }
+};
+
+// std::map, which was used to store sent queries in Session before
+class SentQueriesMap {
+ public:
+  static string get_name() {
+    return "std::map";
+  }
+
+  void add(uint64 message_id) {
+    map_.emplace(message_id, SentQueryStub(message_id, message_id));
+  }
+
+  bool ack(uint64 message_id) {
+    auto it = map_.find(message_id);
+    if (it == map_.end()) {
+      return false;
+    }
+    it->second.ack = true;
+    return true;
+  }
+
+  void erase(uint64 message_id) {
+    map_.erase(message_id);
+  }
+
+ private:
+  std::map<uint64, SentQueryStub> map_;
+};
+
+class SentQueriesSlabMap {
+ public:
+  static string get_name() {
+    return "SlabMap";
+  }
+
+  void add(uint64 message_id) {
+    map_.emplace(message_id, message_id, message_id);
+  }
+
+  bool ack(uint64 message_id) {
+    auto query = map_.find(message_id);
+    if (query == nullptr) {
+      return false;
+    }
+    query->ack = true;
+    return true;
+  }
+
+  void erase(uint64 message_id) {
+    map_.erase(message_id);
+  }
+
+ private:
+  SlabMap<uint64, SentQueryStub> map_;
+};
+
+// keeps QUERY_COUNT queries in flight; each iteration sends a new query, and acks and answers a random sent query
+template <class SentQueriesT>
+class SentQueriesBench : public Benchmark {
+  static constexpr int QUERY_COUNT = 100000;
+  SentQueriesT sent_queries_;
+  std::vector<uint64> message_ids_;
+  uint64 next_message_id_ = static_cast<uint64>(1500000000) << 32;
+
+  string get_description() const override {
+    return PSTRING() << SentQueriesT::get_name() << " send, ack and answer with " << QUERY_COUNT << " queries in flight";
+  }
+  void start_up() override {
+    sent_queries_ = SentQueriesT();
+    message_ids_.clear();
+    for (int i = 0; i < QUERY_COUNT; i++) {
+      message_ids_.push_back(send());
+    }
+  }
+  void run(int n) override {
+    for (int i = 0; i < n; i++) {
+      auto &message_id = message_ids_[Random::fast(0, QUERY_COUNT - 1)];
+      CHECK(sent_queries_.ack(message_id));
+      sent_queries_.erase(message_id);
+      message_id = send();
+    }
+  }
+
+  uint64 send() {
+    next_message_id_ += 4 * Random::fast(1, 1000);
+    sent_queries_.add(next_message_id_);
+    return next_message_id_;
+  }
+};
+template <class SentQueriesT>
+constexpr int SentQueriesBench<SentQueriesT>::QUERY_COUNT;
 }  // namespace td
 
-int main() {
+BENCHMARK_SUITE(misc) {
   SET_VERBOSITY_LEVEL(VERBOSITY_NAME(DEBUG));
+  td::bench(td::MessagesInsertBench<td::MessagesTreap>());
+  td::bench(td::MessagesInsertBench<td::MessagesChunkedMap>());
+  td::bench(td::MessagesScanBench<td::MessagesTreap>());
+  td::bench(td::MessagesScanBench<td::MessagesChunkedMap>());
+  td::bench(td::MessagesDeleteBench<td::MessagesTreap>());
+  td::bench(td::MessagesDeleteBench<td::MessagesChunkedMap>());
+  td::bench(td::SentQueriesBench<td::SentQueriesMap>());
+  td::bench(td::SentQueriesBench<td::SentQueriesSlabMap>());
 #if !TD_THREAD_UNSUPPORTED
   td::bench(td::AtomicReleaseIncBench<1>());
   td::bench(td::AtomicReleaseIncBench<2>());
   td::bench(td::AtomicReleaseCasIncBench<1>());
   td::bench(td::AtomicReleaseCasIncBench<2>());
+  td::bench(td::DcInitCheckBench<td::DcInitAtomicChecker>());
+  td::bench(td::DcInitCheckBench<td::DcInitLocalChecker>());
   td::bench(td::RwMutexWriteBench<1>());
   td::bench(td::RwMutexReadBench<1>());
   td::bench(td::RwMutexWriteBench<>());
@@ -372,6 +901,8 @@ int main() {
   td::bench(td::WalkPathBench());
   td::bench(td::CreateFileBench());
   td::bench(td::PwriteBench());
+  td::bench(td::FilePartWriteBench<false>());
+  td::bench(td::FilePartWriteBench<true>());
 
   td::bench(td::CallBench());
 #if !TD_THREAD_UNSUPPORTED
@@ -388,5 +919,4 @@ int main() {
 #if TD_LINUX || TD_ANDROID || TD_TIZEN
   td::bench(td::SemBench());
 #endif
-  return 0;
 }
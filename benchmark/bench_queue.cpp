@@ -556,6 +556,7 @@ class SemCheatQueue {
 template <class QueueT>
 class QueueBenchmark2 : public td::Benchmark {
   QueueT client, server;
+  std::string name;
   int connections_n, queries_n;
 
   int server_active_connections;
@@ -564,11 +565,11 @@ class QueueBenchmark2 : public td::Benchmark {
   vector<td::int64> client_conn;
 
  public:
-  explicit QueueBenchmark2(int connections_n = 1) : connections_n(connections_n) {
+  QueueBenchmark2(std::string name, int connections_n) : name(std::move(name)), connections_n(connections_n) {
   }
 
   std::string get_description() const override {
-    return "QueueBenchmark2";
+    return PSTRING() << "QueueBenchmark2 " << name << " " << connections_n;
   }
 
   void start_up() override {
@@ -698,15 +699,16 @@ class QueueBenchmark2 : public td::Benchmark {
 template <class QueueT>
 class QueueBenchmark : public td::Benchmark {
   QueueT client, server;
+  std::string name;
   const int connections_n;
   int queries_n;
 
  public:
-  explicit QueueBenchmark(int connections_n = 1) : connections_n(connections_n) {
+  QueueBenchmark(std::string name, int connections_n) : name(std::move(name)), connections_n(connections_n) {
   }
 
   std::string get_description() const override {
-    return "QueueBenchmark";
+    return PSTRING() << "QueueBenchmark " << name << " " << connections_n;
   }
 
   void start_up() override {
@@ -893,14 +895,10 @@ class RingBenchmark : public td::Benchmark {
   }
 };
 
-int main() {
+BENCHMARK_SUITE(queue) {
   SET_VERBOSITY_LEVEL(VERBOSITY_NAME(DEBUG));
-#define BENCH_Q2(Q, N)                      \
-  std::fprintf(stderr, "!%s %d:\t", #Q, N); \
-  td::bench(QueueBenchmark2<Q>(N));
-#define BENCH_Q(Q, N)                      \
-  std::fprintf(stderr, "%s %d:\t", #Q, N); \
-  td::bench(QueueBenchmark<Q>(N));
+#define BENCH_Q2(Q, N) td::bench(QueueBenchmark2<Q>(#Q, N));
+#define BENCH_Q(Q, N) td::bench(QueueBenchmark<Q>(#Q, N));
 
 #define BENCH_R(Q)                   \
   std::fprintf(stderr, "%s:\t", #Q); \
@@ -938,6 +936,4 @@ int main() {
   // BENCH_Q(BufferQueue, 100);
   // BENCH_Q(BufferQueue, 10);
   // BENCH_Q(BufferQueue, 1);
-
-  return 0;
 }
@@ -9,14 +9,26 @@
 #include "td/telegram/MessagesDb.h"
 #include "td/telegram/UserId.h"
 
+#include "td/actor/actor.h"
+#include "td/actor/PromiseFuture.h"
+
+#include "td/db/binlog/Binlog.h"
+#include "td/db/binlog/BinlogHelper.h"
+#include "td/db/binlog/ConcurrentBinlog.h"
+#include "td/db/DbKey.h"
+
 #include "td/utils/benchmark.h"
 #include "td/utils/buffer.h"
 #include "td/utils/common.h"
 #include "td/utils/logging.h"
+#include "td/utils/port/thread.h"
 #include "td/utils/Random.h"
 #include "td/utils/Status.h"
+#include "td/utils/Time.h"
 
+#include <algorithm>
 #include <memory>
+#include <vector>
 
 namespace td {
 
@@ -29,10 +41,17 @@ static Status init_db(SqliteDb &db) {
   return Status::OK();
 }
 
+// about a quarter of messages has some media
+static int32 get_random_index_mask() {
+  return Random::fast(0, 3) == 0 ? 1 << Random::fast(0, 29) : 0;
+}
+
 class MessagesDbBench : public Benchmark {
  public:
+  explicit MessagesDbBench(bool read_after_write = false) : read_after_write_(read_after_write) {
+  }
   string get_description() const override {
-    return "MessagesDb";
+    return read_after_write_ ? "MessagesDb with read after write" : "MessagesDb";
   }
   void start_up() override {
     LOG(ERROR) << "START UP";
@@ -40,22 +59,37 @@ class MessagesDbBench : public Benchmark {
     scheduler_->start();
   }
   void run(int n) override {
-    auto guard = scheduler_->get_current_guard();
-    for (int i = 0; i < n; i += 20) {
-      auto dialog_id = DialogId{UserId{Random::fast(1, 100)}};
-      auto message_id_raw = Random::fast(1, 100000);
-      for (int j = 0; j < 20; j++) {
-        auto message_id = MessageId{ServerMessageId{message_id_raw + j}};
-        auto unique_message_id = ServerMessageId{i + 1};
-        auto sender_user_id = UserId{Random::fast(1, 1000)};
-        auto random_id = i + 1;
-        auto ttl_expires_at = 0;
-        auto data = BufferSlice(Random::fast(100, 299));
-
-        // use async on same thread.
-        messages_db_async_->add_message({dialog_id, message_id}, unique_message_id, sender_user_id, random_id,
-                                        ttl_expires_at, 0, 0, "", std::move(data), Promise<>());
+    {
+      auto guard = scheduler_->get_current_guard();
+      for (int i = 0; i < n; i += 20) {
+        auto dialog_id = DialogId{UserId{Random::fast(1, 100)}};
+        auto message_id_raw = Random::fast(1, 100000);
+        for (int j = 0; j < 20; j++) {
+          auto message_id = MessageId{ServerMessageId{message_id_raw + j}};
+          auto unique_message_id = ServerMessageId{i + 1};
+          auto sender_user_id = UserId{Random::fast(1, 1000)};
+          auto random_id = i + 1;
+          auto ttl_expires_at = 0;
+          auto index_mask = get_random_index_mask();
+          auto data = BufferSlice(Random::fast(100, 299));
+
+          // use async on same thread.
+          pending_queries_++;
+          messages_db_async_->add_message({dialog_id, message_id}, unique_message_id, sender_user_id, random_id,
+                                          ttl_expires_at, index_mask, 0, "", std::move(data),
+                                          PromiseCreator::lambda([this](Unit) { pending_queries_--; }));
+          if (read_after_write_) {
+            pending_queries_++;
+            messages_db_async_->get_message(
+                {dialog_id, message_id},
+                PromiseCreator::lambda([this](Result<BufferSlice> result) { pending_queries_--; }));
+          }
+        }
       }
+      messages_db_async_->force_flush();
+    }
+    while (pending_queries_ != 0) {
+      scheduler_->run_main(10);
     }
   }
   void tear_down() override {
@@ -77,6 +111,8 @@ class MessagesDbBench : public Benchmark {
   std::shared_ptr<SqliteConnectionSafe> sql_connection_;
   std::shared_ptr<MessagesDbSyncSafeInterface> messages_db_sync_safe_;
   std::shared_ptr<MessagesDbAsyncInterface> messages_db_async_;
+  bool read_after_write_;
+  int pending_queries_ = 0;
 
   Status do_start_up() {
     scheduler_ = std::make_unique<ConcurrentScheduler>();
@@ -99,10 +135,255 @@ class MessagesDbBench : public Benchmark {
     return Status::OK();
   }
 };
+
+class MessagesDbHistoryBench : public Benchmark {
+ public:
+  string get_description() const override {
+    return "MessagesDb history with a filter";
+  }
+  void start_up() override {
+    do_start_up().ensure();
+  }
+  void run(int n) override {
+    auto guard = scheduler_->get_current_guard();
+    auto &messages_db = messages_db_sync_safe_->get();
+    size_t loaded_count = 0;
+    for (int i = 0; i < n; i++) {
+      MessagesDbMessagesQuery query;
+      query.dialog_id = DialogId{UserId{Random::fast(1, DIALOG_COUNT)}};
+      query.index_mask = 1 << Random::fast(0, 29);
+      query.from_message_id = MessageId{ServerMessageId{Random::fast(1, MESSAGE_COUNT)}};
+      query.limit = 20;
+      loaded_count += messages_db.get_messages(query).move_as_ok().messages.size();
+    }
+    CHECK(loaded_count <= static_cast<size_t>(n) * 20);
+  }
+  void tear_down() override {
+    {
+      auto guard = scheduler_->get_current_guard();
+      messages_db_sync_safe_.reset();
+      sql_connection_->close_and_destroy();
+      sql_connection_.reset();
+    }
+    scheduler_->finish();
+    scheduler_.reset();
+  }
+
+ private:
+  static constexpr int DIALOG_COUNT = 100;
+  static constexpr int MESSAGE_COUNT = 2000;
+
+  std::unique_ptr<td::ConcurrentScheduler> scheduler_;
+  std::shared_ptr<SqliteConnectionSafe> sql_connection_;
+  std::shared_ptr<MessagesDbSyncSafeInterface> messages_db_sync_safe_;
+
+  Status do_start_up() {
+    scheduler_ = std::make_unique<ConcurrentScheduler>();
+    scheduler_->init(0);
+
+    auto guard = scheduler_->get_current_guard();
+
+    string sql_db_name = "testdb_history.sqlite";
+    SqliteDb::destroy(sql_db_name).ignore();
+    sql_connection_ = std::make_shared<SqliteConnectionSafe>(sql_db_name);
+    auto &db = sql_connection_->get();
+    TRY_STATUS(init_db(db));
+
+    db.exec("BEGIN TRANSACTION").ensure();
+    TRY_STATUS(init_messages_db(db, 0));
+    db.exec("COMMIT TRANSACTION").ensure();
+
+    messages_db_sync_safe_ = create_messages_db_sync(sql_connection_);
+    auto &messages_db = messages_db_sync_safe_->get();
+    TRY_STATUS(messages_db.begin_transaction());
+    for (int i = 1; i <= DIALOG_COUNT; i++) {
+      for (int j = 1; j <= MESSAGE_COUNT; j++) {
+        auto dialog_id = DialogId{UserId{i}};
+        auto message_id = MessageId{ServerMessageId{j}};
+        TRY_STATUS(messages_db.add_message({dialog_id, message_id}, ServerMessageId(), UserId(), 0, 0,
+                                           get_random_index_mask(), 0, "", BufferSlice(Random::fast(100, 299))));
+      }
+    }
+    TRY_STATUS(messages_db.commit_transaction());
+    return Status::OK();
+  }
+};
+
+static void print_sync_latency(Slice name, std::vector<double> latencies) {
+  if (latencies.empty()) {
+    return;
+  }
+  std::sort(latencies.begin(), latencies.end());
+  LOG(ERROR) << name << ": " << tag("syncs", latencies.size())
+             << tag("p50 sync latency", format::as_time(latencies[latencies.size() / 2]))
+             << tag("p99 sync latency", format::as_time(latencies[latencies.size() * 99 / 100]));
+}
+
+// every op is one binlog event, every SYNC_EVERY-th event is synced
+static constexpr int SYNC_EVERY = 16;
+static CSlice BINLOG_NAME("bench_binlog");
+
+class BinlogSyncBench : public Benchmark {
+ public:
+  string get_description() const override {
+    return "Binlog events with inline sync";
+  }
+  void start_up() override {
+    Binlog::destroy(BINLOG_NAME).ignore();
+    binlog_.init(BINLOG_NAME.str(), Binlog::Callback()).ensure();
+  }
+  void run(int n) override {
+    for (int i = 0; i < n; i++) {
+      binlog_.add_raw_event(BinlogEvent::create_raw(binlog_.next_id(), 1, 0, create_storer(Slice(data_))));
+      if ((i + 1) % SYNC_EVERY == 0) {
+        auto start = Time::now();
+        binlog_.sync();
+        latencies_.push_back(Time::now() - start);
+      }
+    }
+  }
+  void tear_down() override {
+    binlog_.close().ensure();
+    Binlog::destroy(BINLOG_NAME).ignore();
+  }
+  ~BinlogSyncBench() override {
+    print_sync_latency(get_description(), std::move(latencies_));
+  }
+
+ private:
+  Binlog binlog_;
+  string data_ = string(100, 'a');
+  std::vector<double> latencies_;
+};
+
+class ConcurrentBinlogSyncBench : public Benchmark {
+ public:
+  string get_description() const override {
+    return "ConcurrentBinlog events with group commit";
+  }
+  void start_up() override {
+    Binlog::destroy(BINLOG_NAME).ignore();
+    scheduler_ = std::make_unique<ConcurrentScheduler>();
+    scheduler_->init(0);
+  }
+  void run(int n) override {
+    scheduler_->create_actor_unsafe<Writer>(0, "Writer", n, &latencies_).release();
+    scheduler_->start();
+    while (scheduler_->run_main(10)) {
+      // empty
+    }
+  }
+  void tear_down() override {
+    scheduler_->finish();
+    scheduler_.reset();
+    Binlog::destroy(BINLOG_NAME).ignore();
+  }
+  ~ConcurrentBinlogSyncBench() override {
+    print_sync_latency(get_description(), std::move(latencies_));
+  }
+
+ private:
+  class Writer : public Actor {
+   public:
+    Writer(int n, std::vector<double> *latencies) : n_(n), latencies_(latencies) {
+    }
+
+   private:
+    int n_;
+    std::vector<double> *latencies_;
+    ConcurrentBinlog binlog_;
+    int pending_syncs_ = 0;
+    bool is_closed_ = false;
+
+    void start_up() override {
+      binlog_.init(BINLOG_NAME.str(), ConcurrentBinlog::Callback()).ensure();
+      string data(100, 'a');
+      for (int i = 0; i < n_; i++) {
+        BinlogHelper::add(&binlog_, 1, create_storer(Slice(data)));
+        if ((i + 1) % SYNC_EVERY == 0) {
+          pending_syncs_++;
+          binlog_.force_sync(
+              PromiseCreator::lambda([actor_id = actor_id(this), start = Time::now()](Unit) {
+                send_closure(actor_id, &Writer::on_synced, Time::now() - start);
+              }));
+        }
+      }
+      try_close();
+    }
+
+    void on_synced(double latency) {
+      latencies_->push_back(latency);
+      pending_syncs_--;
+      try_close();
+    }
+
+    void try_close() {
+      if (pending_syncs_ != 0 || is_closed_) {
+        return;
+      }
+      is_closed_ = true;
+      binlog_.close(PromiseCreator::lambda([](Unit) { Scheduler::instance()->finish(); }));
+      stop();
+    }
+  };
+
+  std::unique_ptr<ConcurrentScheduler> scheduler_;
+  std::vector<double> latencies_;
+};
+
+static CSlice STARTUP_BINLOG_NAME("bench_startup_binlog");
+
+static void create_startup_binlog(const DbKey &db_key, int64 size) {
+  Binlog::destroy(STARTUP_BINLOG_NAME).ignore();
+  Binlog binlog;
+  binlog.init(STARTUP_BINLOG_NAME.str(), Binlog::Callback(), db_key).ensure();
+  string data(1000, 'a');
+  for (int64 i = 0; i * static_cast<int64>(data.size()) < size; i++) {
+    binlog.add_raw_event(BinlogEvent::create_raw(binlog.next_id(), 1, 0, create_storer(Slice(data))));
+  }
+  binlog.close().ensure();
+}
+
+// every op is one full load of the binlog created by create_startup_binlog
+class BinlogStartupBench : public Benchmark {
+ public:
+  BinlogStartupBench(DbKey db_key, int32 load_threads_n) : db_key_(std::move(db_key)), load_threads_n_(load_threads_n) {
+  }
+
+  string get_description() const override {
+    return PSTRING() << "Binlog startup" << (db_key_.is_empty() ? "" : " encrypted") << " [threads:" << load_threads_n_
+                     << "]";
+  }
+  void run(int n) override {
+    for (int i = 0; i < n; i++) {
+      size_t events_n = 0;
+      Binlog binlog;
+      binlog.set_load_threads_n(load_threads_n_);
+      binlog.init(STARTUP_BINLOG_NAME.str(), [&](const BinlogEvent &event) { events_n++; }, db_key_).ensure();
+      binlog.close().ensure();
+      CHECK(events_n != 0);
+    }
+  }
+
+ private:
+  DbKey db_key_;
+  int32 load_threads_n_;
+};
 }  // namespace td
 
-int main() {
+BENCHMARK_SUITE(tddb) {
   SET_VERBOSITY_LEVEL(VERBOSITY_NAME(WARNING));
   bench(td::MessagesDbBench());
-  return 0;
+  bench(td::MessagesDbBench(true));
+  bench(td::MessagesDbHistoryBench());
+  bench(td::BinlogSyncBench());
+  bench(td::ConcurrentBinlogSyncBench());
+
+  auto load_threads_n = static_cast<td::int32>(td::thread::hardware_concurrency());
+  for (auto db_key : {td::DbKey::empty(), td::DbKey::raw_key(std::string(32, 'A'))}) {
+    td::create_startup_binlog(db_key, 256 << 20);
+    bench(td::BinlogStartupBench(db_key, 1));
+    bench(td::BinlogStartupBench(db_key, load_threads_n));
+  }
+  td::Binlog::destroy(td::STARTUP_BINLOG_NAME).ignore();
 }
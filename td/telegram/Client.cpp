@@ -241,7 +241,8 @@ class Client::Impl final : ObserverBase {
     output_queue_ = std::make_shared<OutputQueue>();
     output_queue_->init();
     scheduler_ = std::make_shared<ConcurrentScheduler>();
-    scheduler_->init(3);
+    // database reader schedulers are started only if the message database is used
+    scheduler_->init(6, {5, 6});
     scheduler_->create_actor_unsafe<TdProxy>(0, "TdProxy", input_queue_, output_queue_).release();
     scheduler_->start();
 
@@ -14,34 +14,89 @@
 #include "td/utils/format.h"
 #include "td/utils/JsonBuilder.h"
 #include "td/utils/logging.h"
+#include "td/utils/Parser.h"
 #include "td/utils/Status.h"
+#include "td/utils/StringBuilder.h"
 
 #include <algorithm>
 
 namespace td {
 
+namespace {
+constexpr int32 MAX_JSON_DEPTH = 100;
+
+// returns raw text of the top-level "@extra" field, which is passed to the response as is
+Result<Slice> get_json_extra(MutableSlice request) {
+  Parser parser(request);
+  parser.skip_whitespaces();
+  if (!parser.try_skip('{')) {
+    return Status::Error("Expected an object");
+  }
+  parser.skip_whitespaces();
+  if (parser.try_skip('}')) {
+    return Slice();
+  }
+  while (!parser.empty()) {
+    auto key_begin = parser.ptr();
+    TRY_STATUS(json_string_skip(parser));
+    auto key = Slice(key_begin, parser.ptr());
+    parser.skip_whitespaces();
+    if (!parser.try_skip(':')) {
+      return Status::Error("':' expected");
+    }
+    parser.skip_whitespaces();
+    auto value_begin = parser.ptr();
+    TRY_STATUS(do_json_skip(parser, MAX_JSON_DEPTH));
+    if (key == "\"@extra\"") {
+      return Slice(value_begin, parser.ptr());
+    }
+    parser.skip_whitespaces();
+    if (!parser.try_skip(',')) {
+      break;
+    }
+    parser.skip_whitespaces();
+  }
+  return Slice();
+}
+}  // namespace
+
+TD_THREAD_LOCAL std::string *ClientJson::current_input_;
+
 Result<Client::Request> ClientJson::to_request(Slice request) {
-  auto request_str = request.str();
+  // the request is decoded in place, so it is copied to a reusable buffer
+  init_thread_local<std::string>(current_input_);
+  auto &request_str = *current_input_;
+  request_str.assign(request.begin(), request.size());
+
+  // the request is decoded in place and the buffer is reused by the next request before the response is received,
+  // so the only copy of "@extra" is made here and then moved to extra_; short values don't allocate memory
+  TRY_RESULT(raw_extra, get_json_extra(request_str));
+  auto extra = raw_extra.str();
+
   TRY_RESULT(json_value, json_decode(request_str));
   if (json_value.type() != JsonValue::Type::Object) {
     return Status::Error("Expected an object");
   }
-  TRY_RESULT(extra_field, get_json_object_field(json_value.get_object(), "@extra", JsonValue::Type::Null, true));
-  std::uint64_t extra_id = extra_id_.fetch_add(1, std::memory_order_relaxed);
-  auto extra_str = json_encode<string>(extra_field);
-  if (!extra_str.empty()) {
-    std::lock_guard<std::mutex> guard(mutex_);
-    extra_[extra_id] = std::move(extra_str);
+  if (extra.empty() && has_json_object_field(json_value.get_object(), "@extra")) {
+    // the key contains escaped characters
+    TRY_RESULT(extra_field, get_json_object_field(json_value.get_object(), "@extra", JsonValue::Type::Null, true));
+    extra = json_encode<string>(extra_field);
   }
 
   td_api::object_ptr<td_api::Function> func;
   TRY_STATUS(from_json(func, json_value));
+
+  std::uint64_t extra_id = extra_id_.fetch_add(1, std::memory_order_relaxed);
+  if (!extra.empty()) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    extra_[extra_id] = std::move(extra);
+  }
   return Client::Request{extra_id, std::move(func)};
 }
 
-std::string ClientJson::from_response(Client::Response response) {
-  auto str = json_encode<string>(ToJson(static_cast<td_api::Object &>(*response.object)));
-  CHECK(!str.empty() && str.back() == '}');
+TD_THREAD_LOCAL std::string *ClientJson::current_output_;
+
+CSlice ClientJson::from_response(Client::Response response) {
   std::string extra;
   if (response.id != 0) {
     std::lock_guard<std::mutex> guard(mutex_);
@@ -51,21 +106,54 @@ std::string ClientJson::from_response(Client::Response response) {
       extra_.erase(it);
     }
   }
-  if (!extra.empty()) {
-    str.pop_back();
-    str.reserve(str.size() + 10 + extra.size());
-    str += ",\"@extra\":";
-    str += extra;
-    str += "}";
+  Slice extra_value = extra;
+  if (response.id != 0 && extra_value.empty()) {
+    // responses to requests without "@extra" have "@extra":null
+    extra_value = Slice("null");
   }
-  return str;
-}
 
-TD_THREAD_LOCAL std::string *ClientJson::current_output_;
-CSlice ClientJson::store_string(std::string str) {
-  init_thread_local<std::string>(ClientJson::current_output_);
-  *current_output_ = std::move(str);
-  return *current_output_;
+  // the response is stored directly to the reusable buffer; the previous response isn't needed anymore,
+  // so the memory left after an exceptionally big response is freed
+  init_thread_local<std::string>(current_output_);
+  auto &output = *current_output_;
+  if (output.size() > MAX_KEPT_OUTPUT_BUFFER_SIZE) {
+    std::string().swap(output);
+  }
+  if (output.size() < MIN_OUTPUT_BUFFER_SIZE) {
+    output.resize(MIN_OUTPUT_BUFFER_SIZE);
+  }
+  auto store_json = [&] {
+    JsonBuilder jb(StringBuilder(MutableSlice(&output[0], output.size())));
+    jb.enter_value() << ToJson(static_cast<td_api::Object &>(*response.object));
+    return jb.string_builder();
+  };
+  auto sb = store_json();
+  if (sb.is_error()) {
+    // the buffer is too small, but the exact size of the response is known now
+    output.resize(sb.get_required_size() + MIN_OUTPUT_BUFFER_SIZE);
+    sb = store_json();
+    CHECK(!sb.is_error());
+  }
+  Slice json = sb.as_cslice();
+  CHECK(!json.empty() && json.back() == '}');
+
+  if (extra_value.empty()) {
+    return CSlice(json.begin(), json.end());
+  }
+  Slice extra_prefix(",\"@extra\":");
+  auto size = json.size() - 1;
+  auto new_size = size + extra_prefix.size() + extra_value.size() + 1;
+  if (output.size() <= new_size) {
+    output.resize(new_size + 1);
+  }
+  auto *ptr = &output[0];
+  MutableSlice(ptr + size, extra_prefix.size()).copy_from(extra_prefix);
+  size += extra_prefix.size();
+  MutableSlice(ptr + size, extra_value.size()).copy_from(extra_value);
+  size += extra_value.size();
+  ptr[size++] = '}';
+  ptr[size] = '\0';
+  return CSlice(ptr, ptr + size);
 }
 
 void ClientJson::send(Slice request) {
@@ -83,7 +171,7 @@ CSlice ClientJson::receive(double timeout) {
   if (!response.object) {
     return {};
   }
-  return store_string(from_response(std::move(response)));
+  return from_response(std::move(response));
 }
 
 CSlice ClientJson::execute(Slice request) {
@@ -93,7 +181,7 @@ CSlice ClientJson::execute(Slice request) {
     return {};
   }
 
-  return store_string(from_response(Client::execute(r_request.move_as_ok())));
+  return from_response(Client::execute(r_request.move_as_ok()));
 }
 
 }  // namespace td
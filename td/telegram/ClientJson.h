@@ -34,11 +34,13 @@ class ClientJson final {
   std::mutex mutex_;  // for extra_
   std::unordered_map<std::int64_t, std::string> extra_;
   std::atomic<std::uint64_t> extra_id_{1};
+  static TD_THREAD_LOCAL std::string *current_input_;
   static TD_THREAD_LOCAL std::string *current_output_;
 
-  CSlice store_string(std::string str);
+  static constexpr size_t MIN_OUTPUT_BUFFER_SIZE = 1 << 12;
+  static constexpr size_t MAX_KEPT_OUTPUT_BUFFER_SIZE = 1 << 20;
 
   Result<Client::Request> to_request(Slice request);
-  std::string from_response(Client::Response response);
+  CSlice from_response(Client::Response response);
 };
 }  // namespace td
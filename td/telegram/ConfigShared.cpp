@@ -55,7 +55,8 @@ std::unordered_map<string, string> ConfigShared::get_options() const {
 }
 
 bool ConfigShared::get_option_boolean(Slice name) const {
-  auto value = get_option(name);
+  auto buffer = config_pmc_->get_view(name);
+  auto value = buffer.as_slice();
   if (value.empty()) {
     return false;
   }
@@ -70,7 +71,8 @@ bool ConfigShared::get_option_boolean(Slice name) const {
 }
 
 int32 ConfigShared::get_option_integer(Slice name, int32 default_value) const {
-  auto str_value = get_option(name);
+  auto buffer = config_pmc_->get_view(name);
+  auto str_value = buffer.as_slice();
   if (str_value.empty()) {
     return default_value;
   }
@@ -82,7 +84,7 @@ int32 ConfigShared::get_option_integer(Slice name, int32 default_value) const {
 }
 
 tl_object_ptr<td_api::OptionValue> ConfigShared::get_option_value(Slice value) const {
-  return get_option_value_object(get_option(value));
+  return get_option_value_object(config_pmc_->get_view(value).as_slice());
 }
 
 bool ConfigShared::set_option(Slice name, Slice value) {
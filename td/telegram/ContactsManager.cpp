@@ -5596,6 +5596,9 @@ void ContactsManager::update_user(User *u, UserId user_id, bool from_binlog, boo
   if (u->is_name_changed || u->is_username_changed || u->is_outbound_link_changed) {
     update_contacts_hints(u, user_id, from_database);
   }
+  if (u->is_name_changed || u->is_username_changed || u->is_status_changed) {
+    update_users_hints(u, user_id);
+  }
   if (u->is_name_changed) {
     td_->messages_manager_->on_dialog_title_updated(DialogId(user_id));
     auto it = secret_chats_with_user_.find(user_id);
@@ -7477,6 +7480,14 @@ void ContactsManager::on_update_channel_is_all_history_available(ChannelId chann
   }
 }
 
+void ContactsManager::update_users_hints(const User *u, UserId user_id) {
+  int64 key = user_id.get();
+  if (u->is_name_changed || u->is_username_changed) {
+    users_hints_.add(key, u->first_name + " " + u->last_name + " " + u->username);
+  }
+  users_hints_.set_rating(key, -u->was_online);
+}
+
 void ContactsManager::update_contacts_hints(const User *u, UserId user_id, bool from_database) {
   bool is_contact = u->outbound == LinkState::Contact && user_id != get_my_id("update_contacts_hints");
   if (td_->auth_manager_->is_bot()) {
@@ -8253,18 +8264,8 @@ void ContactsManager::on_update_secret_chat(SecretChatId secret_chat_id, int64 a
 
 std::pair<int32, vector<UserId>> ContactsManager::search_among_users(const vector<UserId> &user_ids,
                                                                      const string &query, int32 limit) {
-  Hints hints;  // TODO cache Hints
-
-  for (auto user_id : user_ids) {
-    auto u = get_user(user_id);
-    if (u == nullptr) {
-      continue;
-    }
-    hints.add(user_id.get(), u->first_name + " " + u->last_name + " " + u->username);
-    hints.set_rating(user_id.get(), -u->was_online);
-  }
-
-  auto result = hints.search(query, limit, true);
+  auto keys = transform(user_ids, [](UserId user_id) { return static_cast<int64>(user_id.get()); });
+  auto result = users_hints_.search_among(query, limit, std::move(keys));
   return {narrow_cast<int32>(result.first),
           transform(result.second, [](int64 key) { return UserId(narrow_cast<int32>(key)); })};
 }
@@ -882,6 +882,8 @@ class ContactsManager : public Actor {
 
   void update_contacts_hints(const User *u, UserId user_id, bool from_database);
 
+  void update_users_hints(const User *u, UserId user_id);
+
   void save_next_contacts_sync_date();
 
   void save_contacts_to_database();
@@ -1024,7 +1026,9 @@ class ContactsManager : public Actor {
 
   bool are_contacts_loaded_ = false;
   int32 next_contacts_sync_date_ = 0;
-  Hints contacts_hints_;  // search contacts by first name, last name and username
+  Hints<int64, int64> contacts_hints_;  // search contacts by first name, last name and username
+  Hints<int64, int64> users_hints_;     // search all known users by first name, last name and username,
+                                        // rated by last online time
   vector<Promise<Unit>> load_contacts_queries_;
   MultiPromiseActor load_contact_users_multipromise_;
   int32 saved_contact_count_ = -1;
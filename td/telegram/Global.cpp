@@ -61,12 +61,31 @@ void Global::set_mtproto_header(std::unique_ptr<MtprotoHeader> mtproto_header) {
   mtproto_header_ = std::move(mtproto_header);
 }
 
+void Global::init_scheduler_ids(bool use_database_readers) {
+  auto current_scheduler_id = Scheduler::instance()->sched_id();
+  auto max_scheduler_id = Scheduler::instance()->sched_count() - 1;
+  database_scheduler_id_ = std::min(current_scheduler_id + 1, max_scheduler_id);
+  gc_scheduler_id_ = std::min(current_scheduler_id + 2, max_scheduler_id);
+  slow_net_scheduler_id_ = std::min(current_scheduler_id + 3, max_scheduler_id);
+  file_io_scheduler_id_ = std::min(current_scheduler_id + 4, max_scheduler_id);
+
+  // readers are created only if there are spare schedulers, otherwise reads are done by the database writer
+  database_reader_scheduler_ids_.clear();
+  if (!use_database_readers) {
+    return;
+  }
+  auto first_reader_scheduler_id = current_scheduler_id + 5;
+  auto last_reader_scheduler_id =
+      std::min(first_reader_scheduler_id + MAX_DATABASE_READER_SCHEDULER_COUNT - 1, max_scheduler_id);
+  for (auto scheduler_id = first_reader_scheduler_id; scheduler_id <= last_reader_scheduler_id; scheduler_id++) {
+    database_reader_scheduler_ids_.push_back(scheduler_id);
+    Scheduler::instance()->start_scheduler(scheduler_id);
+  }
+}
+
 Status Global::init(const TdParameters &parameters, ActorId<Td> td, std::unique_ptr<TdDb> td_db) {
   parameters_ = parameters;
 
-  gc_scheduler_id_ = std::min(Scheduler::instance()->sched_id() + 2, Scheduler::instance()->sched_count() - 1);
-  slow_net_scheduler_id_ = std::min(Scheduler::instance()->sched_id() + 3, Scheduler::instance()->sched_count() - 1);
-
   td_ = td;
   td_db_ = std::move(td_db);
 
@@ -228,6 +228,14 @@ class Global : public ActorContext {
     my_id_ = my_id;
   }
 
+  // must be called on the scheduler of Td before the database is opened
+  // database readers are used only with the message database; their schedulers are started on demand
+  void init_scheduler_ids(bool use_database_readers);
+
+  int32 get_database_scheduler_id() const {
+    return database_scheduler_id_;
+  }
+
   int32 get_gc_scheduler_id() const {
     return gc_scheduler_id_;
   }
@@ -236,6 +244,15 @@ class Global : public ActorContext {
     return slow_net_scheduler_id_;
   }
 
+  int32 get_file_io_scheduler_id() const {
+    return file_io_scheduler_id_;
+  }
+
+  // schedulers, which are used only by database readers, so long queries don't block other actors
+  const std::vector<int32> &get_database_reader_scheduler_ids() const {
+    return database_reader_scheduler_ids_;
+  }
+
 #if !TD_HAVE_ATOMIC_SHARED_PTR
   std::mutex dh_config_mutex_;
 #endif
@@ -305,8 +322,12 @@ class Global : public ActorContext {
   std::unique_ptr<MtprotoHeader> mtproto_header_;
 
   TdParameters parameters_;
-  int32 gc_scheduler_id_;
-  int32 slow_net_scheduler_id_;
+  static constexpr int32 MAX_DATABASE_READER_SCHEDULER_COUNT = 2;
+  int32 database_scheduler_id_ = 0;
+  int32 gc_scheduler_id_ = 0;
+  int32 slow_net_scheduler_id_ = 0;
+  int32 file_io_scheduler_id_ = 0;
+  std::vector<int32> database_reader_scheduler_ids_;
 
   std::atomic<double> server_time_difference_;
   std::atomic<bool> server_time_difference_was_updated_;
@@ -26,7 +26,7 @@ class HashtagHints : public Actor {
 
  private:
   string mode_;
-  Hints hints_;
+  Hints<int64, int64> hints_;
   bool sync_with_db_ = false;
   int64 counter_ = 0;
 
@@ -0,0 +1,114 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2017
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "td/utils/common.h"
+#include "td/utils/logging.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace td {
+
+namespace detail {
+// unloads items in the order of their last access date, until size is reduced to target_size;
+// unload_item must return the number of unloaded messages; returns the new size
+template <class ItemT, class UnloadItemT>
+int32 unload_least_recently_used(vector<std::pair<int32, ItemT>> items, int32 size, int32 target_size,
+                                 UnloadItemT &&unload_item) {
+  std::stable_sort(items.begin(), items.end(),
+                   [](const std::pair<int32, ItemT> &lhs, const std::pair<int32, ItemT> &rhs) {
+                     return lhs.first < rhs.first;
+                   });
+  for (auto &item : items) {
+    if (size <= target_size) {
+      break;
+    }
+    size -= unload_item(item.second);
+  }
+  return size;
+}
+}  // namespace detail
+
+// counts messages kept in memory and chooses chats, whose messages are unloaded, if there are too many of them
+class MessageCache {
+ public:
+  static constexpr int32 MIN_MAX_SIZE = 100;
+
+  // returns true, if the cache needs to be reduced after new messages were loaded
+  bool on_loaded_message_count_changed(int32 diff) {
+    size_ += diff;
+    CHECK(size_ >= 0);
+    return diff > 0 && need_reduce();
+  }
+
+  // returns true, if the cache needs to be reduced after the change of the maximum size
+  bool set_max_size(int32 max_size) {
+    if (max_size < 0) {
+      max_size = 0;
+    }
+    if (max_size > 0 && max_size < MIN_MAX_SIZE) {
+      max_size = MIN_MAX_SIZE;
+    }
+    if (max_size == max_size_) {
+      return false;
+    }
+    max_size_ = max_size;
+    return need_reduce();
+  }
+
+  int32 get_size() const {
+    return size_;
+  }
+
+  int32 get_max_size() const {
+    return max_size_;
+  }
+
+  bool need_reduce() const {
+    return max_size_ > 0 && size_ > max_size_;
+  }
+
+  // unloads messages from the least recently used chats, which aren't opened;
+  // dialogs is a map to pointers to chats with is_opened, loaded_message_count and last_access_date;
+  // unload_dialog must unload all messages, which can be unloaded, and report them through
+  // on_loaded_message_count_changed; returns the number of chats, which were unloaded
+  template <class DialogsT, class UnloadDialogT>
+  size_t reduce(const DialogsT &dialogs, UnloadDialogT &&unload_dialog) {
+    if (!need_reduce()) {
+      return 0;
+    }
+
+    // unload more than needed to not do this after each new message
+    int32 target_size = max_size_ - max_size_ / 4;
+
+    using DialogPtr = decltype(&*dialogs.begin()->second);
+    vector<std::pair<int32, DialogPtr>> items;
+    for (auto &it : dialogs) {
+      auto d = &*it.second;
+      if (!d->is_opened && d->loaded_message_count > 0) {
+        items.emplace_back(d->last_access_date, d);
+      }
+    }
+
+    size_t unloaded_dialog_count = 0;
+    auto new_size = detail::unload_least_recently_used(std::move(items), size_, target_size, [&](DialogPtr d) {
+      auto old_size = size_;
+      unload_dialog(d);
+      unloaded_dialog_count++;
+      return old_size - size_;
+    });
+    CHECK(new_size == size_);
+    return unloaded_dialog_count;
+  }
+
+ private:
+  int32 size_ = 0;
+  int32 max_size_ = 0;  // 0 means no limit
+};
+
+}  // namespace td
@@ -9,9 +9,11 @@
 #include "td/telegram/logevent/LogEvent.h"
 #include "td/telegram/Version.h"
 
+#include "td/db/AdaptiveBatcher.h"
 #include "td/db/SqliteDb.h"
 #include "td/db/SqliteStatement.h"
 
+#include "td/actor/MultiPromise.h"
 #include "td/actor/PromiseFuture.h"
 
 #include "td/utils/format.h"
@@ -30,11 +32,24 @@
 #include <iterator>
 #include <limits>
 #include <tuple>
+#include <unordered_map>
+#include <unordered_set>
 
 namespace td {
 
 static constexpr int32 MESSAGES_DB_INDEX_COUNT = 30;
-static constexpr int32 MESSAGES_DB_INDEX_COUNT_OLD = 9;
+
+// returns "VALUES (0), (1), ..., (MESSAGES_DB_INDEX_COUNT - 1)" to enumerate bits of index_mask inside of SQL queries
+static string get_message_index_ids() {
+  string result = "VALUES ";
+  for (int32 i = 0; i < MESSAGES_DB_INDEX_COUNT; i++) {
+    if (i != 0) {
+      result += ", ";
+    }
+    result += PSTRING() << '(' << i << ')';
+  }
+  return result;
+}
 
 // NB: must happen inside a transaction
 Status init_messages_db(SqliteDb &db, int32 version) {
@@ -49,12 +64,46 @@ Status init_messages_db(SqliteDb &db, int32 version) {
     version = 0;
   }
 
-  auto add_media_indices = [&db](int begin, int end) {
-    for (int i = begin; i < end; i++) {
-      TRY_STATUS(db.exec(PSLICE() << "CREATE INDEX IF NOT EXISTS message_index_" << i
-                                  << " ON messages (dialog_id, message_id) WHERE (index_mask & " << (1 << i)
-                                  << ") != 0"));
-    }
+  // all columns, which are used in queries, are stored before the big data blob, so they can be read
+  // without loading of overflow pages; row_id is an alias for rowid, so it isn't changed by VACUUM
+  auto create_messages_table = [&db](Slice table_name) {
+    return db.exec(PSLICE() << "CREATE TABLE IF NOT EXISTS " << table_name
+                            << " (row_id INTEGER PRIMARY KEY, dialog_id INT8, message_id INT8, unique_message_id INT4, "
+                               "sender_user_id INT4, random_id INT8, ttl_expires_at INT4, index_mask INT4, "
+                               "search_id INT8, text STRING, data BLOB, UNIQUE (dialog_id, message_id))");
+  };
+
+  auto add_indices = [&db] {
+    TRY_STATUS(
+        db.exec("CREATE INDEX IF NOT EXISTS message_by_random_id ON messages (dialog_id, random_id) "
+                "WHERE random_id IS NOT NULL"));
+    TRY_STATUS(
+        db.exec("CREATE INDEX IF NOT EXISTS message_by_unique_message_id ON messages "
+                "(unique_message_id) WHERE unique_message_id IS NOT NULL"));
+
+    TRY_STATUS(
+        db.exec("CREATE INDEX IF NOT EXISTS message_by_ttl ON messages "
+                "(ttl_expires_at) WHERE ttl_expires_at IS NOT NULL"));
+    return Status::OK();
+  };
+
+  // one composite key per set bit of index_mask instead of a separate partial index for each bit,
+  // so adding of a message updates only one B-tree; row_id allows to find the message with one lookup
+  auto add_media_index = [&db] {
+    TRY_STATUS(
+        db.exec("CREATE TABLE IF NOT EXISTS message_media_index (dialog_id INT8, index_id INT4, message_id INT8, "
+                "row_id INT8, PRIMARY KEY (dialog_id, index_id, message_id)) WITHOUT ROWID"));
+    auto index_ids = get_message_index_ids();
+    TRY_STATUS(db.exec(PSLICE() << "CREATE TRIGGER IF NOT EXISTS trigger_media_index_insert AFTER INSERT ON messages "
+                                   "WHEN NEW.index_mask IS NOT NULL BEGIN INSERT INTO message_media_index SELECT "
+                                   "NEW.dialog_id, column1, NEW.message_id, NEW.row_id FROM ("
+                                << index_ids << ") WHERE (NEW.index_mask & (1 << column1)) != 0; END"));
+    TRY_STATUS(db.exec(PSLICE() << "CREATE TRIGGER IF NOT EXISTS trigger_media_index_delete BEFORE DELETE ON messages "
+                                   "WHEN OLD.index_mask IS NOT NULL BEGIN DELETE FROM message_media_index WHERE "
+                                   "dialog_id = OLD.dialog_id AND index_id IN (SELECT column1 FROM ("
+                                << index_ids
+                                << ") WHERE (OLD.index_mask & (1 << column1)) != 0) AND message_id = OLD.message_id; "
+                                   "END"));
     return Status::OK();
   };
 
@@ -93,24 +142,11 @@ Status init_messages_db(SqliteDb &db, int32 version) {
 
   if (version == 0) {
     LOG(INFO) << "Create new messages db";
-    TRY_STATUS(
-        db.exec("CREATE TABLE IF NOT EXISTS messages (dialog_id INT8, message_id INT8, "
-                "unique_message_id INT4, sender_user_id INT4, random_id INT8, data BLOB, "
-                "ttl_expires_at INT4, index_mask INT4, search_id INT8, text STRING, PRIMARY KEY "
-                "(dialog_id, message_id))"));
-
-    TRY_STATUS(
-        db.exec("CREATE INDEX IF NOT EXISTS message_by_random_id ON messages (dialog_id, random_id) "
-                "WHERE random_id IS NOT NULL"));
-    TRY_STATUS(
-        db.exec("CREATE INDEX IF NOT EXISTS message_by_unique_message_id ON messages "
-                "(unique_message_id) WHERE unique_message_id IS NOT NULL"));
+    TRY_STATUS(create_messages_table("messages"));
 
-    TRY_STATUS(
-        db.exec("CREATE INDEX IF NOT EXISTS message_by_ttl ON messages "
-                "(ttl_expires_at) WHERE ttl_expires_at IS NOT NULL"));
+    TRY_STATUS(add_indices());
 
-    TRY_STATUS(add_media_indices(0, MESSAGES_DB_INDEX_COUNT));
+    TRY_STATUS(add_media_index());
 
     TRY_STATUS(add_fts());
 
@@ -120,17 +156,35 @@ Status init_messages_db(SqliteDb &db, int32 version) {
   }
   if (version < static_cast<int32>(DbVersion::MessagesDbMediaIndex)) {
     TRY_STATUS(db.exec("ALTER TABLE messages ADD COLUMN index_mask INT4"));
-    TRY_STATUS(add_media_indices(0, MESSAGES_DB_INDEX_COUNT_OLD));
-  }
-  if (version < static_cast<int32>(DbVersion::MessagesDb30MediaIndex)) {
-    TRY_STATUS(add_media_indices(MESSAGES_DB_INDEX_COUNT_OLD, MESSAGES_DB_INDEX_COUNT));
   }
   if (version < static_cast<int32>(DbVersion::MessagesDbFts)) {
     TRY_STATUS(db.exec("ALTER TABLE messages ADD COLUMN search_id INT8"));
     TRY_STATUS(db.exec("ALTER TABLE messages ADD COLUMN text STRING"));
     TRY_STATUS(add_fts());
   }
-  if (version < static_cast<int32>(DbVersion::MessagesCallIndex)) {
+  if (version < static_cast<int32>(DbVersion::MessagesDbMediaIndexTable)) {
+    LOG(WARNING) << "Rebuild messages db";
+    // the table is rewritten with the new column order;
+    // old per-bit indices and all triggers are dropped together with the old table
+    static const char *const columns =
+        "dialog_id, message_id, unique_message_id, sender_user_id, random_id, ttl_expires_at, index_mask, search_id, "
+        "text, data";
+    TRY_STATUS(create_messages_table("messages_new"));
+    TRY_STATUS(db.exec(PSLICE() << "INSERT INTO messages_new (" << columns << ") SELECT " << columns
+                                << " FROM messages"));
+    TRY_STATUS(db.exec("DROP TABLE messages"));
+    TRY_STATUS(db.exec("ALTER TABLE messages_new RENAME TO messages"));
+
+    TRY_STATUS(add_indices());
+
+    TRY_STATUS(add_media_index());
+    TRY_STATUS(db.exec(PSLICE() << "INSERT OR IGNORE INTO message_media_index SELECT dialog_id, column1, message_id, "
+                                   "row_id FROM messages, ("
+                                << get_message_index_ids()
+                                << ") WHERE index_mask IS NOT NULL AND (index_mask & (1 << column1)) != 0"));
+
+    TRY_STATUS(add_fts());
+
     TRY_STATUS(add_call_index());
   }
   return Status::OK();
@@ -139,6 +193,7 @@ Status init_messages_db(SqliteDb &db, int32 version) {
 // NB: must happen inside a transaction
 Status drop_messages_db(SqliteDb &db, int32 version) {
   LOG(WARNING) << "Drop messages db " << tag("version", version) << tag("current_db_version", current_db_version());
+  TRY_STATUS(db.exec("DROP TABLE IF EXISTS message_media_index"));
   return db.exec("DROP TABLE IF EXISTS messages");
 }
 
@@ -150,7 +205,9 @@ class MessagesDbImpl : public MessagesDbSyncInterface {
 
   Status init() {
     TRY_RESULT(add_message_stmt,
-               db_.get_statement("INSERT OR REPLACE INTO messages VALUES(?1, ?2, ?3, ?4, ?5, ?6, ?7, ?8, ?9, ?10)"));
+               db_.get_statement("INSERT OR REPLACE INTO messages (dialog_id, message_id, unique_message_id, "
+                                 "sender_user_id, random_id, data, ttl_expires_at, index_mask, search_id, text) "
+                                 "VALUES(?1, ?2, ?3, ?4, ?5, ?6, ?7, ?8, ?9, ?10)"));
     TRY_RESULT(delete_message_stmt, db_.get_statement("DELETE FROM messages WHERE dialog_id = ?1 AND message_id = ?2"));
     TRY_RESULT(delete_all_dialog_messages_stmt,
                db_.get_statement("DELETE FROM messages WHERE dialog_id = ?1 AND message_id <= ?2"));
@@ -184,15 +241,21 @@ class MessagesDbImpl : public MessagesDbSyncInterface {
 
     for (int32 i = 0; i < MESSAGES_DB_INDEX_COUNT; i++) {
       TRY_RESULT(get_messages_from_index_desc_stmt,
-                 db_.get_statement(PSLICE() << "SELECT data, message_id FROM messages WHERE dialog_id = ?1 "
-                                               "AND message_id < ?2 AND (index_mask & "
-                                            << (1 << i) << ") != 0 ORDER BY message_id DESC LIMIT ?3"));
+                 db_.get_statement(PSLICE() << "SELECT data, messages.message_id FROM message_media_index JOIN "
+                                               "messages USING (row_id) WHERE message_media_index.dialog_id = ?1 AND "
+                                               "index_id = "
+                                            << i
+                                            << " AND message_media_index.message_id < ?2 ORDER BY "
+                                               "message_media_index.message_id DESC LIMIT ?3"));
       get_messages_from_index_stmts_[i].desc_stmt_ = std::move(get_messages_from_index_desc_stmt);
 
       TRY_RESULT(get_messages_from_index_asc_stmt,
-                 db_.get_statement(PSLICE() << "SELECT data, message_id FROM messages WHERE dialog_id = ?1 "
-                                               "AND message_id > ?2 AND (index_mask & "
-                                            << (1 << i) << ") != 0 ORDER BY message_id ASC LIMIT ?3"));
+                 db_.get_statement(PSLICE() << "SELECT data, messages.message_id FROM message_media_index JOIN "
+                                               "messages USING (row_id) WHERE message_media_index.dialog_id = ?1 AND "
+                                               "index_id = "
+                                            << i
+                                            << " AND message_media_index.message_id > ?2 ORDER BY "
+                                               "message_media_index.message_id ASC LIMIT ?3"));
       get_messages_from_index_stmts_[i].asc_stmt_ = std::move(get_messages_from_index_asc_stmt);
 
       // LOG(ERROR) << get_messages_from_index_stmts_[i].explain().ok();
@@ -796,15 +859,21 @@ std::shared_ptr<MessagesDbSyncSafeInterface> create_messages_db_sync(
   class MessagesDbSyncSafe : public MessagesDbSyncSafeInterface {
    public:
     explicit MessagesDbSyncSafe(std::shared_ptr<SqliteConnectionSafe> sqlite_connection)
-        : lsls_db_([safe_connection = std::move(sqlite_connection)] {
+        : sqlite_connection_(sqlite_connection)
+        , lsls_db_([safe_connection = std::move(sqlite_connection)] {
           return std::make_unique<MessagesDbImpl>(safe_connection->get().clone());
         }) {
     }
     MessagesDbSyncInterface &get() override {
       return *lsls_db_.get();
     }
+    MessagesDbSyncInterface &get_read_only() override {
+      sqlite_connection_->get().exec("PRAGMA query_only=1").ensure();
+      return get();
+    }
 
    private:
+    std::shared_ptr<SqliteConnectionSafe> sqlite_connection_;
     LazySchedulerLocalStorage<std::unique_ptr<MessagesDbSyncInterface>> lsls_db_;
   };
   return std::make_shared<MessagesDbSyncSafe>(std::move(sqlite_connection));
@@ -812,8 +881,14 @@ std::shared_ptr<MessagesDbSyncSafeInterface> create_messages_db_sync(
 
 class MessagesDbAsync : public MessagesDbAsyncInterface {
  public:
-  MessagesDbAsync(std::shared_ptr<MessagesDbSyncSafeInterface> sync_db, int32 scheduler_id) {
-    impl_ = create_actor_on_scheduler<Impl>("MessagesDbActor", scheduler_id, std::move(sync_db));
+  MessagesDbAsync(std::shared_ptr<MessagesDbSyncSafeInterface> sync_db, int32 scheduler_id,
+                  const std::vector<int32> &reader_scheduler_ids) {
+    std::vector<ActorId<Reader>> readers;
+    for (auto reader_scheduler_id : reader_scheduler_ids) {
+      readers_.push_back(create_actor_on_scheduler<Reader>("MessagesDbReader", reader_scheduler_id, sync_db));
+      readers.push_back(readers_.back().get());
+    }
+    impl_ = create_actor_on_scheduler<Impl>("MessagesDbActor", scheduler_id, std::move(sync_db), std::move(readers));
   }
 
   void add_message(FullMessageId full_message_id, ServerMessageId unique_message_id, UserId sender_user_id,
@@ -865,7 +940,13 @@ class MessagesDbAsync : public MessagesDbAsyncInterface {
   }
 
   void close(Promise<> promise) override {
-    send_closure_later(impl_, &Impl::close, std::move(promise));
+    MultiPromiseActorSafe mpas;
+    mpas.add_promise(std::move(promise));
+    auto lock = mpas.get_promise();
+    for (auto &reader : readers_) {
+      send_closure_later(reader, &Reader::close, mpas.get_promise());
+    }
+    send_closure_later(impl_, &Impl::close, mpas.get_promise());
   }
 
   void force_flush() override {
@@ -873,13 +954,59 @@ class MessagesDbAsync : public MessagesDbAsyncInterface {
   }
 
  private:
+  // executes read queries on its own connection in parallel with the writer
+  // in WAL mode readers see the last committed state and never wait for the writer
+  class Reader : public Actor {
+   public:
+    explicit Reader(std::shared_ptr<MessagesDbSyncSafeInterface> sync_db_safe)
+        : sync_db_safe_(std::move(sync_db_safe)) {
+    }
+
+    void get_message(FullMessageId full_message_id, Promise<BufferSlice> promise) {
+      promise.set_result(sync_db_->get_message(full_message_id));
+    }
+    void get_message_by_random_id(DialogId dialog_id, int64 random_id, Promise<BufferSlice> promise) {
+      promise.set_result(sync_db_->get_message_by_random_id(dialog_id, random_id));
+    }
+    void get_dialog_message_by_date(DialogId dialog_id, MessageId first_message_id, MessageId last_message_id,
+                                    int32 date, Promise<BufferSlice> promise) {
+      promise.set_result(sync_db_->get_dialog_message_by_date(dialog_id, first_message_id, last_message_id, date));
+    }
+    void get_messages(MessagesDbMessagesQuery query, Promise<MessagesDbMessagesResult> promise) {
+      promise.set_result(sync_db_->get_messages(std::move(query)));
+    }
+    void get_calls(MessagesDbCallsQuery query, Promise<MessagesDbCallsResult> promise) {
+      promise.set_result(sync_db_->get_calls(std::move(query)));
+    }
+    void get_messages_fts(MessagesDbFtsQuery query, Promise<MessagesDbFtsResult> promise) {
+      promise.set_result(sync_db_->get_messages_fts(std::move(query)));
+    }
+
+    void close(Promise<> promise) {
+      sync_db_safe_.reset();
+      sync_db_ = nullptr;
+      promise.set_value(Unit());
+      stop();
+    }
+
+   private:
+    std::shared_ptr<MessagesDbSyncSafeInterface> sync_db_safe_;
+    MessagesDbSyncInterface *sync_db_ = nullptr;
+
+    void start_up() override {
+      sync_db_ = &sync_db_safe_->get_read_only();
+    }
+  };
+
   class Impl : public Actor {
    public:
-    explicit Impl(std::shared_ptr<MessagesDbSyncSafeInterface> sync_db_safe) : sync_db_safe_(std::move(sync_db_safe)) {
+    Impl(std::shared_ptr<MessagesDbSyncSafeInterface> sync_db_safe, std::vector<ActorId<Reader>> readers)
+        : sync_db_safe_(std::move(sync_db_safe)), readers_(std::move(readers)) {
     }
     void add_message(FullMessageId full_message_id, ServerMessageId unique_message_id, UserId sender_user_id,
                      int64 random_id, int32 ttl_expires_at, int32 index_mask, int64 search_id, string text,
                      BufferSlice data, Promise<> promise) {
+      add_pending_message(full_message_id, random_id, data.clone());
       add_write_query([=, promise = std::move(promise), data = std::move(data), text = std::move(text)](Unit) mutable {
         promise.set_result(sync_db_->add_message(full_message_id, unique_message_id, sender_user_id, random_id,
                                                  ttl_expires_at, index_mask, search_id, std::move(text),
@@ -888,6 +1015,7 @@ class MessagesDbAsync : public MessagesDbAsyncInterface {
     }
 
     void delete_message(FullMessageId full_message_id, Promise<> promise) {
+      add_pending_message(full_message_id, 0, BufferSlice(), true);
       add_write_query([=, promise = std::move(promise)](Unit) mutable {
         promise.set_result(sync_db_->delete_message(full_message_id));
       });
@@ -902,7 +1030,13 @@ class MessagesDbAsync : public MessagesDbAsyncInterface {
     }
 
     void get_message(FullMessageId full_message_id, Promise<BufferSlice> promise) {
-      add_read_query();
+      auto it = pending_messages_.find(full_message_id);
+      if (it != pending_messages_.end()) {
+        return promise.set_result(it->second.get_data());
+      }
+      if (!readers_.empty()) {
+        return send_closure(get_reader(), &Reader::get_message, full_message_id, std::move(promise));
+      }
       promise.set_result(sync_db_->get_message(full_message_id));
     }
     void get_message_by_unique_message_id(ServerMessageId unique_message_id,
@@ -911,25 +1045,48 @@ class MessagesDbAsync : public MessagesDbAsyncInterface {
       promise.set_result(sync_db_->get_message_by_unique_message_id(unique_message_id));
     }
     void get_message_by_random_id(DialogId dialog_id, int64 random_id, Promise<BufferSlice> promise) {
-      add_read_query();
+      if (random_id != 0 && pending_dialog_ids_.count(dialog_id) != 0) {
+        for (auto &it : pending_messages_) {
+          if (it.first.get_dialog_id() == dialog_id && it.second.random_id == random_id) {
+            return promise.set_result(it.second.get_data());
+          }
+        }
+      }
+      add_dialog_read_query(dialog_id);
+      if (!readers_.empty()) {
+        return send_closure(get_reader(), &Reader::get_message_by_random_id, dialog_id, random_id, std::move(promise));
+      }
       promise.set_result(sync_db_->get_message_by_random_id(dialog_id, random_id));
     }
     void get_dialog_message_by_date(DialogId dialog_id, MessageId first_message_id, MessageId last_message_id,
                                     int32 date, Promise<BufferSlice> promise) {
-      add_read_query();
+      add_dialog_read_query(dialog_id);
+      if (!readers_.empty()) {
+        return send_closure(get_reader(), &Reader::get_dialog_message_by_date, dialog_id, first_message_id,
+                            last_message_id, date, std::move(promise));
+      }
       promise.set_result(sync_db_->get_dialog_message_by_date(dialog_id, first_message_id, last_message_id, date));
     }
 
     void get_messages(MessagesDbMessagesQuery query, Promise<MessagesDbMessagesResult> promise) {
-      add_read_query();
+      add_dialog_read_query(query.dialog_id);
+      if (!readers_.empty()) {
+        return send_closure(get_reader(), &Reader::get_messages, std::move(query), std::move(promise));
+      }
       promise.set_result(sync_db_->get_messages(std::move(query)));
     }
     void get_calls(MessagesDbCallsQuery query, Promise<MessagesDbCallsResult> promise) {
       add_read_query();
+      if (!readers_.empty()) {
+        return send_closure(get_reader(), &Reader::get_calls, std::move(query), std::move(promise));
+      }
       promise.set_result(sync_db_->get_calls(std::move(query)));
     }
     void get_messages_fts(MessagesDbFtsQuery query, Promise<MessagesDbFtsResult> promise) {
       add_read_query();
+      if (!readers_.empty()) {
+        return send_closure(get_reader(), &Reader::get_messages_fts, std::move(query), std::move(promise));
+      }
       promise.set_result(sync_db_->get_messages_fts(std::move(query)));
     }
     void get_expiring_messages(int32 expire_from, int32 expire_till, int32 limit,
@@ -939,7 +1096,7 @@ class MessagesDbAsync : public MessagesDbAsyncInterface {
     }
 
     void close(Promise<> promise) {
-      do_flush();
+      do_flush(AdaptiveBatcher::FlushReason::Force);
       sync_db_safe_.reset();
       sync_db_ = nullptr;
       promise.set_value(Unit());
@@ -948,47 +1105,94 @@ class MessagesDbAsync : public MessagesDbAsyncInterface {
 
     void force_flush() {
       LOG(INFO) << "MessagesDb flushed";
-      do_flush();
+      do_flush(AdaptiveBatcher::FlushReason::Force);
     }
 
    private:
     std::shared_ptr<MessagesDbSyncSafeInterface> sync_db_safe_;
     MessagesDbSyncInterface *sync_db_ = nullptr;
 
-    static constexpr size_t MAX_PENDING_QUERIES_COUNT{50};
+    std::vector<ActorId<Reader>> readers_;
+    size_t next_reader_ = 0;
+
+    ActorId<Reader> get_reader() {
+      next_reader_ = (next_reader_ + 1) % readers_.size();
+      return readers_[next_reader_];
+    }
+
+    static constexpr size_t MIN_PENDING_QUERIES_COUNT{50};
+    static constexpr size_t MAX_PENDING_QUERIES_COUNT{1000};
     static constexpr double MAX_PENDING_QUERIES_DELAY{1};
+    AdaptiveBatcher batcher_{MIN_PENDING_QUERIES_COUNT, MAX_PENDING_QUERIES_COUNT, MAX_PENDING_QUERIES_DELAY};
     std::vector<Promise<>> pending_writes_;
     double wakeup_at_ = 0;
+
+    // last pending change of a message; reads of changed messages are served from it without a flush
+    struct PendingMessage {
+      int64 random_id = 0;
+      BufferSlice data;
+      bool is_deleted = false;
+
+      Result<BufferSlice> get_data() const {
+        if (is_deleted) {
+          return Status::Error("Not found");
+        }
+        return data.clone();
+      }
+    };
+    std::unordered_map<FullMessageId, PendingMessage, FullMessageIdHash> pending_messages_;
+    std::unordered_set<DialogId, DialogIdHash> pending_dialog_ids_;
+
+    void add_pending_message(FullMessageId full_message_id, int64 random_id, BufferSlice data,
+                             bool is_deleted = false) {
+      auto &message = pending_messages_[full_message_id];
+      message.random_id = random_id;
+      message.data = std::move(data);
+      message.is_deleted = is_deleted;
+      pending_dialog_ids_.insert(full_message_id.get_dialog_id());
+    }
+
     template <class F>
     void add_write_query(F &&f) {
       pending_writes_.push_back(PromiseCreator::lambda(std::forward<F>(f), PromiseCreator::Ignore()));
-      if (pending_writes_.size() > MAX_PENDING_QUERIES_COUNT) {
-        do_flush();
+      if (batcher_.need_flush(pending_writes_.size())) {
+        do_flush(AdaptiveBatcher::FlushReason::Size);
         wakeup_at_ = 0;
       } else if (wakeup_at_ == 0) {
-        wakeup_at_ = Time::now_cached() + MAX_PENDING_QUERIES_DELAY;
+        wakeup_at_ = Time::now_cached() + batcher_.get_delay();
       }
       if (wakeup_at_ != 0) {
         set_timeout_at(wakeup_at_);
       }
     }
     void add_read_query() {
-      do_flush();
+      do_flush(AdaptiveBatcher::FlushReason::Force);
+    }
+    // reads, which depend only on messages from the dialog, don't need to wait for writes to other dialogs
+    void add_dialog_read_query(DialogId dialog_id) {
+      if (pending_dialog_ids_.count(dialog_id) != 0) {
+        add_read_query();
+      }
     }
-    void do_flush() {
+    void do_flush(AdaptiveBatcher::FlushReason reason) {
       if (pending_writes_.empty()) {
         return;
       }
+      auto begin_time = Time::now();
       sync_db_->begin_transaction().ensure();
       for (auto &query : pending_writes_) {
         query.set_value(Unit());
       }
       sync_db_->commit_transaction().ensure();
+      batcher_.on_flushed(pending_writes_.size(), Time::now() - begin_time, reason);
       pending_writes_.clear();
+      pending_messages_.clear();
+      pending_dialog_ids_.clear();
+      wakeup_at_ = 0;
       cancel_timeout();
     }
     void timeout_expired() override {
-      do_flush();
+      do_flush(AdaptiveBatcher::FlushReason::Timeout);
     }
 
     void start_up() override {
@@ -996,11 +1200,13 @@ class MessagesDbAsync : public MessagesDbAsyncInterface {
     }
   };
   ActorOwn<Impl> impl_;
+  std::vector<ActorOwn<Reader>> readers_;
 };
 
 std::shared_ptr<MessagesDbAsyncInterface> create_messages_db_async(std::shared_ptr<MessagesDbSyncSafeInterface> sync_db,
-                                                                   int32 scheduler_id) {
-  return std::make_shared<MessagesDbAsync>(std::move(sync_db), scheduler_id);
+                                                                   int32 scheduler_id,
+                                                                   const std::vector<int32> &reader_scheduler_ids) {
+  return std::make_shared<MessagesDbAsync>(std::move(sync_db), scheduler_id, reader_scheduler_ids);
 }
 
 }  // namespace td
@@ -121,6 +121,10 @@ class MessagesDbSyncSafeInterface {
   virtual ~MessagesDbSyncSafeInterface() = default;
 
   virtual MessagesDbSyncInterface &get() = 0;
+
+  // returns the database for the current scheduler, whose connection can't modify the database;
+  // must be used only on schedulers, which don't write to the database
+  virtual MessagesDbSyncInterface &get_read_only() = 0;
 };
 
 class MessagesDbAsyncInterface {
@@ -164,6 +168,8 @@ Status drop_messages_db(SqliteDb &db, int version) TD_WARN_UNUSED_RESULT;
 std::shared_ptr<MessagesDbSyncSafeInterface> create_messages_db_sync(
     std::shared_ptr<SqliteConnectionSafe> sqlite_connection);
 
-std::shared_ptr<MessagesDbAsyncInterface> create_messages_db_async(std::shared_ptr<MessagesDbSyncSafeInterface> sync_db,
-                                                                   int32 scheduler_id);
+// read queries are executed by readers on reader_scheduler_ids after pending writes they depend on are committed
+std::shared_ptr<MessagesDbAsyncInterface> create_messages_db_async(
+    std::shared_ptr<MessagesDbSyncSafeInterface> sync_db, int32 scheduler_id,
+    const std::vector<int32> &reader_scheduler_ids = std::vector<int32>());
 };  // namespace td
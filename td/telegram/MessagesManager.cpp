@@ -3948,7 +3948,6 @@ void MessagesManager::Message::parse(ParserT &parser) {
   END_PARSE_FLAGS();
 
   parse(message_id, parser);
-  random_y = get_random_y(message_id);
   if (has_sender) {
     parse(sender_user_id, parser);
   }
@@ -4242,8 +4241,8 @@ void MessagesManager::Dialog::parse(ParserT &parser) {
   parse(last_clear_history_date, parser);
   parse(order, parser);
   if (has_last_database_message) {
-    messages = make_unique<Message>();
-    parse(*messages, parser);
+    last_database_message = make_unique<Message>();
+    parse(*last_database_message, parser);
   }
   if (has_first_database_message_id) {
     parse(first_database_message_id, parser);
@@ -4379,6 +4378,8 @@ MessagesManager::MessagesManager(Td *td, ActorShared<> parent) : td_(td), parent
   pending_unload_dialog_timeout_.set_callback(on_pending_unload_dialog_timeout_callback);
   pending_unload_dialog_timeout_.set_callback_data(static_cast<void *>(this));
 
+  on_update_message_cache_max_size();
+
   sequence_dispatcher_ = create_actor<MultiSequenceDispatcher>("multi sequence dispatcher");
 
   if (G()->parameters().use_message_db) {
@@ -5058,7 +5059,6 @@ void MessagesManager::on_update_service_notification(tl_object_ptr<telegram_api:
     CHECK(dialog_id.get_type() == DialogType::User);
     auto new_message = make_unique<Message>();
     new_message->message_id = get_next_local_message_id(d);
-    new_message->random_y = get_random_y(new_message->message_id);
     new_message->sender_user_id = dialog_id.get_user_id();
     new_message->date = update->inbox_date_;
     new_message->ttl = ttl;
@@ -5110,7 +5110,6 @@ void MessagesManager::on_update_contact_registered(tl_object_ptr<telegram_api::u
 
     auto new_message = make_unique<Message>();
     new_message->message_id = get_next_local_message_id(d);
-    new_message->random_y = get_random_y(new_message->message_id);
     new_message->sender_user_id = user_id;
     new_message->date = update->date_;
     new_message->content = make_unique<MessageContactRegistered>();
@@ -7244,7 +7243,7 @@ void MessagesManager::delete_dialog_history(DialogId dialog_id, bool remove_from
     // TODO get dialog from the server and delete history from last message id
   }
 
-  bool allow_error = d->messages == nullptr;
+  bool allow_error = d->messages.empty();
 
   delete_all_dialog_messages(d, remove_from_dialog_list, true);
 
@@ -7337,67 +7336,48 @@ void MessagesManager::delete_dialog_history_from_server(DialogId dialog_id, Mess
   }
 }
 
-void MessagesManager::find_messages_from_user(const unique_ptr<Message> &m, UserId user_id,
-                                              vector<MessageId> &message_ids) {
-  if (m == nullptr) {
-    return;
-  }
-
-  find_messages_from_user(m->left, user_id, message_ids);
-
-  if (m->sender_user_id == user_id) {
-    message_ids.push_back(m->message_id);
-  }
-
-  find_messages_from_user(m->right, user_id, message_ids);
+void MessagesManager::find_messages_from_user(const Dialog *d, UserId user_id, vector<MessageId> &message_ids) {
+  d->messages.for_each([&](int64, const unique_ptr<Message> &m) {
+    if (m->sender_user_id == user_id) {
+      message_ids.push_back(m->message_id);
+    }
+  });
 }
 
-void MessagesManager::find_unread_mentions(const unique_ptr<Message> &m, vector<MessageId> &message_ids) {
-  if (m == nullptr) {
-    return;
-  }
-
-  find_unread_mentions(m->left, message_ids);
-
-  if (m->contains_unread_mention) {
-    message_ids.push_back(m->message_id);
-  }
-
-  find_unread_mentions(m->right, message_ids);
+void MessagesManager::find_unread_mentions(const Dialog *d, vector<MessageId> &message_ids) {
+  d->messages.for_each([&](int64, const unique_ptr<Message> &m) {
+    if (m->contains_unread_mention) {
+      message_ids.push_back(m->message_id);
+    }
+  });
 }
 
-void MessagesManager::find_old_messages(const unique_ptr<Message> &m, MessageId max_message_id,
-                                        vector<MessageId> &message_ids) {
-  if (m == nullptr) {
-    return;
-  }
-
-  find_old_messages(m->left, max_message_id, message_ids);
-
-  if (m->message_id.get() <= max_message_id.get()) {
-    message_ids.push_back(m->message_id);
-
-    find_old_messages(m->right, max_message_id, message_ids);
+void MessagesManager::find_old_messages(const Dialog *d, MessageId max_message_id, vector<MessageId> &message_ids) {
+  for (auto it = d->messages.get_first(); it && it.key() <= max_message_id.get(); ++it) {
+    message_ids.push_back(it.value()->message_id);
   }
 }
 
-void MessagesManager::find_unloadable_messages(const Dialog *d, int32 unload_before_date, const unique_ptr<Message> &m,
-                                               vector<MessageId> &message_ids, int32 &left_to_unload) const {
-  if (m == nullptr) {
-    return;
-  }
-
-  find_unloadable_messages(d, unload_before_date, m->left, message_ids, left_to_unload);
-
-  if (can_unload_message(d, m.get())) {
-    if (m->last_access_date <= unload_before_date) {
-      message_ids.push_back(m->message_id);
-    } else {
-      left_to_unload++;
+bool MessagesManager::have_old_yet_unsent_messages(const Dialog *d, MessageId max_message_id) {
+  for (auto it = d->messages.get_first(); it && it.key() <= max_message_id.get(); ++it) {
+    if (it.value()->message_id.is_yet_unsent()) {
+      return true;
     }
   }
+  return false;
+}
 
-  find_unloadable_messages(d, unload_before_date, m->right, message_ids, left_to_unload);
+void MessagesManager::find_unloadable_messages(const Dialog *d, int32 unload_before_date, vector<MessageId> &message_ids,
+                                               int32 &left_to_unload) const {
+  d->messages.for_each([&](int64, const unique_ptr<Message> &m) {
+    if (can_unload_message(d, m.get())) {
+      if (m->last_access_date <= unload_before_date) {
+        message_ids.push_back(m->message_id);
+      } else {
+        left_to_unload++;
+      }
+    }
+  });
 }
 
 void MessagesManager::delete_dialog_messages_from_user(DialogId dialog_id, UserId user_id, Promise<Unit> &&promise) {
@@ -7455,7 +7435,7 @@ void MessagesManager::delete_dialog_messages_from_user(DialogId dialog_id, UserI
   }
 
   vector<MessageId> message_ids;
-  find_messages_from_user(d->messages, user_id, message_ids);
+  find_messages_from_user(d, user_id, message_ids);
 
   vector<int64> deleted_message_ids;
   bool need_update_dialog_pos = false;
@@ -7528,10 +7508,17 @@ void MessagesManager::unload_dialog(DialogId dialog_id) {
   Dialog *d = get_dialog(dialog_id);
   CHECK(d != nullptr);
 
+  int32 left_to_unload = unload_dialog_messages(d, G()->unix_time_cached() - DIALOG_UNLOAD_DELAY + 2);
+  if (left_to_unload > 0) {
+    LOG(INFO) << "Need to unload " << left_to_unload << " messages more in " << dialog_id;
+    pending_unload_dialog_timeout_.add_timeout_in(d->dialog_id.get(), DIALOG_UNLOAD_DELAY);
+  }
+}
+
+int32 MessagesManager::unload_dialog_messages(Dialog *d, int32 unload_before_date) {
   vector<MessageId> to_unload_message_ids;
   int32 left_to_unload = 0;
-  find_unloadable_messages(d, G()->unix_time_cached() - DIALOG_UNLOAD_DELAY + 2, d->messages, to_unload_message_ids,
-                           left_to_unload);
+  find_unloadable_messages(d, unload_before_date, to_unload_message_ids, left_to_unload);
 
   vector<int64> unloaded_message_ids;
   for (auto message_id : to_unload_message_ids) {
@@ -7542,12 +7529,57 @@ void MessagesManager::unload_dialog(DialogId dialog_id) {
   if (!unloaded_message_ids.empty() && !G()->parameters().use_message_db) {
     d->have_full_history = false;
   }
-  send_update_delete_messages(dialog_id, std::move(unloaded_message_ids), false, true);
+  send_update_delete_messages(d->dialog_id, std::move(unloaded_message_ids), false, true);
+  return left_to_unload;
+}
 
-  if (left_to_unload > 0) {
-    LOG(INFO) << "Need to unload " << left_to_unload << " messages more in " << dialog_id;
-    pending_unload_dialog_timeout_.add_timeout_in(d->dialog_id.get(), DIALOG_UNLOAD_DELAY);
+void MessagesManager::on_loaded_message_count_changed(Dialog *d, int32 diff) {
+  d->loaded_message_count += diff;
+  CHECK(d->loaded_message_count >= 0);
+
+  if (message_cache_.on_loaded_message_count_changed(diff) && !is_message_cache_reduce_scheduled_ &&
+      is_message_unload_enabled()) {
+    // messages can't be unloaded right now, because the caller can still use pointers to them
+    is_message_cache_reduce_scheduled_ = true;
+    send_closure_later(actor_id(this), &MessagesManager::reduce_message_cache);
+  }
+}
+
+void MessagesManager::reduce_message_cache() {
+  is_message_cache_reduce_scheduled_ = false;
+  if (G()->close_flag() || !message_cache_.need_reduce() || !is_message_unload_enabled()) {
+    return;
+  }
+
+  auto old_loaded_message_count = message_cache_.get_size();
+  auto unloaded_dialog_count = message_cache_.reduce(
+      dialogs_, [&](Dialog *d) { unload_dialog_messages(d, std::numeric_limits<int32>::max()); });
+  LOG(INFO) << "Unload " << old_loaded_message_count - message_cache_.get_size() << " messages from "
+            << unloaded_dialog_count << " least recently used chats, " << message_cache_.get_size()
+            << " messages are left in memory, cache hit rate is " << get_message_cache_hit_rate() << '%';
+  LOG_IF(WARNING, message_cache_.need_reduce())
+      << "Can't reduce message cache size to " << message_cache_.get_max_size() << ", there are still "
+      << message_cache_.get_size() << " messages in memory";
+}
+
+void MessagesManager::on_update_message_cache_max_size() {
+  if (message_cache_.set_max_size(G()->shared_config().get_option_integer("message_cache_max_size")) &&
+      !is_message_cache_reduce_scheduled_ && is_message_unload_enabled()) {
+    is_message_cache_reduce_scheduled_ = true;
+    send_closure_later(actor_id(this), &MessagesManager::reduce_message_cache);
+  }
+}
+
+int32 MessagesManager::get_message_cache_size() const {
+  return message_cache_.get_size();
+}
+
+int32 MessagesManager::get_message_cache_hit_rate() const {
+  auto total_count = message_cache_hit_count_ + message_cache_miss_count_;
+  if (total_count == 0) {
+    return 100;
   }
+  return static_cast<int32>(message_cache_hit_count_ * 100 / total_count);
 }
 
 void MessagesManager::delete_all_dialog_messages(Dialog *d, bool remove_from_dialog_list, bool is_permanent) {
@@ -7591,7 +7623,7 @@ void MessagesManager::delete_all_dialog_messages(Dialog *d, bool remove_from_dia
   }
 
   vector<int64> deleted_message_ids;
-  do_delete_all_dialog_messages(d, d->messages, deleted_message_ids);
+  do_delete_all_dialog_messages(d, deleted_message_ids);
   delete_all_dialog_messages_from_database(d->dialog_id, MessageId::max(), "delete_all_dialog_messages");
   if (is_permanent) {
     for (auto id : deleted_message_ids) {
@@ -7661,7 +7693,7 @@ void MessagesManager::read_all_dialog_mentions(DialogId dialog_id, Promise<Unit>
   }
 
   vector<MessageId> message_ids;
-  find_unread_mentions(d->messages, message_ids);
+  find_unread_mentions(d, message_ids);
 
   LOG(INFO) << "Found " << message_ids.size() << " messages with unread mentions in memory";
   bool is_update_sent = false;
@@ -7982,24 +8014,30 @@ void MessagesManager::set_dialog_max_unavailable_message_id(DialogId dialog_id,
 
     d->max_unavailable_message_id = max_unavailable_message_id;
 
-    vector<MessageId> message_ids;
-    find_old_messages(d->messages, max_unavailable_message_id, message_ids);
-
     vector<int64> deleted_message_ids;
     bool need_update_dialog_pos = false;
-    for (auto message_id : message_ids) {
-      if (message_id.is_yet_unsent()) {
-        continue;
-      }
+    if (!have_old_yet_unsent_messages(d, max_unavailable_message_id)) {
+      do_delete_old_messages(d, max_unavailable_message_id, !from_update, &need_update_dialog_pos, deleted_message_ids,
+                             "set dialog max unavailable message id");
+    } else {
+      // yet unsent messages must be kept, so the messages are deleted one by one
+      vector<MessageId> message_ids;
+      find_old_messages(d, max_unavailable_message_id, message_ids);
 
-      auto m = get_message(d, message_id);
-      CHECK(m != nullptr);
-      CHECK(m->message_id.get() <= max_unavailable_message_id.get());
-      CHECK(m->message_id == message_id);
-      deleted_message_ids.push_back(message_id.get());
-      auto p =
-          delete_message(d, message_id, !from_update, &need_update_dialog_pos, "set dialog max unavailable message id");
-      CHECK(p.get() == m);
+      for (auto message_id : message_ids) {
+        if (message_id.is_yet_unsent()) {
+          continue;
+        }
+
+        auto m = get_message(d, message_id);
+        CHECK(m != nullptr);
+        CHECK(m->message_id.get() <= max_unavailable_message_id.get());
+        CHECK(m->message_id == message_id);
+        deleted_message_ids.push_back(message_id.get());
+        auto p = delete_message(d, message_id, !from_update, &need_update_dialog_pos,
+                                "set dialog max unavailable message id");
+        CHECK(p.get() == m);
+      }
     }
 
     if (need_update_dialog_pos) {
@@ -8469,13 +8507,10 @@ void MessagesManager::start_up() {
       bool have_next;
     };
     vector<MessageBasicInfo> messages_info;
-    std::function<void(Message *m)> get_messages_info = [&](Message *m) {
-      if (m == nullptr) {
-        return;
-      }
-      get_messages_info(m->left.get());
-      messages_info.push_back(MessageBasicInfo{m->message_id, m->have_previous, m->have_next});
-      get_messages_info(m->right.get());
+    auto get_messages_info = [&](const MessagesMap &messages) {
+      messages.for_each([&](int64, const unique_ptr<Message> &m) {
+        messages_info.push_back(MessageBasicInfo{m->message_id, m->have_previous, m->have_next});
+      });
     };
 
     char buf[1280];
@@ -8542,7 +8577,6 @@ void MessagesManager::start_up() {
       CHECK(content_type != MessageChatDeleteHistory::ID);  // not supported
       if (op == "MessageOpAdd") {
         auto m = make_unique<Message>();
-        m->random_y = get_random_y(message_id);
         m->message_id = message_id;
         m->date = G()->unix_time();
         m->content = make_unique<MessageText>("text", vector<MessageEntity>(), WebPageId());
@@ -8563,7 +8597,7 @@ void MessagesManager::start_up() {
       }
 
       messages_info.clear();
-      get_messages_info(d->messages.get());
+      get_messages_info(d->messages);
 
       for (size_t i = 0; i + 1 < messages_info.size(); i++) {
         if (messages_info[i].have_next != messages_info[i + 1].have_previous) {
@@ -8583,7 +8617,7 @@ void MessagesManager::start_up() {
     }
 
     messages_info.clear();
-    get_messages_info(d->messages.get());
+    get_messages_info(d->messages);
     for (auto &info : messages_info) {
       bool need_update_dialog_pos = false;
       auto m = delete_message(d, info.message_id, true, &need_update_dialog_pos, "Unknown source");
@@ -9163,7 +9197,6 @@ std::pair<DialogId, unique_ptr<MessagesManager::Message>> MessagesManager::creat
   LOG(INFO) << "Receive " << message_id << " in " << dialog_id << " from " << sender_user_id;
 
   auto message = make_unique<Message>();
-  message->random_y = get_random_y(message_id);
   message->message_id = message_id;
   message->sender_user_id = sender_user_id;
   message->date = date;
@@ -9277,14 +9310,12 @@ FullMessageId MessagesManager::on_get_message(MessageInfo &&message_info, bool f
     need_update = false;
 
     new_message->message_id = old_message_id;
-    new_message->random_y = get_random_y(new_message->message_id);
     new_message->have_previous = false;
     new_message->have_next = false;
     update_message(d, old_message, std::move(new_message), true, &need_update_dialog_pos);
     new_message = std::move(old_message);
 
     new_message->message_id = message_id;
-    new_message->random_y = get_random_y(new_message->message_id);
     send_update_message_send_succeeded(d, old_message_id, new_message.get());
 
     try_add_active_live_location(dialog_id, new_message.get());
@@ -9320,7 +9351,7 @@ FullMessageId MessagesManager::on_get_message(MessageInfo &&message_info, bool f
   if (!have_input_peer(dialog_id, AccessRights::Read)) {
     auto p = delete_message(d, message_id, false, &need_update_dialog_pos, "get a message in inaccessible chat");
     CHECK(p.get() == m);
-    // CHECK(d->messages == nullptr);
+    // CHECK(d->messages.empty());
     send_update_delete_messages(dialog_id, {message_id.get()}, false, false);
     // don't need to update dialog pos
     return FullMessageId();
@@ -9949,7 +9980,7 @@ unique_ptr<MessagesManager::Message> MessagesManager::delete_message(Dialog *d,
   return do_delete_message(d, message_id, is_permanently_deleted, false, need_update_dialog_pos, source);
 }
 
-// DO NOT FORGET TO ADD ALL CHANGES OF THIS FUNCTION AS WELL TO do_delete_all_dialog_messages
+// DO NOT FORGET TO ADD ALL CHANGES OF THIS FUNCTION AS WELL TO do_delete_all_dialog_messages AND do_delete_old_messages
 unique_ptr<MessagesManager::Message> MessagesManager::do_delete_message(Dialog *d, MessageId message_id,
                                                                         bool is_permanently_deleted,
                                                                         bool only_from_memory,
@@ -9961,8 +9992,8 @@ unique_ptr<MessagesManager::Message> MessagesManager::do_delete_message(Dialog *
   }
 
   FullMessageId full_message_id(d->dialog_id, message_id);
-  unique_ptr<Message> *v = find_message(&d->messages, message_id);
-  if (*v == nullptr) {
+  unique_ptr<Message> *v = d->messages.find(message_id.get());
+  if (v == nullptr) {
     LOG(INFO) << message_id << " is not found in " << d->dialog_id << " to be deleted from " << source;
     if (only_from_memory) {
       return nullptr;
@@ -9997,8 +10028,8 @@ unique_ptr<MessagesManager::Message> MessagesManager::do_delete_message(Dialog *
       */
       return nullptr;
     }
-    v = find_message(&d->messages, message_id);
-    CHECK(*v != nullptr);
+    v = d->messages.find(message_id.get());
+    CHECK(v != nullptr);
   }
 
   const Message *m = v->get();
@@ -10084,7 +10115,7 @@ unique_ptr<MessagesManager::Message> MessagesManager::do_delete_message(Dialog *
       dump_debug_message_op(d);
     }
   }
-  if ((*v)->have_next && (only_from_memory || !(*v)->have_previous)) {
+  if (m->have_next && (only_from_memory || !m->have_previous)) {
     MessagesIterator it(d, message_id);
     CHECK(*it == m);
     ++it;
@@ -10097,22 +10128,9 @@ unique_ptr<MessagesManager::Message> MessagesManager::do_delete_message(Dialog *
     }
   }
 
-  unique_ptr<Message> result = std::move(*v);
-  unique_ptr<Message> left = std::move(result->left);
-  unique_ptr<Message> right = std::move(result->right);
-
-  while (left != nullptr || right != nullptr) {
-    if (left == nullptr || (right != nullptr && right->random_y > left->random_y)) {
-      *v = std::move(right);
-      v = &((*v)->left);
-      right = std::move(*v);
-    } else {
-      *v = std::move(left);
-      v = &((*v)->right);
-      left = std::move(*v);
-    }
-  }
-  CHECK(*v == nullptr);
+  unique_ptr<Message> result = d->messages.extract(message_id.get());
+  CHECK(result.get() == m);
+  on_loaded_message_count_changed(d, -1);
 
   if (!only_from_memory) {
     if (message_id.is_yet_unsent()) {
@@ -10179,48 +10197,167 @@ unique_ptr<MessagesManager::Message> MessagesManager::do_delete_message(Dialog *
   return result;
 }
 
-void MessagesManager::do_delete_all_dialog_messages(Dialog *d, unique_ptr<Message> &m,
-                                                    vector<int64> &deleted_message_ids) {
-  if (m == nullptr) {
+void MessagesManager::do_delete_all_dialog_messages(Dialog *d, vector<int64> &deleted_message_ids) {
+  d->messages.for_each([&](int64, unique_ptr<Message> &m) {
+    MessageId message_id = m->message_id;
+
+    if (is_debug_message_op_enabled()) {
+      d->debug_message_op.emplace_back(Dialog::MessageOp::Delete, m->message_id, m->content->get_id(), false,
+                                       m->have_previous, m->have_next, "delete all messages");
+    }
+
+    LOG(INFO) << "Delete " << message_id;
+    deleted_message_ids.push_back(message_id.get());
+
+    delete_active_live_location(d->dialog_id, m.get());
+
+    if (message_id.is_yet_unsent()) {
+      cancel_send_message_query(d->dialog_id, m);
+    }
+
+    switch (d->dialog_id.get_type()) {
+      case DialogType::User:
+      case DialogType::Chat:
+        message_id_to_dialog_id_.erase(message_id);
+        break;
+      case DialogType::Channel:
+        // nothing to do
+        break;
+      case DialogType::SecretChat:
+        d->random_id_to_message_id.erase(m->random_id);
+        break;
+      case DialogType::None:
+      default:
+        UNREACHABLE();
+    }
+    ttl_unregister_message(d->dialog_id, m.get(), Time::now());
+  });
+
+  on_loaded_message_count_changed(d, -static_cast<int32>(d->messages.size()));
+  d->messages.clear();
+}
+
+// deletes all messages with identifiers up to max_message_id, which must not be yet unsent, with a single range erase;
+// the result is the same as of deletion of the messages by do_delete_message one by one in order of identifiers
+void MessagesManager::do_delete_old_messages(Dialog *d, MessageId max_message_id, bool is_permanently_deleted,
+                                             bool *need_update_dialog_pos, vector<int64> &deleted_message_ids,
+                                             const char *source) {
+  vector<unique_ptr<Message>> messages;
+  d->messages.erase_range(0, max_message_id.get() + 1,
+                          [&](int64, unique_ptr<Message> &&m) { messages.push_back(std::move(m)); });
+  if (messages.empty()) {
     return;
   }
-  MessageId message_id = m->message_id;
+  on_loaded_message_count_changed(d, -narrow_cast<int32>(messages.size()));
 
-  if (is_debug_message_op_enabled()) {
-    d->debug_message_op.emplace_back(Dialog::MessageOp::Delete, m->message_id, m->content->get_id(), false,
-                                     m->have_previous, m->have_next, "delete all messages");
+  // there are no previous messages in memory anymore
+  auto first_it = d->messages.get_first();
+  if (first_it) {
+    first_it.value()->have_previous = false;
   }
 
-  LOG(INFO) << "Delete " << message_id;
-  deleted_message_ids.push_back(message_id.get());
+  bool need_get_history = false;
+  bool is_unread_count_changed = false;
+  bool is_unread_mention_count_changed = false;
+  auto my_dialog_id = DialogId(td_->contacts_manager_->get_my_id("do_delete_old_messages"));
+  for (auto &m : messages) {
+    MessageId message_id = m->message_id;
+    CHECK(!message_id.is_yet_unsent());
+
+    if (is_debug_message_op_enabled()) {
+      d->debug_message_op.emplace_back(Dialog::MessageOp::Delete, m->message_id, m->content->get_id(), false,
+                                       m->have_previous, m->have_next, source);
+    }
 
-  do_delete_all_dialog_messages(d, m->right, deleted_message_ids);
-  do_delete_all_dialog_messages(d, m->left, deleted_message_ids);
+    LOG(INFO) << "Deleting " << FullMessageId{d->dialog_id, message_id} << " from " << source;
+    deleted_message_ids.push_back(message_id.get());
 
-  delete_active_live_location(d->dialog_id, m.get());
+    delete_message_from_database(d, message_id, m.get(), is_permanently_deleted);
 
-  if (message_id.is_yet_unsent()) {
-    cancel_send_message_query(d->dialog_id, m);
+    delete_active_live_location(d->dialog_id, m.get());
+
+    // all previous messages are deleted as well
+    if (message_id == d->last_message_id) {
+      need_get_history = true;
+      set_dialog_last_message_id(d, MessageId(), "do_delete_old_messages");
+      d->delete_last_message_date = m->date;
+      d->deleted_last_message_id = message_id;
+      d->is_last_message_deleted_locally = Slice(source) == Slice(DELETE_MESSAGE_USER_REQUEST_SOURCE);
+      on_dialog_updated(d->dialog_id, "do delete last message");
+      *need_update_dialog_pos = true;
+    }
+    if (message_id == d->last_database_message_id) {
+      need_get_history = true;
+      on_dialog_updated(d->dialog_id, "do delete last database message");
+    }
+
+    if (d->reply_markup_message_id == message_id) {
+      set_dialog_reply_markup(d, MessageId());
+    }
+    // if last_read_inbox_message_id is not known, we can't be sure whether unread_count should be decreased or not
+    if (!m->is_outgoing && message_id.get() > d->last_read_inbox_message_id.get() && d->dialog_id != my_dialog_id &&
+        d->is_last_read_inbox_message_id_inited) {
+      int32 &unread_count = message_id.is_server() ? d->server_unread_count : d->local_unread_count;
+      unread_count--;
+      if (unread_count < 0) {
+        LOG(ERROR) << "Unread count became negative in " << d->dialog_id << " after deletion of " << message_id
+                   << ". Last read is " << d->last_read_inbox_message_id;
+        dump_debug_message_op(d, 3);
+        unread_count = 0;
+      }
+      is_unread_count_changed = true;
+    }
+    if (m->contains_unread_mention) {
+      if (d->unread_mention_count == 0) {
+        LOG_IF(ERROR,
+               d->message_count_by_index[search_messages_filter_index(SearchMessagesFilter::UnreadMention)] != -1)
+            << "Unread mention count became negative in " << d->dialog_id << " after deletion of " << message_id;
+      } else {
+        d->unread_mention_count--;
+        d->message_count_by_index[search_messages_filter_index(SearchMessagesFilter::UnreadMention)] =
+            d->unread_mention_count;
+        is_unread_mention_count_changed = true;
+      }
+    }
+
+    update_message_count_by_index(d, -1, m.get());
+
+    switch (d->dialog_id.get_type()) {
+      case DialogType::User:
+      case DialogType::Chat:
+        message_id_to_dialog_id_.erase(message_id);
+        break;
+      case DialogType::Channel:
+        // nothing to do
+        break;
+      case DialogType::SecretChat:
+        d->random_id_to_message_id.erase(m->random_id);
+        break;
+      case DialogType::None:
+      default:
+        UNREACHABLE();
+    }
+    ttl_unregister_message(d->dialog_id, m.get(), Time::now());
   }
 
-  switch (d->dialog_id.get_type()) {
-    case DialogType::User:
-    case DialogType::Chat:
-      message_id_to_dialog_id_.erase(message_id);
-      break;
-    case DialogType::Channel:
-      // nothing to do
-      break;
-    case DialogType::SecretChat:
-      d->random_id_to_message_id.erase(m->random_id);
-      break;
-    case DialogType::None:
-    default:
-      UNREACHABLE();
+  if (d->last_database_message_id.is_valid()) {
+    CHECK(d->first_database_message_id.is_valid());
+  } else {
+    set_dialog_first_database_message_id(d, MessageId(), "do_delete_old_messages");
   }
-  ttl_unregister_message(d->dialog_id, m.get(), Time::now());
 
-  m = nullptr;
+  if (is_unread_count_changed) {
+    LOG(INFO) << "Delete incoming unread messages and update unread message count in " << d->dialog_id << " to "
+              << d->server_unread_count << " + " << d->local_unread_count;
+    send_update_chat_read_inbox(d, false, source);
+  }
+  if (is_unread_mention_count_changed) {
+    send_update_chat_unread_mention_count(d);
+  }
+
+  if (need_get_history && !td_->auth_manager_->is_bot() && have_input_peer(d->dialog_id, AccessRights::Read)) {
+    get_history_from_the_end(d->dialog_id, true, false, Auto());
+  }
 }
 
 bool MessagesManager::have_dialog(DialogId dialog_id) const {
@@ -11658,11 +11795,8 @@ void MessagesManager::open_dialog(Dialog *d) {
 
   auto min_message_id = MessageId(ServerMessageId(1)).get();
   if (d->last_message_id == MessageId() && d->last_read_outbox_message_id.get() < min_message_id &&
-      d->messages != nullptr && d->messages->message_id.get() < min_message_id) {
-    Message *m = d->messages.get();
-    while (m->right != nullptr) {
-      m = m->right.get();
-    }
+      !d->messages.empty() && d->messages.get_last().key() < min_message_id) {
+    Message *m = d->messages.get_last().value().get();
     if (m->message_id.get() < min_message_id) {
       read_history_inbox(d->dialog_id, m->message_id, -1, "open_dialog");
     }
@@ -12089,11 +12223,8 @@ tl_object_ptr<td_api::messages> MessagesManager::get_dialog_history(DialogId dia
     bool have_a_gap = false;
     if (*p == nullptr) {
       // there is no gap if from_message_id is less than first message in the dialog
-      if (left_tries == 0 && d->messages != nullptr && offset < 0) {
-        Message *cur = d->messages.get();
-        while (cur->left != nullptr) {
-          cur = cur->left.get();
-        }
+      if (left_tries == 0 && !d->messages.empty() && offset < 0) {
+        const Message *cur = d->messages.get_first().value().get();
         CHECK(cur->message_id.get() > from_message_id.get());
         from_message_id = cur->message_id;
         p = MessagesConstIterator(d, from_message_id);
@@ -12874,7 +13005,7 @@ int64 MessagesManager::get_dialog_message_by_date(DialogId dialog_id, int32 date
            get_dialog_message_by_date_results_.find(random_id) != get_dialog_message_by_date_results_.end());
   get_dialog_message_by_date_results_[random_id];  // reserve place for result
 
-  auto message_id = find_message_by_date(d->messages, date);
+  auto message_id = find_message_by_date(d, date);
   if (message_id.is_valid() && (message_id == d->last_message_id || get_message(d, message_id)->have_next)) {
     get_dialog_message_by_date_results_[random_id] = {dialog_id, message_id};
     promise.set_value(Unit());
@@ -12896,21 +13027,13 @@ int64 MessagesManager::get_dialog_message_by_date(DialogId dialog_id, int32 date
   return random_id;
 }
 
-MessageId MessagesManager::find_message_by_date(const unique_ptr<Message> &m, int32 date) {
-  if (m == nullptr) {
+MessageId MessagesManager::find_message_by_date(const Dialog *d, int32 date) {
+  auto it = d->messages.find_last_not_satisfying(
+      [date](int64, const unique_ptr<Message> &m) { return m->date > date; });
+  if (!it) {
     return MessageId();
   }
-
-  if (m->date > date) {
-    return find_message_by_date(m->left, date);
-  }
-
-  auto message_id = find_message_by_date(m->right, date);
-  if (message_id.is_valid()) {
-    return message_id;
-  }
-
-  return m->message_id;
+  return it.value()->message_id;
 }
 
 void MessagesManager::on_get_dialog_message_by_date_from_database(DialogId dialog_id, int32 date, int64 random_id,
@@ -12920,7 +13043,7 @@ void MessagesManager::on_get_dialog_message_by_date_from_database(DialogId dialo
   if (result.is_ok()) {
     Message *m = on_get_message_from_database(dialog_id, d, result.ok());
     if (m != nullptr) {
-      auto message_id = find_message_by_date(d->messages, date);
+      auto message_id = find_message_by_date(d, date);
       if (!message_id.is_valid()) {
         LOG(ERROR) << "Failed to find " << m->message_id << " in " << dialog_id << " by date " << date;
         message_id = m->message_id;
@@ -12944,7 +13067,7 @@ void MessagesManager::get_dialog_message_by_date_from_server(const Dialog *d, in
       return promise.set_value(Unit());
     }
 
-    auto message_id = find_message_by_date(d->messages, date);
+    auto message_id = find_message_by_date(d, date);
     if (message_id.is_valid()) {
       get_dialog_message_by_date_results_[random_id] = {d->dialog_id, message_id};
     }
@@ -12979,7 +13102,7 @@ void MessagesManager::on_get_dialog_message_by_date_success(DialogId dialog_id,
       if (result != FullMessageId()) {
         const Dialog *d = get_dialog(dialog_id);
         CHECK(d != nullptr);
-        auto message_id = find_message_by_date(d->messages, date);
+        auto message_id = find_message_by_date(d, date);
         if (!message_id.is_valid()) {
           LOG(ERROR) << "Failed to find " << result.get_message_id() << " in " << dialog_id << " by date " << date;
           message_id = result.get_message_id();
@@ -14126,7 +14249,6 @@ MessagesManager::Message *MessagesManager::get_message_to_send(Dialog *d, Messag
   auto my_id = td_->contacts_manager_->get_my_id("get_message_to_send");
 
   auto m = make_unique<Message>();
-  m->random_y = get_random_y(message_id);
   m->message_id = message_id;
   bool is_channel_post = is_broadcast_channel(dialog_id);
   if (is_channel_post) {
@@ -17601,7 +17723,7 @@ void MessagesManager::send_update_delete_messages(DialogId dialog_id, vector<int
 
 void MessagesManager::send_update_chat(Dialog *d) {
   CHECK(d != nullptr);
-  CHECK(d->messages == nullptr);
+  CHECK(d->messages.empty());
   send_closure(G()->td(), &Td::send_update, make_tl_object<td_api::updateNewChat>(get_chat_object(d)));
 }
 
@@ -17910,7 +18032,6 @@ FullMessageId MessagesManager::on_send_message_success(int64 random_id, MessageI
   }
 
   sent_message->message_id = new_message_id;
-  sent_message->random_y = get_random_y(sent_message->message_id);
 
   sent_message->have_previous = true;
   sent_message->have_next = true;
@@ -18184,7 +18305,6 @@ void MessagesManager::fail_send_message(FullMessageId full_message_id, int error
 
   message->message_id = MessageId(old_message_id.get() - MessageId::TYPE_YET_UNSENT + MessageId::TYPE_LOCAL);
   CHECK(message->message_id.is_valid());
-  message->random_y = get_random_y(message->message_id);
   message->is_failed_to_send = true;
 
   message->have_previous = true;
@@ -19409,29 +19529,6 @@ tl_object_ptr<td_api::chatEvents> MessagesManager::get_chat_events_object(int64
   return result;
 }
 
-unique_ptr<MessagesManager::Message> *MessagesManager::find_message(unique_ptr<Message> *v, MessageId message_id) {
-  return const_cast<unique_ptr<Message> *>(find_message(static_cast<const unique_ptr<Message> *>(v), message_id));
-}
-
-const unique_ptr<MessagesManager::Message> *MessagesManager::find_message(const unique_ptr<Message> *v,
-                                                                          MessageId message_id) {
-  LOG(DEBUG) << "Searching for " << message_id << " in " << static_cast<const void *>(v->get());
-  while (*v != nullptr) {
-    //    LOG(DEBUG) << "Pass " << (*v)->message_id;
-    if ((*v)->message_id.get() < message_id.get()) {
-      //      LOG(DEBUG) << "Go right";
-      v = &(*v)->right;
-    } else if ((*v)->message_id.get() > message_id.get()) {
-      //      LOG(DEBUG) << "Go left";
-      v = &(*v)->left;
-    } else {
-      LOG(DEBUG) << "Message found";
-      break;
-    }
-  }
-  return v;
-}
-
 MessagesManager::Message *MessagesManager::get_message(Dialog *d, MessageId message_id) {
   return const_cast<Message *>(get_message(static_cast<const Dialog *>(d), message_id));
 }
@@ -19443,9 +19540,14 @@ const MessagesManager::Message *MessagesManager::get_message(const Dialog *d, Me
 
   CHECK(d != nullptr);
   LOG(DEBUG) << "Search for " << message_id << " in " << d->dialog_id;
-  auto result = find_message(&d->messages, message_id)->get();
+  auto v = d->messages.find(message_id.get());
+  if (v == nullptr) {
+    return nullptr;
+  }
+  auto result = v->get();
   if (result != nullptr) {
     result->last_access_date = G()->unix_time_cached();
+    d->last_access_date = result->last_access_date;
   }
   return result;
 }
@@ -19457,6 +19559,7 @@ MessagesManager::Message *MessagesManager::get_message_force(Dialog *d, MessageI
 
   auto result = get_message(d, message_id);
   if (result != nullptr) {
+    message_cache_hit_count_++;
     return result;
   }
 
@@ -19473,6 +19576,7 @@ MessagesManager::Message *MessagesManager::get_message_force(Dialog *d, MessageI
   if (r_value.is_error()) {
     return nullptr;
   }
+  message_cache_miss_count_++;
   return on_get_message_from_database(d->dialog_id, d, r_value.ok());
 }
 
@@ -20537,10 +20641,6 @@ unique_ptr<MessageContent> MessagesManager::get_message_action_content(
   return make_unique<MessageText>("", vector<MessageEntity>(), WebPageId());
 }
 
-int32 MessagesManager::get_random_y(MessageId message_id) {
-  return static_cast<int32>(static_cast<uint32>(message_id.get() * 2101234567u));
-}
-
 MessagesManager::Message *MessagesManager::add_message_to_dialog(DialogId dialog_id, unique_ptr<Message> message,
                                                                  bool from_update, bool *need_update,
                                                                  bool *need_update_dialog_pos, const char *source) {
@@ -20710,40 +20810,34 @@ MessagesManager::Message *MessagesManager::add_message_to_dialog(Dialog *d, uniq
     message->reply_markup = nullptr;
   }
 
-  unique_ptr<Message> *v = &d->messages;
-  while (*v != nullptr && (*v)->random_y >= message->random_y) {
-    if ((*v)->message_id.get() < message_id.get()) {
-      v = &(*v)->right;
-    } else if ((*v)->message_id == message_id) {
-      LOG(INFO) << "Adding already existed " << message_id << " in " << dialog_id;
-      if (*need_update) {
-        *need_update = false;
-        if (!G()->parameters().use_message_db) {
-          LOG(ERROR) << "Receive again " << (message->is_outgoing ? "outgoing" : "incoming")
-                     << (message->forward_info == nullptr ? " not" : "") << " forwarded " << message_id
-                     << " with content of type " << message_content_id << " in " << dialog_id << " from " << source
-                     << ", current last new is " << d->last_new_message_id << ", last is " << d->last_message_id << ". "
-                     << td_->updates_manager_->get_state();
-          dump_debug_message_op(d, 1);
-        }
+  unique_ptr<Message> *v = d->messages.find(message_id.get());
+  if (v != nullptr) {
+    LOG(INFO) << "Adding already existed " << message_id << " in " << dialog_id;
+    if (*need_update) {
+      *need_update = false;
+      if (!G()->parameters().use_message_db) {
+        LOG(ERROR) << "Receive again " << (message->is_outgoing ? "outgoing" : "incoming")
+                   << (message->forward_info == nullptr ? " not" : "") << " forwarded " << message_id
+                   << " with content of type " << message_content_id << " in " << dialog_id << " from " << source
+                   << ", current last new is " << d->last_new_message_id << ", last is " << d->last_message_id << ". "
+                   << td_->updates_manager_->get_state();
+        dump_debug_message_op(d, 1);
       }
-      if (auto_attach) {
-        CHECK(message->have_previous);
-        CHECK(message->have_next);
-        message->have_previous = false;
-        message->have_next = false;
-      }
-      if (!message->from_database) {
-        bool was_deleted = delete_active_live_location(dialog_id, v->get());
-        update_message(d, *v, std::move(message), true, need_update_dialog_pos);
-        if (was_deleted) {
-          try_add_active_live_location(dialog_id, v->get());
-        }
+    }
+    if (auto_attach) {
+      CHECK(message->have_previous);
+      CHECK(message->have_next);
+      message->have_previous = false;
+      message->have_next = false;
+    }
+    if (!message->from_database) {
+      bool was_deleted = delete_active_live_location(dialog_id, v->get());
+      update_message(d, *v, std::move(message), true, need_update_dialog_pos);
+      if (was_deleted) {
+        try_add_active_live_location(dialog_id, v->get());
       }
-      return v->get();
-    } else {
-      v = &(*v)->left;
     }
+    return v->get();
   }
 
   if (d->have_full_history && !message->from_database && !from_update && !message_id.is_local() &&
@@ -20753,7 +20847,7 @@ MessagesManager::Message *MessagesManager::add_message_to_dialog(Dialog *d, uniq
     on_dialog_updated(dialog_id, "drop have_full_history");
   }
 
-  if (!d->is_opened && d->messages != nullptr && is_message_unload_enabled()) {
+  if (!d->is_opened && !d->messages.empty() && is_message_unload_enabled()) {
     LOG(INFO) << "Schedule unload of " << dialog_id;
     pending_unload_dialog_timeout_.add_timeout_in(dialog_id.get(), DIALOG_UNLOAD_DELAY);
   }
@@ -20861,16 +20955,13 @@ MessagesManager::Message *MessagesManager::add_message_to_dialog(Dialog *d, uniq
     }
     if (!is_attached && !message_id.is_yet_unsent()) {
       // message may be attached to the next message if there is no previous message
-      Message *cur = d->messages.get();
-      Message *next_message = nullptr;
-      while (cur != nullptr) {
-        if (cur->message_id.get() < message_id.get()) {
-          cur = cur->right.get();
-        } else {
-          next_message = cur;
-          cur = cur->left.get();
-        }
+      auto next_it = d->messages.find_less_or_equal(message_id.get());
+      if (next_it) {
+        ++next_it;
+      } else {
+        next_it = d->messages.get_first();
       }
+      Message *next_message = next_it ? next_it.value().get() : nullptr;
       if (next_message != nullptr) {
         CHECK(!next_message->have_previous);
         LOG(INFO) << "Attach " << message_id << " to the next " << next_message->message_id;
@@ -21063,44 +21154,17 @@ MessagesManager::Message *MessagesManager::add_message_to_dialog(Dialog *d, uniq
     }
   }
 
-  // TODO function
-  v = &d->messages;
-  while (*v != nullptr && (*v)->random_y >= message->random_y) {
-    if ((*v)->message_id.get() < message_id.get()) {
-      v = &(*v)->right;
-    } else if ((*v)->message_id == message_id) {
-      UNREACHABLE();
-    } else {
-      v = &(*v)->left;
-    }
-  }
-
-  unique_ptr<Message> *left = &message->left;
-  unique_ptr<Message> *right = &message->right;
-
-  unique_ptr<Message> cur = std::move(*v);
-  while (cur != nullptr) {
-    if (cur->message_id.get() < message_id.get()) {
-      *left = std::move(cur);
-      left = &((*left)->right);
-      cur = std::move(*left);
-    } else {
-      *right = std::move(cur);
-      right = &((*right)->left);
-      cur = std::move(*right);
-    }
-  }
-  CHECK(*left == nullptr);
-  CHECK(*right == nullptr);
-  *v = std::move(message);
-
-  CHECK(d->messages != nullptr);
+  Message *m = message.get();
+  bool is_inserted = d->messages.insert(message_id.get(), std::move(message)).second;
+  CHECK(is_inserted);
+  on_loaded_message_count_changed(d, 1);
+  d->last_access_date = m->last_access_date;
 
   if (!is_attached) {
-    if ((*v)->have_next) {
-      CHECK(!(*v)->have_previous);
+    if (m->have_next) {
+      CHECK(!m->have_previous);
       attach_message_to_next(d, message_id);
-    } else if ((*v)->have_previous) {
+    } else if (m->have_previous) {
       attach_message_to_previous(d, message_id);
     }
   }
@@ -21114,14 +21178,14 @@ MessagesManager::Message *MessagesManager::add_message_to_dialog(Dialog *d, uniq
       // nothing to do
       break;
     case DialogType::SecretChat:
-      d->random_id_to_message_id[(*v)->random_id] = message_id;
+      d->random_id_to_message_id[m->random_id] = message_id;
       break;
     case DialogType::None:
     default:
       UNREACHABLE();
   }
 
-  return v->get();
+  return m;
 }
 
 void MessagesManager::add_message_to_database(const Dialog *d, const Message *m, const char *source) {
@@ -21354,7 +21418,6 @@ void MessagesManager::update_message(Dialog *d, unique_ptr<Message> &old_message
   CHECK(old_message != nullptr);
   CHECK(new_message != nullptr);
   CHECK(old_message->message_id == new_message->message_id);
-  CHECK(old_message->random_y == new_message->random_y);
   CHECK(need_update_dialog_pos != nullptr);
 
   DialogId dialog_id = d->dialog_id;
@@ -22151,7 +22214,7 @@ MessagesManager::Dialog *MessagesManager::add_new_dialog(unique_ptr<Dialog> &&d,
     on_dialog_updated(dialog_id, "add_new_dialog");
   }
 
-  unique_ptr<Message> last_database_message = std::move(d->messages);
+  unique_ptr<Message> last_database_message = std::move(d->last_database_message);
   int64 order = d->order;
   d->order = DEFAULT_ORDER;
   int32 last_clear_history_date = d->last_clear_history_date;
@@ -22284,8 +22347,6 @@ MessagesManager::Dialog *MessagesManager::add_new_dialog(unique_ptr<Dialog> &&d,
 void MessagesManager::add_dialog_last_database_message(Dialog *d, unique_ptr<Message> &&last_database_message) {
   CHECK(d != nullptr);
   CHECK(last_database_message != nullptr);
-  CHECK(last_database_message->left == nullptr);
-  CHECK(last_database_message->right == nullptr);
 
   auto message_id = last_database_message->message_id;
   CHECK(d->last_database_message_id == message_id);
@@ -22596,8 +22657,8 @@ unique_ptr<MessagesManager::Dialog> MessagesManager::parse_dialog(DialogId dialo
 
   Dependencies dependencies;
   add_dialog_dependencies(dependencies, dialog_id);
-  if (d->messages != nullptr) {
-    add_message_dependencies(dependencies, dialog_id, d->messages.get());
+  if (d->last_database_message != nullptr) {
+    add_message_dependencies(dependencies, dialog_id, d->last_database_message.get());
   }
   resolve_dependencies_force(dependencies);
 
@@ -23156,7 +23217,6 @@ MessagesManager::Message *MessagesManager::continue_send_message(DialogId dialog
   }
 
   m->message_id = get_next_yet_unsent_message_id(d);
-  m->random_y = get_random_y(m->message_id);
   m->date = G()->unix_time();
   m->have_previous = true;
   m->have_next = true;
@@ -23354,7 +23414,6 @@ void MessagesManager::on_binlog_events(vector<BinlogEvent> &&events) {
         }
         for (auto &m : messages) {
           m->message_id = get_next_yet_unsent_message_id(to_dialog);
-          m->random_y = get_random_y(m->message_id);
           m->date = G()->unix_time();
           m->content = dup_message_content(to_dialog_id, m->content.get(), true);
           m->have_previous = true;
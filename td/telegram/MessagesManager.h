@@ -29,6 +29,7 @@
 #include "td/telegram/Game.h"
 #include "td/telegram/Global.h"
 #include "td/telegram/Location.h"
+#include "td/telegram/MessageCache.h"
 #include "td/telegram/MessageEntity.h"
 #include "td/telegram/MessageId.h"
 #include "td/telegram/MessagesDb.h"
@@ -43,6 +44,7 @@
 
 #include "td/utils/buffer.h"
 #include "td/utils/ChangesProcessor.h"
+#include "td/utils/ChunkedSortedMap.h"
 #include "td/utils/common.h"
 #include "td/utils/Heap.h"
 #include "td/utils/Hints.h"
@@ -51,6 +53,7 @@
 #include "td/utils/StringBuilder.h"
 #include "td/utils/tl_storers.h"
 
+#include <algorithm>
 #include <array>
 #include <functional>
 #include <limits>
@@ -1289,6 +1292,12 @@ class MessagesManager : public Actor {
 
   void get_payment_receipt(FullMessageId full_message_id, Promise<tl_object_ptr<td_api::paymentReceipt>> &&promise);
 
+  void on_update_message_cache_max_size();
+
+  int32 get_message_cache_size() const;
+
+  int32 get_message_cache_hit_rate() const;
+
   ActorOwn<MultiSequenceDispatcher> sequence_dispatcher_;
 
  private:
@@ -1365,8 +1374,6 @@ class MessagesManager : public Actor {
 
   // Do not forget to update MessagesManager::update_message when this class is changed
   struct Message {
-    int32 random_y;
-
     MessageId message_id;
     UserId sender_user_id;
     int32 date = 0;
@@ -1413,9 +1420,6 @@ class MessagesManager : public Actor {
 
     string public_link;
 
-    unique_ptr<Message> left;
-    unique_ptr<Message> right;
-
     int32 last_access_date = 0;
 
     uint64 send_message_logevent_id = 0;
@@ -1431,6 +1435,8 @@ class MessagesManager : public Actor {
     void parse(ParserT &parser);
   };
 
+  using MessagesMap = ChunkedSortedMap<int64, unique_ptr<Message>>;
+
   struct Dialog {
     DialogId dialog_id;
     MessageId last_new_message_id;  // identifier of the last known server message received from update, there should be
@@ -1476,6 +1482,9 @@ class MessagesManager : public Actor {
 
     bool is_opened = false;
 
+    int32 loaded_message_count = 0;     // number of messages in memory, memory only
+    mutable int32 last_access_date = 0;  // memory only, updated also on read-only access to messages
+
     bool need_restore_reply_markup = true;
 
     bool have_full_history = false;
@@ -1511,7 +1520,8 @@ class MessagesManager : public Actor {
 
     std::unordered_set<MessageId, MessageIdHash> pending_viewed_message_ids;
 
-    unique_ptr<Message> messages = nullptr;
+    MessagesMap messages;                      // message_id.get() -> Message
+    unique_ptr<Message> last_database_message;  // used only while the dialog is being loaded
 
     struct MessageOp {
       enum : int8 { Add, SetPts, Delete, DeleteAll } type;
@@ -1553,31 +1563,18 @@ class MessagesManager : public Actor {
   };
 
   class MessagesIteratorBase {
-    vector<const Message *> stack_;
+    MessagesMap::ConstIterator it_;
 
    protected:
     MessagesIteratorBase() = default;
 
     // points iterator to message with greatest id which is less or equal than message_id
-    MessagesIteratorBase(const Message *root, MessageId message_id) {
-      size_t last_right_pos = 0;
-      while (root != nullptr) {
-        //        LOG(DEBUG) << "root->message_id = " << root->message_id;
-        stack_.push_back(root);
-        if (root->message_id.get() <= message_id.get()) {
-          //          LOG(DEBUG) << "Go right";
-          last_right_pos = stack_.size();
-          root = root->right.get();
-        } else {
-          //          LOG(DEBUG) << "Go left";
-          root = root->left.get();
-        }
-      }
-      stack_.resize(last_right_pos);
+    MessagesIteratorBase(const MessagesMap &messages, MessageId message_id)
+        : it_(messages.find_less_or_equal(message_id.get())) {
     }
 
     const Message *operator*() const {
-      return stack_.empty() ? nullptr : stack_.back();
+      return it_ ? it_.value().get() : nullptr;
     }
 
     ~MessagesIteratorBase() = default;
@@ -1589,65 +1586,27 @@ class MessagesManager : public Actor {
     MessagesIteratorBase &operator=(MessagesIteratorBase &&other) = default;
 
     void operator++() {
-      if (stack_.empty()) {
+      if (!it_) {
         return;
       }
 
-      const Message *cur = stack_.back();
-      if (!cur->have_next) {
-        stack_.clear();
+      if (!it_.value()->have_next) {
+        it_ = MessagesMap::ConstIterator();
         return;
       }
-      if (cur->right == nullptr) {
-        while (true) {
-          stack_.pop_back();
-          if (stack_.empty()) {
-            return;
-          }
-          const Message *new_cur = stack_.back();
-          if (new_cur->left.get() == cur) {
-            return;
-          }
-          cur = new_cur;
-        }
-      }
-
-      cur = cur->right.get();
-      while (cur != nullptr) {
-        stack_.push_back(cur);
-        cur = cur->left.get();
-      }
+      ++it_;
     }
 
     void operator--() {
-      if (stack_.empty()) {
+      if (!it_) {
         return;
       }
 
-      const Message *cur = stack_.back();
-      if (!cur->have_previous) {
-        stack_.clear();
+      if (!it_.value()->have_previous) {
+        it_ = MessagesMap::ConstIterator();
         return;
       }
-      if (cur->left == nullptr) {
-        while (true) {
-          stack_.pop_back();
-          if (stack_.empty()) {
-            return;
-          }
-          const Message *new_cur = stack_.back();
-          if (new_cur->right.get() == cur) {
-            return;
-          }
-          cur = new_cur;
-        }
-      }
-
-      cur = cur->left.get();
-      while (cur != nullptr) {
-        stack_.push_back(cur);
-        cur = cur->right.get();
-      }
+      --it_;
     }
   };
 
@@ -1655,7 +1614,7 @@ class MessagesManager : public Actor {
    public:
     MessagesIterator() = default;
 
-    MessagesIterator(Dialog *d, MessageId message_id) : MessagesIteratorBase(d->messages.get(), message_id) {
+    MessagesIterator(Dialog *d, MessageId message_id) : MessagesIteratorBase(d->messages, message_id) {
     }
 
     Message *operator*() const {
@@ -1667,7 +1626,7 @@ class MessagesManager : public Actor {
    public:
     MessagesConstIterator() = default;
 
-    MessagesConstIterator(const Dialog *d, MessageId message_id) : MessagesIteratorBase(d->messages.get(), message_id) {
+    MessagesConstIterator(const Dialog *d, MessageId message_id) : MessagesIteratorBase(d->messages, message_id) {
     }
 
     const Message *operator*() const {
@@ -1894,9 +1853,18 @@ class MessagesManager : public Actor {
 
   void unload_dialog(DialogId dialog_id);
 
+  int32 unload_dialog_messages(Dialog *d, int32 unload_before_date);
+
+  void on_loaded_message_count_changed(Dialog *d, int32 diff);
+
+  void reduce_message_cache();
+
   void delete_all_dialog_messages(Dialog *d, bool remove_from_dialog_list, bool is_permanent);
 
-  void do_delete_all_dialog_messages(Dialog *d, unique_ptr<Message> &m, vector<int64> &deleted_message_ids);
+  void do_delete_all_dialog_messages(Dialog *d, vector<int64> &deleted_message_ids);
+
+  void do_delete_old_messages(Dialog *d, MessageId max_message_id, bool is_permanently_deleted,
+                              bool *need_update_dialog_pos, vector<int64> &deleted_message_ids, const char *source);
 
   void delete_messages_from_server(DialogId dialog_id, vector<MessageId> message_ids, bool revoke, uint64 logevent_id,
                                    Promise<Unit> &&promise);
@@ -1909,16 +1877,18 @@ class MessagesManager : public Actor {
 
   void read_all_dialog_mentions_on_server(DialogId dialog_id, uint64 logevent_id, Promise<Unit> &&promise);
 
-  static MessageId find_message_by_date(const unique_ptr<Message> &m, int32 date);
+  static MessageId find_message_by_date(const Dialog *d, int32 date);
+
+  static void find_messages_from_user(const Dialog *d, UserId user_id, vector<MessageId> &message_ids);
 
-  static void find_messages_from_user(const unique_ptr<Message> &m, UserId user_id, vector<MessageId> &message_ids);
+  static void find_unread_mentions(const Dialog *d, vector<MessageId> &message_ids);
 
-  static void find_unread_mentions(const unique_ptr<Message> &m, vector<MessageId> &message_ids);
+  static void find_old_messages(const Dialog *d, MessageId max_message_id, vector<MessageId> &message_ids);
 
-  static void find_old_messages(const unique_ptr<Message> &m, MessageId max_message_id, vector<MessageId> &message_ids);
+  static bool have_old_yet_unsent_messages(const Dialog *d, MessageId max_message_id);
 
-  void find_unloadable_messages(const Dialog *d, int32 unload_before_date, const unique_ptr<Message> &m,
-                                vector<MessageId> &message_ids, int32 &left_to_unload) const;
+  void find_unloadable_messages(const Dialog *d, int32 unload_before_date, vector<MessageId> &message_ids,
+                                int32 &left_to_unload) const;
 
   bool message_views_enabled(DialogId dialog_id) const;
 
@@ -1963,8 +1933,6 @@ class MessagesManager : public Actor {
   void load_messages(DialogId dialog_id, MessageId from_message_id, int32 offset, int32 limit, int left_tries,
                      bool only_local, Promise<Unit> &&promise);
 
-  static int32 get_random_y(MessageId message_id);
-
   bool is_allowed_useless_update(const tl_object_ptr<telegram_api::Update> &update) const;
 
   bool is_message_auto_read(DialogId dialog_id, bool is_outgoing, bool only_content) const;
@@ -2131,9 +2099,6 @@ class MessagesManager : public Actor {
   std::pair<int32, vector<DialogParticipant>> search_private_chat_participants(UserId my_user_id, UserId peer_user_id,
                                                                                const string &query, int32 limit) const;
 
-  static unique_ptr<Message> *find_message(unique_ptr<Message> *v, MessageId message_id);
-  static const unique_ptr<Message> *find_message(const unique_ptr<Message> *v, MessageId message_id);
-
   static Message *get_message(Dialog *d, MessageId message_id);
   static const Message *get_message(const Dialog *d, MessageId message_id);
 
@@ -2568,7 +2533,12 @@ class MessagesManager : public Actor {
   MultiTimeout pending_updated_dialog_timeout_;
   MultiTimeout pending_unload_dialog_timeout_;
 
-  Hints dialogs_hints_;  // search dialogs by title and username
+  MessageCache message_cache_;
+  bool is_message_cache_reduce_scheduled_ = false;
+  int64 message_cache_hit_count_ = 0;
+  int64 message_cache_miss_count_ = 0;
+
+  Hints<int64, int64> dialogs_hints_;  // search dialogs by title and username
 
   std::unordered_set<FullMessageId, FullMessageIdHash> active_live_location_full_message_ids_;
   bool are_active_live_location_messages_loaded_ = false;
@@ -22,6 +22,8 @@
 #include "td/utils/Slice.h"
 #include "td/utils/Time.h"
 
+#include <algorithm>
+
 namespace td {
 StorageManager::StorageManager(ActorShared<> parent, int32 scheduler_id)
     : parent_(std::move(parent)), scheduler_id_(scheduler_id) {
@@ -32,8 +34,13 @@ void StorageManager::start_up() {
   schedule_next_gc();
 
   load_fast_stat();
+  load_file_stats();
 }
-void StorageManager::on_new_file(int64 size) {
+void StorageManager::on_new_file(int64 size, FileType file_type, DialogId owner_dialog_id) {
+  if (file_type == FileType::Temp) {
+    // partial files aren't tracked, so they are excluded from results of full files scans too
+    return;
+  }
   if (size > 0) {
     fast_stat_.cnt++;
   } else {
@@ -46,6 +53,25 @@ void StorageManager::on_new_file(int64 size) {
     fast_stat_ = FileTypeStat();
   }
   save_fast_stat();
+
+  if (!file_stats_.is_inited()) {
+    return;
+  }
+  if (!G()->parameters().use_chat_info_db) {
+    owner_dialog_id = DialogId();
+  }
+  if (!file_stats_.add_file(owner_dialog_id, file_type, size)) {
+    LOG(ERROR) << "Wrong file stats of " << owner_dialog_id << " after adding size " << size;
+    drop_file_stats();
+    schedule_file_stats_rescan();
+    return;
+  }
+  // fast stat is saved at once, while stats by owner are saved in batches to reduce the number of binlog writes
+  unsaved_file_stats_owner_dialog_ids_.insert(owner_dialog_id);
+  if (save_file_stats_at_ == 0) {
+    save_file_stats_at_ = Time::now() + FILE_STATS_SAVE_DELAY;
+    update_timeout();
+  }
 }
 void StorageManager::get_storage_stats(int32 dialog_limit, Promise<FileStats> promise) {
   if (pending_storage_stats_.size() != 0) {
@@ -55,8 +81,15 @@ void StorageManager::get_storage_stats(int32 dialog_limit, Promise<FileStats> pr
   stats_dialog_limit_ = dialog_limit;
   pending_storage_stats_.emplace_back(std::move(promise));
 
+  if (file_stats_.is_inited()) {
+    return send_stats(get_file_stats(stats_dialog_limit_ != 0), stats_dialog_limit_,
+                      std::move(pending_storage_stats_));
+  }
+
   create_stats_worker();
-  send_closure(stats_worker_, &FileStatsWorker::get_stats, false /*need_all_files*/, stats_dialog_limit_ != 0,
+  send_closure(stats_worker_, &FileStatsWorker::get_stats, false /*need_all_files*/,
+               true /*split_by_owner_dialog_id*/,
+               stats_cancellation_token_source_.get_cancellation_token(),
                PromiseCreator::lambda([actor_id = actor_id(this)](Result<FileStats> file_stats) {
                  send_closure(actor_id, &StorageManager::on_file_stats, std::move(file_stats), false);
                }));
@@ -84,9 +117,10 @@ void StorageManager::run_gc(FileGcParameters parameters, Promise<FileStats> prom
   gc_parameters_ = std::move(parameters);
 
   create_stats_worker();
+  // files are always split by owner, so the GC result can replace incrementally updated file stats
   send_closure(stats_worker_, &FileStatsWorker::get_stats, true /*need_all_file*/,
-               !gc_parameters_.owner_dialog_ids.empty() || !gc_parameters_.exclude_owner_dialog_ids.empty() ||
-                   gc_parameters_.dialog_limit != 0 /*split_by_owner_dialog_id*/,
+               true /*split_by_owner_dialog_id*/,
+               stats_cancellation_token_source_.get_cancellation_token(),
                PromiseCreator::lambda([actor_id = actor_id(this)](Result<FileStats> file_stats) {
                  send_closure(actor_id, &StorageManager::on_all_files, std::move(file_stats), false);
                }));
@@ -101,12 +135,24 @@ void StorageManager::on_file_stats(Result<FileStats> r_file_stats, bool dummy) {
     return;
   }
 
-  send_stats(r_file_stats.move_as_ok(), stats_dialog_limit_, std::move(pending_storage_stats_));
+  auto file_stats = r_file_stats.move_as_ok();
+  on_full_file_stats(file_stats);
+  if (file_stats_.is_inited()) {
+    file_stats = get_file_stats(stats_dialog_limit_ != 0);
+  }
+  send_stats(std::move(file_stats), stats_dialog_limit_, std::move(pending_storage_stats_));
 }
 
 void StorageManager::create_stats_worker() {
   if (stats_worker_.empty()) {
-    stats_worker_ = create_actor_on_scheduler<FileStatsWorker>("FileStatsWorker", scheduler_id_, create_reference());
+    // stat calls block, so they are made on schedulers, which aren't used by time-critical actors
+    auto stat_scheduler_ids = G()->get_database_reader_scheduler_ids();
+    stat_scheduler_ids.push_back(G()->get_file_io_scheduler_id());
+    std::sort(stat_scheduler_ids.begin(), stat_scheduler_ids.end());
+    stat_scheduler_ids.erase(std::unique(stat_scheduler_ids.begin(), stat_scheduler_ids.end()),
+                             stat_scheduler_ids.end());
+    stats_worker_ = create_actor_on_scheduler<FileStatsWorker>("FileStatsWorker", scheduler_id_, create_reference(),
+                                                               std::move(stat_scheduler_ids));
   }
 }
 
@@ -159,7 +205,12 @@ void StorageManager::on_gc_finished(Result<FileStats> r_file_stats, bool dummy)
     return;
   }
 
-  send_stats(r_file_stats.move_as_ok(), gc_parameters_.dialog_limit, std::move(pending_run_gc_));
+  auto file_stats = r_file_stats.move_as_ok();
+  on_full_file_stats(file_stats);
+  if (gc_parameters_.dialog_limit == 0) {
+    file_stats.merge_owner_dialog_stats();
+  }
+  send_stats(std::move(file_stats), gc_parameters_.dialog_limit, std::move(pending_run_gc_));
 }
 
 void StorageManager::save_fast_stat() {
@@ -172,10 +223,113 @@ void StorageManager::load_fast_stat() {
   }
 }
 
-void StorageManager::send_stats(FileStats &&stats, int32 dialog_limit, std::vector<Promise<FileStats>> promises) {
+FileStats StorageManager::get_file_stats(bool split_by_owner_dialog_id) const {
+  return file_stats_.get_file_stats(split_by_owner_dialog_id && G()->parameters().use_chat_info_db);
+}
+
+void StorageManager::on_full_file_stats(const FileStats &stats) {
   fast_stat_ = stats.get_total_nontemp_stat();
   save_fast_stat();
 
+  if (!stats.split_by_owner_dialog_id && G()->parameters().use_chat_info_db) {
+    // stats by owner can't be restored, so keep the incrementally updated ones
+    return;
+  }
+
+  drop_file_stats();
+  file_stats_.on_full_file_stats(stats);
+  for (auto &it : file_stats_.get_stat_by_owner_dialog_id()) {
+    save_file_stats(it.first);
+  }
+  G()->td_db()->get_binlog_pmc()->set("file_stats_inited", "1");
+  if (rescan_file_stats_at_ != 0) {
+    rescan_file_stats_at_ = 0;
+    update_timeout();
+  }
+}
+
+void StorageManager::save_file_stats(DialogId owner_dialog_id) {
+  auto &stat_by_owner_dialog_id = file_stats_.get_stat_by_owner_dialog_id();
+  auto it = stat_by_owner_dialog_id.find(owner_dialog_id);
+  CHECK(it != stat_by_owner_dialog_id.end());
+  G()->td_db()->get_binlog_pmc()->set(PSTRING() << "file_stats#" << owner_dialog_id.get(),
+                                      log_event_store(it->second).as_slice().str());
+}
+
+void StorageManager::save_unsaved_file_stats() {
+  save_file_stats_at_ = 0;
+  auto owner_dialog_ids = std::move(unsaved_file_stats_owner_dialog_ids_);
+  unsaved_file_stats_owner_dialog_ids_.clear();
+  if (!file_stats_.is_inited()) {
+    return;
+  }
+  for (auto owner_dialog_id : owner_dialog_ids) {
+    save_file_stats(owner_dialog_id);
+  }
+}
+
+void StorageManager::load_file_stats() {
+  auto binlog_pmc = G()->td_db()->get_binlog_pmc();
+  if (binlog_pmc->get("file_stats_inited").empty()) {
+    return;
+  }
+  file_stats_.on_full_file_stats(FileStats());
+  bool is_ok = true;
+  binlog_pmc->prefix_for_each("file_stats#", [&](Slice key, Slice value) {
+    auto owner_dialog_id = DialogId(to_integer<int64>(key.substr(Slice("file_stats#").size())));
+    FileStats::StatByType stat_by_type;
+    if (log_event_parse(stat_by_type, value).is_error()) {
+      LOG(ERROR) << "Failed to parse file stats of " << owner_dialog_id;
+      is_ok = false;
+      return;
+    }
+    file_stats_.set_owner_dialog_stats(owner_dialog_id, stat_by_type);
+  });
+  if (!is_ok) {
+    drop_file_stats();
+    schedule_file_stats_rescan();
+  }
+}
+
+void StorageManager::drop_file_stats() {
+  file_stats_.drop();
+  unsaved_file_stats_owner_dialog_ids_.clear();
+  save_file_stats_at_ = 0;
+  G()->td_db()->get_binlog_pmc()->erase_by_prefix("file_stats");
+}
+
+// without the rescan the stats would be unknown until the next GC
+void StorageManager::schedule_file_stats_rescan() {
+  if (rescan_file_stats_at_ == 0) {
+    rescan_file_stats_at_ = Time::now() + FILE_STATS_RESCAN_DELAY;
+  }
+  update_timeout();
+}
+
+void StorageManager::rescan_file_stats() {
+  rescan_file_stats_at_ = 0;
+  if (file_stats_.is_inited()) {
+    return;
+  }
+  create_stats_worker();
+  send_closure(stats_worker_, &FileStatsWorker::get_stats, false /*need_all_files*/,
+               true /*split_by_owner_dialog_id*/, stats_cancellation_token_source_.get_cancellation_token(),
+               PromiseCreator::lambda([actor_id = actor_id(this)](Result<FileStats> file_stats) {
+                 send_closure(actor_id, &StorageManager::on_file_stats_rescanned, std::move(file_stats), false);
+               }));
+}
+
+void StorageManager::on_file_stats_rescanned(Result<FileStats> r_file_stats, bool dummy) {
+  if (r_file_stats.is_error()) {
+    LOG(ERROR) << "Failed to rescan file stats: " << r_file_stats.error();
+    return;
+  }
+  if (!file_stats_.is_inited()) {
+    on_full_file_stats(r_file_stats.ok());
+  }
+}
+
+void StorageManager::send_stats(FileStats &&stats, int32 dialog_limit, std::vector<Promise<FileStats>> promises) {
   stats.apply_dialog_limit(dialog_limit);
   std::vector<DialogId> dialog_ids = stats.get_dialog_ids();
 
@@ -201,6 +355,9 @@ void StorageManager::hangup_shared() {
 }
 
 void StorageManager::hangup() {
+  save_unsaved_file_stats();
+  // don't wait for the end of a long files scan
+  stats_cancellation_token_source_.cancel();
   hangup_shared();
 }
 
@@ -216,7 +373,7 @@ void StorageManager::schedule_next_gc() {
   if (!G()->shared_config().get_option_boolean("use_storage_optimizer") &&
       !G()->parameters().enable_storage_optimizer) {
     next_gc_at_ = 0;
-    cancel_timeout();
+    update_timeout();
     LOG(INFO) << "No next file gc is scheduled";
     return;
   }
@@ -235,14 +392,37 @@ void StorageManager::schedule_next_gc() {
 
   LOG(INFO) << "Schedule next file gc in " << next_gc_in;
   next_gc_at_ = Time::now() + next_gc_in;
-  set_timeout_at(next_gc_at_);
+  update_timeout();
+}
+
+// the actor timeout is shared by the GC, saving of file stats and their rescan
+void StorageManager::update_timeout() {
+  double timeout_at = 0;
+  for (auto at : {next_gc_at_, save_file_stats_at_, rescan_file_stats_at_}) {
+    if (at != 0 && (timeout_at == 0 || at < timeout_at)) {
+      timeout_at = at;
+    }
+  }
+  if (timeout_at == 0) {
+    cancel_timeout();
+  } else {
+    set_timeout_at(timeout_at);
+  }
 }
 
 void StorageManager::timeout_expired() {
-  if (next_gc_at_ == 0) {
-    return;
+  auto now = Time::now();
+  if (save_file_stats_at_ != 0 && save_file_stats_at_ <= now) {
+    save_unsaved_file_stats();
+  }
+  if (rescan_file_stats_at_ != 0 && rescan_file_stats_at_ <= now) {
+    rescan_file_stats();
+  }
+  if (next_gc_at_ == 0 || next_gc_at_ > now) {
+    return update_timeout();
   }
   next_gc_at_ = 0;
+  update_timeout();
   run_gc({}, PromiseCreator::lambda([actor_id = actor_id(this)](Result<FileStats> r_stats) {
            if (!r_stats.is_error() || r_stats.error().code() != 1) {
              send_closure(actor_id, &StorageManager::save_last_gc_timestamp);
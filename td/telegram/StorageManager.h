@@ -9,12 +9,16 @@
 #include "td/actor/actor.h"
 #include "td/actor/PromiseFuture.h"
 
+#include "td/telegram/DialogId.h"
 #include "td/telegram/files/FileGcWorker.h"
 #include "td/telegram/files/FileStats.h"
 
+#include "td/utils/CancellationToken.h"
 #include "td/utils/common.h"
 #include "td/utils/Status.h"
 
+#include <unordered_set>
+
 namespace td {
 class FileStatsWorker;
 class FileGcWorker;
@@ -28,12 +32,14 @@ class StorageManager : public Actor {
   void get_storage_stats_fast(Promise<FileStatsFast> promise);
   void run_gc(FileGcParameters parameters, Promise<FileStats> promise);
   void update_use_storage_optimizer();
-  void on_new_file(int64 size);
+  void on_new_file(int64 size, FileType file_type, DialogId owner_dialog_id);
 
  private:
   static constexpr uint32 GC_EACH = 60 * 60 * 24;  // 1 day
   static constexpr uint32 GC_DELAY = 60;
   static constexpr uint32 GC_RAND_DELAY = 60 * 15;
+  static constexpr int32 FILE_STATS_SAVE_DELAY = 10;
+  static constexpr int32 FILE_STATS_RESCAN_DELAY = 60;
 
   ActorShared<> parent_;
 
@@ -41,17 +47,35 @@ class StorageManager : public Actor {
 
   // get stats
   ActorOwn<FileStatsWorker> stats_worker_;
+  CancellationTokenSource stats_cancellation_token_source_;
   std::vector<Promise<FileStats>> pending_storage_stats_;
   int32 stats_dialog_limit_ = 0;
 
   FileTypeStat fast_stat_;
 
+  // incrementally updated file stats, which are known only after a full files scan
+  FileStatsCounter file_stats_;
+  // owners, whose changed file stats aren't saved yet; they are saved together after a delay
+  std::unordered_set<DialogId, DialogIdHash> unsaved_file_stats_owner_dialog_ids_;
+  double save_file_stats_at_ = 0;
+  double rescan_file_stats_at_ = 0;
+
   void on_file_stats(Result<FileStats> r_file_stats, bool dummy);
   void create_stats_worker();
+  void on_full_file_stats(const FileStats &stats);
   void send_stats(FileStats &&stats, int32 dialog_limit, std::vector<Promise<FileStats>> promises);
 
   void save_fast_stat();
   void load_fast_stat();
+
+  FileStats get_file_stats(bool split_by_owner_dialog_id) const;
+  void save_file_stats(DialogId owner_dialog_id);
+  void save_unsaved_file_stats();
+  void load_file_stats();
+  void drop_file_stats();
+  void schedule_file_stats_rescan();
+  void rescan_file_stats();
+  void on_file_stats_rescanned(Result<FileStats> r_file_stats, bool dummy);
   static int64 get_db_size();
 
   // RefCnt
@@ -77,6 +101,7 @@ class StorageManager : public Actor {
   void save_last_gc_timestamp();
   void schedule_next_gc();
 
+  void update_timeout();
   void timeout_expired() override;
 };
 }  // namespace td
@@ -3710,6 +3710,8 @@ void Td::on_config_option_updated(const string &name) {
     G()->net_query_dispatcher().update_use_pfs();
   } else if (name == "use_storage_optimizer") {
     send_closure(storage_manager_, &StorageManager::update_use_storage_optimizer);
+  } else if (name == "message_cache_max_size") {
+    messages_manager_->on_update_message_cache_max_size();
   } else if (name == "rating_e_decay") {
     return send_closure(top_dialog_manager_, &TopDialogManager::update_rating_e_decay);
   } else if (name == "call_ring_timeout_ms" || name == "call_receive_timeout_ms" ||
@@ -4040,12 +4042,10 @@ class Td::UploadFileCallback : public FileManager::UploadCallback {
 };
 
 Status Td::init(DbKey key) {
-  auto current_scheduler_id = Scheduler::instance()->sched_id();
-  auto scheduler_count = Scheduler::instance()->sched_count();
+  G()->init_scheduler_ids(parameters_.use_message_db);
 
   TdDb::Events events;
-  TRY_RESULT(td_db,
-             TdDb::open(std::min(current_scheduler_id + 1, scheduler_count - 1), parameters_, std::move(key), events));
+  TRY_RESULT(td_db, TdDb::open(G()->get_database_scheduler_id(), parameters_, std::move(key), events));
   LOG(INFO) << "Successfully inited database in " << tag("database_directory", parameters_.database_directory)
             << " and " << tag("files_directory", parameters_.files_directory);
   G()->init(parameters_, actor_id(this), std::move(td_db)).ensure();
@@ -4114,8 +4114,8 @@ Status Td::init(DbKey key) {
    public:
     explicit FileManagerContext(Td *td) : td_(td) {
     }
-    void on_new_file(int64 size) final {
-      send_closure(G()->storage_manager(), &StorageManager::on_new_file, size);
+    void on_new_file(int64 size, FileType file_type, DialogId owner_dialog_id) final {
+      send_closure(G()->storage_manager(), &StorageManager::on_new_file, size, file_type, owner_dialog_id);
     }
     void on_file_updated(FileId file_id) final {
       send_closure(G()->td(), &Td::send_update,
@@ -4171,8 +4171,7 @@ Status Td::init(DbKey key) {
   privacy_manager_ = create_actor<PrivacyManager>("PrivacyManager", create_reference());
   secret_chats_manager_ = create_actor<SecretChatsManager>("SecretChatsManager", create_reference());
   G()->set_secret_chats_manager(secret_chats_manager_.get());
-  storage_manager_ = create_actor<StorageManager>("StorageManager", create_reference(),
-                                                  std::min(current_scheduler_id + 2, scheduler_count - 1));
+  storage_manager_ = create_actor<StorageManager>("StorageManager", create_reference(), G()->get_gc_scheduler_id());
   G()->set_storage_manager(storage_manager_.get());
   top_dialog_manager_ = create_actor<TopDialogManager>("TopDialogManager", create_reference());
   G()->set_top_dialog_manager(top_dialog_manager_.get());
@@ -4348,6 +4347,13 @@ Status Td::fix_parameters(TdParameters &parameters) {
   if (parameters.api_hash.empty()) {
     return Status::Error(400, "Valid api_hash must be provided. Can be obtained at https://my.telegram.org");
   }
+  if (parameters.database_wal_autocheckpoint < 0 || parameters.database_checkpoint_period < 0 ||
+      parameters.database_mmap_size < 0) {
+    return Status::Error(400, "Wrong database parameters specified");
+  }
+  if (parameters.database_wal_autocheckpoint == 0 && parameters.database_checkpoint_period == 0) {
+    return Status::Error(400, "Database checkpoints can't be disabled both on commit and by period");
+  }
 
   auto prepare_dir = [](string dir) -> Result<string> {
     CHECK(!dir.empty());
@@ -4396,6 +4402,17 @@ Status Td::set_td_parameters(td_api::object_ptr<td_api::tdlibParameters> paramet
   parameters_.use_secret_chats = parameters->use_secret_chats_;
   parameters_.use_chat_info_db = parameters->use_chat_info_database_;
   parameters_.use_message_db = parameters->use_message_database_;
+  // zero values mean that the defaults are used
+  if (parameters->database_wal_autocheckpoint_ != 0) {
+    parameters_.database_wal_autocheckpoint =
+        parameters->database_wal_autocheckpoint_ == -1 ? 0 : parameters->database_wal_autocheckpoint_;
+  }
+  parameters_.database_checkpoint_period = parameters->database_checkpoint_period_;
+  parameters_.database_mmap_size = parameters->database_mmap_size_;
+  if (parameters->database_cache_size_ != 0) {
+    parameters_.database_cache_size = parameters->database_cache_size_;
+  }
+  parameters_.database_secure_delete = !parameters->disable_database_secure_delete_;
 
   TRY_STATUS(fix_parameters(parameters_));
   TRY_RESULT(encryption_info, TdDb::check_encryption(parameters_));
@@ -6066,6 +6083,13 @@ void Td::on_request(uint64 id, td_api::getOption &request) {
 
   tl_object_ptr<td_api::OptionValue> option_value;
   switch (request.name_[0]) {
+    case 'm':
+      if (request.name_ == "message_cache_size") {
+        option_value = make_tl_object<td_api::optionValueInteger>(messages_manager_->get_message_cache_size());
+      } else if (request.name_ == "message_cache_hit_rate") {
+        option_value = make_tl_object<td_api::optionValueInteger>(messages_manager_->get_message_cache_hit_rate());
+      }
+      break;
     case 'o':
       if (request.name_ == "online") {
         option_value = make_tl_object<td_api::optionValueBoolean>(is_online_);
@@ -6137,6 +6161,11 @@ void Td::on_request(uint64 id, td_api::setOption &request) {
         return;
       }
       break;
+    case 'm':
+      if (set_integer_option("message_cache_max_size")) {
+        return;
+      }
+      break;
     case 'o':
       if (request.name_ == "online") {
         if (value_constructor_id != td_api::optionValueBoolean::ID &&
@@ -8,6 +8,7 @@
 
 #include "td/telegram/DialogDb.h"
 #include "td/telegram/files/FileDb.h"
+#include "td/telegram/Global.h"
 #include "td/telegram/logevent/LogEvent.h"
 #include "td/telegram/MessagesDb.h"
 #include "td/telegram/TdParameters.h"
@@ -16,6 +17,7 @@
 #include "td/actor/MultiPromise.h"
 
 #include "td/db/BinlogKeyValue.h"
+#include "td/db/SqliteCheckpointer.h"
 
 #include "td/utils/logging.h"
 #include "td/utils/port/path.h"
@@ -105,10 +107,7 @@ Status init_db(SqliteDb &db) {
   TRY_STATUS(db.exec("PRAGMA encoding=\"UTF-8\""));
   TRY_STATUS(db.exec("PRAGMA journal_mode=WAL"));
 
-  TRY_STATUS(db.exec("PRAGMA synchronous=NORMAL"));
-  TRY_STATUS(db.exec("PRAGMA temp_store=MEMORY"));
-  TRY_STATUS(db.exec("PRAGMA secure_delete=1"));
-
+  // other settings are applied to each connection by SqliteConnectionSafe
   return Status::OK();
 }
 
@@ -196,6 +195,11 @@ void TdDb::do_close(Promise<> on_finished, bool destroy_flag) {
       }));
   auto lock = mpas.get_promise();
 
+  if (sqlite_checkpointer_) {
+    sqlite_checkpointer_->close(mpas.get_promise());
+    sqlite_checkpointer_.reset();
+  }
+
   if (file_db_) {
     file_db_->close(mpas.get_promise());
     file_db_.reset();
@@ -250,7 +254,12 @@ Status TdDb::init_sqlite(int32 scheduler_id, const TdParameters &parameters, DbK
 
   sqlite_path_ = sql_db_name;
   TRY_STATUS(SqliteDb::change_key(sqlite_path_, key, old_key));
-  sql_connection_ = std::make_shared<SqliteConnectionSafe>(sql_db_name, key);
+  SqliteConnectionOptions connection_options;
+  connection_options.wal_autocheckpoint = parameters.database_wal_autocheckpoint;
+  connection_options.mmap_size = parameters.database_mmap_size;
+  connection_options.cache_size = parameters.database_cache_size;
+  connection_options.secure_delete = parameters.database_secure_delete;
+  sql_connection_ = std::make_shared<SqliteConnectionSafe>(sql_db_name, key, connection_options);
   auto &db = sql_connection_->get();
 
   TRY_STATUS(init_db(db));
@@ -318,7 +327,14 @@ Status TdDb::init_sqlite(int32 scheduler_id, const TdParameters &parameters, DbK
 
   if (use_message_db) {
     messages_db_sync_safe_ = create_messages_db_sync(sql_connection_);
-    messages_db_async_ = create_messages_db_async(messages_db_sync_safe_, scheduler_id);
+    messages_db_async_ = create_messages_db_async(messages_db_sync_safe_, scheduler_id,
+                                                  G()->get_database_reader_scheduler_ids());
+  }
+
+  if (parameters.database_checkpoint_period > 0) {
+    // checkpoints are done on the same scheduler as garbage collection, away from the database writer
+    sqlite_checkpointer_ = std::make_unique<SqliteCheckpointer>(sql_connection_, parameters.database_checkpoint_period,
+                                                                G()->get_gc_scheduler_id());
   }
 
   return Status::OK();
@@ -26,6 +26,7 @@
 
 namespace td {
 
+class SqliteCheckpointer;
 class SqliteConnectionSafe;
 class SqliteKeyValueSafe;
 class SqliteKeyValueAsyncInterface;
@@ -96,6 +97,7 @@ class TdDb {
  private:
   string sqlite_path_;
   std::shared_ptr<SqliteConnectionSafe> sql_connection_;
+  std::unique_ptr<SqliteCheckpointer> sqlite_checkpointer_;
 
   std::shared_ptr<FileDbInterface> file_db_;
 
@@ -23,6 +23,13 @@ struct TdParameters {
   bool use_secret_chats = false;
   bool use_chat_info_db = false;
   bool use_message_db = false;
+
+  // sqlite database tuning, see SqliteConnectionOptions
+  std::int32_t database_wal_autocheckpoint = 1000;
+  std::int32_t database_checkpoint_period = 0;  // in seconds; 0 disables background checkpoints
+  std::int64_t database_mmap_size = 0;
+  std::int32_t database_cache_size = -2000;
+  bool database_secure_delete = true;
 };
 
 }  // namespace td
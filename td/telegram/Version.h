@@ -32,6 +32,7 @@ enum class DbVersion : int32 {
   MessagesDbFts,
   MessagesCallIndex,
   FixFileRemoteLocationKeyBug,
+  MessagesDbMediaIndexTable,
   Next
 };
 
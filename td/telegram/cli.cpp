@@ -211,12 +211,14 @@ StringBuilder &operator<<(StringBuilder &sb, const SendMessageInfo &info) {
 
 class CliClient final : public Actor {
  public:
-  CliClient(bool use_test_dc, bool get_chat_list, bool disable_network, int32 api_id, string api_hash)
+  CliClient(bool use_test_dc, bool get_chat_list, bool disable_network, int32 api_id, string api_hash,
+            int32 database_checkpoint_period)
       : use_test_dc_(use_test_dc)
       , get_chat_list_(get_chat_list)
       , disable_network_(disable_network)
       , api_id_(api_id)
-      , api_hash_(api_hash) {
+      , api_hash_(api_hash)
+      , database_checkpoint_period_(database_checkpoint_period) {
   }
 
   static void quit_instance() {
@@ -630,6 +632,7 @@ class CliClient final : public Actor {
     parameters->device_model_ = "Desktop";
     parameters->system_version_ = "Unknown";
     parameters->application_version_ = "tg_cli";
+    parameters->database_checkpoint_period_ = database_checkpoint_period_;
     send_request(td_api::make_object<td_api::setTdlibParameters>(std::move(parameters)));
     send_request(td_api::make_object<td_api::checkDatabaseEncryptionKey>());
   }
@@ -2774,6 +2777,7 @@ class CliClient final : public Actor {
   bool disable_network_ = false;
   int api_id_ = 0;
   std::string api_hash_;
+  int32 database_checkpoint_period_ = 0;
 
 #if TD_WINDOWS
   ActorOwn<> stdin_reader_;
@@ -2812,6 +2816,7 @@ void main(int argc, char **argv) {
   bool use_test_dc = false;
   bool get_chat_list = false;
   bool disable_network = false;
+  int32 database_checkpoint_period = 0;
   auto api_id = [](auto x) -> int32 {
     if (x) {
       return td::to_integer<int32>(Slice(x));
@@ -2866,6 +2871,11 @@ void main(int argc, char **argv) {
         return usage();
       }
       api_hash = argv[++i];
+    } else if (!std::strcmp(argv[i], "--database-checkpoint-period")) {
+      if (i + 1 >= argc) {
+        return usage();
+      }
+      database_checkpoint_period = td::to_integer<int32>(Slice(argv[++i]));
     }
   }
 
@@ -2878,10 +2888,12 @@ void main(int argc, char **argv) {
 
   {
     ConcurrentScheduler scheduler;
-    scheduler.init(4);
+    // database reader schedulers are started only if the message database is used
+    scheduler.init(7, {5, 6});
 
     scheduler
-        .create_actor_unsafe<CliClient>(0, "CliClient", use_test_dc, get_chat_list, disable_network, api_id, api_hash)
+        .create_actor_unsafe<CliClient>(0, "CliClient", use_test_dc, get_chat_list, disable_network, api_id, api_hash,
+                                        database_checkpoint_period)
         .release();
 
     scheduler.start();
@@ -22,22 +22,23 @@
 #include "td/utils/Slice.h"
 
 #include <algorithm>
-#include <tuple>
 
 namespace td {
 
 FileDownloader::FileDownloader(const FullRemoteFileLocation &remote, const LocalFileLocation &local, int64 size,
                                string name, const FileEncryptionKey &encryption_key, bool is_small,
-                               std::unique_ptr<Callback> callback)
+                               ActorId<FileIoWorker> io_worker, std::unique_ptr<Callback> callback)
     : remote_(remote)
     , local_(local)
     , size_(size)
     , name_(std::move(name))
     , encryption_key_(encryption_key)
+    , io_worker_(io_worker)
     , callback_(std::move(callback))
     , is_small_(is_small) {
   if (!encryption_key.empty()) {
     set_ordered_flag(true);
+    aes_ige_state_.init(encryption_key_.key(), false);
   }
 }
 
@@ -61,7 +62,7 @@ Result<FileLoader::FileInfo> FileDownloader::init() {
         encryption_key_.mutable_iv() = as<UInt256>(partial.iv_.data());
         next_part_ = partial.ready_part_count_;
       }
-      fd_ = result_fd.move_as_ok();
+      fd_ = std::make_shared<FileFd>(result_fd.move_as_ok());
       part_size = partial.part_size_;
       offset = partial.ready_part_count_;
     }
@@ -83,12 +84,12 @@ Status FileDownloader::on_ok(int64 size) {
   auto dir = get_files_dir(remote_.type_);
 
   TRY_RESULT(perm_path, create_from_temp(path_, dir, name_));
-  fd_.close();
+  fd_.reset();
   callback_->on_ok(FullLocalFileLocation(remote_.type_, std::move(perm_path), 0), size);
   return Status::OK();
 }
 void FileDownloader::on_error(Status status) {
-  fd_.close();
+  fd_.reset();
   callback_->on_error(std::move(status));
 }
 
@@ -214,7 +215,7 @@ Result<std::pair<NetQueryPtr, bool>> FileDownloader::start_part(Part part, int32
   return std::make_pair(std::move(net_query), false);
 }
 
-Result<size_t> FileDownloader::process_part(Part part, NetQueryPtr net_query) {
+Status FileDownloader::process_part(Part part, NetQueryPtr net_query, Promise<size_t> promise) {
   if (net_query->is_error()) {
     return std::move(net_query->error());
   }
@@ -258,7 +259,8 @@ Result<size_t> FileDownloader::process_part(Part part, NetQueryPtr net_query) {
     return Status::Error("Part size is more than requested");
   }
   if (bytes.empty()) {
-    return 0;
+    promise.set_value(0);
+    return Status::OK();
   }
 
   // Encryption
@@ -282,17 +284,26 @@ Result<size_t> FileDownloader::process_part(Part part, NetQueryPtr net_query) {
     if (part.size % 16 != 0) {
       next_part_stop_ = true;
     }
-    aes_ige_decrypt(encryption_key_.key(), &encryption_key_.mutable_iv(), bytes.as_slice(), bytes.as_slice());
+    aes_ige_state_.decrypt(&encryption_key_.mutable_iv(), bytes.as_slice(), bytes.as_slice());
+    // the part is saved asynchronously, so remember iv for the partial location until it is written
+    part_iv_[next_part_] = encryption_key_.mutable_iv();
   }
 
-  auto slice = bytes.as_slice().truncate(part.size);
+  bytes.truncate(part.size);
   TRY_STATUS(acquire_fd());
-  TRY_RESULT(written, fd_.pwrite(slice, part.offset));
-  // may write less than part.size, when size of downloadable file is unknown
-  if (written != slice.size()) {
-    return Status::Error("Failed to save file part to the file");
-  }
-  return written;
+  auto size = bytes.size();
+  send_closure(io_worker_, &FileIoWorker::pwrite, fd_, part.offset, std::move(bytes),
+               PromiseCreator::lambda([size, promise = std::move(promise)](Result<size_t> r_written) mutable {
+                 if (r_written.is_error()) {
+                   return promise.set_error(r_written.move_as_error());
+                 }
+                 // may write less than part.size, when size of downloadable file is unknown
+                 if (r_written.ok() != size) {
+                   return promise.set_error(Status::Error("Failed to save file part to the file"));
+                 }
+                 promise.set_value(r_written.move_as_ok());
+               }));
+  return Status::OK();
 }
 void FileDownloader::on_progress(int32 part_count, int32 part_size, int32 ready_part_count, bool is_ready,
                                  int64 ready_size) {
@@ -308,8 +319,11 @@ void FileDownloader::on_progress(int32 part_count, int32 part_size, int32 ready_
                                    ready_size);
   } else {
     UInt256 iv;
+    part_iv_.erase(part_iv_.begin(), part_iv_.lower_bound(ready_part_count));
     if (ready_part_count == next_part_) {
       iv = encryption_key_.mutable_iv();
+    } else if (!part_iv_.empty() && part_iv_.begin()->first == ready_part_count) {
+      iv = part_iv_.begin()->second;
     } else {
       LOG(FATAL) << tag("ready_part_count", ready_part_count) << tag("next_part", next_part_);
     }
@@ -334,11 +348,18 @@ Result<FileLoader::CheckInfo> FileDownloader::check_loop(int64 checked_prefix_si
   if (!need_check_) {
     return CheckInfo{};
   }
+  if (hash_check_status_.is_error()) {
+    return std::move(hash_check_status_);
+  }
   SCOPE_EXIT {
     try_release_fd();
   };
   CheckInfo info;
+  checked_prefix_size = std::max(checked_prefix_size, hash_checked_prefix_size_);
   while (checked_prefix_size < ready_prefix_size) {
+    if (has_hash_read_) {
+      break;
+    }
     //LOG(ERROR) << "NEED TO CHECK: " << checked_prefix_size << "->" << ready_prefix_size - checked_prefix_size;
     HashInfo search_info;
     search_info.offset = checked_prefix_size;
@@ -357,21 +378,15 @@ Result<FileLoader::CheckInfo> FileDownloader::check_loop(int64 checked_prefix_si
         end_offset = ready_prefix_size;
       }
       size_t size = narrow_cast<size_t>(end_offset - begin_offset);
-      auto slice = BufferSlice(size);
       TRY_STATUS(acquire_fd());
-      TRY_RESULT(read_size, fd_.pread(slice.as_slice(), begin_offset));
-      if (size != read_size) {
-        return Status::Error("Failed to read file to check hash");
-      }
-      string hash(32, ' ');
-      sha256(slice.as_slice(), hash);
-
-      if (hash != it->hash) {
-        return Status::Error("Hash mismatch");
-      }
-
-      checked_prefix_size = end_offset;
-      continue;
+      has_hash_read_ = true;
+      send_closure(io_worker_, &FileIoWorker::pread, fd_, begin_offset, size,
+                   PromiseCreator::lambda([actor_id = actor_id(this), begin_offset, end_offset,
+                                           hash = it->hash](Result<BufferSlice> r_bytes) mutable {
+                     send_closure(actor_id, &FileDownloader::on_hash_part_read, begin_offset, end_offset,
+                                  std::move(hash), std::move(r_bytes));
+                   }));
+      break;
     }
     if (!has_hash_query_ && use_cdn_) {
       has_hash_query_ = true;
@@ -390,6 +405,27 @@ Result<FileLoader::CheckInfo> FileDownloader::check_loop(int64 checked_prefix_si
   info.checked_prefix_size = checked_prefix_size;
   return std::move(info);
 }
+void FileDownloader::on_hash_part_read(int64 begin_offset, int64 end_offset, string hash,
+                                       Result<BufferSlice> r_data) {
+  has_hash_read_ = false;
+  hash_check_status_ = [&]() -> Status {
+    TRY_RESULT(bytes, std::move(r_data));
+    if (bytes.size() != narrow_cast<size_t>(end_offset - begin_offset)) {
+      return Status::Error("Failed to read file to check hash");
+    }
+    string real_hash(32, ' ');
+    sha256(bytes.as_slice(), real_hash);
+    if (real_hash != hash) {
+      return Status::Error("Hash mismatch");
+    }
+    return Status::OK();
+  }();
+  if (hash_check_status_.is_ok()) {
+    hash_checked_prefix_size_ = end_offset;
+  }
+  loop();
+}
+
 void FileDownloader::add_hash_info(const std::vector<telegram_api::object_ptr<telegram_api::cdnFileHash>> &hashes) {
   for (auto &hash : hashes) {
     //LOG(ERROR) << "ADD HASH " << hash->offset_ << "->" << hash->limit_;
@@ -407,19 +443,20 @@ void FileDownloader::keep_fd_flag(bool keep_fd) {
 }
 
 void FileDownloader::try_release_fd() {
-  if (!keep_fd_ && !fd_.empty()) {
-    fd_.close();
+  if (!keep_fd_ && fd_ != nullptr) {
+    fd_.reset();
   }
 }
 
 Status FileDownloader::acquire_fd() {
-  if (fd_.empty()) {
+  if (fd_ == nullptr) {
     if (path_.empty()) {
       TRY_RESULT(file_path, open_temp_file(remote_.type_));
-      std::tie(fd_, path_) = std::move(file_path);
+      fd_ = std::make_shared<FileFd>(std::move(file_path.first));
+      path_ = std::move(file_path.second);
     } else {
       TRY_RESULT(fd, FileFd::open(path_, FileFd::Write | FileFd::Read));
-      fd_ = std::move(fd);
+      fd_ = std::make_shared<FileFd>(std::move(fd));
     }
   }
   return Status::OK();
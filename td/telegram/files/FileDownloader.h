@@ -11,15 +11,19 @@
 #include "td/actor/actor.h"
 #include "td/actor/PromiseFuture.h"
 
+#include "td/telegram/files/FileIoWorker.h"
 #include "td/telegram/files/FileLoader.h"
 #include "td/telegram/files/FileLocation.h"
 #include "td/telegram/net/NetQuery.h"
 
+#include "td/utils/buffer.h"
 #include "td/utils/common.h"
+#include "td/utils/crypto.h"
 #include "td/utils/port/FileFd.h"
 #include "td/utils/Status.h"
 
 #include <map>
+#include <memory>
 #include <set>
 #include <utility>
 
@@ -34,7 +38,8 @@ class FileDownloader : public FileLoader {
   };
 
   FileDownloader(const FullRemoteFileLocation &remote, const LocalFileLocation &local, int64 size, string name,
-                 const FileEncryptionKey &encryption_key, bool is_small, std::unique_ptr<Callback> callback);
+                 const FileEncryptionKey &encryption_key, bool is_small, ActorId<FileIoWorker> io_worker,
+                 std::unique_ptr<Callback> callback);
 
   // Should just implement all parent pure virtual methods.
   // Must not call any of them...
@@ -46,13 +51,16 @@ class FileDownloader : public FileLoader {
   int64 size_;
   string name_;
   FileEncryptionKey encryption_key_;
+  AesIgeState aes_ige_state_;
+  ActorId<FileIoWorker> io_worker_;
   std::unique_ptr<Callback> callback_;
 
   string path_;
-  FileFd fd_;
+  std::shared_ptr<FileFd> fd_;
 
   int32 next_part_ = 0;
   bool next_part_stop_ = false;
+  std::map<int32, UInt256> part_iv_;
   bool is_small_;
 
   bool use_cdn_ = false;
@@ -75,17 +83,21 @@ class FileDownloader : public FileLoader {
   };
   std::set<HashInfo> hash_info_;
   bool has_hash_query_ = false;
+  bool has_hash_read_ = false;
+  int64 hash_checked_prefix_size_ = 0;
+  Status hash_check_status_;
 
   Result<FileInfo> init() override TD_WARN_UNUSED_RESULT;
   Status on_ok(int64 size) override TD_WARN_UNUSED_RESULT;
   void on_error(Status status) override;
   Result<bool> should_restart_part(Part part, NetQueryPtr &net_query) override TD_WARN_UNUSED_RESULT;
   Result<std::pair<NetQueryPtr, bool>> start_part(Part part, int32 part_count) override TD_WARN_UNUSED_RESULT;
-  Result<size_t> process_part(Part part, NetQueryPtr net_query) override TD_WARN_UNUSED_RESULT;
+  Status process_part(Part part, NetQueryPtr net_query, Promise<size_t> promise) override TD_WARN_UNUSED_RESULT;
   void on_progress(int32 part_count, int32 part_size, int32 ready_part_count, bool is_ready, int64 ready_size) override;
   FileLoader::Callback *get_callback() override;
   Status process_check_query(NetQueryPtr net_query) override;
   Result<CheckInfo> check_loop(int64 checked_prefix_size, int64 ready_prefix_size, bool is_ready) override;
+  void on_hash_part_read(int64 begin_offset, int64 end_offset, string hash, Result<BufferSlice> r_data);
   void add_hash_info(const std::vector<telegram_api::object_ptr<telegram_api::cdnFileHash>> &hashes);
 
   bool keep_fd_ = false;
@@ -78,7 +78,8 @@ void FileGcWorker::run_gc(const FileGcParameters &parameters, std::vector<FullFi
   }
 
   FileStats new_stats;
-  new_stats.split_by_owner_dialog_id = parameters.dialog_limit != 0;
+  // owners of files are known if chat info database is used
+  new_stats.split_by_owner_dialog_id = G()->parameters().use_chat_info_db;
 
   // Remove all files with atime > now - max_time_from_last_access
   double now = Clocks::system();
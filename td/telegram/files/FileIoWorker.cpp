@@ -0,0 +1,33 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2017
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/telegram/files/FileIoWorker.h"
+
+#include "td/utils/filesystem.h"
+#include "td/utils/logging.h"
+
+namespace td {
+void FileIoWorker::pread(std::shared_ptr<FileFd> fd, int64 offset, size_t size, Promise<BufferSlice> promise) {
+  CHECK(fd != nullptr);
+  BufferSlice bytes(size);
+  auto r_size = fd->pread(bytes.as_slice(), offset);
+  if (r_size.is_error()) {
+    return promise.set_error(r_size.move_as_error());
+  }
+  bytes.truncate(r_size.ok());
+  promise.set_value(std::move(bytes));
+}
+
+void FileIoWorker::pwrite(std::shared_ptr<FileFd> fd, int64 offset, BufferSlice bytes, Promise<size_t> promise) {
+  CHECK(fd != nullptr);
+  promise.set_result(fd->pwrite(bytes.as_slice(), offset));
+}
+
+void FileIoWorker::read_file(string path, Promise<BufferSlice> promise) {
+  promise.set_result(td::read_file(path));
+}
+
+}  // namespace td
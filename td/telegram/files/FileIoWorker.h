@@ -0,0 +1,28 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2017
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "td/actor/actor.h"
+#include "td/actor/PromiseFuture.h"
+
+#include "td/utils/buffer.h"
+#include "td/utils/common.h"
+#include "td/utils/port/FileFd.h"
+
+#include <memory>
+
+namespace td {
+// Does blocking disk I/O of file loaders, so a slow disk doesn't stall actors on their scheduler.
+// Requests are handled in order of arrival; fd is shared to be kept open until the request is done.
+class FileIoWorker : public Actor {
+ public:
+  void pread(std::shared_ptr<FileFd> fd, int64 offset, size_t size, Promise<BufferSlice> promise);
+  void pwrite(std::shared_ptr<FileFd> fd, int64 offset, BufferSlice bytes, Promise<size_t> promise);
+  void read_file(string path, Promise<BufferSlice> promise);
+};
+
+}  // namespace td
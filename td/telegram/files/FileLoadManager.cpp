@@ -9,7 +9,6 @@
 #include "td/telegram/Global.h"
 
 #include "td/utils/common.h"
-#include "td/utils/filesystem.h"
 #include "td/utils/logging.h"
 
 namespace td {
@@ -26,6 +25,7 @@ void FileLoadManager::start_up() {
       create_actor<ResourceManager>("DownloadResourceManager", ResourceManager::Mode::Baseline);
   download_small_resource_manager_ =
       create_actor<ResourceManager>("DownloadSmallResourceManager", ResourceManager::Mode::Baseline);
+  io_worker_ = create_actor_on_scheduler<FileIoWorker>("FileIoWorker", G()->get_file_io_scheduler_id());
 }
 
 void FileLoadManager::download(QueryId id, const FullRemoteFileLocation &remote_location,
@@ -42,7 +42,7 @@ void FileLoadManager::download(QueryId id, const FullRemoteFileLocation &remote_
   auto callback = make_unique<FileDownloaderCallback>(actor_shared(this, node_id));
   bool is_small = size < 20 * 1024;
   node->loader_ = create_actor<FileDownloader>("Downloader", remote_location, local, size, std::move(name),
-                                               encryption_key, is_small, std::move(callback));
+                                               encryption_key, is_small, io_worker_.get(), std::move(callback));
   auto &resource_manager = is_small ? download_small_resource_manager_ : download_resource_manager_;
   send_closure(resource_manager, &ResourceManager::register_worker,
                ActorShared<FileLoaderActor>(node->loader_.get(), static_cast<uint64>(-1)), priority);
@@ -62,7 +62,7 @@ void FileLoadManager::upload(QueryId id, const LocalFileLocation &local_location
   node->query_id_ = id;
   auto callback = make_unique<FileUploaderCallback>(actor_shared(this, node_id));
   node->loader_ = create_actor<FileUploader>("Uploader", local_location, remote_location, size, encryption_key,
-                                             std::move(bad_parts), std::move(callback));
+                                             std::move(bad_parts), io_worker_.get(), std::move(callback));
   send_closure(upload_resource_manager_, &ResourceManager::register_worker,
                ActorShared<FileLoaderActor>(node->loader_.get(), static_cast<uint64>(-1)), priority);
   query_id_to_node_id_[id] = node_id;
@@ -116,8 +116,7 @@ void FileLoadManager::from_bytes(QueryId id, FileType type, BufferSlice bytes, s
 }
 
 void FileLoadManager::get_content(const FullLocalFileLocation &local_location, Promise<BufferSlice> promise) {
-  // TODO: send query to other thread
-  promise.set_result(read_file(local_location.path_));
+  send_closure(io_worker_, &FileIoWorker::read_file, local_location.path_, std::move(promise));
 }
 
 // void upload_reload_parts(QueryId id, vector<int32> parts);
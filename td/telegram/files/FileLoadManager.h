@@ -12,6 +12,7 @@
 #include "td/telegram/files/FileDownloader.h"
 #include "td/telegram/files/FileFromBytes.h"
 #include "td/telegram/files/FileHashUploader.h"
+#include "td/telegram/files/FileIoWorker.h"
 #include "td/telegram/files/FileLocation.h"
 #include "td/telegram/files/FileUploader.h"
 #include "td/telegram/files/ResourceManager.h"
@@ -67,6 +68,7 @@ class FileLoadManager final : public Actor {
   ActorOwn<ResourceManager> download_resource_manager_;
   ActorOwn<ResourceManager> download_small_resource_manager_;
   ActorOwn<ResourceManager> upload_resource_manager_;
+  ActorOwn<FileIoWorker> io_worker_;
 
   Container<Node> nodes_container_;
   ActorShared<Callback> callback_;
@@ -143,18 +143,38 @@ Status FileLoader::do_loop() {
     NetQueryPtr query;
     bool is_blocking;
     std::tie(query, is_blocking) = std::move(query_flag);
-    uint64 id = UniqueId::next();
-    if (is_blocking) {
-      CHECK(blocking_id_ == 0);
-      blocking_id_ = id;
+    if (query.empty()) {
+      CHECK(!is_blocking);
+      continue;
     }
-    part_map_[id] = std::make_pair(part, query->cancel_slot_.get_signal_new());
-    // part_map_[id] = std::make_pair(part, query.get_weak());
-    G()->net_query_dispatcher().dispatch_with_callback(std::move(query), actor_shared(this, id));
+    send_part_query(part, std::move(query), is_blocking);
   }
   return Status::OK();
 }
 
+void FileLoader::send_part_query(Part part, NetQueryPtr query, bool is_blocking) {
+  uint64 id = UniqueId::next();
+  if (is_blocking) {
+    CHECK(blocking_id_ == 0);
+    blocking_id_ = id;
+  }
+  part_map_[id] = std::make_pair(part, query->cancel_slot_.get_signal_new());
+  // part_map_[id] = std::make_pair(part, query.get_weak());
+  G()->net_query_dispatcher().dispatch_with_callback(std::move(query), actor_shared(this, id));
+}
+
+void FileLoader::on_part_query_ready(Part part, Result<NetQueryPtr> r_query) {
+  if (stop_flag_) {
+    return;
+  }
+  if (r_query.is_error()) {
+    on_error(r_query.move_as_error());
+    stop_flag_ = true;
+    return;
+  }
+  send_part_query(part, r_query.move_as_ok(), false);
+}
+
 void FileLoader::tear_down() {
   for (auto &it : part_map_) {
     it.second.second.reset();
@@ -228,13 +248,30 @@ void FileLoader::on_result(NetQueryPtr query) {
 }
 
 void FileLoader::on_part_query(Part part, NetQueryPtr query) {
-  auto status = try_on_part_query(part, std::move(query));
+  auto status = process_part(part, std::move(query),
+                             PromiseCreator::lambda([actor_id = actor_id(this), part](Result<size_t> r_size) {
+                               send_closure(actor_id, &FileLoader::on_part_processed, part, std::move(r_size));
+                             }));
   if (status.is_error()) {
     on_error(std::move(status));
     stop_flag_ = true;
   }
 }
 
+void FileLoader::on_part_processed(Part part, Result<size_t> r_size) {
+  if (stop_flag_) {
+    return;
+  }
+  auto status = try_on_part_processed(part, std::move(r_size));
+  if (status.is_error()) {
+    on_error(std::move(status));
+    stop_flag_ = true;
+    return;
+  }
+  update_estimated_limit();
+  loop();
+}
+
 void FileLoader::on_common_query(NetQueryPtr query) {
   auto status = process_check_query(std::move(query));
   if (status.is_error()) {
@@ -243,8 +280,8 @@ void FileLoader::on_common_query(NetQueryPtr query) {
   }
 }
 
-Status FileLoader::try_on_part_query(Part part, NetQueryPtr query) {
-  TRY_RESULT(size, process_part(part, std::move(query)));
+Status FileLoader::try_on_part_processed(Part part, Result<size_t> r_written) {
+  TRY_RESULT(size, std::move(r_written));
   VLOG(files) << "Ok part " << tag("id", part.id) << tag("size", part.size);
   resource_state_.stop_use(static_cast<int64>(part.size));
   TRY_STATUS(parts_manager_.on_part_ok(part.id, part.size, size));
@@ -59,10 +59,12 @@ class FileLoader : public FileLoaderActor {
   virtual Status before_start_parts() {
     return Status::OK();
   }
+  // returns an empty query, if it will be passed to on_part_query_ready later
   virtual Result<std::pair<NetQueryPtr, bool>> start_part(Part part, int part_count) TD_WARN_UNUSED_RESULT = 0;
   virtual void after_start_parts() {
   }
-  virtual Result<size_t> process_part(Part part, NetQueryPtr net_query) TD_WARN_UNUSED_RESULT = 0;
+  // the part is ready, when the promise is set, so the part can be saved asynchronously
+  virtual Status process_part(Part part, NetQueryPtr net_query, Promise<size_t> promise) TD_WARN_UNUSED_RESULT = 0;
   virtual void on_progress(int32 part_count, int32 part_size, int32 ready_part_count, bool is_ready,
                            int64 ready_size) = 0;
   virtual Callback *get_callback() = 0;
@@ -88,6 +90,9 @@ class FileLoader : public FileLoaderActor {
   virtual void keep_fd_flag(bool keep_fd) {
   }
 
+  void loop() override;
+  void on_part_query_ready(Part part, Result<NetQueryPtr> r_query);
+
  private:
   enum { CommonQueryKey = 2 };
   bool stop_flag_ = false;
@@ -101,7 +106,6 @@ class FileLoader : public FileLoaderActor {
   OrderedEventsProcessor<std::pair<Part, NetQueryPtr>> ordered_parts_;
 
   void start_up() override;
-  void loop() override;
   Status do_loop();
   void hangup() override;
   void tear_down() override;
@@ -110,8 +114,10 @@ class FileLoader : public FileLoaderActor {
   void on_progress_impl(size_t size);
 
   void on_result(NetQueryPtr query) override;
+  void send_part_query(Part part, NetQueryPtr query, bool is_blocking);
   void on_part_query(Part part, NetQueryPtr query);
+  void on_part_processed(Part part, Result<size_t> r_size);
   void on_common_query(NetQueryPtr query);
-  Status try_on_part_query(Part part, NetQueryPtr query);
+  Status try_on_part_processed(Part part, Result<size_t> r_written);
 };
 }  // namespace td
@@ -1115,8 +1115,9 @@ class FileData {
     store(url_, storer);
     store(encryption_key_, storer);
   }
+  // parses only the fields, which are stored before the name, so the rest of the data can be skipped
   template <class ParserT>
-  void parse(ParserT &parser) {
+  void parse_owner_locations_and_size(ParserT &parser) {
     using ::td::parse;
     bool has_owner_dialog_id;
     bool has_expected_size;
@@ -1137,6 +1138,11 @@ class FileData {
     } else {
       parse(size_, parser);
     }
+  }
+  template <class ParserT>
+  void parse(ParserT &parser) {
+    using ::td::parse;
+    parse_owner_locations_and_size(parser);
     parse(name_, parser);
     parse(url_, parser);
     parse(encryption_key_, parser);
@@ -361,8 +361,21 @@ namespace {
 void prepare_path_for_pmc(FileType file_type, string &path) {
   path = PathView::relative(path, get_files_base_dir(file_type)).str();
 }
+
+// only fully downloaded files in files directories are accounted in storage statistics
+bool is_stored_file(const FileView &file_view) {
+  return file_view.has_local_location() && file_view.can_delete();
+}
 }  // namespace
 
+void FileManager::update_storage_stats(const FileView &file_view, bool is_added) {
+  if (!is_stored_file(file_view)) {
+    return;
+  }
+  auto size = file_view.size();
+  context_->on_new_file(is_added ? size : -size, file_view.get_type(), file_view.owner_dialog_id());
+}
+
 FileManager::FileManager(std::unique_ptr<Context> context) : context_(std::move(context)) {
   if (G()->parameters().use_file_db) {
     file_db_ = G()->td_db()->get_file_db_shared();
@@ -578,6 +591,7 @@ void FileManager::on_file_unlink(const FullLocalFileLocation &location) {
   auto file_id = it->second;
   auto *file_node = get_sync_file_node(file_id);
   CHECK(file_node);
+  // storage statistics are replaced with the GC result, so they must not be updated here
   file_node->set_local_location(LocalFileLocation(), 0);
   try_flush_node_info(file_node);
 }
@@ -900,6 +914,11 @@ Result<FileId> FileManager::merge(FileId x_file_id, FileId y_file_id, bool no_sy
   FileNode *other_node = nodes[other_node_i];
   auto file_view = FileView(node);
 
+  // the file is accounted in storage statistics by the owner of the node with its local location
+  auto *local_node = local_i == other_node_i ? other_node : node;
+  auto old_local_owner_dialog_id = local_node->owner_dialog_id_;
+  auto old_local_size = FileView(local_node).size();
+
   LOG(INFO) << "x_node->pmc_id_ = " << x_node->pmc_id_ << ", y_node->pmc_id_ = " << y_node->pmc_id_
             << ", x_node_size = " << x_node->file_ids_.size() << ", y_node_size = " << y_node->file_ids_.size()
             << ", node_i = " << node_i << ", local_i = " << local_i << ", remote_i = " << remote_i
@@ -973,6 +992,10 @@ Result<FileId> FileManager::merge(FileId x_file_id, FileId y_file_id, bool no_sy
   if (owner_i == other_node_i) {
     node->set_owner_dialog_id(other_node->owner_dialog_id_);
   }
+  if (old_local_owner_dialog_id != node->owner_dialog_id_ && is_stored_file(file_view)) {
+    context_->on_new_file(-old_local_size, file_view.get_type(), old_local_owner_dialog_id);
+    update_storage_stats(file_view, true);
+  }
 
   if (encryption_key_i == other_node_i) {
     node->set_encryption_key(other_node->encryption_key_);
@@ -1281,7 +1304,7 @@ void FileManager::delete_file(FileId file_id, Promise<Unit> promise, const char
       clear_from_pmc(node);
 
       unlink(file_view.local_location().path_).ignore();
-      context_->on_new_file(-file_view.size());
+      update_storage_stats(file_view, false);
       node->set_local_location(LocalFileLocation(), 0);
       try_flush_node(node);
     }
@@ -1958,7 +1981,7 @@ void FileManager::on_download_ok(QueryId query_id, const FullLocalFileLocation &
   if (r_new_file_id.is_error()) {
     LOG(ERROR) << "Can't register local file after download: " << r_new_file_id.error();
   } else {
-    context_->on_new_file(get_file_view(r_new_file_id.ok()).size());
+    update_storage_stats(get_file_view(r_new_file_id.ok()), true);
     LOG_STATUS(merge(r_new_file_id.ok(), file_id));
   }
 }
@@ -2080,6 +2103,7 @@ void FileManager::on_generate_ok(QueryId query_id, const FullLocalFileLocation &
   if (r_new_file_id.is_error()) {
     status = Status::Error(PSLICE() << "Can't register local file after generate: " << r_new_file_id.error());
   } else {
+    update_storage_stats(get_file_view(r_new_file_id.ok()), true);
     auto result = merge(r_new_file_id.ok(), generate_file_id);
     if (result.is_error()) {
       status = result.move_as_error();
@@ -2091,7 +2115,6 @@ void FileManager::on_generate_ok(QueryId query_id, const FullLocalFileLocation &
 
   file_node = get_file_node(generate_file_id);
   CHECK(file_node != nullptr);
-  context_->on_new_file(FileView(file_node).size());
 
   run_upload(file_node, {});
 
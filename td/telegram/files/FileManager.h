@@ -213,7 +213,8 @@ class FileManager : public FileLoadManager::Callback {
 
   class Context {
    public:
-    virtual void on_new_file(int64 size) = 0;
+    // negative size means that the file was deleted
+    virtual void on_new_file(int64 size, FileType file_type, DialogId owner_dialog_id) = 0;
     virtual void on_file_updated(FileId size) = 0;
     virtual ActorShared<> create_reference() = 0;
     Context() = default;
@@ -348,6 +349,7 @@ class FileManager : public FileLoadManager::Callback {
   void try_flush_node(FileNode *node, bool new_remote = false, bool new_local = false, bool new_generate = false,
                       FileDbId other_pmc_id = Auto());
   void try_flush_node_info(FileNode *node);
+  void update_storage_stats(const FileView &file_view, bool is_added);
   void clear_from_pmc(FileNode *node);
   void flush_to_pmc(FileNode *node, bool new_remote, bool new_local, bool new_generate);
   bool load_from_pmc(FileNode *node, bool new_remote, bool new_local, bool new_generate);
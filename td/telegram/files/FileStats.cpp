@@ -16,6 +16,7 @@
 #include "td/utils/Slice.h"
 
 #include <algorithm>
+#include <iterator>
 #include <unordered_set>
 #include <utility>
 
@@ -43,6 +44,26 @@ void FileStats::add(FullFileInfo &&info) {
   }
 }
 
+void FileStats::add(FileStats &&other) {
+  CHECK(need_all_files == other.need_all_files);
+  CHECK(split_by_owner_dialog_id == other.split_by_owner_dialog_id);
+  auto add_stat_by_type = [](StatByType &to, const StatByType &from) {
+    for (size_t i = 0; i < file_type_size; i++) {
+      to[i].size += from[i].size;
+      to[i].cnt += from[i].cnt;
+    }
+  };
+  add_stat_by_type(stat_by_type, other.stat_by_type);
+  for (auto &it : other.stat_by_owner_dialog_id) {
+    add_stat_by_type(stat_by_owner_dialog_id[it.first], it.second);
+  }
+  if (all_files.empty()) {
+    all_files = std::move(other.all_files);
+  } else {
+    std::move(other.all_files.begin(), other.all_files.end(), std::back_inserter(all_files));
+  }
+}
+
 FileTypeStat get_nontemp_stat(const FileStats::StatByType &by_type) {
   FileTypeStat stat;
   for (size_t i = 0; i < file_type_size; i++) {
@@ -119,6 +140,20 @@ void FileStats::apply_dialog_limit(int32 limit) {
   }
 }
 
+void FileStats::merge_owner_dialog_stats() {
+  if (!split_by_owner_dialog_id) {
+    return;
+  }
+  for (auto &dialog : stat_by_owner_dialog_id) {
+    for (size_t i = 0; i < file_type_size; i++) {
+      stat_by_type[i].size += dialog.second[i].size;
+      stat_by_type[i].cnt += dialog.second[i].cnt;
+    }
+  }
+  stat_by_owner_dialog_id.clear();
+  split_by_owner_dialog_id = false;
+}
+
 tl_object_ptr<td_api::storageStatisticsByChat> as_td_api(DialogId dialog_id,
                                                          const FileStats::StatByType &stat_by_type) {
   auto stats = make_tl_object<td_api::storageStatisticsByChat>(dialog_id.get(), 0, 0, Auto());
@@ -172,6 +207,73 @@ std::vector<DialogId> FileStats::get_dialog_ids() const {
   return res;
 }
 
+bool FileStatsCounter::add_file(DialogId owner_dialog_id, FileType file_type, int64 size) {
+  if (!is_inited_ || file_type == FileType::Temp) {
+    return true;
+  }
+  auto &stat = stat_by_owner_dialog_id_[owner_dialog_id][static_cast<size_t>(file_type)];
+  if (size > 0) {
+    stat.cnt++;
+  } else {
+    stat.cnt--;
+  }
+  stat.size += size;
+
+  if (stat.cnt < 0 || stat.size < 0) {
+    drop();
+    return false;
+  }
+  return true;
+}
+
+void FileStatsCounter::on_full_file_stats(const FileStats &stats) {
+  stat_by_owner_dialog_id_.clear();
+  if (stats.split_by_owner_dialog_id) {
+    stat_by_owner_dialog_id_.insert(stats.stat_by_owner_dialog_id.begin(), stats.stat_by_owner_dialog_id.end());
+  } else {
+    stat_by_owner_dialog_id_[DialogId()] = stats.stat_by_type;
+  }
+  for (auto &it : stat_by_owner_dialog_id_) {
+    // partial files aren't tracked incrementally
+    it.second[static_cast<size_t>(FileType::Temp)] = FileTypeStat();
+  }
+  is_inited_ = true;
+}
+
+void FileStatsCounter::set_owner_dialog_stats(DialogId owner_dialog_id, const FileStats::StatByType &stat_by_type) {
+  stat_by_owner_dialog_id_[owner_dialog_id] = stat_by_type;
+}
+
+void FileStatsCounter::drop() {
+  is_inited_ = false;
+  stat_by_owner_dialog_id_.clear();
+}
+
+FileStats FileStatsCounter::get_file_stats(bool split_by_owner_dialog_id) const {
+  FileStats stats;
+  stats.split_by_owner_dialog_id = split_by_owner_dialog_id;
+  for (auto &it : stat_by_owner_dialog_id_) {
+    bool is_empty = true;
+    for (auto &stat : it.second) {
+      if (stat.cnt != 0) {
+        is_empty = false;
+      }
+    }
+    if (is_empty) {
+      continue;
+    }
+    if (stats.split_by_owner_dialog_id) {
+      stats.stat_by_owner_dialog_id[it.first] = it.second;
+    } else {
+      for (size_t i = 0; i < file_type_size; i++) {
+        stats.stat_by_type[i].size += it.second[i].size;
+        stats.stat_by_type[i].cnt += it.second[i].cnt;
+      }
+    }
+  }
+  return stats;
+}
+
 StringBuilder &operator<<(StringBuilder &sb, const FileTypeStat &stat) {
   return sb << tag("size", format::as_size(stat.size)) << tag("count", stat.cnt);
 }
@@ -73,7 +73,10 @@ struct FileStats {
   std::vector<FullFileInfo> all_files;
 
   void add(FullFileInfo &&info);
+  // adds stats of other files, which must be collected with the same options
+  void add(FileStats &&other);
   void apply_dialog_limit(int32 limit);
+  void merge_owner_dialog_stats();
 
   tl_object_ptr<td_api::storageStatistics> as_td_api() const;
   std::vector<DialogId> get_dialog_ids() const;
@@ -83,6 +86,48 @@ struct FileStats {
   void add(StatByType &by_type, FileType file_type, int64 size);
 };
 
+template <class T>
+void store(const FileStats::StatByType &stat_by_type, T &storer) {
+  for (auto &stat : stat_by_type) {
+    store(stat, storer);
+  }
+}
+template <class T>
+void parse(FileStats::StatByType &stat_by_type, T &parser) {
+  for (auto &stat : stat_by_type) {
+    parse(stat, parser);
+  }
+}
+
+// stats of non-temporary files by owner, which are replaced by full files scans and updated incrementally in between
+class FileStatsCounter {
+ public:
+  using StatByOwnerDialogId = std::unordered_map<DialogId, FileStats::StatByType, DialogIdHash>;
+
+  bool is_inited() const {
+    return is_inited_;
+  }
+
+  const StatByOwnerDialogId &get_stat_by_owner_dialog_id() const {
+    return stat_by_owner_dialog_id_;
+  }
+
+  // negative size means that the file was deleted; returns false if the stats became wrong and were dropped
+  bool add_file(DialogId owner_dialog_id, FileType file_type, int64 size);
+
+  void on_full_file_stats(const FileStats &stats);
+
+  void set_owner_dialog_stats(DialogId owner_dialog_id, const FileStats::StatByType &stat_by_type);
+
+  void drop();
+
+  FileStats get_file_stats(bool split_by_owner_dialog_id) const;
+
+ private:
+  bool is_inited_ = false;
+  StatByOwnerDialogId stat_by_owner_dialog_id_;
+};
+
 StringBuilder &operator<<(StringBuilder &sb, const FileStats &file_stats);
 
 }  // namespace td
@@ -13,6 +13,7 @@
 
 #include "td/utils/format.h"
 #include "td/utils/logging.h"
+#include "td/utils/misc.h"
 #include "td/utils/PathView.h"
 #include "td/utils/port/path.h"
 #include "td/utils/port/Stat.h"
@@ -20,52 +21,95 @@
 #include "td/utils/Status.h"
 #include "td/utils/Time.h"
 #include "td/utils/tl_helpers.h"
+#include "td/utils/tl_parsers.h"
 
-#include <functional>
+#include <algorithm>
+#include <array>
+#include <memory>
 #include <unordered_map>
 
 namespace td {
 namespace {
-// Performance ideas:
-// - use slice instead of string
-// - use arena memory allocator
-// - store FileType or dir, no both
-// - store dir relative to G()->files_dir()
+// stores scanned paths in big chunks instead of allocating a string for each of millions of files
+class PathArena {
+ public:
+  explicit PathArena(size_t chunk_size) : chunk_size_(chunk_size) {
+  }
+
+  CSlice add(Slice path) {
+    auto size = path.size() + 1;
+    if (size > left_) {
+      auto chunk_size = std::max(chunk_size_, size);
+      chunks_.push_back(std::make_unique<char[]>(chunk_size));
+      pos_ = chunks_.back().get();
+      left_ = chunk_size;
+    }
+    auto begin = pos_;
+    MutableSlice(begin, path.size()).copy_from(path);
+    begin[path.size()] = '\0';
+    pos_ += size;
+    left_ -= size;
+    return CSlice(begin, begin + path.size());
+  }
+
+ private:
+  size_t chunk_size_;
+  std::vector<std::unique_ptr<char[]>> chunks_;
+  char *pos_ = nullptr;
+  size_t left_ = 0;
+};
 
 struct DbFileInfo {
   FileType file_type;
-  string path;
+  Slice path;  // valid only inside of the callback
   DialogId owner_dialog_id;
   int64 size;
 };
 
 // long and blocking
 template <class CallbackT>
-Status scan_db(CallbackT &&callback) {
+Status scan_db(CancellationToken &token, CallbackT &&callback) {
+  std::array<string, file_type_size> files_base_dirs;
+  for (int i = 0; i < file_type_size; i++) {
+    files_base_dirs[i] = get_files_base_dir(static_cast<FileType>(i));
+  }
+  string full_path;
   G()->td_db()->get_file_db_shared()->pmc().get_by_range("file0", "file:", [&](Slice key, Slice value) {
+    if (token) {
+      return;
+    }
     // skip reference to other data
     if (value.substr(0, 2) == "@@") {
       return;
     }
+    // only the owner, the location and the size are needed, so the name, the URL and the key aren't parsed
     FileData data;
-    auto status = unserialize(data, value);
+    TlParser parser(value);
+    data.parse_owner_locations_and_size(parser);
+    auto status = parser.get_status();
     if (status.is_error()) {
       LOG(ERROR) << "Invalid FileData in db " << tag("value", format::escaped(value));
       return;
     }
     DbFileInfo info;
+    const string *path;
     if (data.local_.type_ == LocalFileLocation::Type::Full) {
       info.file_type = data.local_.full().type_;
-      info.path = data.local_.full().path_;
+      path = &data.local_.full().path_;
     } else if (data.local_.type_ == LocalFileLocation::Type::Partial) {
       info.file_type = data.local_.partial().type_;
-      info.path = data.local_.partial().path_;
+      path = &data.local_.partial().path_;
     } else {
       return;
     }
-    PathView path_view(info.path);
+    PathView path_view(*path);
     if (path_view.is_relative()) {
-      info.path = get_files_base_dir(info.file_type) + info.path;
+      full_path.clear();
+      full_path += files_base_dirs[static_cast<size_t>(info.file_type)];
+      full_path += *path;
+      info.path = full_path;
+    } else {
+      info.path = *path;
     }
     info.owner_dialog_id = data.owner_dialog_id_;
     info.size = data.size_;
@@ -75,105 +119,197 @@ Status scan_db(CallbackT &&callback) {
     }
     callback(info);
   });
+  if (token) {
+    return Status::Error(500, "Request aborted");
+  }
   return Status::OK();
 }
 
-struct FsFileInfo {
-  FileType file_type;
-  string path;
-  int64 size;
-  uint64 atime_nsec;
-  uint64 mtime_nsec;
+class FileStatsBatchWorker : public Actor {};
+
+constexpr size_t STAT_BATCH_SIZE = 256;
+constexpr size_t MAX_PENDING_STAT_BATCHES = 64;
+}  // namespace
+
+// scanned files, which are checked by stat calls together
+struct FileStatsWorker::FilesBatch {
+  PathArena arena{1 << 15};
+  std::vector<std::pair<FileType, CSlice>> files;
 };
 
-// long and blocking
-template <class CallbackT>
-Status scan_fs(CallbackT &&callback) {
+// owners of the files from the file database
+struct FileStatsWorker::FileOwners {
+  PathArena arena{1 << 20};
+  std::unordered_map<Slice, DialogId, SliceHash> owner_dialog_ids;
+};
+
+FileStatsWorker::FileStatsWorker(ActorShared<> parent, std::vector<int32> stat_scheduler_ids)
+    : parent_(std::move(parent)), stat_scheduler_ids_(std::move(stat_scheduler_ids)) {
+}
+
+void FileStatsWorker::start_up() {
+  for (auto scheduler_id : stat_scheduler_ids_) {
+    stat_workers_.push_back(
+        ActorOwn<Actor>(create_actor_on_scheduler<FileStatsBatchWorker>("FileStatsBatchWorker", scheduler_id)));
+  }
+}
+
+void FileStatsWorker::get_stats(bool need_all_files, bool split_by_owner_dialog_id, CancellationToken token,
+                                Promise<FileStats> promise) {
+  if (!G()->parameters().use_chat_info_db) {
+    split_by_owner_dialog_id = false;
+  }
+
+  // files are matched with their owners during the scan, so only the database entries are kept in memory
+  std::shared_ptr<FileOwners> owners;
+  if (split_by_owner_dialog_id) {
+    owners = std::make_shared<FileOwners>();
+    auto status = scan_db(token, [&](DbFileInfo &db_info) {
+      owners->owner_dialog_ids[owners->arena.add(db_info.path)] = db_info.owner_dialog_id;
+    });
+    if (status.is_error()) {
+      return promise.set_error(std::move(status));
+    }
+  }
+
+  std::vector<std::pair<FileType, string>> dirs;
   for (int i = 0; i < file_type_size; i++) {
     auto file_type = static_cast<FileType>(i);
-    auto files_dir = get_files_dir(file_type);
-    td::walk_path(files_dir, [&](CSlice path, bool is_dir) {
-      if (is_dir) {
+    dirs.emplace_back(file_type, get_files_dir(file_type));
+  }
+  scan_dirs(std::move(dirs), std::move(owners), need_all_files, std::move(token), std::move(promise));
+}
+
+void FileStatsWorker::get_dir_stats(std::vector<std::pair<FileType, string>> dirs, bool need_all_files,
+                                    CancellationToken token, Promise<FileStats> promise) {
+  scan_dirs(std::move(dirs), nullptr, need_all_files, std::move(token), std::move(promise));
+}
+
+// long and blocking, but stat calls are made in parallel by the stat workers
+void FileStatsWorker::scan_dirs(std::vector<std::pair<FileType, string>> dirs,
+                                std::shared_ptr<const FileOwners> owners, bool need_all_files,
+                                CancellationToken token, Promise<FileStats> promise) {
+  Query query;
+  query.stats.need_all_files = need_all_files;
+  query.stats.split_by_owner_dialog_id = owners != nullptr;
+  query.start_time = Time::now();
+  query.token = token;
+  query.promise = std::move(promise);
+  auto query_id = queries_.create(std::move(query));
+
+  auto batch = std::make_unique<FilesBatch>();
+  for (auto &dir : dirs) {
+    td::walk_path(dir.second, [&](CSlice path, bool is_dir) {
+      if (is_dir || token) {
         // TODO: skip subdirs
         return;
       }
-      auto r_stat = stat(path);
-      if (r_stat.is_error()) {
-        LOG(WARNING) << "Stat in files gc failed: " << r_stat.error();
-        return;
+      batch->files.emplace_back(dir.first, batch->arena.add(path));
+      if (batch->files.size() == STAT_BATCH_SIZE) {
+        send_batch(query_id, std::move(batch), owners);
+        batch = std::make_unique<FilesBatch>();
       }
-      auto stat = r_stat.move_as_ok();
-      FsFileInfo info;
-      info.path = path.str();
-      info.size = stat.size_;
-      info.file_type = file_type;
-      info.atime_nsec = stat.atime_nsec_;
-      info.mtime_nsec = stat.mtime_nsec_;
-      callback(info);
-    });
+    }).ignore();
+    if (token) {
+      break;
+    }
   }
-  return Status::OK();
+  if (!batch->files.empty()) {
+    send_batch(query_id, std::move(batch), owners);
+  }
+
+  auto *scanned_query = queries_.get(query_id);
+  CHECK(scanned_query != nullptr);
+  scanned_query->is_scan_finished = true;
+  try_finish_query(query_id);
 }
-}  // namespace
 
-void FileStatsWorker::get_stats(bool need_all_files, bool split_by_owner_dialog_id, Promise<FileStats> promise) {
-  if (!G()->parameters().use_chat_info_db) {
-    split_by_owner_dialog_id = false;
+void FileStatsWorker::send_batch(uint64 query_id, std::unique_ptr<FilesBatch> batch,
+                                 const std::shared_ptr<const FileOwners> &owners) {
+  auto *query = queries_.get(query_id);
+  CHECK(query != nullptr);
+  auto need_all_files = query->stats.need_all_files;
+  if (stat_workers_.empty() || pending_batch_count_->load(std::memory_order_relaxed) >= MAX_PENDING_STAT_BATCHES) {
+    // the stat workers are busy, so the batch is checked here; this also limits the memory used by pending batches
+    query->stats.add(get_batch_stats(*batch, owners.get(), need_all_files, query->token));
+    return;
   }
-  if (!split_by_owner_dialog_id) {
-    FileStats file_stats;
-    file_stats.need_all_files = need_all_files;
-    auto start = Time::now();
-    scan_fs([&](FsFileInfo &fs_info) {
-      FullFileInfo info;
-      info.file_type = fs_info.file_type;
-      info.path = std::move(fs_info.path);
-      info.size = fs_info.size;
-      info.atime_nsec = fs_info.atime_nsec;
-      info.mtime_nsec = fs_info.mtime_nsec;
-      file_stats.add(std::move(info));
-    });
-    auto passed = Time::now() - start;
-    LOG_IF(INFO, passed > 0.5) << "Get file stats took: " << format::as_time(passed);
-    promise.set_value(std::move(file_stats));
-  } else {
-    auto start = Time::now();
-
-    std::vector<FullFileInfo> full_infos;
-    scan_fs([&](FsFileInfo &fs_info) {
-      FullFileInfo info;
-      info.file_type = fs_info.file_type;
-      info.path = std::move(fs_info.path);
-      info.size = fs_info.size;
-      info.atime_nsec = fs_info.atime_nsec;
-      info.mtime_nsec = fs_info.mtime_nsec;
-      full_infos.push_back(info);
-    });
 
-    std::unordered_map<size_t, size_t> hash_to_pos;
-    size_t pos = 0;
-    for (auto &full_info : full_infos) {
-      hash_to_pos[std::hash<std::string>()(full_info.path)] = pos;
-      pos++;
+  pending_batch_count_->fetch_add(1, std::memory_order_relaxed);
+  query->pending_batch_count++;
+  auto &stat_worker = stat_workers_[next_stat_worker_++ % stat_workers_.size()];
+  send_lambda(stat_worker, [actor_id = actor_id(this), query_id, batch = std::move(batch), owners, need_all_files,
+                            token = query->token, pending_batch_count = pending_batch_count_] {
+    auto stats = get_batch_stats(*batch, owners.get(), need_all_files, token);
+    pending_batch_count->fetch_sub(1, std::memory_order_relaxed);
+    send_closure(actor_id, &FileStatsWorker::on_batch_stats, query_id, std::move(stats));
+  });
+}
+
+void FileStatsWorker::on_batch_stats(uint64 query_id, FileStats stats) {
+  auto *query = queries_.get(query_id);
+  if (query == nullptr) {
+    // the query was cancelled
+    return;
+  }
+  CHECK(query->pending_batch_count > 0);
+  query->pending_batch_count--;
+  query->stats.add(std::move(stats));
+  try_finish_query(query_id);
+}
+
+void FileStatsWorker::try_finish_query(uint64 query_id) {
+  auto *query = queries_.get(query_id);
+  CHECK(query != nullptr);
+  if (query->token) {
+    auto promise = std::move(query->promise);
+    queries_.erase(query_id);
+    return promise.set_error(Status::Error(500, "Request aborted"));
+  }
+  if (!query->is_scan_finished || query->pending_batch_count != 0) {
+    return;
+  }
+
+  auto passed = Time::now() - query->start_time;
+  LOG_IF(INFO, passed > 0.5) << "Get file stats took: " << format::as_time(passed);
+  auto promise = std::move(query->promise);
+  auto stats = std::move(query->stats);
+  queries_.erase(query_id);
+  promise.set_value(std::move(stats));
+}
+
+FileStats FileStatsWorker::get_batch_stats(const FilesBatch &batch, const FileOwners *owners, bool need_all_files,
+                                           const CancellationToken &token) {
+  FileStats stats;
+  stats.need_all_files = need_all_files;
+  stats.split_by_owner_dialog_id = owners != nullptr;
+  for (auto &file : batch.files) {
+    if (token) {
+      break;
     }
-    scan_db([&](DbFileInfo &db_info) {
-      auto it = hash_to_pos.find(std::hash<std::string>()(db_info.path));
-      if (it == hash_to_pos.end()) {
-        return;
+    auto r_stat = stat(file.second);
+    if (r_stat.is_error()) {
+      LOG(WARNING) << "Stat in files gc failed: " << r_stat.error();
+      continue;
+    }
+    auto stat = r_stat.move_as_ok();
+    FullFileInfo info;
+    info.file_type = file.first;
+    if (need_all_files) {
+      info.path = file.second.str();
+    }
+    info.size = stat.size_;
+    info.atime_nsec = stat.atime_nsec_;
+    info.mtime_nsec = stat.mtime_nsec_;
+    if (owners != nullptr) {
+      auto it = owners->owner_dialog_ids.find(file.second);
+      if (it != owners->owner_dialog_ids.end()) {
+        info.owner_dialog_id = it->second;
       }
-      full_infos[it->second].owner_dialog_id = db_info.owner_dialog_id;
-    });
-
-    FileStats file_stats;
-    file_stats.need_all_files = need_all_files;
-    file_stats.split_by_owner_dialog_id = split_by_owner_dialog_id;
-    for (auto &full_info : full_infos) {
-      file_stats.add(std::move(full_info));
     }
-    auto passed = Time::now() - start;
-    LOG_IF(INFO, passed > 0.5) << "Get file stats took: " << format::as_time(passed);
-    promise.set_value(std::move(file_stats));
+    stats.add(std::move(info));
   }
+  return stats;
 }
 
 }  // namespace td
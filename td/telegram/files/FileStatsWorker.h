@@ -9,18 +9,65 @@
 #include "td/actor/actor.h"
 #include "td/actor/PromiseFuture.h"
 
+#include "td/telegram/files/FileLocation.h"
 #include "td/telegram/files/FileStats.h"
 
+#include "td/utils/CancellationToken.h"
+#include "td/utils/common.h"
+#include "td/utils/Container.h"
+
+#include <atomic>
+#include <memory>
+#include <utility>
+
 namespace td {
 
 class FileStatsWorker : public Actor {
  public:
-  explicit FileStatsWorker(ActorShared<> parent) : parent_(std::move(parent)) {
-  }
-  void get_stats(bool need_all_files, bool split_by_owner_dialog_id, Promise<FileStats> promise);
+  // stat calls are made by workers on the given schedulers, while the files are still being scanned
+  FileStatsWorker(ActorShared<> parent, std::vector<int32> stat_scheduler_ids);
+
+  void get_stats(bool need_all_files, bool split_by_owner_dialog_id, CancellationToken token,
+                 Promise<FileStats> promise);
+
+  // scans only the given directories and doesn't match the files with the file database
+  void get_dir_stats(std::vector<std::pair<FileType, string>> dirs, bool need_all_files, CancellationToken token,
+                     Promise<FileStats> promise);
 
  private:
+  struct FilesBatch;
+  struct FileOwners;
+
+  struct Query {
+    FileStats stats;
+    size_t pending_batch_count = 0;
+    bool is_scan_finished = false;
+    double start_time = 0;
+    CancellationToken token;
+    Promise<FileStats> promise;
+  };
+
   ActorShared<> parent_;
+  std::vector<int32> stat_scheduler_ids_;
+  std::vector<ActorOwn<Actor>> stat_workers_;
+  size_t next_stat_worker_ = 0;
+  // number of batches sent to all stat workers, which aren't checked yet
+  std::shared_ptr<std::atomic<size_t>> pending_batch_count_ = std::make_shared<std::atomic<size_t>>(0);
+  Container<Query> queries_;
+
+  void start_up() override;
+
+  void scan_dirs(std::vector<std::pair<FileType, string>> dirs, std::shared_ptr<const FileOwners> owners,
+                 bool need_all_files, CancellationToken token, Promise<FileStats> promise);
+
+  void send_batch(uint64 query_id, std::unique_ptr<FilesBatch> batch, const std::shared_ptr<const FileOwners> &owners);
+
+  void on_batch_stats(uint64 query_id, FileStats stats);
+
+  void try_finish_query(uint64 query_id);
+
+  static FileStats get_batch_stats(const FilesBatch &batch, const FileOwners *owners, bool need_all_files,
+                                   const CancellationToken &token);
 };
 
 }  // namespace td
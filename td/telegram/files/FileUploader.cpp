@@ -22,16 +22,18 @@
 namespace td {
 FileUploader::FileUploader(const LocalFileLocation &local, const RemoteFileLocation &remote, int64 expected_size,
                            const FileEncryptionKey &encryption_key, std::vector<int> bad_parts,
-                           std::unique_ptr<Callback> callback)
+                           ActorId<FileIoWorker> io_worker, std::unique_ptr<Callback> callback)
     : local_(local)
     , remote_(remote)
     , expected_size_(expected_size)
     , encryption_key_(encryption_key)
     , bad_parts_(std::move(bad_parts))
+    , io_worker_(io_worker)
     , callback_(std::move(callback)) {
   if (!encryption_key_.empty()) {
     iv_ = encryption_key_.mutable_iv();
     generate_iv_ = encryption_key_.iv_slice().str();
+    aes_ige_state_.init(encryption_key_.key(), true);
   }
 }
 
@@ -117,19 +119,18 @@ Result<FileLoader::PrefixInfo> FileUploader::on_update_local_location(const Loca
       return res_fd.move_as_error();
     }
 
-    fd_.close();
-    fd_ = res_fd.move_as_ok();
+    fd_ = std::make_shared<FileFd>(res_fd.move_as_ok());
     fd_path_ = path;
   }
 
   if (local_is_ready) {
-    CHECK(!fd_.empty());
-    local_size = fd_.get_size();
+    CHECK(fd_ != nullptr);
+    local_size = fd_->get_size();
     if (local_size == 0) {
       return Status::Error("Can't upload empty file");
     }
-  } else if (!fd_.empty()) {
-    auto real_local_size = fd_.get_size();
+  } else if (fd_ != nullptr) {
+    auto real_local_size = fd_->get_size();
     if (real_local_size < local_size) {
       LOG(ERROR) << tag("real_local_size", real_local_size) << " < " << tag("local_size", local_size);
       PrefixInfo info;
@@ -150,11 +151,11 @@ Result<FileLoader::PrefixInfo> FileUploader::on_update_local_location(const Loca
 }
 
 Status FileUploader::on_ok(int64 size) {
-  fd_.close();
+  fd_.reset();
   return Status::OK();
 }
 void FileUploader::on_error(Status status) {
-  fd_.close();
+  fd_.reset();
   callback_->on_error(std::move(status));
 }
 
@@ -166,14 +167,14 @@ Status FileUploader::generate_iv_map() {
   if (iv_map_.empty()) {
     iv_map_.push_back(encryption_key.mutable_iv());
   }
-  CHECK(!fd_.empty());
+  CHECK(fd_ != nullptr);
   for (; generate_offset_ + static_cast<int64>(part_size) < local_size_;
        generate_offset_ += static_cast<int64>(part_size)) {
-    TRY_RESULT(read_size, fd_.pread(bytes.as_slice(), generate_offset_));
+    TRY_RESULT(read_size, fd_->pread(bytes.as_slice(), generate_offset_));
     if (read_size != part_size) {
       return Status::Error("Failed to read file part (for iv_map)");
     }
-    aes_ige_encrypt(encryption_key.key(), &encryption_key.mutable_iv(), bytes.as_slice(), bytes.as_slice());
+    aes_ige_state_.encrypt(&encryption_key.mutable_iv(), bytes.as_slice(), bytes.as_slice());
     iv_map_.push_back(encryption_key.mutable_iv());
   }
   generate_iv_ = encryption_key.iv_slice().str();
@@ -192,32 +193,55 @@ void FileUploader::after_start_parts() {
 }
 
 Result<std::pair<NetQueryPtr, bool>> FileUploader::start_part(Part part, int32 part_count) {
-  auto padded_size = part.size;
-  if (!encryption_key_.empty()) {
-    padded_size = (padded_size + 15) & ~15;
+  CHECK(fd_ != nullptr);
+  send_closure(io_worker_, &FileIoWorker::pread, fd_, part.offset, part.size,
+               PromiseCreator::lambda([actor_id = actor_id(this), part, part_count](Result<BufferSlice> r_bytes) {
+                 send_closure(actor_id, &FileUploader::on_part_read, part, part_count, std::move(r_bytes));
+               }));
+  // the query will be sent from on_part_read
+  return std::make_pair(NetQueryPtr(), false);
+}
+
+void FileUploader::on_part_read(Part part, int32 part_count, Result<BufferSlice> r_bytes) {
+  if (r_bytes.is_error()) {
+    return on_part_query_ready(part, r_bytes.move_as_error());
+  }
+  on_part_query_ready(part, create_part_query(part, part_count, r_bytes.move_as_ok()));
+}
+
+Result<NetQueryPtr> FileUploader::create_part_query(Part part, int32 part_count, BufferSlice bytes) {
+  auto size = bytes.size();
+  if (size != part.size) {
+    LOG(ERROR) << "Need to read " << part.size << " bytes, but read " << size << " bytes instead";
+    return Status::Error("Failed to read file part");
   }
-  BufferSlice bytes(padded_size);
-  TRY_RESULT(size, fd_.pread(bytes.as_slice().truncate(part.size), part.offset));
+
   if (!encryption_key_.empty()) {
-    Random::secure_bytes(bytes.as_slice().substr(part.size));
+    auto padded_size = (part.size + 15) & ~15;
+    if (padded_size != part.size) {
+      BufferSlice padded_bytes(padded_size);
+      padded_bytes.as_slice().copy_from(bytes.as_slice());
+      Random::secure_bytes(padded_bytes.as_slice().substr(part.size));
+      bytes = std::move(padded_bytes);
+    }
     if (next_offset_ == part.offset) {
-      aes_ige_encrypt(encryption_key_.key(), &iv_, bytes.as_slice(), bytes.as_slice());
+      aes_ige_state_.encrypt(&iv_, bytes.as_slice(), bytes.as_slice());
       next_offset_ += static_cast<int64>(bytes.size());
     } else {
       if (part.id >= static_cast<int32>(iv_map_.size())) {
+        // happens only once after restart of an upload with bad parts, so it is fine to read the file here
+        SCOPE_EXIT {
+          try_release_fd();
+        };
+        TRY_STATUS(acquire_fd());
         TRY_STATUS(generate_iv_map());
       }
       CHECK(part.id < static_cast<int32>(iv_map_.size()) && part.id >= 0);
       auto iv = iv_map_[part.id];
-      aes_ige_encrypt(encryption_key_.key(), &iv, bytes.as_slice(), bytes.as_slice());
+      aes_ige_state_.encrypt(&iv, bytes.as_slice(), bytes.as_slice());
     }
   }
 
-  if (size != part.size) {
-    LOG(ERROR) << "Need to read " << part.size << " bytes, but read " << size << " bytes instead";
-    return Status::Error("Failed to read file part");
-  }
-
   NetQueryPtr net_query;
   if (big_flag_) {
     auto query = telegram_api::upload_saveBigFilePart(file_id_, part.id, part_count, std::move(bytes));
@@ -229,10 +253,10 @@ Result<std::pair<NetQueryPtr, bool>> FileUploader::start_part(Part part, int32 p
                                                 NetQuery::AuthFlag::On, NetQuery::GzipFlag::Off);
   }
   net_query->file_type_ = narrow_cast<int32>(file_type_);
-  return std::make_pair(std::move(net_query), false);
+  return std::move(net_query);
 }
 
-Result<size_t> FileUploader::process_part(Part part, NetQueryPtr net_query) {
+Status FileUploader::process_part(Part part, NetQueryPtr net_query, Promise<size_t> promise) {
   if (net_query->is_error()) {
     return std::move(net_query->error());
   }
@@ -249,7 +273,8 @@ Result<size_t> FileUploader::process_part(Part part, NetQueryPtr net_query) {
     // TODO: it is possible
     return Status::Error(500, "Internal Server Error");
   }
-  return part.size;
+  promise.set_value(std::move(part.size));
+  return Status::OK();
 }
 
 void FileUploader::on_progress(int32 part_count, int32 part_size, int32 ready_part_count, bool is_ready,
@@ -272,15 +297,15 @@ void FileUploader::keep_fd_flag(bool keep_fd) {
 }
 
 void FileUploader::try_release_fd() {
-  if (!keep_fd_ && !fd_.empty()) {
-    fd_.close();
+  if (!keep_fd_ && fd_ != nullptr) {
+    fd_.reset();
   }
 }
 
 Status FileUploader::acquire_fd() {
-  if (fd_.empty()) {
+  if (fd_ == nullptr) {
     TRY_RESULT(fd, FileFd::open(fd_path_, FileFd::Read));
-    fd_ = std::move(fd);
+    fd_ = std::make_shared<FileFd>(std::move(fd));
   }
   return Status::OK();
 }
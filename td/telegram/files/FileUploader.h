@@ -9,12 +9,17 @@
 #include "td/actor/actor.h"
 #include "td/actor/PromiseFuture.h"
 
+#include "td/telegram/files/FileIoWorker.h"
 #include "td/telegram/files/FileLoader.h"
 #include "td/telegram/files/FileLocation.h"
 
+#include "td/utils/buffer.h"
+#include "td/utils/common.h"
+#include "td/utils/crypto.h"
 #include "td/utils/port/FileFd.h"
 #include "td/utils/Status.h"
 
+#include <memory>
 #include <utility>
 
 namespace td {
@@ -28,7 +33,8 @@ class FileUploader : public FileLoader {
   };
 
   FileUploader(const LocalFileLocation &local, const RemoteFileLocation &remote, int64 expected_size,
-               const FileEncryptionKey &encryption_key, std::vector<int> bad_parts, std::unique_ptr<Callback> callback);
+               const FileEncryptionKey &encryption_key, std::vector<int> bad_parts, ActorId<FileIoWorker> io_worker,
+               std::unique_ptr<Callback> callback);
 
   // Should just implement all parent pure virtual methods.
   // Must not call any of them...
@@ -38,7 +44,9 @@ class FileUploader : public FileLoader {
   RemoteFileLocation remote_;
   int64 expected_size_;
   FileEncryptionKey encryption_key_;
+  AesIgeState aes_ige_state_;
   std::vector<int> bad_parts_;
+  ActorId<FileIoWorker> io_worker_;
   std::unique_ptr<Callback> callback_;
   int64 local_size_ = 0;
   bool local_is_ready_ = false;
@@ -50,7 +58,7 @@ class FileUploader : public FileLoader {
   int64 generate_offset_ = 0;
   int64 next_offset_ = 0;
 
-  FileFd fd_;
+  std::shared_ptr<FileFd> fd_;
   string fd_path_;
   int64 file_id_;
   bool big_flag_;
@@ -61,11 +69,14 @@ class FileUploader : public FileLoader {
   Status before_start_parts() override;
   void after_start_parts() override;
   Result<std::pair<NetQueryPtr, bool>> start_part(Part part, int32 part_count) override TD_WARN_UNUSED_RESULT;
-  Result<size_t> process_part(Part part, NetQueryPtr net_query) override TD_WARN_UNUSED_RESULT;
+  Status process_part(Part part, NetQueryPtr net_query, Promise<size_t> promise) override TD_WARN_UNUSED_RESULT;
   void on_progress(int32 part_count, int32 part_size, int32 ready_part_count, bool is_ready, int64 ready_size) override;
   FileLoader::Callback *get_callback() override;
   Result<PrefixInfo> on_update_local_location(const LocalFileLocation &location) override TD_WARN_UNUSED_RESULT;
 
+  void on_part_read(Part part, int32 part_count, Result<BufferSlice> r_bytes);
+  Result<NetQueryPtr> create_part_query(Part part, int32 part_count, BufferSlice bytes) TD_WARN_UNUSED_RESULT;
+
   Status generate_iv_map();
 
   bool keep_fd_ = false;
@@ -11,15 +11,21 @@
 #include "td/utils/format.h"
 #include "td/utils/logging.h"
 #include "td/utils/port/RwMutex.h"
+#include "td/utils/Slice.h"
 #include "td/utils/tl_helpers.h"
 
+#include <atomic>
+
 namespace td {
 
 class AuthDataSharedImpl : public AuthDataShared {
  public:
   AuthDataSharedImpl(DcId dc_id, std::shared_ptr<PublicRsaKeyShared> public_rsa_key)
-      : dc_id_(dc_id), public_rsa_key_(std::move(public_rsa_key)) {
-    log_auth_key(get_auth_key());
+      : dc_id_(dc_id)
+      , public_rsa_key_(std::move(public_rsa_key))
+      , auth_key_key_(PSTRING() << "auth" << dc_id.get_raw_id()) {
+    auto dc_key = G()->td_db()->get_binlog_pmc()->get_view(auth_key_key_);
+    log_auth_key(*publish_auth_key(dc_key.as_slice()));
   }
 
   DcId dc_id() const override {
@@ -31,25 +37,18 @@ class AuthDataSharedImpl : public AuthDataShared {
   }
 
   mtproto::AuthKey get_auth_key() override {
-    string dc_key = G()->td_db()->get_binlog_pmc()->get(auth_key_key());
-
-    mtproto::AuthKey res;
-    if (!dc_key.empty()) {
-      unserialize(res, dc_key).ensure();
-    }
-    return res;
+    return *std::atomic_load_explicit(&auth_key_, std::memory_order_acquire);
   }
   using AuthDataShared::get_auth_state;
   std::pair<AuthState, bool> get_auth_state() override {
-    // TODO (perf):
-    auto auth_key = get_auth_key();
-    AuthState state = get_auth_state(auth_key);
-    return std::make_pair(state, auth_key.was_auth_flag());
+    auto packed_state = auth_state_.load(std::memory_order_acquire);
+    return std::make_pair(static_cast<AuthState>(packed_state >> 1), (packed_state & 1) != 0);
   }
 
   void set_auth_key(const mtproto::AuthKey &auth_key) override {
-    G()->td_db()->get_binlog_pmc()->set(auth_key_key(), serialize(auth_key));
-    log_auth_key(auth_key);
+    auto dc_key = serialize(auth_key);
+    G()->td_db()->get_binlog_pmc()->set(auth_key_key_, dc_key);
+    log_auth_key(*publish_auth_key(dc_key));
 
     notify();
   }
@@ -75,10 +74,10 @@ class AuthDataSharedImpl : public AuthDataShared {
   }
 
   std::vector<mtproto::ServerSalt> get_future_salts() override {
-    string future_salts = G()->td_db()->get_binlog_pmc()->get(future_salts_key());
+    auto future_salts = G()->td_db()->get_binlog_pmc()->get_view(future_salts_key());
     std::vector<mtproto::ServerSalt> res;
     if (!future_salts.empty()) {
-      unserialize(res, future_salts).ensure();
+      unserialize(res, future_salts.as_slice()).ensure();
     }
     return res;
   }
@@ -88,10 +87,12 @@ class AuthDataSharedImpl : public AuthDataShared {
   std::vector<unique_ptr<Listener>> auth_key_listeners_;
   std::shared_ptr<PublicRsaKeyShared> public_rsa_key_;
   RwMutex rw_mutex_;
+  const string auth_key_key_;
+
+  // the binlog keeps the persistent copy of the key; readers use only the in-memory snapshot
+  std::shared_ptr<const mtproto::AuthKey> auth_key_;  // accessed only through std::atomic_load/std::atomic_store
+  std::atomic<int32> auth_state_{0};                   // AuthState << 1 | was_auth_flag
 
-  string auth_key_key() {
-    return PSTRING() << "auth" << dc_id_.get_raw_id();
-  }
   string future_salts_key() {
     return PSTRING() << "salt" << dc_id_.get_raw_id();
   }
@@ -104,6 +105,21 @@ class AuthDataSharedImpl : public AuthDataShared {
     auth_key_listeners_.erase(it, auth_key_listeners_.end());
   }
 
+  // the snapshot is parsed from the bytes stored in the binlog, so get_auth_key returns the same key as a binlog lookup,
+  // with need_header and expire_at, which aren't persisted, reset
+  std::shared_ptr<const mtproto::AuthKey> publish_auth_key(Slice dc_key) {
+    auto auth_key = std::make_shared<mtproto::AuthKey>();
+    if (!dc_key.empty()) {
+      unserialize(*auth_key, dc_key).ensure();
+    }
+    std::atomic_store_explicit(&auth_key_, std::shared_ptr<const mtproto::AuthKey>(auth_key),
+                               std::memory_order_release);
+    auth_state_.store(
+        static_cast<int32>(get_auth_state(*auth_key)) << 1 | static_cast<int32>(auth_key->was_auth_flag()),
+        std::memory_order_release);
+    return std::move(auth_key);
+  }
+
   void log_auth_key(const mtproto::AuthKey &auth_key) {
     LOG(WARNING) << dc_id_ << " " << tag("auth_key_id", auth_key.id()) << tag("state", get_auth_state(auth_key));
   }
@@ -0,0 +1,40 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2017
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "td/telegram/net/DcId.h"
+
+#include "td/utils/common.h"
+
+#include <array>
+
+namespace td {
+// DCs, which are known to be inited by the owner of the cache; it isn't thread-safe and must be kept per thread
+class InitedDcCache {
+ public:
+  static constexpr size_t MAX_DC_COUNT = 1000;
+
+  bool is_inited(DcId dc_id) const {
+    if (!dc_id.is_exact()) {
+      return false;
+    }
+    size_t pos = static_cast<size_t>(dc_id.get_raw_id() - 1);
+    return pos < MAX_DC_COUNT && is_inited_[pos];
+  }
+
+  // DC is never uninited, so the value can be cached forever
+  void on_dc_inited(DcId dc_id) {
+    CHECK(dc_id.is_exact());
+    size_t pos = static_cast<size_t>(dc_id.get_raw_id() - 1);
+    CHECK(pos < MAX_DC_COUNT);
+    is_inited_[pos] = true;
+  }
+
+ private:
+  std::array<bool, MAX_DC_COUNT> is_inited_{};
+};
+}  // namespace td
@@ -68,6 +68,26 @@ class NetQuery : public ListNode {
     return gzip_flag_;
   }
 
+  // the query is big and is going to be compressed before it is sent to a session
+  bool need_gzip_encode() const {
+    return need_gzip_encode_;
+  }
+
+  void set_need_gzip_encode() {
+    CHECK(gzip_flag_ == GzipFlag::Off);
+    need_gzip_encode_ = true;
+  }
+
+  // compressed_query is empty if the query wasn't compressed
+  void on_gzip_encoded(BufferSlice &&compressed_query) {
+    CHECK(need_gzip_encode_);
+    need_gzip_encode_ = false;
+    if (!compressed_query.empty()) {
+      query_ = std::move(compressed_query);
+      gzip_flag_ = GzipFlag::On;
+    }
+  }
+
   AuthFlag auth_flag() const {
     return auth_flag_;
   }
@@ -267,6 +287,7 @@ class NetQuery : public ListNode {
   Type type_;
   AuthFlag auth_flag_;
   GzipFlag gzip_flag_;
+  bool need_gzip_encode_ = false;
   DcId dc_id_;
 
   Status status_;
@@ -15,19 +15,22 @@ NetQueryCreator::Ptr NetQueryCreator::create(uint64 id, const Storer &storer, Dc
   BufferSlice slice(storer.size());
   storer.store(slice.as_slice().ubegin());
 
-  // TODO: magic constant
-  if (slice.size() < (1 << 8)) {
-    gzip_flag = NetQuery::GzipFlag::Off;
-  }
   int32 tl_constructor = NetQuery::tl_magic(slice);
+  bool need_delayed_gzip = false;
   if (gzip_flag == NetQuery::GzipFlag::On) {
-    // TODO: try to compress files?
-    BufferSlice compressed;
-    compressed = gzencode(slice.as_slice());
-    if (compressed.empty()) {
-      gzip_flag = NetQuery::GzipFlag::Off;
-    } else {
-      slice = std::move(compressed);
+    gzip_flag = NetQuery::GzipFlag::Off;
+    if (slice.size() >= MIN_GZIP_SIZE && gzip_policy_.need_gzip(tl_constructor)) {
+      // TODO: try to compress files?
+      if (slice.size() >= MIN_DELAYED_GZIP_SIZE) {
+        // don't block the caller
+        need_delayed_gzip = true;
+      } else {
+        auto compressed = try_gzip_encode(slice.as_slice(), tl_constructor);
+        if (!compressed.empty()) {
+          gzip_flag = NetQuery::GzipFlag::On;
+          slice = std::move(compressed);
+        }
+      }
     }
   }
 
@@ -35,6 +38,47 @@ NetQueryCreator::Ptr NetQueryCreator::create(uint64 id, const Storer &storer, Dc
                                    gzip_flag, tl_constructor);
   query->set_cancellation_token(query.generation());
   query->total_timeout_limit = total_timeout_limit;
+  if (need_delayed_gzip) {
+    query->set_need_gzip_encode();
+  }
   return query;
 }
+
+void NetQueryCreator::gzip_encode(NetQuery &query) {
+  query.on_gzip_encoded(try_gzip_encode(query.query().as_slice(), query.tl_constructor()));
+}
+
+BufferSlice NetQueryCreator::try_gzip_encode(Slice query, int32 tl_constructor) {
+  auto compressed = gzencode(query);
+  gzip_policy_.on_gzip_result(tl_constructor, !compressed.empty());
+  return compressed;
+}
+
+bool NetQueryCreator::GzipPolicy::need_gzip(int32 tl_constructor) {
+  auto &slot = get_slot(tl_constructor);
+  if (slot.tl_constructor.load(std::memory_order_relaxed) != tl_constructor ||
+      slot.failed_gzip_count.load(std::memory_order_relaxed) < MAX_FAILED_GZIP_COUNT) {
+    return true;
+  }
+  // retry from time to time in case the content has changed
+  return slot.skipped_gzip_count.fetch_add(1, std::memory_order_relaxed) % GZIP_RETRY_PERIOD == GZIP_RETRY_PERIOD - 1;
+}
+
+void NetQueryCreator::GzipPolicy::on_gzip_result(int32 tl_constructor, bool is_compressed) {
+  auto &slot = get_slot(tl_constructor);
+  if (slot.tl_constructor.load(std::memory_order_relaxed) != tl_constructor) {
+    if (is_compressed) {
+      return;
+    }
+    slot.tl_constructor.store(tl_constructor, std::memory_order_relaxed);
+    slot.failed_gzip_count.store(1, std::memory_order_relaxed);
+    slot.skipped_gzip_count.store(0, std::memory_order_relaxed);
+    return;
+  }
+  if (is_compressed) {
+    slot.failed_gzip_count.store(0, std::memory_order_relaxed);
+  } else if (slot.failed_gzip_count.load(std::memory_order_relaxed) < MAX_FAILED_GZIP_COUNT) {
+    slot.failed_gzip_count.fetch_add(1, std::memory_order_relaxed);
+  }
+}
 }  // namespace td
@@ -10,9 +10,13 @@
 #include "td/telegram/UniqueId.h"
 
 #include "td/utils/buffer.h"
+#include "td/utils/common.h"
 #include "td/utils/ObjectPool.h"
 #include "td/utils/Storer.h"
 
+#include <array>
+#include <atomic>
+
 namespace td {
 class NetQueryCreator {
  public:
@@ -48,7 +52,42 @@ class NetQueryCreator {
              NetQuery::AuthFlag auth_flag = NetQuery::AuthFlag::On,
              NetQuery::GzipFlag gzip_flag = NetQuery::GzipFlag::On, double total_timeout_limit = 60);
 
+  // compresses query, for which need_gzip_encode() is true; can be called from any thread
+  void gzip_encode(NetQuery &query);
+
  private:
+  static constexpr size_t MIN_GZIP_SIZE = 1 << 8;
+  // bigger queries are compressed by NetQueryDispatcher on a separate scheduler
+  static constexpr size_t MIN_DELAYED_GZIP_SIZE = 1 << 14;
+
+  // remembers query types, which didn't compress well recently, and compresses them only from time to time;
+  // shared between threads, so the stats are approximate and different types can share a slot
+  class GzipPolicy {
+   public:
+    bool need_gzip(int32 tl_constructor);
+
+    void on_gzip_result(int32 tl_constructor, bool is_compressed);
+
+   private:
+    static constexpr size_t SLOT_COUNT = 256;
+    static constexpr int32 MAX_FAILED_GZIP_COUNT = 3;
+    static constexpr int32 GZIP_RETRY_PERIOD = 32;
+
+    struct Slot {
+      std::atomic<int32> tl_constructor{0};
+      std::atomic<int32> failed_gzip_count{0};
+      std::atomic<int32> skipped_gzip_count{0};
+    };
+    std::array<Slot, SLOT_COUNT> slots_;
+
+    Slot &get_slot(int32 tl_constructor) {
+      return slots_[static_cast<uint32>(tl_constructor) % SLOT_COUNT];
+    }
+  };
+
   ObjectPool<NetQuery> object_pool_;
+  GzipPolicy gzip_policy_;
+
+  BufferSlice try_gzip_encode(Slice query, int32 tl_constructor);
 };
 }  // namespace td
@@ -8,7 +8,9 @@
 
 #include "td/telegram/net/DcAuthManager.h"
 #include "td/telegram/net/NetQuery.h"
+#include "td/telegram/net/NetQueryCreator.h"
 #include "td/telegram/net/NetQueryDelayer.h"
+#include "td/telegram/net/NetQueryGzipEncoder.h"
 #include "td/telegram/net/PublicRsaKeyWatchdog.h"
 #include "td/telegram/net/SessionMultiProxy.h"
 
@@ -80,6 +82,14 @@ void NetQueryDispatcher::dispatch(NetQueryPtr net_query) {
     return;
   }
 
+  if (net_query->need_gzip_encode()) {
+    if (!gzip_encoder_.empty()) {
+      net_query->debug("sent to NetQueryGzipEncoder");
+      return send_closure(gzip_encoder_, &NetQueryGzipEncoder::encode, std::move(net_query));
+    }
+    G()->net_query_creator().gzip_encode(*net_query);
+  }
+
   if (net_query->dispatch_ttl > 0) {
     net_query->dispatch_ttl--;
   }
@@ -106,8 +116,15 @@ void NetQueryDispatcher::dispatch(NetQueryPtr net_query) {
   }
 }
 
+bool NetQueryDispatcher::is_dc_inited_locally(DcId dc_id) {
+  return inited_dcs_.get().is_inited(dc_id);
+}
+
 Status NetQueryDispatcher::wait_dc_init(DcId dc_id, bool force) {
-  // TODO: optimize
+  if (is_dc_inited_locally(dc_id)) {
+    return Status::OK();
+  }
+
   if (!dc_id.is_exact()) {
     return Status::Error("Not exact DC");
   }
@@ -176,6 +193,7 @@ Status NetQueryDispatcher::wait_dc_init(DcId dc_id, bool force) {
 #endif
     }
   }
+  inited_dcs_.get().on_dc_inited(dc_id);
   return Status::OK();
 }
 
@@ -188,6 +206,7 @@ void NetQueryDispatcher::stop() {
   std::lock_guard<std::mutex> guard(main_dc_id_mutex_);
   stop_flag_ = true;
   delayer_.hangup();
+  gzip_encoder_.hangup();
   for (const auto &dc : dcs_) {
     dc.main_session_.hangup();
     dc.upload_session_.hangup();
@@ -245,6 +264,8 @@ NetQueryDispatcher::NetQueryDispatcher(std::function<ActorShared<>()> create_ref
   }
   LOG(INFO) << tag("main_dc_id", main_dc_id_.load(std::memory_order_relaxed));
   delayer_ = create_actor<NetQueryDelayer>("NetQueryDelayer", create_reference());
+  gzip_encoder_ = create_actor_on_scheduler<NetQueryGzipEncoder>("NetQueryGzipEncoder", G()->get_gc_scheduler_id(),
+                                                                 create_reference());
   dc_auth_manager_ = create_actor<DcAuthManager>("DcAuthManager", create_reference());
   common_public_rsa_key_ = std::make_shared<PublicRsaKeyShared>(DcId::empty());
   public_rsa_key_watchdog_ = create_actor<PublicRsaKeyWatchdog>("PublicRsaKeyWatchdog", create_reference());
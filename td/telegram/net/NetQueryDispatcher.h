@@ -6,9 +6,11 @@
 //
 #pragma once
 #include "td/telegram/net/AuthDataShared.h"
+#include "td/telegram/net/InitedDcCache.h"
 #include "td/telegram/net/NetQuery.h"
 
 #include "td/actor/actor.h"
+#include "td/actor/SchedulerLocalStorage.h"
 
 #include "td/utils/common.h"
 #include "td/utils/Status.h"
@@ -21,6 +23,7 @@
 
 namespace td {
 class NetQueryDelayer;
+class NetQueryGzipEncoder;
 class DataCenter;
 class DcAuthManager;
 class SessionMultiProxy;
@@ -54,18 +57,21 @@ class NetQueryDispatcher {
  private:
   std::atomic<bool> stop_flag_{false};
   ActorOwn<NetQueryDelayer> delayer_;
+  ActorOwn<NetQueryGzipEncoder> gzip_encoder_;
   ActorOwn<DcAuthManager> dc_auth_manager_;
   struct Dc {
     std::atomic<bool> is_valid_{false};
-    std::atomic<bool> is_inited_{false};  // TODO: cache in scheduler local storage :D
+    std::atomic<bool> is_inited_{false};
 
     ActorOwn<SessionMultiProxy> main_session_;
     ActorOwn<SessionMultiProxy> download_session_;
     ActorOwn<SessionMultiProxy> download_small_session_;
     ActorOwn<SessionMultiProxy> upload_session_;
   };
-  static constexpr size_t MAX_DC_COUNT = 1000;
+  static constexpr size_t MAX_DC_COUNT = InitedDcCache::MAX_DC_COUNT;
   std::array<Dc, MAX_DC_COUNT> dcs_;
+  // DCs, which are known to be inited by the current scheduler; checked before any access to the shared atomics
+  SchedulerLocalStorage<InitedDcCache> inited_dcs_;
 #if TD_EMSCRIPTEN  // FIXME
   std::atomic<int32> main_dc_id_{2};
 #else
@@ -76,6 +82,7 @@ class NetQueryDispatcher {
   std::mutex main_dc_id_mutex_;
 
   Status wait_dc_init(DcId dc_id, bool force);
+  bool is_dc_inited_locally(DcId dc_id);
   bool is_dc_inited(int32 raw_dc_id);
 
   static int32 get_session_count();
@@ -0,0 +1,19 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2017
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/telegram/net/NetQueryGzipEncoder.h"
+
+#include "td/telegram/Global.h"
+#include "td/telegram/net/NetQueryCreator.h"
+#include "td/telegram/net/NetQueryDispatcher.h"
+
+namespace td {
+void NetQueryGzipEncoder::encode(NetQueryPtr query) {
+  query->debug("gzip encode");
+  G()->net_query_creator().gzip_encode(*query);
+  G()->net_query_dispatcher().dispatch(std::move(query));
+}
+}  // namespace td
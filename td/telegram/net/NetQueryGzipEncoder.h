@@ -0,0 +1,23 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2017
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+#include "td/telegram/net/NetQuery.h"
+
+#include "td/actor/actor.h"
+
+namespace td {
+// compresses big queries away from the actors, which have created them, and returns them to NetQueryDispatcher
+class NetQueryGzipEncoder : public Actor {
+ public:
+  explicit NetQueryGzipEncoder(ActorShared<> parent) : parent_(std::move(parent)) {
+  }
+  void encode(NetQueryPtr query);
+
+ private:
+  ActorShared<> parent_;
+};
+}  // namespace td
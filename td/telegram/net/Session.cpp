@@ -253,10 +253,15 @@ void Session::return_query(NetQueryPtr &&query) {
 }
 
 void Session::flush_pending_invoke_after_queries() {
-  while (!pending_invoke_after_queries_.empty()) {
-    auto &query = pending_invoke_after_queries_.front();
-    pending_queries_.push_back(std::move(query));
-    pending_invoke_after_queries_.pop_front();
+  append(pending_queries_, std::move(pending_invoke_after_queries_));
+}
+
+template <class F>
+void Session::for_each_sent_query(F &&f) {
+  for (auto it = sent_queries_list_.prev; it != &sent_queries_list_;) {
+    auto query = Query::from_list_node(it);
+    it = it->prev;
+    f(query);
   }
 }
 
@@ -265,22 +270,23 @@ void Session::close() {
   connection_close(&main_connection_);
   connection_close(&long_poll_connection_);
 
-  for (auto &it : sent_queries_) {
-    auto &query = it.second.query;
+  for_each_sent_query([&](Query *query_ptr) {
+    auto &query = query_ptr->query;
     query->set_message_id(0);
     query->cancel_slot_.clear_event();
     pending_queries_.push_back(std::move(query));
-  }
+  });
   sent_queries_.clear();
   sent_containers_.clear();
+  unknown_query_count_ = 0;
 
   flush_pending_invoke_after_queries();
   CHECK(sent_queries_.empty());
-  while (!pending_queries_.empty()) {
-    auto &query = pending_queries_.front();
+  auto pending_queries = std::move(pending_queries_);
+  pending_queries_.clear();
+  for (auto &query : pending_queries) {
     query->set_error_resend();
     return_query(std::move(query));
-    pending_queries_.pop_front();
   }
 
   callback_->on_closed();
@@ -294,18 +300,18 @@ void Session::hangup() {
 
 void Session::raw_event(const Event::Raw &event) {
   auto message_id = event.u64;
-  auto it = sent_queries_.find(message_id);
-  if (it == sent_queries_.end()) {
+  auto query_ptr = sent_queries_.find(message_id);
+  if (query_ptr == nullptr) {
     return;
   }
 
-  dec_container(it->first, &it->second);
-  mark_as_known(it->first, &it->second);
+  dec_container(message_id, query_ptr);
+  mark_as_known(message_id, query_ptr);
 
-  auto query = std::move(it->second.query);
+  auto query = std::move(query_ptr->query);
   query->set_message_id(0);
   query->cancel_slot_.clear_event();
-  sent_queries_.erase(it);
+  sent_queries_.erase(message_id);
   return_query(std::move(query));
 
   LOG(DEBUG) << "Drop answer " << tag("message_id", format::as_hex(message_id));
@@ -329,8 +335,8 @@ Status Session::on_pong() {
   if (current_info_ == &main_connection_ &&
       Timestamp::at(current_info_->created_at_ + MIN_CONNECTION_ACTIVE).is_in_past()) {
     Status status;
-    if (!unknown_queries_.empty()) {
-      status = Status::Error(PSLICE() << "No state info for " << unknown_queries_.size() << " queries for "
+    if (unknown_query_count_ != 0) {
+      status = Status::Error(PSLICE() << "No state info for " << unknown_query_count_ << " queries for "
                                       << format::as_time(Time::now_cached() - current_info_->created_at_));
     }
     if (!sent_queries_list_.empty()) {
@@ -401,32 +407,31 @@ void Session::on_closed(Status status) {
   }
 
   // resend all queries without ack.
-  for (auto it = sent_queries_.begin(); it != sent_queries_.end();) {
-    if (!it->second.ack && it->second.connection_id == current_info_->connection_id) {
-      // container vector leak otherwise
-      cleanup_container(it->first, &it->second);
-
-      // mark query as unknown
-      if (status.is_error() && status.code() == 500) {
-        cleanup_container(it->first, &it->second);
-        mark_as_known(it->first, &it->second);
-
-        auto &query = it->second.query;
-        VLOG(net_query) << "resend query (on_disconnected, no ack) " << query;
-        query->set_message_id(0);
-        query->cancel_slot_.clear_event();
-        query->set_error(Status::Error(500, "Session failed: " + status.message().str()),
-                         current_info_->connection->get_name().str());
-        return_query(std::move(query));
-        it = sent_queries_.erase(it);
-      } else {
-        mark_as_unknown(it->first, &it->second);
-        it++;
-      }
+  for_each_sent_query([&](Query *query_ptr) {
+    if (query_ptr->ack || query_ptr->connection_id != current_info_->connection_id) {
+      return;
+    }
+    auto message_id = query_ptr->message_id;
+
+    // container vector leak otherwise
+    cleanup_container(message_id, query_ptr);
+
+    // mark query as unknown
+    if (status.is_error() && status.code() == 500) {
+      mark_as_known(message_id, query_ptr);
+
+      auto &query = query_ptr->query;
+      VLOG(net_query) << "resend query (on_disconnected, no ack) " << query;
+      query->set_message_id(0);
+      query->cancel_slot_.clear_event();
+      query->set_error(Status::Error(500, "Session failed: " + status.message().str()),
+                       current_info_->connection->get_name().str());
+      return_query(std::move(query));
+      sent_queries_.erase(message_id);
     } else {
-      ++it;
+      mark_as_unknown(message_id, query_ptr);
     }
-  }
+  });
 
   current_info_->connection.reset();
   current_info_->state = ConnectionInfo::State::Empty;
@@ -445,23 +450,23 @@ void Session::on_session_created(uint64 unique_id, uint64 first_id) {
     return_query(G()->net_query_creator().create_result(0, std::move(packet)));
   }
 
-  for (auto it = sent_queries_.begin(); it != sent_queries_.end();) {
-    Query *query_ptr = &it->second;
-    if (query_ptr->container_id < first_id) {
-      // container vector leak otherwise
-      cleanup_container(it->first, &it->second);
-      mark_as_known(it->first, &it->second);
-
-      auto &query = it->second.query;
-      VLOG(net_query) << "resend query (on_session_created) " << query;
-      query->set_message_id(0);
-      query->cancel_slot_.clear_event();
-      resend_query(std::move(query));
-      it = sent_queries_.erase(it);
-    } else {
-      ++it;
+  for_each_sent_query([&](Query *query_ptr) {
+    if (query_ptr->container_id >= first_id) {
+      return;
     }
-  }
+    auto message_id = query_ptr->message_id;
+
+    // container vector leak otherwise
+    cleanup_container(message_id, query_ptr);
+    mark_as_known(message_id, query_ptr);
+
+    auto &query = query_ptr->query;
+    VLOG(net_query) << "resend query (on_session_created) " << query;
+    query->set_message_id(0);
+    query->cancel_slot_.clear_event();
+    resend_query(std::move(query));
+    sent_queries_.erase(message_id);
+  });
 }
 
 void Session::on_session_failed(Status status) {
@@ -477,11 +482,11 @@ void Session::on_session_failed(Status status) {
 
 void Session::on_container_sent(uint64 container_id, vector<uint64> msg_ids) {
   auto erase_from = std::remove_if(msg_ids.begin(), msg_ids.end(), [&](uint64 msg_id) {
-    auto it = sent_queries_.find(msg_id);
-    if (it == sent_queries_.end()) {
+    auto query_ptr = sent_queries_.find(msg_id);
+    if (query_ptr == nullptr) {
       return true;  // remove
     }
-    it->second.container_id = container_id;
+    query_ptr->container_id = container_id;
     return false;
   });
   msg_ids.erase(erase_from, msg_ids.end());
@@ -510,18 +515,18 @@ void Session::on_message_ack_impl(uint64 id, int32 type) {
 }
 
 void Session::on_message_ack_impl_inner(uint64 id, int32 type, bool in_container) {
-  auto it = sent_queries_.find(id);
-  if (it == sent_queries_.end()) {
+  auto query_ptr = sent_queries_.find(id);
+  if (query_ptr == nullptr) {
     return;
   }
-  VLOG(net_query) << "Ack " << tag("msg_id", id) << it->second.query;
-  it->second.ack = true;
-  it->second.query->debug_ack |= type;
-  it->second.query->quick_ack_promise_.set_value(Unit());
+  VLOG(net_query) << "Ack " << tag("msg_id", id) << query_ptr->query;
+  query_ptr->ack = true;
+  query_ptr->query->debug_ack |= type;
+  query_ptr->query->quick_ack_promise_.set_value(Unit());
   if (!in_container) {
-    cleanup_container(id, &it->second);
+    cleanup_container(id, query_ptr);
   }
-  mark_as_known(it->first, &it->second);
+  mark_as_known(id, query_ptr);
 }
 
 void Session::dec_container(uint64 message_id, Query *query) {
@@ -557,8 +562,9 @@ void Session::mark_as_known(uint64 id, Query *query) {
   }
   VLOG(net_query) << "Mark as known " << tag("msg_id", id) << query->query;
   query->unknown = false;
-  unknown_queries_.erase(id);
-  if (unknown_queries_.empty()) {
+  CHECK(unknown_query_count_ > 0);
+  unknown_query_count_--;
+  if (unknown_query_count_ == 0) {
     flush_pending_invoke_after_queries();
   }
 }
@@ -570,7 +576,7 @@ void Session::mark_as_unknown(uint64 id, Query *query) {
   }
   VLOG(net_query) << "Mark as unknown " << tag("msg_id", id) << query->query;
   query->unknown = true;
-  unknown_queries_.insert(id);
+  unknown_query_count_++;
 }
 
 Status Session::on_message_result_ok(uint64 id, BufferSlice packet, size_t original_size) {
@@ -593,8 +599,8 @@ Status Session::on_message_result_ok(uint64 id, BufferSlice packet, size_t origi
     return_query(G()->net_query_creator().create_result(0, std::move(packet)));
     return Status::OK();
   }
-  auto it = sent_queries_.find(id);
-  if (it == sent_queries_.end()) {
+  auto query_ptr = sent_queries_.find(id);
+  if (query_ptr == nullptr) {
     LOG(DEBUG) << "DROP result to " << tag("request_id", format::as_hex(id)) << tag("tl", format::as_hex(ID));
 
     if (packet.size() > 16 * 1024) {
@@ -609,7 +615,6 @@ Status Session::on_message_result_ok(uint64 id, BufferSlice packet, size_t origi
     return Status::OK();
   }
   auth_data_.on_api_response();
-  Query *query_ptr = &it->second;
   VLOG(net_query) << "return query result " << query_ptr->query;
 
   cleanup_container(id, query_ptr);
@@ -620,7 +625,7 @@ Status Session::on_message_result_ok(uint64 id, BufferSlice packet, size_t origi
   query_ptr->query->cancel_slot_.clear_event();
   return_query(std::move(query_ptr->query));
 
-  sent_queries_.erase(it);
+  sent_queries_.erase(id);
   return Status::OK();
 }
 
@@ -649,12 +654,11 @@ void Session::on_message_result_error(uint64 id, int error_code, BufferSlice mes
 
   LOG(DEBUG) << "Session::on_error " << tag("id", id) << tag("error_code", error_code)
              << tag("msg", message.as_slice());
-  auto it = sent_queries_.find(id);
-  if (it == sent_queries_.end()) {
+  auto query_ptr = sent_queries_.find(id);
+  if (query_ptr == nullptr) {
     return;
   }
 
-  Query *query_ptr = &it->second;
   VLOG(net_query) << "return query error " << query_ptr->query;
 
   cleanup_container(id, query_ptr);
@@ -665,17 +669,16 @@ void Session::on_message_result_error(uint64 id, int error_code, BufferSlice mes
   query_ptr->query->cancel_slot_.clear_event();
   return_query(std::move(query_ptr->query));
 
-  sent_queries_.erase(it);
+  sent_queries_.erase(id);
 }
 
 void Session::on_message_failed_inner(uint64 id, bool in_container) {
   LOG(INFO) << "message inner failed " << id;
-  auto it = sent_queries_.find(id);
-  if (it == sent_queries_.end()) {
+  auto query_ptr = sent_queries_.find(id);
+  if (query_ptr == nullptr) {
     return;
   }
 
-  Query *query_ptr = &it->second;
   if (!in_container) {
     cleanup_container(id, query_ptr);
   }
@@ -685,7 +688,7 @@ void Session::on_message_failed_inner(uint64 id, bool in_container) {
   query_ptr->query->cancel_slot_.clear_event();
   query_ptr->query->debug_send_failed();
   resend_query(std::move(query_ptr->query));
-  sent_queries_.erase(it);
+  sent_queries_.erase(id);
 }
 
 void Session::on_message_failed(uint64 id, Status status) {
@@ -706,22 +709,22 @@ void Session::on_message_failed(uint64 id, Status status) {
 }
 
 void Session::on_message_info(uint64 id, int32 state, uint64 answer_id, int32 answer_size) {
-  auto it = sent_queries_.find(id);
-  if (it != sent_queries_.end()) {
-    if (it->second.query->update_is_ready()) {
-      dec_container(it->first, &it->second);
-      mark_as_known(it->first, &it->second);
+  auto query_ptr = sent_queries_.find(id);
+  if (query_ptr != nullptr) {
+    if (query_ptr->query->update_is_ready()) {
+      dec_container(id, query_ptr);
+      mark_as_known(id, query_ptr);
 
-      auto query = std::move(it->second.query);
+      auto query = std::move(query_ptr->query);
       query->set_message_id(0);
       query->cancel_slot_.clear_event();
-      sent_queries_.erase(it);
+      sent_queries_.erase(id);
       return_query(std::move(query));
       return;
     }
   }
   if (id != 0) {
-    if (it == sent_queries_.end()) {
+    if (query_ptr == nullptr) {
       return;
     }
     switch (state & 7) {
@@ -747,10 +750,10 @@ void Session::on_message_info(uint64 id, int32 state, uint64 answer_id, int32 an
 
   // ok, we are waiting for result of id. let's ask to resend it
   if (answer_id != 0) {
-    if (it != sent_queries_.end()) {
+    if (query_ptr != nullptr) {
       VLOG_IF(net_query, id != 0) << "Resend answer " << tag("msg_id", id) << tag("answer_id", answer_id)
-                                  << tag("answer_size", answer_size) << it->second.query;
-      it->second.query->debug("Session: resend answer");
+                                  << tag("answer_size", answer_size) << query_ptr->query;
+      query_ptr->query->debug("Session: resend answer");
     }
     current_info_->connection->resend_answer(answer_id);
   }
@@ -773,7 +776,7 @@ void Session::add_query(NetQueryPtr &&net_query) {
   net_query->debug("Session: pending");
   LOG_IF(FATAL, UniqueId::extract_type(net_query->id()) == UniqueId::BindKey)
       << "Add BindKey query inpo pending_queries_";
-  pending_queries_.emplace_back(std::move(net_query));
+  pending_queries_.push_back(std::move(net_query));
 }
 
 void Session::connection_send_query(ConnectionInfo *info, NetQueryPtr &&net_query, uint64 message_id) {
@@ -793,7 +796,7 @@ void Session::connection_send_query(ConnectionInfo *info, NetQueryPtr &&net_quer
       net_query->set_error_resend_invoke_after();
       return return_query(std::move(net_query));
     }
-    if (!unknown_queries_.empty()) {
+    if (unknown_query_count_ != 0) {
       pending_invoke_after_queries_.push_back(std::move(net_query));
       return;
     }
@@ -814,19 +817,19 @@ void Session::connection_send_query(ConnectionInfo *info, NetQueryPtr &&net_quer
                   << tag("invoke_after", format::as_hex(invoke_after_id));
   net_query->set_message_id(message_id);
   net_query->cancel_slot_.clear_event();
-  CHECK(sent_queries_.find(message_id) == sent_queries_.end()) << message_id;
+  CHECK(sent_queries_.find(message_id) == nullptr) << message_id;
   net_query->debug_unknown = false;
   net_query->debug_ack = 0;
   if (!net_query->cancel_slot_.empty()) {
     LOG(DEBUG) << "set event for net_query cancellation " << tag("message_id", format::as_hex(message_id));
     net_query->cancel_slot_.set_event(EventCreator::raw(actor_id(), message_id));
   }
-  auto status = sent_queries_.emplace(
-      message_id, Query{message_id, std::move(net_query), main_connection_.connection_id, Time::now_cached()});
-  sent_queries_list_.put(status.first->second.get_list_node());
+  auto status = sent_queries_.emplace(message_id, message_id, std::move(net_query), main_connection_.connection_id,
+                                      Time::now_cached());
   if (!status.second) {
     LOG(FATAL) << "Duplicate message_id oO [message_id=" << message_id << "]";
   }
+  sent_queries_list_.put(status.first->get_list_node());
 }
 
 void Session::connection_open(ConnectionInfo *info, bool ask_info) {
@@ -935,14 +938,16 @@ void Session::connection_open_finish(ConnectionInfo *info,
   info->state = ConnectionInfo::State::Ready;
   info->created_at_ = Time::now_cached();
   info->wakeup_at = Time::now_cached() + 10;
-  if (unknown_queries_.size() > 1024) {
+  if (unknown_query_count_ > 1024) {
     on_session_failed(Status::Error("Too much queries with unknown state"));
     return;
   }
   if (info->ask_info) {
-    for (auto &id : unknown_queries_) {
-      info->connection->get_state_info(id);
-    }
+    for_each_sent_query([&](Query *query_ptr) {
+      if (query_ptr->unknown) {
+        info->connection->get_state_info(query_ptr->message_id);
+      }
+    });
     for (auto &id : to_cancel_) {
       info->connection->cancel_answer(id);
     }
@@ -1143,9 +1148,11 @@ void Session::loop() {
       if (auth_data_.is_ready(Time::now_cached())) {
         if (need_send_query()) {
           while (!pending_queries_.empty()) {
-            auto &query = pending_queries_.front();
-            connection_send_query(&main_connection_, std::move(query));
-            pending_queries_.pop_front();
+            auto pending_queries = std::move(pending_queries_);
+            pending_queries_.clear();
+            for (auto &query : pending_queries) {
+              connection_send_query(&main_connection_, std::move(query));
+            }
           }
           need_flush = true;
         }
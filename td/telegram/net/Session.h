@@ -21,15 +21,13 @@
 #include "td/utils/buffer.h"
 #include "td/utils/common.h"
 #include "td/utils/List.h"
+#include "td/utils/SlabMap.h"
 #include "td/utils/Status.h"
 #include "td/utils/StringBuilder.h"
 
 #include <array>
-#include <deque>
-#include <map>
 #include <memory>
 #include <unordered_map>
-#include <unordered_set>
 #include <utility>
 
 namespace td {
@@ -68,6 +66,7 @@ class Session final
 
  private:
   struct Query : private ListNode {
+    uint64 message_id;
     uint64 container_id;
     NetQueryPtr query;
 
@@ -77,7 +76,11 @@ class Session final
     int8 connection_id;
     double sent_at_;
     Query(uint64 message_id, NetQueryPtr &&q, int8 connection_id, double sent_at)
-        : container_id(message_id), query(std::move(q)), connection_id(connection_id), sent_at_(sent_at) {
+        : message_id(message_id)
+        , container_id(message_id)
+        , query(std::move(q))
+        , connection_id(connection_id)
+        , sent_at_(sent_at) {
     }
 
     ListNode *get_list_node() {
@@ -107,15 +110,14 @@ class Session final
   double last_activity_timestamp_ = 0;
   size_t dropped_size_ = 0;
 
-  std::unordered_set<uint64> unknown_queries_;
+  size_t unknown_query_count_ = 0;
   std::vector<int64> to_cancel_;
 
-  // Do not invalidate iterators of this two containers!
-  // TODO: better data structures
-  std::deque<NetQueryPtr> pending_queries_;
-  std::map<uint64, Query> sent_queries_;
-  std::deque<NetQueryPtr> pending_invoke_after_queries_;
-  ListNode sent_queries_list_;
+  // queries can be added while pending queries are sent, so the pending queries are sent in batches
+  vector<NetQueryPtr> pending_queries_;
+  SlabMap<uint64, Query> sent_queries_;  // message_id -> Query; queries are never moved, so they can be in a list
+  vector<NetQueryPtr> pending_invoke_after_queries_;
+  ListNode sent_queries_list_;  // sent queries from the newest to the oldest
 
   struct ConnectionInfo {
     int8 connection_id;
@@ -191,6 +193,10 @@ class Session final
   void on_message_info(uint64 id, int32 state, uint64 answer_id, int32 answer_size) override;
 
   void flush_pending_invoke_after_queries();
+
+  // calls f(query) for each sent query from the oldest to the newest; f can erase the query from sent_queries_
+  template <class F>
+  void for_each_sent_query(F &&f);
   bool has_queries() const;
 
   void dec_container(uint64 message_id, Query *query);
@@ -15,11 +15,18 @@
 
 namespace td {
 
-void ConcurrentScheduler::init(int32 threads_n) {
+void ConcurrentScheduler::init(int32 threads_n, const std::vector<int32> &lazy_sched_ids) {
 #if TD_THREAD_UNSUPPORTED || TD_EVENTFD_UNSUPPORTED
   threads_n = 0;
 #endif
   threads_n++;
+#if !TD_THREAD_UNSUPPORTED && !TD_EVENTFD_UNSUPPORTED
+  is_lazy_thread_.assign(threads_n, false);
+  for (auto sched_id : lazy_sched_ids) {
+    CHECK(0 < sched_id && sched_id < threads_n);
+    is_lazy_thread_[sched_id] = true;
+  }
+#endif
   std::vector<std::shared_ptr<MpscPollableQueue<EventFull>>> outbound(threads_n);
   for (int32 i = 0; i < threads_n; i++) {
     auto queue = std::make_shared<MpscPollableQueue<EventFull>>();
@@ -50,19 +57,43 @@ void ConcurrentScheduler::start() {
   is_finished_.store(false, std::memory_order_relaxed);
   set_thread_id(0);
 #if !TD_THREAD_UNSUPPORTED && !TD_EVENTFD_UNSUPPORTED
-  for (size_t i = 1; i < schedulers_.size(); i++) {
-    auto &sched = schedulers_[i];
-    threads_.push_back(td::thread([&, tid = i]() {
-      set_thread_id(static_cast<int32>(tid));
-      while (!is_finished()) {
-        sched->run(10);
+  {
+    std::lock_guard<std::mutex> lock(threads_mutex_);
+    for (size_t i = 1; i < schedulers_.size(); i++) {
+      if (!is_lazy_thread_[i]) {
+        start_thread(i);
       }
-    }));
+    }
   }
 #endif
   state_ = State::Run;
 }
 
+#if !TD_THREAD_UNSUPPORTED && !TD_EVENTFD_UNSUPPORTED
+void ConcurrentScheduler::start_thread(size_t sched_id) {
+  auto &sched = schedulers_[sched_id];
+  threads_.push_back(td::thread([&, tid = sched_id]() {
+    set_thread_id(static_cast<int32>(tid));
+    while (!is_finished()) {
+      sched->run(10);
+    }
+  }));
+}
+#endif
+
+void ConcurrentScheduler::start_scheduler(int32 sched_id) {
+#if !TD_THREAD_UNSUPPORTED && !TD_EVENTFD_UNSUPPORTED
+  std::lock_guard<std::mutex> lock(threads_mutex_);
+  CHECK(0 <= sched_id && static_cast<size_t>(sched_id) < schedulers_.size());
+  // after finish has begun no new threads are started
+  if (!is_lazy_thread_[sched_id] || is_finished()) {
+    return;
+  }
+  is_lazy_thread_[sched_id] = false;
+  start_thread(sched_id);
+#endif
+}
+
 bool ConcurrentScheduler::run_main(double timeout) {
   CHECK(state_ == State::Run);
   // run main scheduler in same thread
@@ -79,10 +110,17 @@ void ConcurrentScheduler::finish() {
     on_finish();
   }
 #if !TD_THREAD_UNSUPPORTED && !TD_EVENTFD_UNSUPPORTED
-  for (auto &thread : threads_) {
+  // a thread may still be started by start_scheduler, so the threads are taken under the lock,
+  // but are joined without it, because they may wait for it
+  std::vector<thread> threads;
+  {
+    std::lock_guard<std::mutex> lock(threads_mutex_);
+    threads = std::move(threads_);
+    threads_.clear();
+  }
+  for (auto &thread : threads) {
     thread.join();
   }
-  threads_.clear();
 #endif
   schedulers_.clear();
   for (auto &f : at_finish_) {
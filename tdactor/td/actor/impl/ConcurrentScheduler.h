@@ -17,12 +17,14 @@
 #include <functional>
 #include <mutex>
 #include <utility>
+#include <vector>
 
 namespace td {
 
 class ConcurrentScheduler : private Scheduler::Callback {
  public:
-  void init(int32 threads_n);
+  // threads of schedulers from lazy_sched_ids are started only when Scheduler::start_scheduler is called for them
+  void init(int32 threads_n, const std::vector<int32> &lazy_sched_ids = std::vector<int32>());
 
   void finish_async() {
     schedulers_[0]->finish();
@@ -74,7 +76,11 @@ class ConcurrentScheduler : private Scheduler::Callback {
   std::mutex at_finish_mutex_;
   std::vector<std::function<void()>> at_finish_;
 #if !TD_THREAD_UNSUPPORTED && !TD_EVENTFD_UNSUPPORTED
+  std::mutex threads_mutex_;
   std::vector<thread> threads_;
+  std::vector<bool> is_lazy_thread_;
+
+  void start_thread(size_t sched_id);
 #endif
 
   void on_finish() override {
@@ -88,6 +94,8 @@ class ConcurrentScheduler : private Scheduler::Callback {
     std::lock_guard<std::mutex> lock(at_finish_mutex_);
     at_finish_.push_back(std::move(f));
   }
+
+  void start_scheduler(int32 sched_id) override;
 };
 
 }  // namespace td
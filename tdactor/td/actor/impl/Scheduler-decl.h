@@ -66,6 +66,7 @@ class Scheduler {
     virtual ~Callback() = default;
     virtual void on_finish() = 0;
     virtual void register_at_finish(std::function<void()>) = 0;
+    virtual void start_scheduler(int32 sched_id) = 0;
   };
   Scheduler() = default;
   Scheduler(const Scheduler &) = delete;
@@ -81,6 +82,9 @@ class Scheduler {
   int32 sched_id() const;
   int32 sched_count() const;
 
+  // starts the thread of the scheduler, if it wasn't started yet
+  void start_scheduler(int32 sched_id);
+
   template <class ActorT, class... Args>
   TD_WARN_UNUSED_RESULT ActorOwn<ActorT> create_actor(Slice name, Args &&... args);
   template <class ActorT, class... Args>
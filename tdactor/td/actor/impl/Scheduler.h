@@ -70,6 +70,12 @@ inline int32 Scheduler::sched_count() const {
   return sched_n_;
 }
 
+inline void Scheduler::start_scheduler(int32 sched_id) {
+  if (callback_) {
+    callback_->start_scheduler(sched_id);
+  }
+}
+
 template <class ActorT, class... Args>
 ActorOwn<ActorT> Scheduler::create_actor(Slice name, Args &&... args) {
   return register_actor_impl(name, new ActorT(std::forward<Args>(args)...), Actor::Deleter::Destroy, sched_id_);
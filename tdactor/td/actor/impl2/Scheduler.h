@@ -736,16 +736,24 @@ struct SchedulerInfo {
   // only scheduler itself may read from io_queue_
   std::unique_ptr<MpscPollableQueue<SchedulerMessage>> io_queue;
   size_t cpu_threads_count{0};
+  // set when cpu_queue is created and may be used by workers of other schedulers
+  std::atomic<bool> is_cpu_queue_ready{false};
 
   std::unique_ptr<WorkerInfo> io_worker;
   std::vector<std::unique_ptr<WorkerInfo>> cpu_workers;
 };
 
 struct SchedulerGroupInfo {
-  explicit SchedulerGroupInfo(size_t n) : schedulers(n) {
+  explicit SchedulerGroupInfo(size_t n, bool is_work_stealing_enabled = false)
+      : is_work_stealing_enabled(is_work_stealing_enabled), schedulers(n) {
   }
   std::atomic<bool> is_stop_requested{false};
 
+  // idle cpu workers will pop shared actors from cpu queues of other schedulers
+  const bool is_work_stealing_enabled;
+  // number of cpu workers inside of try_steal; stop messages are pushed only when there are none of them
+  std::atomic<int> stealing_worker_count{0};
+
   int active_scheduler_count{0};
   std::mutex active_scheduler_count_mutex;
   std::condition_variable active_scheduler_count_condition_variable;
@@ -790,6 +798,7 @@ class Scheduler {
       info_->cpu_threads_count = cpu_threads_count;
       info_->cpu_queue = std::make_unique<MpmcQueue<SchedulerMessage>>(1024, max_thread_count());
       info_->cpu_queue_waiter = std::make_unique<MpmcWaiter>();
+      info_->is_cpu_queue_ready.store(true, std::memory_order_release);
     }
     info_->io_queue = std::make_unique<MpscPollableQueue<SchedulerMessage>>();
     info_->io_queue->init();
@@ -817,8 +826,9 @@ class Scheduler {
   void start() {
     for (size_t i = 0; i < cpu_threads_.size(); i++) {
       cpu_threads_[i] = td::thread([this, i] {
-        this->run_in_context_impl(*this->info_->cpu_workers[i],
-                                  [this] { CpuWorker(*info_->cpu_queue, *info_->cpu_queue_waiter).run(); });
+        this->run_in_context_impl(*this->info_->cpu_workers[i], [this] {
+          CpuWorker(*info_->cpu_queue, *info_->cpu_queue_waiter, *scheduler_group_info_, info_->id).run();
+        });
       });
     }
     this->run_in_context([this] { this->io_worker_->start_up(); });
@@ -941,6 +951,12 @@ class Scheduler {
         return;
       }
 
+      // Workers, which have started stealing before the stop request, must finish it before stop messages are pushed,
+      // so a stop message is never taken by a worker of another scheduler
+      while (group.stealing_worker_count.load() != 0) {
+        td::this_thread::yield();
+      }
+
       // Notify all workers of all schedulers
       for (auto &scheduler_info : group.schedulers) {
         scheduler_info.io_queue->writer_put({});
@@ -981,7 +997,9 @@ class Scheduler {
 
   class CpuWorker {
    public:
-    CpuWorker(MpmcQueue<SchedulerMessage> &queue, MpmcWaiter &waiter) : queue_(queue), waiter_(waiter) {
+    CpuWorker(MpmcQueue<SchedulerMessage> &queue, MpmcWaiter &waiter, SchedulerGroupInfo &scheduler_group,
+              SchedulerId scheduler_id)
+        : queue_(queue), waiter_(waiter), scheduler_group_(scheduler_group), scheduler_id_(scheduler_id) {
     }
     void run() {
       auto thread_id = get_thread_id();
@@ -990,7 +1008,7 @@ class Scheduler {
       int yields = 0;
       while (true) {
         SchedulerMessage message;
-        if (queue_.try_pop(message, thread_id)) {
+        if (queue_.try_pop(message, thread_id) || try_steal(message, thread_id)) {
           if (!message) {
             return;
           }
@@ -1005,6 +1023,40 @@ class Scheduler {
    private:
     MpmcQueue<SchedulerMessage> &queue_;
     MpmcWaiter &waiter_;
+    SchedulerGroupInfo &scheduler_group_;
+    SchedulerId scheduler_id_;
+
+    // Only shared actors are in cpu queues, so they may be executed by any cpu worker.
+    // ActorLocker still guarantees that an actor is executed by at most one thread at a time.
+    // After execution the actor will be returned to the queue of its own scheduler.
+    bool try_steal(SchedulerMessage &message, uint32 thread_id) {
+      if (!scheduler_group_.is_work_stealing_enabled) {
+        return false;
+      }
+      scheduler_group_.stealing_worker_count.fetch_add(1);
+      SCOPE_EXIT {
+        scheduler_group_.stealing_worker_count.fetch_sub(1);
+      };
+      // is_stop_requested is set before stop() waits for stealing workers, so either the stop request is seen here,
+      // or stop messages are pushed only after the steal is finished
+      if (scheduler_group_.is_stop_requested.load()) {
+        return false;
+      }
+      auto &schedulers = scheduler_group_.schedulers;
+      auto scheduler_count = schedulers.size();
+      for (size_t i = 1; i < scheduler_count; i++) {
+        auto &victim = schedulers[(scheduler_id_.value() + i) % scheduler_count];
+        if (!victim.is_cpu_queue_ready.load(std::memory_order_acquire)) {
+          continue;
+        }
+        if (!victim.cpu_queue->try_pop(message, thread_id)) {
+          continue;
+        }
+        CHECK(message);
+        return true;
+      }
+      return false;
+    }
   };
 
   class IoWorker {
@@ -391,6 +391,60 @@ TEST(Actor2, scheduler_simple) {
   Scheduler::close_scheduler_group(*group_info);
 }
 
+TEST(Actor2, scheduler_work_stealing) {
+  static std::atomic<int> stolen_cnt;
+  class Counter : public Actor {
+   public:
+    void inc() {
+      CHECK(executing_cnt_.fetch_add(1) == 0);
+      if (SchedulerContext::get()->get_scheduler_id().value() != 0) {
+        stolen_cnt++;
+      }
+      if (++value_ == 10000) {
+        if (!--cnt) {
+          SchedulerContext::get()->stop();
+        }
+        stop();
+      } else {
+        send_closure_later(actor_id(this), &Counter::inc);
+      }
+      CHECK(executing_cnt_.fetch_sub(1) == 1);
+    }
+
+   private:
+    std::atomic<int> executing_cnt_{0};
+    int value_ = 0;
+  };
+
+  auto group_info = std::make_shared<SchedulerGroupInfo>(2, true);
+  Scheduler busy_scheduler{group_info, SchedulerId{0}, 1};
+  Scheduler idle_scheduler{group_info, SchedulerId{1}, 2};
+  busy_scheduler.start();
+  idle_scheduler.start();
+  stolen_cnt = 0;
+  busy_scheduler.run_in_context([] {
+    cnt = 10;
+    for (int i = 0; i < 10; i++) {
+      auto counter = create_actor<Counter>(ActorOptions().with_name("Counter").on_scheduler(SchedulerId{0})).release();
+      send_closure_later(counter, &Counter::inc);
+    }
+  });
+  bool is_busy_running = true;
+  bool is_idle_running = true;
+  while (is_busy_running || is_idle_running) {
+    if (is_busy_running) {
+      is_busy_running = busy_scheduler.run(0.01);
+    }
+    if (is_idle_running) {
+      is_idle_running = idle_scheduler.run(0.01);
+    }
+  }
+  LOG(INFO) << "Stolen " << stolen_cnt.load() << " executions";
+  // all counters are created on the busy scheduler, so the idle one can execute them only by stealing
+  ASSERT_TRUE(stolen_cnt.load() > 0);
+  Scheduler::close_scheduler_group(*group_info);
+}
+
 TEST(Actor2, actor_id_simple) {
   auto group_info = std::make_shared<SchedulerGroupInfo>(1);
   Scheduler scheduler{group_info, SchedulerId{0}, 2};
@@ -462,3 +462,54 @@ TEST(Actors, do_after_stop) {
   }
   sched.finish();
 }
+
+class LazySchedulerWorker : public Actor {
+ public:
+  explicit LazySchedulerWorker(ActorShared<> parent) : parent_(std::move(parent)) {
+  }
+  void start_up() override {
+    CHECK(Scheduler::instance()->sched_id() == 2);
+    parent_.reset();
+  }
+
+ private:
+  ActorShared<> parent_;
+};
+
+class LazySchedulerMain : public Actor {
+ public:
+  void start_up() override {
+    worker_ = create_actor_on_scheduler<LazySchedulerWorker>("Worker", 2, actor_shared());
+    set_timeout_in(0.1);
+  }
+  void timeout_expired() override {
+    is_scheduler_started_ = true;
+    Scheduler::instance()->start_scheduler(2);
+  }
+  void hangup_shared() override {
+    // the worker can't start before its scheduler does
+    CHECK(is_scheduler_started_);
+    worker_.reset();
+    Scheduler::instance()->finish();
+    stop();
+  }
+
+ private:
+  ActorOwn<LazySchedulerWorker> worker_;
+  bool is_scheduler_started_ = false;
+};
+
+TEST(Actors, lazy_scheduler) {
+  SET_VERBOSITY_LEVEL(VERBOSITY_NAME(ERROR));
+
+  ConcurrentScheduler sched;
+  int threads_n = 2;
+  sched.init(threads_n, {2});
+
+  sched.create_actor_unsafe<LazySchedulerMain>(0, "LazySchedulerMain").release();
+  sched.start();
+  while (sched.run_main(10)) {
+    // empty
+  }
+  sched.finish();
+}
@@ -0,0 +1,88 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2017
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "td/utils/common.h"
+#include "td/utils/logging.h"
+#include "td/utils/misc.h"
+
+#include <algorithm>
+
+namespace td {
+
+// Chooses size of write transactions for asynchronous databases.
+// Flush delay is proportional to the measured commit time, so cheap commits are done almost immediately and
+// expensive commits are amortized over more writes. Maximum transaction size grows while writes are queued faster
+// than they are committed and shrinks back when transactions are committed by timeout.
+class AdaptiveBatcher {
+ public:
+  enum class FlushReason : int32 { Size, Timeout, Force };
+
+  AdaptiveBatcher(size_t min_batch_size, size_t max_batch_size, double max_delay)
+      : min_batch_size_(min_batch_size)
+      , max_batch_size_(max_batch_size)
+      , max_delay_(max_delay)
+      , batch_size_(min_batch_size)
+      , delay_(max_delay) {
+    CHECK(0 < min_batch_size && min_batch_size <= max_batch_size);
+  }
+
+  bool need_flush(size_t pending_count) const {
+    return pending_count >= batch_size_;
+  }
+
+  // maximum time between the first pending write and the flush
+  double get_delay() const {
+    return delay_;
+  }
+
+  size_t get_batch_size() const {
+    return batch_size_;
+  }
+
+  void on_flushed(size_t count, double commit_time, FlushReason reason) {
+    if (commit_time < 0) {
+      commit_time = 0;
+    }
+    if (commit_time_ < 0) {
+      commit_time_ = commit_time;
+    } else {
+      commit_time_ += (commit_time - commit_time_) * COMMIT_TIME_WEIGHT;
+    }
+    delay_ = clamp(commit_time_ * DELAY_PER_COMMIT_TIME, MIN_DELAY, max_delay_);
+
+    switch (reason) {
+      case FlushReason::Size:
+        batch_size_ = std::min(batch_size_ * 2, max_batch_size_);
+        break;
+      case FlushReason::Timeout:
+        if (count * 4 <= batch_size_) {
+          batch_size_ = std::max(batch_size_ / 2, min_batch_size_);
+        }
+        break;
+      case FlushReason::Force:
+        break;
+      default:
+        UNREACHABLE();
+    }
+  }
+
+ private:
+  static constexpr double COMMIT_TIME_WEIGHT = 0.2;
+  static constexpr double DELAY_PER_COMMIT_TIME = 100;
+  static constexpr double MIN_DELAY = 0.005;
+
+  size_t min_batch_size_;
+  size_t max_batch_size_;
+  double max_delay_;
+
+  size_t batch_size_;
+  double delay_;
+  double commit_time_ = -1;
+};
+
+}  // namespace td
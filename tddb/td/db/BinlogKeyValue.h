@@ -23,12 +23,25 @@
 #include "td/utils/tl_parsers.h"
 #include "td/utils/tl_storers.h"
 
+#include <algorithm>
+#include <cstring>
 #include <map>
 #include <memory>
 #include <unordered_map>
 #include <utility>
 
 namespace td {
+namespace detail {
+// allows to search keys by Slice without creating a string
+struct BinlogKeyLess {
+  using is_transparent = void;
+  bool operator()(Slice lhs, Slice rhs) const {
+    auto res = std::memcmp(lhs.data(), rhs.data(), std::min(lhs.size(), rhs.size()));
+    return res < 0 || (res == 0 && lhs.size() < rhs.size());
+  }
+};
+}  // namespace detail
+
 template <class BinlogT>
 class BinlogKeyValue : public KeyValueSyncInterface {
  public:
@@ -79,10 +92,7 @@ class BinlogKeyValue : public KeyValueSyncInterface {
     binlog_ = std::make_unique<BinlogT>();
     TRY_STATUS(binlog_->init(name,
                              [&](const BinlogEvent &binlog_event) {
-                               Event event;
-                               event.parse(TlParser(binlog_event.data_));
-                               map_.emplace(std::make_pair(event.key.str(),
-                                                           std::make_pair(event.value.str(), binlog_event.id_)));
+                               add_loaded_event(binlog_event);
                              },
                              std::move(db_key), DbKey::empty(), scheduler_id));
     return Status::OK();
@@ -101,9 +111,7 @@ class BinlogKeyValue : public KeyValueSyncInterface {
   }
 
   void external_init_handle(const BinlogEvent &binlog_event) {
-    Event event;
-    event.parse(TlParser(binlog_event.data_));
-    map_.emplace(std::make_pair(event.key.str(), std::make_pair(event.value.str(), binlog_event.id_)));
+    add_loaded_event(binlog_event);
   }
 
   void external_init_finish(std::shared_ptr<BinlogT> binlog) {
@@ -117,14 +125,15 @@ class BinlogKeyValue : public KeyValueSyncInterface {
   SeqNo set(string key, string value) override {
     auto lock = rw_mutex_.lock_write().move_as_ok();
     uint64 old_id = 0;
-    auto it_ok = map_.insert({key, {value, 0}});
+    auto it_ok = map_.emplace(key, std::make_pair(BufferSlice(), 0));
     if (!it_ok.second) {
-      if (it_ok.first->second.first == value) {
+      if (it_ok.first->second.first.as_slice() == value) {
         return 0;
       }
       old_id = it_ok.first->second.second;
-      it_ok.first->second.first = value;
     }
+    // views returned before must remain unchanged, so the value is replaced instead of being modified
+    it_ok.first->second.first = BufferSlice(value);
     bool rewrite = false;
     uint64 id;
     auto seq_no = binlog_->next_id();
@@ -163,12 +172,17 @@ class BinlogKeyValue : public KeyValueSyncInterface {
   }
 
   string get(const string &key) override {
+    return get_view(key).as_slice().str();
+  }
+
+  // returns value without copying it; the returned view isn't affected by subsequent changes of the key
+  BufferSlice get_view(Slice key) {
     auto lock = rw_mutex_.lock_read().move_as_ok();
     auto it = map_.find(key);
     if (it == map_.end()) {
-      return string();
+      return BufferSlice();
     }
-    return it->second.first;
+    return it->second.first.clone();
   }
 
   void force_sync(Promise<> &&promise) {
@@ -179,22 +193,26 @@ class BinlogKeyValue : public KeyValueSyncInterface {
   }
 
   std::unordered_map<string, string> prefix_get(Slice prefix) {
-    // TODO: optimize with std::map?
-    auto lock = rw_mutex_.lock_write().move_as_ok();
     std::unordered_map<string, string> res;
-    for (const auto &kv : map_) {
-      if (begins_with(kv.first, prefix)) {
-        res[kv.first] = kv.second.first;
-      }
-    }
+    prefix_for_each(prefix, [&](Slice key, Slice value) { res.emplace(key.str(), value.str()); });
     return res;
   }
 
+  // calls f(key, value) for all keys starting with the prefix in the ascending order of keys
+  template <class F>
+  void prefix_for_each(Slice prefix, F &&f) {
+    auto lock = rw_mutex_.lock_read().move_as_ok();
+    for (auto it = map_.lower_bound(prefix); it != map_.end() && begins_with(it->first, prefix); ++it) {
+      f(Slice(it->first), it->second.first.as_slice());
+    }
+  }
+
   std::unordered_map<string, string> get_all() {
-    auto lock = rw_mutex_.lock_write().move_as_ok();
+    auto lock = rw_mutex_.lock_read().move_as_ok();
     std::unordered_map<string, string> res;
+    res.reserve(map_.size());
     for (const auto &kv : map_) {
-      res[kv.first] = kv.second.first;
+      res.emplace(kv.first, kv.second.first.as_slice().str());
     }
     return res;
   }
@@ -202,13 +220,10 @@ class BinlogKeyValue : public KeyValueSyncInterface {
   void erase_by_prefix(Slice prefix) {
     auto lock = rw_mutex_.lock_write().move_as_ok();
     std::vector<uint64> ids;
-    for (auto it = map_.begin(); it != map_.end();) {
-      if (begins_with(it->first, prefix)) {
-        ids.push_back(it->second.second);
-        it = map_.erase(it);
-      } else {
-        ++it;
-      }
+    auto it = map_.lower_bound(prefix);
+    while (it != map_.end() && begins_with(it->first, prefix)) {
+      ids.push_back(it->second.second);
+      it = map_.erase(it);
     }
     auto seq_no = binlog_->next_id(narrow_cast<int32>(ids.size()));
     lock.reset();
@@ -226,10 +241,17 @@ class BinlogKeyValue : public KeyValueSyncInterface {
   }
 
  private:
-  std::unordered_map<string, std::pair<string, uint64>> map_;
+  // value is a view of the binlog event, which has set it, or a separate buffer
+  std::map<string, std::pair<BufferSlice, uint64>, detail::BinlogKeyLess> map_;
   std::shared_ptr<BinlogT> binlog_;
   RwMutex rw_mutex_;
   int32 magic_ = magic;
+
+  void add_loaded_event(const BinlogEvent &binlog_event) {
+    Event event;
+    event.parse(TlParser(binlog_event.data_));
+    map_.emplace(event.key.str(), std::make_pair(binlog_event.raw_event_.from_slice(event.value), binlog_event.id_));
+  }
 };
 template <>
 inline void BinlogKeyValue<Binlog>::add_event(uint64 seq_no, BufferSlice &&event) {
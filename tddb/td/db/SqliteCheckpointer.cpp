@@ -0,0 +1,73 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2017
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/db/SqliteCheckpointer.h"
+
+#include "td/utils/logging.h"
+#include "td/utils/Time.h"
+
+namespace td {
+
+class SqliteCheckpointer::Impl : public Actor {
+ public:
+  Impl(std::shared_ptr<SqliteConnectionSafe> connection, double period)
+      : connection_(std::move(connection)), period_(period) {
+  }
+
+  void checkpoint(Promise<> promise) {
+    auto status = do_checkpoint();
+    if (status.is_error()) {
+      return promise.set_error(std::move(status));
+    }
+    promise.set_value(Unit());
+  }
+
+  void close(Promise<> promise) {
+    connection_.reset();
+    stop();
+    promise.set_value(Unit());
+  }
+
+ private:
+  std::shared_ptr<SqliteConnectionSafe> connection_;
+  double period_;
+
+  void start_up() override {
+    set_timeout_in(period_);
+  }
+
+  void timeout_expired() override {
+    auto status = do_checkpoint();
+    LOG_IF(ERROR, status.is_error()) << "Failed to checkpoint sqlite database: " << status;
+    set_timeout_in(period_);
+  }
+
+  Status do_checkpoint() {
+    // passive checkpoint neither waits for readers nor blocks writers
+    auto start = Time::now();
+    auto status = connection_->get().exec("PRAGMA wal_checkpoint(PASSIVE)");
+    LOG(DEBUG) << "Sqlite checkpoint took " << Time::now() - start;
+    return status;
+  }
+};
+
+SqliteCheckpointer::SqliteCheckpointer(std::shared_ptr<SqliteConnectionSafe> connection, double period,
+                                       int32 scheduler_id) {
+  CHECK(period > 0);
+  impl_ = create_actor_on_scheduler<Impl>("SqliteCheckpointer", scheduler_id, std::move(connection), period);
+}
+
+SqliteCheckpointer::~SqliteCheckpointer() = default;
+
+void SqliteCheckpointer::checkpoint(Promise<> promise) {
+  send_closure(impl_, &Impl::checkpoint, std::move(promise));
+}
+
+void SqliteCheckpointer::close(Promise<> promise) {
+  send_closure_later(std::move(impl_), &Impl::close, std::move(promise));
+}
+
+}  // namespace td
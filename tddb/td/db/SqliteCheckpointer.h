@@ -0,0 +1,39 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2017
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "td/db/SqliteConnectionSafe.h"
+
+#include "td/actor/actor.h"
+#include "td/actor/PromiseFuture.h"
+
+#include "td/utils/common.h"
+
+#include <memory>
+
+namespace td {
+
+// Periodically moves pages from the write-ahead log to the database using a separate connection,
+// so writers with disabled wal_autocheckpoint don't need to do this on commit
+class SqliteCheckpointer {
+ public:
+  SqliteCheckpointer(std::shared_ptr<SqliteConnectionSafe> connection, double period, int32 scheduler_id);
+  SqliteCheckpointer(const SqliteCheckpointer &) = delete;
+  SqliteCheckpointer &operator=(const SqliteCheckpointer &) = delete;
+  ~SqliteCheckpointer();
+
+  // makes a checkpoint right now, without waiting for the end of the period
+  void checkpoint(Promise<> promise);
+
+  void close(Promise<> promise);
+
+ private:
+  class Impl;
+  ActorOwn<Impl> impl_;
+};
+
+}  // namespace td
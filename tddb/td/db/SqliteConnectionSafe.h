@@ -16,16 +16,28 @@
 
 namespace td {
 
+// settings of each connection to the database; the database is expected to be in WAL mode
+struct SqliteConnectionOptions {
+  int32 wal_autocheckpoint = 1000;  // in pages; 0 disables checkpoints on commit, see SqliteCheckpointer
+  int64 mmap_size = 0;              // in bytes
+  int32 cache_size = -2000;         // in pages if positive, in KiB if negative
+  bool secure_delete = true;        // can be disabled if the database has no secret data
+};
+
 class SqliteConnectionSafe {
  public:
   SqliteConnectionSafe() = default;
-  explicit SqliteConnectionSafe(string name, DbKey key = DbKey::empty())
-      : lsls_connection_([name = name, key = std::move(key)] {
+  explicit SqliteConnectionSafe(string name, DbKey key = DbKey::empty(),
+                                SqliteConnectionOptions options = SqliteConnectionOptions())
+      : lsls_connection_([name = name, key = std::move(key), options] {
         auto db = SqliteDb::open_with_key(name, key).move_as_ok();
         db.exec("PRAGMA synchronous=NORMAL").ensure();
         db.exec("PRAGMA temp_store=MEMORY").ensure();
-        db.exec("PRAGMA secure_delete=1").ensure();
+        db.exec(PSLICE() << "PRAGMA secure_delete=" << (options.secure_delete ? 1 : 0)).ensure();
         db.exec("PRAGMA recursive_triggers=1").ensure();
+        db.exec(PSLICE() << "PRAGMA wal_autocheckpoint=" << options.wal_autocheckpoint).ensure();
+        db.exec(PSLICE() << "PRAGMA mmap_size=" << options.mmap_size).ensure();
+        db.exec(PSLICE() << "PRAGMA cache_size=" << options.cache_size).ensure();
         return db;
       })
       , name_(std::move(name)) {
@@ -6,6 +6,8 @@
 //
 #include "td/db/SqliteKeyValueAsync.h"
 
+#include "td/db/AdaptiveBatcher.h"
+
 #include "td/utils/optional.h"
 #include "td/utils/Time.h"
 
@@ -82,7 +84,9 @@ class SqliteKeyValueAsync : public SqliteKeyValueAsyncInterface {
     SqliteKeyValue *kv_ = nullptr;
 
     static constexpr double MAX_PENDING_QUERIES_DELAY = 10;
-    static constexpr size_t MAX_PENDING_QUERIES_COUNT = 100;
+    static constexpr size_t MIN_PENDING_QUERIES_COUNT = 100;
+    static constexpr size_t MAX_PENDING_QUERIES_COUNT = 5000;
+    AdaptiveBatcher batcher_{MIN_PENDING_QUERIES_COUNT, MAX_PENDING_QUERIES_COUNT, MAX_PENDING_QUERIES_DELAY};
     std::unordered_map<string, optional<string>> buffer_;
     std::vector<Promise<>> buffer_promises_;
     size_t cnt_ = 0;
@@ -93,20 +97,24 @@ class SqliteKeyValueAsync : public SqliteKeyValueAsyncInterface {
         return;
       }
 
+      auto reason = AdaptiveBatcher::FlushReason::Force;
       if (!force) {
         auto now = Time::now_cached();
         if (wakeup_at_ == 0) {
-          wakeup_at_ = now + MAX_PENDING_QUERIES_DELAY;
+          wakeup_at_ = now + batcher_.get_delay();
         }
-        if (now < wakeup_at_ && cnt_ < MAX_PENDING_QUERIES_COUNT) {
+        if (now < wakeup_at_ && !batcher_.need_flush(cnt_)) {
           set_timeout_at(wakeup_at_);
           return;
         }
+        reason = now < wakeup_at_ ? AdaptiveBatcher::FlushReason::Size : AdaptiveBatcher::FlushReason::Timeout;
       }
 
+      auto flushed_cnt = cnt_;
       wakeup_at_ = 0;
       cnt_ = 0;
 
+      auto begin_time = Time::now();
       kv_->begin_transaction().ensure();
       for (auto &it : buffer_) {
         if (it.second) {
@@ -116,6 +124,7 @@ class SqliteKeyValueAsync : public SqliteKeyValueAsyncInterface {
         }
       }
       kv_->commit_transaction().ensure();
+      batcher_.on_flushed(flushed_cnt, Time::now() - begin_time, reason);
       buffer_.clear();
       for (auto &promise : buffer_promises_) {
         promise.set_value(Unit());
@@ -17,6 +17,7 @@
 #include "td/utils/port/Fd.h"
 #include "td/utils/port/path.h"
 #include "td/utils/port/Stat.h"
+#include "td/utils/port/thread.h"
 #include "td/utils/Random.h"
 #include "td/utils/ScopeGuard.h"
 #include "td/utils/Status.h"
@@ -25,6 +26,9 @@
 #include "td/utils/tl_parsers.h"
 
 #include <algorithm>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
 
 namespace td {
 namespace detail {
@@ -103,7 +107,7 @@ class BinlogReader {
   int64 offset() {
     return offset_;
   }
-  Result<size_t> read_next(BinlogEvent *event) {
+  Result<size_t> read_next(BinlogEvent *event, bool check_crc = true) {
     if (state_ == ReadLength) {
       if (input_->size() < 4) {
         return 4;
@@ -127,7 +131,7 @@ class BinlogReader {
       return size_;
     }
 
-    TRY_STATUS(event->init(input_->cut_head(size_).move_as_buffer_slice()));
+    TRY_STATUS(event->init(input_->cut_head(size_).move_as_buffer_slice(), check_crc));
     offset_ += size_;
     event->offset_ = offset_;
     state_ = ReadLength;
@@ -140,8 +144,152 @@ class BinlogReader {
   size_t size_{0};
   int64 offset_{0};
 };
+
+// State of an incremental compaction: live events are copied to a new file chunk by chunk,
+// events added in the meantime are appended to the new file just before the switch
+struct BinlogCompaction {
+  string path;
+  FileFd fd;
+  int64 size{0};
+  uint64 events_n{0};
+  bool is_encrypted{false};
+  AesCtrState aes_ctr_state;
+
+  std::vector<BufferSlice> events;  // live events at the moment of compaction start
+  size_t events_pos{0};
+  std::vector<BufferSlice> new_events;
+
+  double start_time{0};
+  int64 start_size{0};
+  uint64 start_events{0};
+
+  Status write(BufferSlice data) {
+    if (is_encrypted) {
+      aes_ctr_state.encrypt(data.as_slice(), data.as_slice());
+    }
+    Slice left = data.as_slice();
+    while (!left.empty()) {
+      TRY_RESULT(written, fd.write(left));
+      left.remove_prefix(written);
+    }
+    return Status::OK();
+  }
+
+  Status write_events(const std::vector<BufferSlice> &from, size_t begin, size_t end) {
+    size_t data_size = 0;
+    for (size_t i = begin; i < end; i++) {
+      data_size += from[i].size();
+    }
+    BufferSlice data(data_size);
+    auto to = data.as_slice();
+    for (size_t i = begin; i < end; i++) {
+      to.copy_from(from[i].as_slice());
+      to.remove_prefix(from[i].size());
+    }
+    size += static_cast<int64>(data_size);
+    events_n += end - begin;
+    return write(std::move(data));
+  }
+};
+
+#if !TD_THREAD_UNSUPPORTED
+// Fixed set of threads, which run parts of the same job during binlog loading
+class BinlogLoadWorkers {
+ public:
+  explicit BinlogLoadWorkers(size_t threads_n) {
+    threads_.reserve(threads_n);
+    for (size_t i = 0; i < threads_n; i++) {
+      threads_.emplace_back([this, id = i + 1] { loop(id); });
+    }
+  }
+  BinlogLoadWorkers(const BinlogLoadWorkers &) = delete;
+  BinlogLoadWorkers &operator=(const BinlogLoadWorkers &) = delete;
+  BinlogLoadWorkers(BinlogLoadWorkers &&) = delete;
+  BinlogLoadWorkers &operator=(BinlogLoadWorkers &&) = delete;
+  ~BinlogLoadWorkers() {
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      is_closed_ = true;
+      job_condition_variable_.notify_all();
+    }
+    for (auto &thread : threads_) {
+      thread.join();
+    }
+  }
+
+  size_t size() const {
+    return threads_.size() + 1;
+  }
+
+  // calls job(i) for every i in [0, size()) and waits for all calls to finish; job(0) is called from current thread
+  void run(const std::function<void(size_t)> &job) {
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      job_ = &job;
+      job_generation_++;
+      running_n_ = threads_.size();
+      job_condition_variable_.notify_all();
+    }
+    job(0);
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_condition_variable_.wait(lock, [&] { return running_n_ == 0; });
+    job_ = nullptr;
+  }
+
+ private:
+  std::vector<thread> threads_;
+  std::mutex mutex_;
+  std::condition_variable job_condition_variable_;
+  std::condition_variable done_condition_variable_;
+  const std::function<void(size_t)> *job_ = nullptr;
+  uint64 job_generation_ = 0;
+  size_t running_n_ = 0;
+  bool is_closed_ = false;
+
+  void loop(size_t id) {
+    uint64 done_generation = 0;
+    while (true) {
+      const std::function<void(size_t)> *job;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        job_condition_variable_.wait(lock, [&] { return is_closed_ || job_generation_ != done_generation; });
+        if (is_closed_) {
+          return;
+        }
+        done_generation = job_generation_;
+        job = job_;
+      }
+      (*job)(id);
+      std::lock_guard<std::mutex> guard(mutex_);
+      if (--running_n_ == 0) {
+        done_condition_variable_.notify_one();
+      }
+    }
+  }
+};
+#endif
 }  // namespace detail
 
+// returns AES-CTR state positioned at the given offset of the stream
+static AesCtrState create_aes_ctr_state(const UInt256 &key, const UInt128 &iv, int64 offset) {
+  UInt128 counter = iv;
+  auto blocks = static_cast<uint64>(offset) / 16;
+  for (int i = 15; i >= 0 && blocks != 0; i--) {
+    auto sum = static_cast<uint64>(counter.raw[i]) + (blocks & 255);
+    counter.raw[i] = static_cast<uint8>(sum & 255);
+    blocks = (blocks >> 8) + (sum >> 8);
+  }
+
+  AesCtrState state;
+  state.init(key, counter);
+  auto skip_size = static_cast<size_t>(offset % 16);
+  if (skip_size != 0) {
+    char skip[16] = {};
+    state.encrypt(Slice(skip, skip_size), MutableSlice(skip, skip_size));
+  }
+  return state;
+}
+
 bool Binlog::IGNORE_ERASE_HACK = false;
 
 Binlog::Binlog() = default;
@@ -156,6 +304,15 @@ Result<FileFd> Binlog::open_binlog(CSlice path, int32 flags) {
   return std::move(fd);
 }
 
+void Binlog::replace_fd(FileFd fd, FileFd sync_fd) {
+  std::lock_guard<std::mutex> guard(fd_mutex_);
+  // the duplicate must be closed together with the file, because closing it releases the file lock
+  sync_fd_.close();
+  fd_.close();
+  fd_ = BufferedFdBase<FileFd>(std::move(fd));
+  sync_fd_ = std::move(sync_fd);
+}
+
 Status Binlog::init(string path, const Callback &callback, DbKey db_key, DbKey old_db_key, int32 dummy,
                     const Callback &debug_callback) {
   close().ignore();
@@ -176,7 +333,8 @@ Status Binlog::init(string path, const Callback &callback, DbKey db_key, DbKey o
   info_.was_created = stat(path).is_error();
 
   TRY_RESULT(fd, open_binlog(path, FileFd::Flags::Read | FileFd::Flags::Write | FileFd::Flags::Create));
-  fd_ = BufferedFdBase<FileFd>(std::move(fd));
+  TRY_RESULT(sync_fd, fd.duplicate());
+  replace_fd(std::move(fd), std::move(sync_fd));
   fd_size_ = 0;
   path_ = std::move(path);
 
@@ -202,6 +360,9 @@ Status Binlog::init(string path, const Callback &callback, DbKey db_key, DbKey o
 }
 
 void Binlog::add_event(BinlogEvent &&event) {
+  if (use_crc32c_) {
+    event.use_crc32c();
+  }
   if (!events_buffer_) {
     do_add_event(std::move(event));
   } else {
@@ -210,6 +371,11 @@ void Binlog::add_event(BinlogEvent &&event) {
   lazy_flush();
 
   if (state_ == State::Run) {
+    if (compaction_) {
+      do_compaction_step();
+      return;
+    }
+
     auto fd_size = fd_size_;
     if (events_buffer_) {
       fd_size += events_buffer_->size();
@@ -220,7 +386,7 @@ void Binlog::add_event(BinlogEvent &&event) {
     if (need_reindex(100000, 5) || need_reindex(500000, 2)) {
       LOG(INFO) << tag("fd_size", format::as_size(fd_size))
                 << tag("total events size", format::as_size(processor_->total_raw_events_size()));
-      do_reindex();
+      start_compaction();
     }
   }
 }
@@ -256,10 +422,11 @@ Status Binlog::close(bool need_sync) {
   if (fd_.empty()) {
     return Status::OK();
   }
+  cancel_compaction();
   SCOPE_EXIT {
     path_ = "";
     info_.is_opened = false;
-    fd_.close();
+    replace_fd(FileFd(), FileFd());
   };
   flush();
   if (need_sync) {
@@ -292,6 +459,9 @@ void Binlog::do_event(BinlogEvent &&event) {
 
   if (state_ == State::Run || state_ == State::Reindex) {
     VLOG(binlog) << "Write binlog event: " << format::cond(state_ == State::Reindex, "[reindex] ") << event;
+    if (compaction_) {
+      compaction_->new_events.push_back(event.raw_event_.clone());
+    }
     switch (encryption_type_) {
       case EncryptionType::None: {
         buffer_writer_.append(event.raw_event_.clone());
@@ -358,6 +528,14 @@ void Binlog::sync() {
   fd_.sync().ensure();
 }
 
+Status Binlog::sync_flushed() {
+  std::lock_guard<std::mutex> guard(fd_mutex_);
+  if (sync_fd_.empty()) {
+    return Status::OK();
+  }
+  return sync_fd_.sync();
+}
+
 void Binlog::flush() {
   if (state_ == State::Load) {
     return;
@@ -384,6 +562,24 @@ void Binlog::lazy_flush() {
 
 void Binlog::update_read_encryption() {
   CHECK(binlog_reader_ptr_);
+  if (load_workers_ != nullptr) {
+    // data is decrypted just after it is read, so decrypt only already read data
+    binlog_reader_ptr_->set_input(&buffer_reader_);
+    byte_flow_flag_ = false;
+    if (encryption_type_ == EncryptionType::AesCtr) {
+      load_encrypted_size_ = 0;
+      auto it = buffer_reader_.clone();
+      while (true) {
+        auto ready = it.prepare_read();
+        if (ready.empty()) {
+          break;
+        }
+        decrypt_loaded_data(MutableSlice(const_cast<char *>(ready.data()), ready.size()));
+        it.confirm_read(ready.size());
+      }
+    }
+    return;
+  }
   switch (encryption_type_) {
     case EncryptionType::None: {
       binlog_reader_ptr_->set_input(&buffer_reader_);
@@ -434,44 +630,16 @@ Status Binlog::load_binlog(const Callback &callback, const Callback &debug_callb
 
   update_read_encryption();
 
-  bool ready_flag = false;
   fd_.update_flags(Fd::Flag::Read);
   info_.wrong_password = false;
-  while (true) {
-    BinlogEvent event;
-    auto r_need_size = reader.read_next(&event);
-    if (r_need_size.is_error()) {
-      LOG(ERROR) << r_need_size.error();
-      break;
-    }
-    auto need_size = r_need_size.move_as_ok();
-    // LOG(ERROR) << "need size = " << need_size;
-    if (need_size == 0) {
-      if (IGNORE_ERASE_HACK && event.type_ == BinlogEvent::ServiceTypes::Empty &&
-          (event.flags_ & BinlogEvent::Flags::Rewrite) != 0) {
-        // skip erase
-      } else {
-        if (debug_callback) {
-          debug_callback(event);
-        }
-        do_add_event(std::move(event));
-        if (info_.wrong_password) {
-          return Status::OK();
-        }
-      }
-      ready_flag = false;
-    } else {
-      // TODO(now): fix bug
-      if (ready_flag) {
-        break;
-      }
-      TRY_STATUS(fd_.flush_read(std::max(need_size, static_cast<size_t>(4096))));
-      buffer_reader_.sync_with_writer();
-      if (byte_flow_flag_) {
-        byte_flow_source_.wakeup();
-      }
-      ready_flag = true;
-    }
+  bool is_parallel = get_load_threads_n(fd_.get_size()) > 1;
+  if (is_parallel) {
+    TRY_STATUS(load_events_parallel(reader, debug_callback));
+  } else {
+    TRY_STATUS(load_events(reader, debug_callback));
+  }
+  if (info_.wrong_password) {
+    return Status::OK();
   }
 
   auto offset = processor_->offset();
@@ -498,13 +666,181 @@ Status Binlog::load_binlog(const Callback &callback, const Callback &debug_callb
 
   // reuse aes_ctr_state_
   if (encryption_type_ == EncryptionType::AesCtr) {
-    aes_ctr_state_ = aes_xcode_byte_flow_.move_aes_ctr_state();
+    if (is_parallel) {
+      aes_ctr_state_ = create_aes_ctr_state(aes_ctr_key_, aes_ctr_iv_, load_encrypted_size_);
+    } else {
+      aes_ctr_state_ = aes_xcode_byte_flow_.move_aes_ctr_state();
+    }
   }
   update_write_encryption();
 
   return Status::OK();
 }
 
+int32 Binlog::get_load_threads_n(int64 fd_size) const {
+#if TD_THREAD_UNSUPPORTED
+  return 1;
+#else
+  if (load_threads_n_ > 0) {
+    return load_threads_n_;
+  }
+  if (fd_size < PARALLEL_LOAD_MIN_SIZE) {
+    return 1;
+  }
+  return clamp(static_cast<int32>(thread::hardware_concurrency()), 1, 8);
+#endif
+}
+
+void Binlog::load_event(BinlogEvent &&event, const Callback &debug_callback) {
+  if (IGNORE_ERASE_HACK && event.type_ == BinlogEvent::ServiceTypes::Empty &&
+      (event.flags_ & BinlogEvent::Flags::Rewrite) != 0) {
+    // skip erase
+    return;
+  }
+  if (debug_callback) {
+    debug_callback(event);
+  }
+  do_add_event(std::move(event));
+}
+
+Status Binlog::load_events(detail::BinlogReader &reader, const Callback &debug_callback) {
+  while (true) {
+    BinlogEvent event;
+    auto r_need_size = reader.read_next(&event);
+    if (r_need_size.is_error()) {
+      LOG(ERROR) << r_need_size.error();
+      break;
+    }
+    auto need_size = r_need_size.move_as_ok();
+    // LOG(ERROR) << "need size = " << need_size;
+    if (need_size == 0) {
+      load_event(std::move(event), debug_callback);
+      if (info_.wrong_password) {
+        return Status::OK();
+      }
+    } else {
+      // need_size can be bigger than the read size, if only event length was requested
+      TRY_RESULT(read_size, fd_.flush_read(std::max(need_size, static_cast<size_t>(4096))));
+      if (read_size == 0) {
+        break;
+      }
+      buffer_reader_.sync_with_writer();
+      if (byte_flow_flag_) {
+        byte_flow_source_.wakeup();
+      }
+    }
+  }
+  return Status::OK();
+}
+
+// The file is read by big chunks, which are decrypted in parallel. Then events are parsed sequentially,
+// their crc is checked in parallel and they are added in the original order up to the first broken event.
+Status Binlog::load_events_parallel(detail::BinlogReader &reader, const Callback &debug_callback) {
+#if TD_THREAD_UNSUPPORTED
+  UNREACHABLE();
+  return Status::OK();
+#else
+  detail::BinlogLoadWorkers workers(static_cast<size_t>(get_load_threads_n(fd_.get_size()) - 1));
+  load_workers_ = &workers;
+  load_encrypted_size_ = 0;
+  SCOPE_EXIT {
+    load_workers_ = nullptr;
+  };
+  update_read_encryption();
+
+  std::vector<BinlogEvent> events;
+  while (true) {
+    events.clear();
+    size_t events_size = 0;
+    bool need_read = false;
+    Status error;
+    while (events_size < PARALLEL_LOAD_READ_SIZE) {
+      BinlogEvent event;
+      auto r_need_size = reader.read_next(&event, false);
+      if (r_need_size.is_error()) {
+        error = r_need_size.move_as_error();
+        break;
+      }
+      if (r_need_size.ok() != 0) {
+        need_read = true;
+        break;
+      }
+      events_size += event.raw_event_.size();
+      bool is_encryption_event = event.type_ == BinlogEvent::ServiceTypes::AesCtrEncryption;
+      events.push_back(std::move(event));
+      if (is_encryption_event) {
+        // following data can't be parsed before the encryption is initialized
+        break;
+      }
+    }
+
+    auto parts_n = workers.size();
+    std::vector<size_t> first_invalid(parts_n, events.size());
+    workers.run([&](size_t part) {
+      auto begin = events.size() * part / parts_n;
+      auto end = events.size() * (part + 1) / parts_n;
+      for (auto i = begin; i < end; i++) {
+        if (events[i].validate().is_error()) {
+          first_invalid[part] = i;
+          return;
+        }
+        // copy the event, so it doesn't hold the whole read buffer
+        events[i].init(events[i].raw_event_.copy(), false).ensure();
+      }
+    });
+    auto valid_n = *std::min_element(first_invalid.begin(), first_invalid.end());
+    if (valid_n != events.size()) {
+      error = events[valid_n].validate();
+    }
+
+    for (size_t i = 0; i < valid_n; i++) {
+      load_event(std::move(events[i]), debug_callback);
+      if (info_.wrong_password) {
+        return Status::OK();
+      }
+    }
+    if (error.is_error()) {
+      LOG(ERROR) << error;
+      break;
+    }
+
+    if (need_read) {
+      BufferSlice data(PARALLEL_LOAD_READ_SIZE);
+      TRY_RESULT(read_size, fd_.read(data.as_slice()));
+      if (read_size == 0) {
+        break;
+      }
+      data.truncate(read_size);
+      if (encryption_type_ == EncryptionType::AesCtr) {
+        decrypt_loaded_data(data.as_slice());
+      }
+      buffer_writer_.append(std::move(data));
+      buffer_reader_.sync_with_writer();
+    }
+  }
+  return Status::OK();
+#endif
+}
+
+void Binlog::decrypt_loaded_data(MutableSlice data) {
+#if !TD_THREAD_UNSUPPORTED
+  CHECK(load_workers_ != nullptr);
+  auto parts_n = load_workers_->size();
+  auto offset = load_encrypted_size_;
+  load_workers_->run([&](size_t part) {
+    auto begin = data.size() * part / parts_n;
+    auto end = data.size() * (part + 1) / parts_n;
+    if (begin == end) {
+      return;
+    }
+    auto aes_ctr_state = create_aes_ctr_state(aes_ctr_key_, aes_ctr_iv_, offset + static_cast<int64>(begin));
+    auto part_data = data.substr(begin, end - begin);
+    aes_ctr_state.decrypt(part_data, part_data);
+  });
+  load_encrypted_size_ += static_cast<int64>(data.size());
+#endif
+}
+
 static int64 file_size(CSlice path) {
   auto r_stat = stat(path);
   if (r_stat.is_error()) {
@@ -515,9 +851,8 @@ static int64 file_size(CSlice path) {
 
 void Binlog::update_encryption(Slice key, Slice iv) {
   MutableSlice(aes_ctr_key_.raw, sizeof(aes_ctr_key_.raw)).copy_from(key);
-  UInt128 aes_ctr_iv;
-  MutableSlice(aes_ctr_iv.raw, sizeof(aes_ctr_iv.raw)).copy_from(iv);
-  aes_ctr_state_.init(aes_ctr_key_, aes_ctr_iv);
+  MutableSlice(aes_ctr_iv_.raw, sizeof(aes_ctr_iv_.raw)).copy_from(iv);
+  aes_ctr_state_.init(aes_ctr_key_, aes_ctr_iv_);
 }
 
 void Binlog::reset_encryption() {
@@ -552,6 +887,7 @@ void Binlog::reset_encryption() {
 }
 
 void Binlog::do_reindex() {
+  cancel_compaction();
   flush_events_buffer(true);
   // start reindex
   CHECK(state_ == State::Run);
@@ -571,8 +907,12 @@ void Binlog::do_reindex() {
     LOG(ERROR) << "Can't open new binlog for regenerate: " << r_opened_file.error();
     return;
   }
-  fd_.close();
-  fd_ = BufferedFdBase<FileFd>(r_opened_file.move_as_ok());
+  auto r_sync_fd = r_opened_file.ok().duplicate();
+  if (r_sync_fd.is_error()) {
+    LOG(ERROR) << "Can't duplicate new binlog for regenerate: " << r_sync_fd.error();
+    return;
+  }
+  replace_fd(r_opened_file.move_as_ok(), r_sync_fd.move_as_ok());
 
   buffer_writer_ = ChainBufferWriter();
   buffer_reader_ = buffer_writer_.extract_reader();
@@ -618,4 +958,147 @@ void Binlog::do_reindex() {
   update_write_encryption();
 }
 
+void Binlog::start_compaction() {
+  CHECK(state_ == State::Run);
+  CHECK(!compaction_);
+
+  auto new_path = path_ + ".new";
+  auto r_opened_file = open_binlog(new_path, FileFd::Flags::Write | FileFd::Flags::Create | FileFd::Truncate);
+  if (r_opened_file.is_error()) {
+    LOG(ERROR) << "Can't open new binlog for compaction: " << r_opened_file.error();
+    return;
+  }
+
+  auto compaction = std::make_unique<detail::BinlogCompaction>();
+  compaction->path = std::move(new_path);
+  compaction->fd = r_opened_file.move_as_ok();
+  compaction->start_time = Clocks::monotonic();
+  compaction->start_size = fd_size_;
+  compaction->start_events = fd_events_;
+
+  if (encryption_type_ == EncryptionType::AesCtr) {
+    // the key is the same, so only iv is changed
+    detail::AesCtrEncryptionEvent event;
+    event.key_salt_ = aes_ctr_key_salt_.clone();
+    event.iv_ = BufferSlice(detail::AesCtrEncryptionEvent::iv_size());
+    Random::secure_bytes(event.iv_.as_slice());
+    event.key_hash_ = event.generate_hash(Slice(aes_ctr_key_.raw, sizeof(aes_ctr_key_.raw)));
+
+    std::vector<BufferSlice> header;
+    header.push_back(
+        BinlogEvent::create_raw(0, BinlogEvent::ServiceTypes::AesCtrEncryption, 0, create_default_storer(event)));
+    auto status = compaction->write_events(header, 0, 1);
+    if (status.is_error()) {
+      LOG(ERROR) << "Failed to start binlog compaction: " << status;
+      compaction->fd.close();
+      unlink(compaction->path).ignore();
+      return;
+    }
+
+    UInt128 aes_ctr_iv;
+    MutableSlice(aes_ctr_iv.raw, sizeof(aes_ctr_iv.raw)).copy_from(event.iv_.as_slice());
+    compaction->aes_ctr_state.init(aes_ctr_key_, aes_ctr_iv);
+    compaction->is_encrypted = true;
+  }
+
+  processor_->for_each([&](BinlogEvent &event) { compaction->events.push_back(event.raw_event_.clone()); });
+  VLOG(binlog) << "Start binlog compaction " << tag("path", path_) << tag("events", compaction->events.size());
+  compaction_ = std::move(compaction);
+}
+
+void Binlog::do_compaction_step() {
+  CHECK(compaction_);
+  auto &events = compaction_->events;
+  auto begin = compaction_->events_pos;
+  auto end = begin;
+  size_t step_size = 0;
+  while (end < events.size() && step_size < COMPACTION_STEP_SIZE) {
+    step_size += events[end].size();
+    end++;
+  }
+
+  auto status = compaction_->write_events(events, begin, end);
+  if (status.is_error()) {
+    LOG(ERROR) << "Failed to write compacted binlog: " << status;
+    cancel_compaction();
+    return;
+  }
+  for (auto i = begin; i < end; i++) {
+    events[i] = BufferSlice();
+  }
+  compaction_->events_pos = end;
+
+  if (end == events.size()) {
+    finish_compaction();
+  }
+}
+
+void Binlog::continue_compaction() {
+  if (compaction_ && state_ == State::Run) {
+    do_compaction_step();
+  }
+}
+
+void Binlog::finish_compaction() {
+  CHECK(compaction_);
+  // all events must be written to the old file, before it is replaced
+  flush();
+
+  auto &new_events = compaction_->new_events;
+  auto status = compaction_->write_events(new_events, 0, new_events.size());
+  if (status.is_ok()) {
+    status = compaction_->fd.sync();
+  }
+  FileFd sync_fd;
+  if (status.is_ok()) {
+    auto r_sync_fd = compaction_->fd.duplicate();
+    if (r_sync_fd.is_ok()) {
+      sync_fd = r_sync_fd.move_as_ok();
+    } else {
+      status = r_sync_fd.move_as_error();
+    }
+  }
+  if (status.is_error()) {
+    LOG(ERROR) << "Failed to finish binlog compaction: " << status;
+    cancel_compaction();
+    return;
+  }
+
+  status = unlink(path_);
+  LOG_IF(FATAL, status.is_error()) << "Failed to unlink old binlog: " << status;
+  status = rename(compaction_->path, path_);
+  LOG_IF(FATAL, status.is_error()) << "Failed to rename binlog: " << status;
+
+  auto compaction = std::move(compaction_);
+  replace_fd(std::move(compaction->fd), std::move(sync_fd));
+  fd_size_ = compaction->size;
+  fd_events_ = compaction->events_n;
+  CHECK(fd_size_ == file_size(path_));
+
+  buffer_writer_ = ChainBufferWriter();
+  buffer_reader_ = buffer_writer_.extract_reader();
+  if (compaction->is_encrypted) {
+    aes_ctr_state_ = std::move(compaction->aes_ctr_state);
+  }
+  update_write_encryption();
+
+  auto finish_time = Clocks::monotonic();
+  double ratio = static_cast<double>(compaction->start_size) / static_cast<double>(fd_size_ + 1);
+  LOG(INFO) << "compact binlog " << tag("name", path_)
+            << tag("time", format::as_time(finish_time - compaction->start_time))
+            << tag("before_size", format::as_size(compaction->start_size))
+            << tag("after_size", format::as_size(fd_size_)) << tag("ratio", ratio)
+            << tag("before_events", compaction->start_events) << tag("after_events", fd_events_);
+}
+
+void Binlog::cancel_compaction() {
+  if (!compaction_) {
+    return;
+  }
+  VLOG(binlog) << "Cancel binlog compaction " << tag("path", path_);
+  compaction_->fd.close();
+  unlink(compaction_->path).ignore();
+  compaction_.reset();
+}
+
 }  // namespace td
@@ -20,6 +20,7 @@
 #include "td/utils/Status.h"
 
 #include <functional>
+#include <mutex>
 
 namespace td {
 struct BinlogInfo {
@@ -34,6 +35,8 @@ namespace detail {
 class BinlogReader;
 class BinlogEventsProcessor;
 class BinlogEventsBuffer;
+struct BinlogCompaction;
+class BinlogLoadWorkers;
 };  // namespace detail
 
 class Binlog {
@@ -51,6 +54,17 @@ class Binlog {
   Status init(string path, const Callback &callback, DbKey db_key = DbKey::empty(), DbKey old_db_key = DbKey::empty(),
               int32 dummy = -1, const Callback &debug_callback = Callback()) TD_WARN_UNUSED_RESULT;
 
+  // number of threads used to decrypt and check events in init; 0 means automatic choice based on the file size
+  void set_load_threads_n(int32 load_threads_n) {
+    load_threads_n_ = load_threads_n;
+  }
+
+  // if enabled, all new events are written with CRC-32C checksums, which are faster to calculate,
+  // but the binlog can't be read by versions, which don't support Crc32c flag; disabled by default
+  void set_use_crc32c(bool use_crc32c) {
+    use_crc32c_ = use_crc32c;
+  }
+
   uint64 next_id() {
     return ++last_id_;
   }
@@ -73,11 +87,18 @@ class Binlog {
 
   void add_event(BinlogEvent &&event);
   void sync();
+  // syncs all already flushed events; unlike other methods can be called from any thread
+  Status sync_flushed() TD_WARN_UNUSED_RESULT;
   void flush();
   void lazy_flush();
   double need_flush_since() const {
     return need_flush_since_;
   }
+  // compaction advances with every added event; when no events are added, it must be continued explicitly
+  bool need_compaction_step() const {
+    return compaction_ != nullptr;
+  }
+  void continue_compaction();
   void change_key(DbKey new_db_key);
 
   Status close(bool need_sync = true) TD_WARN_UNUSED_RESULT;
@@ -94,6 +115,8 @@ class Binlog {
 
  private:
   BufferedFdBase<FileFd> fd_;
+  FileFd sync_fd_;       // duplicate of fd_, so sync_flushed doesn't share state with the writes to fd_
+  std::mutex fd_mutex_;  // protects fd_ and sync_fd_ from being closed or replaced during sync_flushed
   ChainBufferWriter buffer_writer_;
   ChainBufferReader buffer_reader_;
   detail::BinlogReader *binlog_reader_ptr_;
@@ -107,6 +130,7 @@ class Binlog {
   // AesCtrEncryption
   BufferSlice aes_ctr_key_salt_;
   UInt256 aes_ctr_key_;
+  UInt128 aes_ctr_iv_;
   AesCtrState aes_ctr_state_;
 
   bool byte_flow_flag_ = false;
@@ -124,16 +148,36 @@ class Binlog {
   uint64 last_id_{0};
   double need_flush_since_ = 0;
   enum class State { Empty, Load, Reindex, Run } state_{State::Empty};
+  std::unique_ptr<detail::BinlogCompaction> compaction_;
+
+  int32 load_threads_n_ = 0;
+  bool use_crc32c_ = false;
+  detail::BinlogLoadWorkers *load_workers_ = nullptr;  // not null only during parallel load
+  int64 load_encrypted_size_ = 0;
 
   static constexpr uint32 MAX_EVENT_SIZE = 65536;
+  static constexpr size_t COMPACTION_STEP_SIZE = 1 << 16;
+  static constexpr int64 PARALLEL_LOAD_MIN_SIZE = 1 << 24;
+  static constexpr size_t PARALLEL_LOAD_READ_SIZE = 1 << 22;
 
   Result<FileFd> open_binlog(CSlice path, int32 flags);
+  void replace_fd(FileFd fd, FileFd sync_fd);
   size_t flush_events_buffer(bool force);
   void do_add_event(BinlogEvent &&event);
   void do_event(BinlogEvent &&event);
   Status load_binlog(const Callback &callback, const Callback &debug_callback = Callback()) TD_WARN_UNUSED_RESULT;
+  int32 get_load_threads_n(int64 fd_size) const;
+  void load_event(BinlogEvent &&event, const Callback &debug_callback);
+  Status load_events(detail::BinlogReader &reader, const Callback &debug_callback) TD_WARN_UNUSED_RESULT;
+  Status load_events_parallel(detail::BinlogReader &reader, const Callback &debug_callback) TD_WARN_UNUSED_RESULT;
+  void decrypt_loaded_data(MutableSlice data);
   void do_reindex();
 
+  void start_compaction();
+  void do_compaction_step();
+  void finish_compaction();
+  void cancel_compaction();
+
   void update_encryption(Slice key, Slice iv);
   void reset_encryption();
   void update_read_encryption();
@@ -7,6 +7,7 @@
 #include "td/db/binlog/BinlogEvent.h"
 
 #include "td/utils/tl_parsers.h"
+#include "td/utils/tl_storers.h"
 
 namespace td {
 int32 VERBOSITY_NAME(binlog) = VERBOSITY_NAME(DEBUG) + 8;
@@ -23,16 +24,36 @@ Status BinlogEvent::init(BufferSlice &&raw_event, bool check_crc) {
   auto slice_data = parser.fetch_string_raw<Slice>(size_ - MIN_EVENT_SIZE);
   data_ = MutableSlice(const_cast<char *>(slice_data.begin()), slice_data.size());
   crc32_ = static_cast<uint32>(parser.fetch_int());
+  raw_event_ = std::move(raw_event);
   if (check_crc) {
-    CHECK(size_ >= EVENT_TAIL_SIZE);
-    auto calculated_crc = crc32(raw_event.as_slice().truncate(size_ - EVENT_TAIL_SIZE));
-    if (calculated_crc != crc32_) {
-      return Status::Error(PSLICE() << "crc mismatch " << tag("actual", format::as_hex(calculated_crc))
-                                    << tag("expected", format::as_hex(crc32_)));
-    }
+    return validate();
+  }
+  return Status::OK();
+}
+
+Status BinlogEvent::validate() const {
+  CHECK(size_ >= EVENT_TAIL_SIZE);
+  auto calculated_crc = calc_crc(raw_event_.as_slice().truncate(size_ - EVENT_TAIL_SIZE), flags_);
+  if (calculated_crc != crc32_) {
+    return Status::Error(PSLICE() << "crc mismatch " << tag("actual", format::as_hex(calculated_crc))
+                                  << tag("expected", format::as_hex(crc32_)));
   }
-  raw_event_ = std::move(raw_event);
   return Status::OK();
 }
 
+void BinlogEvent::use_crc32c() {
+  if ((flags_ & Flags::Crc32c) != 0) {
+    return;
+  }
+
+  // the buffer can be shared with the creator of the event, so it must be copied before the change
+  auto raw_event = raw_event_.copy();
+  auto flags = flags_ | Flags::Crc32c;
+  TlStorerUnsafe flags_storer(raw_event.as_slice().begin() + 4 + 8 + 4);
+  flags_storer.store_int(flags);
+  TlStorerUnsafe crc_storer(raw_event.as_slice().end() - EVENT_TAIL_SIZE);
+  crc_storer.store_int(calc_crc(raw_event.as_slice().truncate(raw_event.size() - EVENT_TAIL_SIZE), flags));
+  init(std::move(raw_event), false).ensure();
+}
+
 }  // namespace td
@@ -55,7 +55,9 @@ struct BinlogEvent {
   BufferSlice raw_event_;
 
   enum ServiceTypes { Header = -1, Empty = -2, AesCtrEncryption = -3, NoEncryption = -4 };
-  enum Flags { Rewrite = 1, Partial = 2 };
+  // events with Crc32c flag are checked with CRC-32C instead of CRC-32, which is faster on modern CPUs,
+  // but such events can't be read by older versions, so the flag is set only if Binlog::set_use_crc32c was called
+  enum Flags { Rewrite = 1, Partial = 2, Crc32c = 4 };
 
   void clear() {
     raw_event_ = BufferSlice();
@@ -78,8 +80,16 @@ struct BinlogEvent {
     init(std::move(raw_event), false).ensure();
   }
   Status init(BufferSlice &&raw_event, bool check_crc = true) TD_WARN_UNUSED_RESULT;
+  Status validate() const TD_WARN_UNUSED_RESULT;
+
+  // sets Crc32c flag and recalculates the checksum of the event
+  void use_crc32c();
 
   static BufferSlice create_raw(uint64 id, int32 type, int32 flags, const Storer &storer);
+
+  static uint32 calc_crc(Slice data, int32 flags) {
+    return (flags & Flags::Crc32c) != 0 ? crc32c(data) : crc32(data);
+  }
 };
 
 inline StringBuilder &operator<<(StringBuilder &sb, const BinlogEvent &event) {
@@ -102,7 +112,7 @@ inline BufferSlice BinlogEvent::create_raw(uint64 id, int32 type, int32 flags, c
   tl_storer.store_storer(storer);
 
   CHECK(tl_storer.get_buf() == raw_event.as_slice().end() - EVENT_TAIL_SIZE);
-  tl_storer.store_int(::td::crc32(raw_event.as_slice().truncate(raw_event.size() - EVENT_TAIL_SIZE)));
+  tl_storer.store_int(calc_crc(raw_event.as_slice().truncate(raw_event.size() - EVENT_TAIL_SIZE), flags));
 
   return raw_event;
 }
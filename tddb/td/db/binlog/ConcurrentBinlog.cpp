@@ -7,25 +7,105 @@
 #include "td/db/binlog/ConcurrentBinlog.h"
 
 #include "td/utils/logging.h"
+#include "td/utils/MpscPollableQueue.h"
 #include "td/utils/OrderedEventsProcessor.h"
+#include "td/utils/port/thread.h"
 #include "td/utils/Time.h"
 
+#include <condition_variable>
 #include <map>
+#include <mutex>
+#include <utility>
 
 namespace td {
 namespace detail {
+#if !TD_THREAD_UNSUPPORTED && !TD_EVENTFD_UNSUPPORTED
+// Syncs the binlog in a separate thread, so new events can be appended while previous ones are being synced.
+// All sync requests received during a sync are served by the next single sync.
+class BinlogSyncThread {
+ public:
+  explicit BinlogSyncThread(Binlog *binlog) : binlog_(binlog) {
+    synced_queue_.init();
+    thread_ = thread([this] { run(); });
+  }
+  BinlogSyncThread(const BinlogSyncThread &) = delete;
+  BinlogSyncThread &operator=(const BinlogSyncThread &) = delete;
+  BinlogSyncThread(BinlogSyncThread &&) = delete;
+  BinlogSyncThread &operator=(BinlogSyncThread &&) = delete;
+  ~BinlogSyncThread() {
+    close();
+  }
+
+  // all events flushed before the call will be synced
+  void sync(uint64 generation) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    CHECK(generation > requested_generation_);
+    requested_generation_ = generation;
+    condition_variable_.notify_one();
+  }
+
+  void close() {
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      if (is_closed_) {
+        return;
+      }
+      is_closed_ = true;
+      condition_variable_.notify_one();
+    }
+    thread_.join();
+  }
+
+  // generations of finished syncs are put to the queue
+  MpscPollableQueue<uint64> &get_synced_queue() {
+    return synced_queue_;
+  }
+
+ private:
+  Binlog *binlog_;
+  thread thread_;
+  std::mutex mutex_;
+  std::condition_variable condition_variable_;
+  uint64 requested_generation_ = 0;
+  bool is_closed_ = false;
+  MpscPollableQueue<uint64> synced_queue_;
+
+  void run() {
+    uint64 synced_generation = 0;
+    while (true) {
+      uint64 generation;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        condition_variable_.wait(lock, [&] { return is_closed_ || requested_generation_ != synced_generation; });
+        if (requested_generation_ == synced_generation) {
+          return;
+        }
+        generation = requested_generation_;
+      }
+      binlog_->sync_flushed().ensure();
+      synced_generation = generation;
+      synced_queue_.writer_put(generation);
+    }
+  }
+};
+#endif
+
 class BinlogActor : public Actor {
  public:
   BinlogActor(std::unique_ptr<Binlog> binlog, uint64 seq_no) : binlog_(std::move(binlog)), processor_(seq_no) {
   }
   void close(Promise<> promise) {
+    close_sync_thread();
     binlog_->close().ensure();
+    finish_all_syncs();
     promise.set_value(Unit());
     LOG(INFO) << "close: done";
     stop();
   }
   void close_and_destroy(Promise<> promise) {
+    close_sync_thread();
     binlog_->close_and_destroy().ensure();
+    finish_all_syncs();
     promise.set_value(Unit());
     LOG(INFO) << "close_and_destroy: done";
     stop();
@@ -44,6 +124,7 @@ class BinlogActor : public Actor {
     });
     flush_immediate_sync();
     try_flush();
+    try_compaction();
   }
 
   void force_sync(Promise<> &&promise) {
@@ -73,12 +154,124 @@ class BinlogActor : public Actor {
 
   std::multimap<uint64, Promise<>> immediate_sync_promises_;
   std::vector<Promise<>> sync_promises_;
+
+  // promises waiting for a sync in the sync thread
+  std::vector<std::pair<uint64, std::vector<Promise<>>>> syncing_promises_;
+  uint64 sync_generation_ = 0;
+#if !TD_THREAD_UNSUPPORTED && !TD_EVENTFD_UNSUPPORTED
+  std::unique_ptr<BinlogSyncThread> sync_thread_;
+#endif
   bool force_sync_flag_ = false;
   bool lazy_sync_flag_ = false;
   bool flush_flag_ = false;
+  bool compaction_flag_ = false;
   double wakeup_at_ = 0;
 
   static constexpr int32 FLUSH_TIMEOUT = 1;  // 1s
+  static constexpr double COMPACTION_STEP_DELAY = 0.01;
+
+  void start_up() override {
+#if !TD_THREAD_UNSUPPORTED && !TD_EVENTFD_UNSUPPORTED
+    sync_thread_ = std::make_unique<BinlogSyncThread>(binlog_.get());
+    auto &fd = sync_thread_->get_synced_queue().reader_get_event_fd();
+    fd.get_fd().set_observer(this);
+    ::td::subscribe(fd.get_fd(), Fd::Read);
+    yield();
+#endif
+  }
+
+  void tear_down() override {
+    close_sync_thread();
+    fail_all_syncs();
+  }
+
+  void loop() override {
+#if !TD_THREAD_UNSUPPORTED && !TD_EVENTFD_UNSUPPORTED
+    if (!sync_thread_) {
+      return;
+    }
+    auto &queue = sync_thread_->get_synced_queue();
+    while (true) {
+      int size = queue.reader_wait_nonblock();
+      if (size == 0) {
+        return;
+      }
+      uint64 synced_generation = 0;
+      for (int i = 0; i < size; i++) {
+        synced_generation = queue.reader_get_unsafe();
+      }
+      finish_syncs(synced_generation);
+    }
+#endif
+  }
+
+  void close_sync_thread() {
+#if !TD_THREAD_UNSUPPORTED && !TD_EVENTFD_UNSUPPORTED
+    if (!sync_thread_) {
+      return;
+    }
+    sync_thread_->close();
+    auto &fd = sync_thread_->get_synced_queue().reader_get_event_fd();
+    ::td::unsubscribe(fd.get_fd());
+    fd.get_fd().set_observer(nullptr);
+    sync_thread_.reset();
+#endif
+  }
+
+  void do_sync() {
+#if !TD_THREAD_UNSUPPORTED && !TD_EVENTFD_UNSUPPORTED
+    if (sync_thread_) {
+      binlog_->flush();
+      sync_generation_++;
+      if (!sync_promises_.empty()) {
+        syncing_promises_.emplace_back(sync_generation_, std::move(sync_promises_));
+        sync_promises_.clear();
+      }
+      sync_thread_->sync(sync_generation_);
+      return;
+    }
+#endif
+    binlog_->sync();
+    for (auto &promise : sync_promises_) {
+      promise.set_value(Unit());
+    }
+    sync_promises_.clear();
+  }
+
+  void finish_syncs(uint64 synced_generation) {
+    size_t i = 0;
+    while (i < syncing_promises_.size() && syncing_promises_[i].first <= synced_generation) {
+      for (auto &promise : syncing_promises_[i].second) {
+        promise.set_value(Unit());
+      }
+      i++;
+    }
+    syncing_promises_.erase(syncing_promises_.begin(), syncing_promises_.begin() + i);
+  }
+
+  // must be called after the binlog is synced
+  void finish_all_syncs() {
+    finish_syncs(sync_generation_);
+  }
+
+  // the binlog was neither synced nor closed, so nobody may assume that the events are persisted
+  void fail_all_syncs() {
+    auto fail = [](Promise<> &promise) { promise.set_error(Status::Error("Binlog was closed before sync")); };
+    for (auto &it : syncing_promises_) {
+      for (auto &promise : it.second) {
+        fail(promise);
+      }
+    }
+    syncing_promises_.clear();
+    for (auto &promise : sync_promises_) {
+      fail(promise);
+    }
+    sync_promises_.clear();
+    for (auto &it : immediate_sync_promises_) {
+      fail(it.second);
+    }
+    immediate_sync_promises_.clear();
+  }
 
   void wakeup_after(double after) {
     auto now = Time::now_cached();
@@ -109,6 +302,13 @@ class BinlogActor : public Actor {
     }
   }
 
+  void try_compaction() {
+    if (binlog_->need_compaction_step() && !compaction_flag_) {
+      compaction_flag_ = true;
+      wakeup_after(COMPACTION_STEP_DELAY);
+    }
+  }
+
   void flush_immediate_sync() {
     auto seq_no = processor_.max_finished_seq_no();
     for (auto it = immediate_sync_promises_.begin(), end = immediate_sync_promises_.end();
@@ -144,14 +344,16 @@ class BinlogActor : public Actor {
     force_sync_flag_ = false;
     bool need_flush = flush_flag_;
     flush_flag_ = false;
+    bool need_compaction = compaction_flag_;
+    compaction_flag_ = false;
     wakeup_at_ = 0;
+    if (need_compaction) {
+      binlog_->continue_compaction();
+      try_compaction();
+    }
     if (need_sync) {
-      binlog_->sync();
+      do_sync();
       // LOG(ERROR) << "BINLOG SYNC";
-      for (auto &promise : sync_promises_) {
-        promise.set_value(Unit());
-      }
-      sync_promises_.clear();
     } else if (need_flush) {
       try_flush();
       // LOG(ERROR) << "BINLOG FLUSH";
@@ -34,6 +34,8 @@ class FdInterface {
 
   virtual Result<size_t> write(Slice slice) TD_WARN_UNUSED_RESULT = 0;
   virtual Result<size_t> read(MutableSlice slice) TD_WARN_UNUSED_RESULT = 0;
+  virtual Result<size_t> writev(const Slice *slices, size_t slice_count) TD_WARN_UNUSED_RESULT = 0;
+  virtual Result<size_t> readv(const MutableSlice *slices, size_t slice_count) TD_WARN_UNUSED_RESULT = 0;
 
   virtual void close() = 0;
   virtual bool empty() const = 0;
@@ -65,6 +67,12 @@ class FdToInterface : public FdInterface {
   Result<size_t> read(MutableSlice slice) final TD_WARN_UNUSED_RESULT {
     return fd_.read(slice);
   }
+  Result<size_t> writev(const Slice *slices, size_t slice_count) final TD_WARN_UNUSED_RESULT {
+    return fd_.writev(slices, slice_count);
+  }
+  Result<size_t> readv(const MutableSlice *slices, size_t slice_count) final TD_WARN_UNUSED_RESULT {
+    return fd_.readv(slices, slice_count);
+  }
 
   void close() final {
     fd_.close();
@@ -107,6 +115,12 @@ class FdProxy {
   Result<size_t> read(MutableSlice slice) TD_WARN_UNUSED_RESULT {
     return fd_->read(slice);
   }
+  Result<size_t> writev(const Slice *slices, size_t slice_count) TD_WARN_UNUSED_RESULT {
+    return fd_->writev(slices, slice_count);
+  }
+  Result<size_t> readv(const MutableSlice *slices, size_t slice_count) TD_WARN_UNUSED_RESULT {
+    return fd_->readv(slices, slice_count);
+  }
 
   void close() {
     fd_->close();
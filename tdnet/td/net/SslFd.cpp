@@ -263,6 +263,16 @@ Result<size_t> SslFd::read(MutableSlice slice) {
   return size;
 }
 
+// SSL_write and SSL_read have no vectored versions, so only the first slice is processed
+Result<size_t> SslFd::writev(const Slice *slices, size_t slice_count) {
+  CHECK(slice_count > 0);
+  return write(slices[0]);
+}
+Result<size_t> SslFd::readv(const MutableSlice *slices, size_t slice_count) {
+  CHECK(slice_count > 0);
+  return read(slices[0]);
+}
+
 void SslFd::close() {
   if (fd_.empty()) {
     CHECK(!ssl_handle_ && !ssl_ctx_);
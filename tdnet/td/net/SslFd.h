@@ -61,6 +61,9 @@ class SslFd {
   Result<size_t> write(Slice slice) TD_WARN_UNUSED_RESULT;
   Result<size_t> read(MutableSlice slice) TD_WARN_UNUSED_RESULT;
 
+  Result<size_t> writev(const Slice *slices, size_t slice_count) TD_WARN_UNUSED_RESULT;
+  Result<size_t> readv(const MutableSlice *slices, size_t slice_count) TD_WARN_UNUSED_RESULT;
+
   void close();
 
   int32 get_flags() const {
@@ -13,6 +13,7 @@
 #include "td/utils/Slice.h"
 #include "td/utils/Status.h"
 
+#include <algorithm>
 #include <limits>
 
 namespace td {
@@ -90,10 +91,18 @@ Result<size_t> BufferedFdBase<FdT>::flush_read(size_t max_read) {
   CHECK(read_);
   size_t result = 0;
   while (::td::can_read(*this) && max_read) {
-    MutableSlice slice = read_->prepare_append().truncate(max_read);
-    TRY_RESULT(x, FdT::read(slice));
-    slice.truncate(x);
-    read_->confirm_append(x);
+    // read into the rest of the current buffer and into the next buffer at once
+    MutableSlice slices[2];
+    size_t slice_count = 1;
+    slices[0] = read_->prepare_append().truncate(max_read);
+    if (slices[0].size() < max_read) {
+      slices[1] = read_->prepare_append_spare().truncate(max_read - slices[0].size());
+      slice_count = 2;
+    }
+    TRY_RESULT(x, FdT::readv(slices, slice_count));
+    auto head_size = std::min(x, slices[0].size());
+    read_->confirm_append(head_size);
+    read_->confirm_append_spare(x - head_size);
     result += x;
     max_read -= x;
   }
@@ -106,9 +115,21 @@ Result<size_t> BufferedFdBase<FdT>::flush_write() {
   // TODO: sync on demand
   write_->sync_with_writer();
   while (!write_->empty() && ::td::can_write(*this)) {
-    Slice slice = write_->prepare_read();
-    TRY_RESULT(x, FdT::write(slice));
-    write_->confirm_read(x);
+    // gather as many chunks as possible and write them with a single writev
+    Slice slices[Fd::MAX_IOVEC_COUNT];
+    size_t slice_count = 0;
+    auto it = write_->clone();
+    while (slice_count < Fd::MAX_IOVEC_COUNT) {
+      Slice slice = it.prepare_read();
+      if (slice.empty()) {
+        break;
+      }
+      slices[slice_count++] = slice;
+      it.confirm_read(slice.size());
+    }
+    CHECK(slice_count > 0);
+    TRY_RESULT(x, FdT::writev(slices, slice_count));
+    write_->advance(x);
     result += x;
   }
   return result;
@@ -0,0 +1,71 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2017
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include <atomic>
+#include <memory>
+
+namespace td {
+
+namespace detail {
+struct RawCancellationToken {
+  std::atomic<bool> is_cancelled_{false};
+};
+}  // namespace detail
+
+// checked by long-running jobs from any thread
+class CancellationToken {
+ public:
+  CancellationToken() = default;
+  explicit CancellationToken(std::shared_ptr<detail::RawCancellationToken> token) : token_(std::move(token)) {
+  }
+
+  // empty CancellationToken is never cancelled
+  explicit operator bool() const {
+    return token_ && token_->is_cancelled_.load(std::memory_order_acquire);
+  }
+
+ private:
+  std::shared_ptr<detail::RawCancellationToken> token_;
+};
+
+// cancels all issued tokens on cancel() or destruction
+class CancellationTokenSource {
+ public:
+  CancellationTokenSource() = default;
+  CancellationTokenSource(const CancellationTokenSource &other) = delete;
+  CancellationTokenSource &operator=(const CancellationTokenSource &other) = delete;
+  CancellationTokenSource(CancellationTokenSource &&other) = default;
+  CancellationTokenSource &operator=(CancellationTokenSource &&other) {
+    cancel();
+    token_ = std::move(other.token_);
+    return *this;
+  }
+  ~CancellationTokenSource() {
+    cancel();
+  }
+
+  CancellationToken get_cancellation_token() {
+    if (!token_) {
+      token_ = std::make_shared<detail::RawCancellationToken>();
+    }
+    return CancellationToken(token_);
+  }
+
+  void cancel() {
+    if (!token_) {
+      return;
+    }
+    token_->is_cancelled_.store(true, std::memory_order_release);
+    token_.reset();
+  }
+
+ private:
+  std::shared_ptr<detail::RawCancellationToken> token_;
+};
+
+}  // namespace td
@@ -0,0 +1,386 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2017
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "td/utils/common.h"
+#include "td/utils/logging.h"
+
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
+namespace td {
+
+// Ordered map, which stores sorted keys and values in contiguous chunks of at most MaxChunkSize elements.
+// Lookups touch only a few cache lines, in-order iteration is sequential, insertions and erasures move
+// at most MaxChunkSize elements. Values are moved between and within chunks, so any modification invalidates
+// all iterators and all pointers returned by find() and insert(). Values, which must keep their address,
+// should be stored by pointer, for example as unique_ptr.
+template <class KeyT, class ValueT, size_t MaxChunkSize = 64>
+class ChunkedSortedMap {
+  static_assert(MaxChunkSize >= 4, "Chunk is too small");
+
+  struct Chunk {
+    vector<KeyT> keys;
+    vector<ValueT> values;
+  };
+
+  template <class MapT, class ValueRefT>
+  class IteratorImpl {
+   public:
+    IteratorImpl() = default;
+    IteratorImpl(MapT *map, size_t chunk_pos, size_t pos) : map_(map), chunk_pos_(chunk_pos), pos_(pos) {
+    }
+
+    explicit operator bool() const {
+      return map_ != nullptr;
+    }
+
+    const KeyT &key() const {
+      return map_->chunks_[chunk_pos_].keys[pos_];
+    }
+    ValueRefT value() const {
+      return map_->chunks_[chunk_pos_].values[pos_];
+    }
+
+    void operator++() {
+      if (map_ == nullptr) {
+        return;
+      }
+      if (++pos_ == map_->chunks_[chunk_pos_].keys.size()) {
+        pos_ = 0;
+        if (++chunk_pos_ == map_->chunks_.size()) {
+          map_ = nullptr;
+        }
+      }
+    }
+
+    void operator--() {
+      if (map_ == nullptr) {
+        return;
+      }
+      if (pos_ == 0) {
+        if (chunk_pos_ == 0) {
+          map_ = nullptr;
+          return;
+        }
+        chunk_pos_--;
+        pos_ = map_->chunks_[chunk_pos_].keys.size();
+      }
+      pos_--;
+    }
+
+   private:
+    MapT *map_ = nullptr;
+    size_t chunk_pos_ = 0;
+    size_t pos_ = 0;
+  };
+
+ public:
+  using Iterator = IteratorImpl<ChunkedSortedMap, ValueT &>;
+  using ConstIterator = IteratorImpl<const ChunkedSortedMap, const ValueT &>;
+
+  size_t size() const {
+    return size_;
+  }
+
+  bool empty() const {
+    return size_ == 0;
+  }
+
+  ValueT *find(const KeyT &key) {
+    return const_cast<ValueT *>(static_cast<const ChunkedSortedMap *>(this)->find(key));
+  }
+
+  const ValueT *find(const KeyT &key) const {
+    auto chunk_pos = get_chunk_pos(key);
+    if (chunk_pos == chunks_.size()) {
+      return nullptr;
+    }
+    auto &chunk = chunks_[chunk_pos];
+    auto it = std::lower_bound(chunk.keys.begin(), chunk.keys.end(), key);
+    if (it == chunk.keys.end() || key < *it) {
+      return nullptr;
+    }
+    return &chunk.values[it - chunk.keys.begin()];
+  }
+
+  // returns pointer to the value with the given key and whether the value was inserted
+  std::pair<ValueT *, bool> insert(KeyT key, ValueT value) {
+    if (chunks_.empty()) {
+      chunks_.emplace_back();
+      chunk_last_keys_.push_back(key);
+    }
+    auto chunk_pos = get_chunk_pos(key);
+    if (chunk_pos == chunks_.size()) {
+      chunk_pos--;
+    }
+
+    auto *chunk = &chunks_[chunk_pos];
+    auto pos = static_cast<size_t>(std::lower_bound(chunk->keys.begin(), chunk->keys.end(), key) - chunk->keys.begin());
+    if (pos < chunk->keys.size() && !(key < chunk->keys[pos])) {
+      return {&chunk->values[pos], false};
+    }
+
+    chunk->keys.insert(chunk->keys.begin() + pos, std::move(key));
+    chunk->values.insert(chunk->values.begin() + pos, std::move(value));
+    chunk_last_keys_[chunk_pos] = chunk->keys.back();
+    size_++;
+
+    if (chunk->keys.size() > MaxChunkSize) {
+      split_chunk(chunk_pos);
+      chunk = &chunks_[chunk_pos];
+      if (pos >= chunk->keys.size()) {
+        pos -= chunk->keys.size();
+        chunk = &chunks_[chunk_pos + 1];
+      }
+    }
+    return {&chunk->values[pos], true};
+  }
+
+  // erases value with the given key and returns it, returns ValueT() if there is no such key
+  ValueT extract(const KeyT &key) {
+    auto chunk_pos = get_chunk_pos(key);
+    if (chunk_pos == chunks_.size()) {
+      return ValueT();
+    }
+    auto &chunk = chunks_[chunk_pos];
+    auto it = std::lower_bound(chunk.keys.begin(), chunk.keys.end(), key);
+    if (it == chunk.keys.end() || key < *it) {
+      return ValueT();
+    }
+    auto pos = it - chunk.keys.begin();
+    ValueT result = std::move(chunk.values[pos]);
+    chunk.keys.erase(it);
+    chunk.values.erase(chunk.values.begin() + pos);
+    size_--;
+    on_chunk_shrinked(chunk_pos);
+    return result;
+  }
+
+  // erases all values with keys in [begin_key, end_key), calling f(key, std::move(value)) for each of them in order
+  template <class F>
+  void erase_range(const KeyT &begin_key, const KeyT &end_key, F &&f) {
+    auto first_chunk_pos = get_chunk_pos(begin_key);
+    auto chunk_pos = first_chunk_pos;
+    for (; chunk_pos < chunks_.size(); chunk_pos++) {
+      auto &chunk = chunks_[chunk_pos];
+      auto begin = std::lower_bound(chunk.keys.begin(), chunk.keys.end(), begin_key) - chunk.keys.begin();
+      auto end = std::lower_bound(chunk.keys.begin() + begin, chunk.keys.end(), end_key) - chunk.keys.begin();
+      for (auto pos = begin; pos < end; pos++) {
+        f(chunk.keys[pos], std::move(chunk.values[pos]));
+      }
+      chunk.keys.erase(chunk.keys.begin() + begin, chunk.keys.begin() + end);
+      chunk.values.erase(chunk.values.begin() + begin, chunk.values.begin() + end);
+      size_ -= static_cast<size_t>(end - begin);
+      if (!chunk.keys.empty()) {
+        chunk_last_keys_[chunk_pos] = chunk.keys.back();
+      }
+      if (static_cast<size_t>(end) < chunk.keys.size() + static_cast<size_t>(end - begin)) {
+        // the range ends inside of the chunk
+        chunk_pos++;
+        break;
+      }
+    }
+    if (first_chunk_pos == chunk_pos) {
+      return;
+    }
+
+    // all chunks in between have become empty
+    size_t erase_begin = first_chunk_pos;
+    size_t erase_end = chunk_pos;
+    if (!chunks_[erase_begin].keys.empty()) {
+      erase_begin++;
+    }
+    if (erase_end > erase_begin && !chunks_[erase_end - 1].keys.empty()) {
+      erase_end--;
+    }
+    if (erase_begin < erase_end) {
+      chunks_.erase(chunks_.begin() + erase_begin, chunks_.begin() + erase_end);
+      chunk_last_keys_.erase(chunk_last_keys_.begin() + erase_begin, chunk_last_keys_.begin() + erase_end);
+    }
+    if (first_chunk_pos < chunks_.size()) {
+      on_chunk_shrinked(first_chunk_pos);
+    }
+  }
+
+  void clear() {
+    chunks_.clear();
+    chunk_last_keys_.clear();
+    size_ = 0;
+  }
+
+  // calls f(key, value) for each value in order of keys
+  template <class F>
+  void for_each(F &&f) {
+    for (auto &chunk : chunks_) {
+      for (size_t pos = 0; pos < chunk.keys.size(); pos++) {
+        f(static_cast<const KeyT &>(chunk.keys[pos]), chunk.values[pos]);
+      }
+    }
+  }
+
+  template <class F>
+  void for_each(F &&f) const {
+    for (auto &chunk : chunks_) {
+      for (size_t pos = 0; pos < chunk.keys.size(); pos++) {
+        f(chunk.keys[pos], chunk.values[pos]);
+      }
+    }
+  }
+
+  Iterator get_first() {
+    return empty() ? Iterator() : Iterator(this, 0, 0);
+  }
+  ConstIterator get_first() const {
+    return empty() ? ConstIterator() : ConstIterator(this, 0, 0);
+  }
+
+  Iterator get_last() {
+    return empty() ? Iterator() : Iterator(this, chunks_.size() - 1, chunks_.back().keys.size() - 1);
+  }
+  ConstIterator get_last() const {
+    return empty() ? ConstIterator() : ConstIterator(this, chunks_.size() - 1, chunks_.back().keys.size() - 1);
+  }
+
+  // returns iterator to the value with the greatest key, which is less or equal than the given key
+  Iterator find_less_or_equal(const KeyT &key) {
+    size_t chunk_pos;
+    size_t pos;
+    if (!do_find_less_or_equal(key, chunk_pos, pos)) {
+      return Iterator();
+    }
+    return Iterator(this, chunk_pos, pos);
+  }
+  ConstIterator find_less_or_equal(const KeyT &key) const {
+    size_t chunk_pos;
+    size_t pos;
+    if (!do_find_less_or_equal(key, chunk_pos, pos)) {
+      return ConstIterator();
+    }
+    return ConstIterator(this, chunk_pos, pos);
+  }
+
+  // returns iterator to the value with the least key, which is greater or equal than the given key
+  ConstIterator find_greater_or_equal(const KeyT &key) const {
+    auto chunk_pos = get_chunk_pos(key);
+    if (chunk_pos == chunks_.size()) {
+      return ConstIterator();
+    }
+    auto &keys = chunks_[chunk_pos].keys;
+    auto pos = static_cast<size_t>(std::lower_bound(keys.begin(), keys.end(), key) - keys.begin());
+    return ConstIterator(this, chunk_pos, pos);
+  }
+
+  // returns iterator to the last value, for which f(key, value) is false, if f is false for some prefix of the values
+  // and true for the remaining values
+  template <class F>
+  ConstIterator find_last_not_satisfying(F &&f) const {
+    auto chunk_it = std::partition_point(chunks_.begin(), chunks_.end(),
+                                         [&f](const Chunk &chunk) { return !f(chunk.keys.back(), chunk.values.back()); });
+    if (chunk_it == chunks_.end()) {
+      return get_last();
+    }
+    auto chunk_pos = static_cast<size_t>(chunk_it - chunks_.begin());
+    size_t pos = 0;
+    while (pos < chunk_it->keys.size() && !f(chunk_it->keys[pos], chunk_it->values[pos])) {
+      pos++;
+    }
+    if (pos == 0) {
+      if (chunk_pos == 0) {
+        return ConstIterator();
+      }
+      chunk_pos--;
+      pos = chunks_[chunk_pos].keys.size();
+    }
+    return ConstIterator(this, chunk_pos, pos - 1);
+  }
+
+ private:
+  vector<Chunk> chunks_;
+  vector<KeyT> chunk_last_keys_;  // chunk_last_keys_[i] == chunks_[i].keys.back(), the only data touched by lookups
+  size_t size_ = 0;
+
+  // returns position of the first chunk, which can contain the key, or chunks_.size() if the key is too big
+  size_t get_chunk_pos(const KeyT &key) const {
+    return static_cast<size_t>(std::lower_bound(chunk_last_keys_.begin(), chunk_last_keys_.end(), key) -
+                               chunk_last_keys_.begin());
+  }
+
+  bool do_find_less_or_equal(const KeyT &key, size_t &chunk_pos, size_t &pos) const {
+    if (empty()) {
+      return false;
+    }
+    chunk_pos = get_chunk_pos(key);
+    if (chunk_pos == chunks_.size()) {
+      chunk_pos--;
+      pos = chunks_[chunk_pos].keys.size() - 1;
+      return true;
+    }
+    auto &keys = chunks_[chunk_pos].keys;
+    pos = static_cast<size_t>(std::upper_bound(keys.begin(), keys.end(), key) - keys.begin());
+    if (pos == 0) {
+      if (chunk_pos == 0) {
+        return false;
+      }
+      chunk_pos--;
+      pos = chunks_[chunk_pos].keys.size();
+    }
+    pos--;
+    return true;
+  }
+
+  void split_chunk(size_t chunk_pos) {
+    Chunk new_chunk;
+    {
+      auto &chunk = chunks_[chunk_pos];
+      auto half = chunk.keys.size() / 2;
+      new_chunk.keys.reserve(MaxChunkSize);
+      new_chunk.values.reserve(MaxChunkSize);
+      std::move(chunk.keys.begin() + half, chunk.keys.end(), std::back_inserter(new_chunk.keys));
+      std::move(chunk.values.begin() + half, chunk.values.end(), std::back_inserter(new_chunk.values));
+      chunk.keys.erase(chunk.keys.begin() + half, chunk.keys.end());
+      chunk.values.erase(chunk.values.begin() + half, chunk.values.end());
+      chunk_last_keys_[chunk_pos] = chunk.keys.back();
+    }
+    chunk_last_keys_.insert(chunk_last_keys_.begin() + chunk_pos + 1, new_chunk.keys.back());
+    chunks_.insert(chunks_.begin() + chunk_pos + 1, std::move(new_chunk));
+  }
+
+  // removes empty chunk or merges small chunk with a neighbour to keep chunks reasonably full
+  void on_chunk_shrinked(size_t chunk_pos) {
+    auto &chunk = chunks_[chunk_pos];
+    if (chunk.keys.empty()) {
+      chunks_.erase(chunks_.begin() + chunk_pos);
+      chunk_last_keys_.erase(chunk_last_keys_.begin() + chunk_pos);
+      return;
+    }
+    chunk_last_keys_[chunk_pos] = chunk.keys.back();
+    if (chunk.keys.size() > MaxChunkSize / 4) {
+      return;
+    }
+
+    size_t left_pos = chunk_pos;
+    if (chunk_pos + 1 < chunks_.size() && chunk.keys.size() + chunks_[chunk_pos + 1].keys.size() <= MaxChunkSize) {
+      // merge with the next chunk
+    } else if (chunk_pos > 0 && chunk.keys.size() + chunks_[chunk_pos - 1].keys.size() <= MaxChunkSize) {
+      left_pos = chunk_pos - 1;
+    } else {
+      return;
+    }
+
+    auto &left = chunks_[left_pos];
+    auto &right = chunks_[left_pos + 1];
+    std::move(right.keys.begin(), right.keys.end(), std::back_inserter(left.keys));
+    std::move(right.values.begin(), right.values.end(), std::back_inserter(left.values));
+    chunk_last_keys_[left_pos] = left.keys.back();
+    chunks_.erase(chunks_.begin() + left_pos + 1);
+    chunk_last_keys_.erase(chunk_last_keys_.begin() + left_pos + 1);
+  }
+};
+
+}  // namespace td
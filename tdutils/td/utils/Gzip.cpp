@@ -10,6 +10,7 @@ char disable_linker_warning_about_empty_file_gzip_cpp TD_UNUSED;
 
 #if TD_HAVE_ZLIB
 #include "td/utils/logging.h"
+#include "td/utils/port/thread_local.h"
 
 #include <cstring>
 #include <limits>
@@ -167,24 +168,56 @@ BufferSlice gzdecode(Slice s) {
   return message.extract_reader().move_as_buffer_slice();
 }
 
-BufferSlice gzencode(Slice s, double k) {
-  Gzip gzip;
-  gzip.init_encode().ensure();
-  gzip.set_input(s);
-  gzip.close_input();
-  size_t max_size = static_cast<size_t>(static_cast<double>(s.size()) * k);
-  BufferWriter message{max_size};
-  gzip.set_output(message.prepare_append());
-  auto r_state = gzip.run();
-  if (r_state.is_error()) {
-    return BufferSlice();
+namespace {
+// deflate state takes a few hundred kilobytes, so it is allocated once per thread and reset between calls
+class GzipEncoder {
+ public:
+  GzipEncoder() {
+    std::memset(&stream_, 0, sizeof(stream_));
+    is_inited_ = deflateInit2(&stream_, 6, Z_DEFLATED, 15, MAX_MEM_LEVEL, Z_DEFAULT_STRATEGY) == Z_OK;
+    LOG_IF(ERROR, !is_inited_) << "zlib deflate init failed";
   }
-  auto state = r_state.ok();
-  if (state != Gzip::Done) {
-    return BufferSlice();
+  GzipEncoder(const GzipEncoder &other) = delete;
+  GzipEncoder &operator=(const GzipEncoder &other) = delete;
+  GzipEncoder(GzipEncoder &&other) = delete;
+  GzipEncoder &operator=(GzipEncoder &&other) = delete;
+  ~GzipEncoder() {
+    if (is_inited_) {
+      deflateEnd(&stream_);
+    }
   }
-  message.confirm_append(gzip.flush_output());
-  return message.as_buffer_slice();
+
+  BufferSlice encode(Slice s, double k) {
+    if (!is_inited_ || deflateReset(&stream_) != Z_OK) {
+      return BufferSlice();
+    }
+    CHECK(s.size() <= std::numeric_limits<uInt>::max());
+    size_t max_size = static_cast<size_t>(static_cast<double>(s.size()) * k);
+    BufferWriter message{max_size};
+    auto output = message.prepare_append();
+    CHECK(output.size() <= std::numeric_limits<uInt>::max());
+    stream_.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(s.data()));
+    stream_.avail_in = static_cast<uInt>(s.size());
+    stream_.next_out = reinterpret_cast<Bytef *>(output.data());
+    stream_.avail_out = static_cast<uInt>(output.size());
+    if (deflate(&stream_, Z_FINISH) != Z_STREAM_END) {
+      // the output doesn't fit, the stream will be reset before the next use
+      return BufferSlice();
+    }
+    message.confirm_append(output.size() - stream_.avail_out);
+    return message.as_buffer_slice();
+  }
+
+ private:
+  z_stream stream_;
+  bool is_inited_ = false;
+};
+}  // namespace
+
+BufferSlice gzencode(Slice s, double k) {
+  static TD_THREAD_LOCAL GzipEncoder *encoder;  // static zero-initialized
+  init_thread_local<GzipEncoder>(encoder);
+  return encoder->encode(s, k);
 }
 
 }  // namespace td
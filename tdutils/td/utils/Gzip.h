@@ -97,6 +97,7 @@ class Gzip {
 
 BufferSlice gzdecode(Slice s);
 
+// returns empty BufferSlice if the data can't be compressed to at most k of its size; thread-safe
 BufferSlice gzencode(Slice s, double k = 0.9);
 
 }  // namespace td
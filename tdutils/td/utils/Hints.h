@@ -6,71 +6,255 @@
 //
 #pragma once
 
+#include "td/utils/ChunkedSortedMap.h"
 #include "td/utils/common.h"
+#include "td/utils/logging.h"
+#include "td/utils/misc.h"
 #include "td/utils/Slice.h"
 
-#include <map>
+#include <algorithm>
 #include <unordered_map>
 #include <utility>
 
 namespace td {
 
-// TODO template KeyT
-class Hints {
-  using KeyT = int64;
-  using RatingT = int64;
+namespace detail {
+// returns sorted normalized words of the name, which aren't prefixes of other words
+vector<string> get_hints_words(Slice name);
+}  // namespace detail
 
+// Prefix search of keys by words of their names. Words are stored in a sorted chunked array, each word with
+// a sorted posting list of keys, so multi-word queries are answered by intersection of the posting lists.
+template <class KeyT, class RatingT>
+class Hints {
  public:
-  void add(KeyT key, Slice name);
+  void add(KeyT key, Slice name) {
+    auto it = keys_.find(key);
+    if (it != keys_.end()) {
+      if (it->second.name == name && !name.empty()) {
+        return;
+      }
+      for (auto &old_word : it->second.words) {
+        auto keys = word_to_keys_.find(old_word);
+        CHECK(keys != nullptr);
+        auto key_it = std::lower_bound(keys->begin(), keys->end(), key);
+        CHECK(key_it != keys->end() && *key_it == key);
+        if (keys->size() == 1) {
+          word_to_keys_.extract(old_word);
+        } else {
+          keys->erase(key_it);
+        }
+      }
+      if (!it->second.name.empty()) {
+        key_count_--;
+      }
+    }
+    if (name.empty()) {
+      if (it != keys_.end()) {
+        keys_.erase(it);
+      }
+      return;
+    }
+    auto words = detail::get_hints_words(name);
+    for (auto &word : words) {
+      auto keys = word_to_keys_.insert(word, vector<KeyT>()).first;
+      auto key_it = std::lower_bound(keys->begin(), keys->end(), key);
+      CHECK(key_it == keys->end() || *key_it != key);
+      keys->insert(key_it, key);
+    }
+    auto &key_info = keys_[key];
+    key_info.name = name.str();
+    key_info.words = std::move(words);
+    key_count_++;
+  }
 
   void remove(KeyT key) {
     add(key, "");
   }
 
-  void set_rating(KeyT key, RatingT rating);
+  void set_rating(KeyT key, RatingT rating) {
+    keys_[key].rating = rating;
+  }
 
   std::pair<size_t, vector<KeyT>> search(
       Slice query, int32 limit,
-      bool return_all_for_empty_query = false) const;  // TODO sort by name instead of sort by rating
+      bool return_all_for_empty_query = false) const {  // TODO sort by name instead of sort by rating
+    if (limit < 0) {
+      return {key_count_, vector<KeyT>()};
+    }
+
+    vector<KeyT> results;
+    auto words = detail::get_hints_words(query);
+    if (words.empty()) {
+      if (return_all_for_empty_query) {
+        results.reserve(key_count_);
+        for (auto &it : keys_) {
+          if (!it.second.name.empty()) {
+            results.push_back(it.first);
+          }
+        }
+      }
+      return get_top_by_rating(std::move(results), limit);
+    }
 
-  bool has_key(KeyT key) const;
+    vector<vector<KeyT>> word_keys;
+    word_keys.reserve(words.size());
+    for (auto &word : words) {
+      word_keys.push_back(search_word(word));
+      if (word_keys.back().empty()) {
+        return {0, vector<KeyT>()};
+      }
+    }
 
-  string key_to_string(KeyT key) const;
+    // intersect starting from the shortest lists to keep intermediate results small
+    std::sort(word_keys.begin(), word_keys.end(),
+              [](const vector<KeyT> &lhs, const vector<KeyT> &rhs) { return lhs.size() < rhs.size(); });
+    results = std::move(word_keys[0]);
+    for (size_t i = 1; i < word_keys.size() && !results.empty(); i++) {
+      intersect(results, word_keys[i]);
+    }
+
+    return get_top_by_rating(std::move(results), limit);
+  }
 
-  std::pair<size_t, vector<KeyT>> search_empty(int32 limit) const;  // == search("", limit, true)
+  bool has_key(KeyT key) const {
+    auto it = keys_.find(key);
+    return it != keys_.end() && !it->second.name.empty();
+  }
+
+  string key_to_string(KeyT key) const {
+    auto it = keys_.find(key);
+    if (it == keys_.end()) {
+      return string();
+    }
+    return it->second.name;
+  }
+
+  std::pair<size_t, vector<KeyT>> search_empty(int32 limit) const {  // == search("", limit, true)
+    return search(Slice(), limit, true);
+  }
 
-  size_t size() const;
+  // searches only among the given keys, returns all of the known given keys for an empty query
+  // words of each given key are checked directly, so the time doesn't depend on the total number of keys
+  std::pair<size_t, vector<KeyT>> search_among(Slice query, int32 limit, vector<KeyT> keys) const {
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+    keys.erase(std::remove_if(keys.begin(), keys.end(), [this](KeyT key) { return !has_key(key); }), keys.end());
+
+    if (limit < 0) {
+      return {keys.size(), vector<KeyT>()};
+    }
+
+    auto words = detail::get_hints_words(query);
+    if (!words.empty()) {
+      keys.erase(std::remove_if(keys.begin(), keys.end(),
+                                [&](KeyT key) { return !has_all_words(keys_.find(key)->second.words, words); }),
+                 keys.end());
+    }
+
+    return get_top_by_rating(std::move(keys), limit);
+  }
+
+  size_t size() const {
+    return key_count_;
+  }
 
  private:
-  std::map<string, vector<KeyT>> word_to_keys_;
-  std::unordered_map<KeyT, string> key_to_name_;
-  std::unordered_map<KeyT, RatingT> key_to_rating_;
+  struct KeyInfo {
+    string name;           // empty if the key has only a rating
+    vector<string> words;  // detail::get_hints_words(name)
+    RatingT rating = RatingT();
+  };
 
-  static vector<string> get_words(Slice name);
+  ChunkedSortedMap<string, vector<KeyT>> word_to_keys_;  // word -> sorted keys, whose names contain the word
+  std::unordered_map<KeyT, KeyInfo> keys_;
+  size_t key_count_ = 0;  // number of keys with non-empty name
 
-  vector<KeyT> search_word(const string &word) const;
+  // returns sorted keys having a word with the given prefix
+  vector<KeyT> search_word(const string &word) const {
+    vector<KeyT> results;
+    size_t list_count = 0;
+    for (auto it = word_to_keys_.find_greater_or_equal(word); it && begins_with(it.key(), word); ++it) {
+      results.insert(results.end(), it.value().begin(), it.value().end());
+      list_count++;
+    }
 
-  class CompareByRating {
-    const std::unordered_map<KeyT, RatingT> &key_to_rating_;
+    if (list_count > 1) {
+      std::sort(results.begin(), results.end());
+      results.erase(std::unique(results.begin(), results.end()), results.end());
+    }
+    return results;
+  }
 
-    RatingT get_rating(const KeyT &key) const {
-      auto it = key_to_rating_.find(key);
-      if (it == key_to_rating_.end()) {
-        return RatingT();
+  // checks that each of the query words is a prefix of some of the sorted words
+  static bool has_all_words(const vector<string> &words, const vector<string> &query_words) {
+    for (auto &query_word : query_words) {
+      auto it = std::lower_bound(words.begin(), words.end(), query_word);
+      if (it == words.end() || !begins_with(*it, query_word)) {
+        return false;
       }
-      return it->second;
     }
+    return true;
+  }
 
-   public:
-    explicit CompareByRating(const std::unordered_map<KeyT, RatingT> &key_to_rating) : key_to_rating_(key_to_rating) {
+  static void intersect(vector<KeyT> &results, const vector<KeyT> &keys) {
+    size_t results_pos = 0;
+    size_t keys_pos = 0;
+    size_t new_results_size = 0;
+    while (results_pos != results.size() && keys_pos != keys.size()) {
+      if (results[results_pos] < keys[keys_pos]) {
+        results_pos++;
+      } else if (keys[keys_pos] < results[results_pos]) {
+        keys_pos++;
+      } else {
+        results[new_results_size++] = results[results_pos];
+        results_pos++;
+        keys_pos++;
+      }
     }
+    results.resize(new_results_size);
+  }
 
-    bool operator()(const KeyT &lhs, const KeyT &rhs) const {
-      auto lhs_rating = get_rating(lhs);
-      auto rhs_rating = get_rating(rhs);
-      return lhs_rating < rhs_rating || (lhs_rating == rhs_rating && lhs < rhs);
+  RatingT get_rating(const KeyT &key) const {
+    auto it = keys_.find(key);
+    if (it == keys_.end()) {
+      return RatingT();
     }
-  };
+    return it->second.rating;
+  }
+
+  // returns total number of keys and at most limit keys with the least ratings in order of increasing rating
+  std::pair<size_t, vector<KeyT>> get_top_by_rating(vector<KeyT> keys, int32 limit) const {
+    auto total_size = keys.size();
+    auto result_size = std::min(total_size, static_cast<size_t>(limit));
+    if (result_size == 0) {
+      return {total_size, vector<KeyT>()};
+    }
+
+    // rating is looked up once per key; the heap keeps the best result_size keys with the worst of them on top
+    vector<std::pair<RatingT, KeyT>> top;
+    top.reserve(result_size);
+    for (auto &key : keys) {
+      std::pair<RatingT, KeyT> item(get_rating(key), key);
+      if (top.size() < result_size) {
+        top.push_back(std::move(item));
+        if (top.size() == result_size) {
+          std::make_heap(top.begin(), top.end());
+        }
+      } else if (item < top[0]) {
+        std::pop_heap(top.begin(), top.end());
+        top.back() = std::move(item);
+        std::push_heap(top.begin(), top.end());
+      }
+    }
+    std::sort_heap(top.begin(), top.end());
+
+    keys.resize(result_size);
+    for (size_t i = 0; i < result_size; i++) {
+      keys[i] = std::move(top[i].second);
+    }
+    return {total_size, std::move(keys)};
+  }
 };
 
 }  // namespace td
@@ -0,0 +1,231 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2017
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "td/utils/common.h"
+#include "td/utils/logging.h"
+
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace td {
+
+// Hash map without per-element allocations, which never moves stored values.
+// Values are constructed in place in a slab of fixed-size chunks and freed slots are reused.
+// Keys are indexed by an open addressing hash table with linear probing, which stores only keys and slot numbers.
+// KeyT() can't be used as a key.
+template <class KeyT, class ValueT, class HashT = std::hash<KeyT>>
+class SlabMap {
+  struct Node {
+    KeyT key;
+    ValueT value;
+
+    template <class... ArgsT>
+    explicit Node(KeyT key, ArgsT &&... args) : key(std::move(key)), value(std::forward<ArgsT>(args)...) {
+    }
+  };
+  using NodeStorage = typename std::aligned_storage<sizeof(Node), alignof(Node)>::type;
+
+  struct Bucket {
+    KeyT key{};
+    uint32 slot = 0;
+  };
+
+ public:
+  SlabMap() = default;
+  SlabMap(const SlabMap &other) = delete;
+  SlabMap &operator=(const SlabMap &other) = delete;
+  SlabMap(SlabMap &&other) = default;
+  SlabMap &operator=(SlabMap &&other) {
+    clear();
+    chunks_ = std::move(other.chunks_);
+    free_slots_ = std::move(other.free_slots_);
+    used_slot_count_ = other.used_slot_count_;
+    buckets_ = std::move(other.buckets_);
+    size_ = other.size_;
+    other.used_slot_count_ = 0;
+    other.size_ = 0;
+    return *this;
+  }
+  ~SlabMap() {
+    clear();
+  }
+
+  size_t size() const {
+    return size_;
+  }
+
+  bool empty() const {
+    return size_ == 0;
+  }
+
+  ValueT *find(const KeyT &key) {
+    return const_cast<ValueT *>(static_cast<const SlabMap *>(this)->find(key));
+  }
+
+  const ValueT *find(const KeyT &key) const {
+    auto bucket_pos = find_bucket(key);
+    if (bucket_pos == buckets_.size()) {
+      return nullptr;
+    }
+    return &get_node(buckets_[bucket_pos].slot).value;
+  }
+
+  // returns pointer to the value with the given key and whether the value was inserted
+  template <class... ArgsT>
+  std::pair<ValueT *, bool> emplace(KeyT key, ArgsT &&... args) {
+    CHECK(!is_empty_key(key));
+    auto value = find(key);
+    if (value != nullptr) {
+      return {value, false};
+    }
+
+    if ((size_ + 1) * 2 > buckets_.size()) {
+      resize(buckets_.empty() ? MIN_BUCKET_COUNT : buckets_.size() * 2);
+    }
+
+    uint32 slot;
+    if (!free_slots_.empty()) {
+      slot = free_slots_.back();
+      free_slots_.pop_back();
+    } else {
+      slot = used_slot_count_++;
+      if (slot % CHUNK_SIZE == 0) {
+        chunks_.push_back(make_unique<NodeStorage[]>(CHUNK_SIZE));
+      }
+    }
+    auto node = new (&chunks_[slot / CHUNK_SIZE][slot % CHUNK_SIZE]) Node(key, std::forward<ArgsT>(args)...);
+    insert_bucket(Bucket{std::move(key), slot});
+    size_++;
+    return {&node->value, true};
+  }
+
+  // returns whether the value was erased
+  bool erase(const KeyT &key) {
+    auto bucket_pos = find_bucket(key);
+    if (bucket_pos == buckets_.size()) {
+      return false;
+    }
+    auto slot = buckets_[bucket_pos].slot;
+    erase_bucket(bucket_pos);
+    get_node(slot).~Node();
+    free_slots_.push_back(slot);
+    size_--;
+    return true;
+  }
+
+  // calls f(key, value) for each value in unspecified order; the map must not be changed inside of f
+  template <class F>
+  void for_each(F &&f) {
+    for (auto &bucket : buckets_) {
+      if (!is_empty_key(bucket.key)) {
+        f(bucket.key, get_node(bucket.slot).value);
+      }
+    }
+  }
+
+  void clear() {
+    for (auto &bucket : buckets_) {
+      if (!is_empty_key(bucket.key)) {
+        get_node(bucket.slot).~Node();
+      }
+    }
+    chunks_.clear();
+    free_slots_.clear();
+    used_slot_count_ = 0;
+    buckets_.clear();
+    size_ = 0;
+  }
+
+ private:
+  static constexpr uint32 CHUNK_SIZE = 256;
+  static constexpr size_t MIN_BUCKET_COUNT = 16;
+
+  vector<unique_ptr<NodeStorage[]>> chunks_;
+  vector<uint32> free_slots_;
+  uint32 used_slot_count_ = 0;
+  vector<Bucket> buckets_;  // size is a power of 2 and at least twice as big as the number of values
+  size_t size_ = 0;
+
+  static bool is_empty_key(const KeyT &key) {
+    return key == KeyT();
+  }
+
+  Node &get_node(uint32 slot) {
+    return *reinterpret_cast<Node *>(&chunks_[slot / CHUNK_SIZE][slot % CHUNK_SIZE]);
+  }
+  const Node &get_node(uint32 slot) const {
+    return *reinterpret_cast<const Node *>(&chunks_[slot / CHUNK_SIZE][slot % CHUNK_SIZE]);
+  }
+
+  size_t get_bucket_pos(const KeyT &key) const {
+    // keys can have equal low bits, for example, message identifiers are divisible by 4, so hash values are mixed
+    auto hash = static_cast<uint64>(HashT()(key)) * static_cast<uint64>(0x9E3779B97F4A7C15);
+    return static_cast<size_t>(hash >> 32) & (buckets_.size() - 1);
+  }
+
+  // returns buckets_.size() if there is no such key
+  size_t find_bucket(const KeyT &key) const {
+    if (buckets_.empty() || is_empty_key(key)) {
+      return buckets_.size();
+    }
+    auto mask = buckets_.size() - 1;
+    for (auto pos = get_bucket_pos(key);; pos = (pos + 1) & mask) {
+      auto &bucket = buckets_[pos];
+      if (bucket.key == key) {
+        return pos;
+      }
+      if (is_empty_key(bucket.key)) {
+        return buckets_.size();
+      }
+    }
+  }
+
+  void insert_bucket(Bucket bucket) {
+    auto mask = buckets_.size() - 1;
+    auto pos = get_bucket_pos(bucket.key);
+    while (!is_empty_key(buckets_[pos].key)) {
+      pos = (pos + 1) & mask;
+    }
+    buckets_[pos] = std::move(bucket);
+  }
+
+  // shifts back following buckets to keep all keys reachable from their initial positions
+  void erase_bucket(size_t pos) {
+    auto mask = buckets_.size() - 1;
+    auto next_pos = pos;
+    while (true) {
+      next_pos = (next_pos + 1) & mask;
+      auto &bucket = buckets_[next_pos];
+      if (is_empty_key(bucket.key)) {
+        break;
+      }
+      auto initial_pos = get_bucket_pos(bucket.key);
+      bool can_stay = pos <= next_pos ? pos < initial_pos && initial_pos <= next_pos
+                                      : pos < initial_pos || initial_pos <= next_pos;
+      if (!can_stay) {
+        buckets_[pos] = std::move(bucket);
+        pos = next_pos;
+      }
+    }
+    buckets_[pos] = Bucket();
+  }
+
+  void resize(size_t bucket_count) {
+    auto old_buckets = std::move(buckets_);
+    buckets_ = vector<Bucket>(bucket_count);
+    for (auto &bucket : old_buckets) {
+      if (!is_empty_key(bucket.key)) {
+        insert_bucket(std::move(bucket));
+      }
+    }
+  }
+};
+
+}  // namespace td
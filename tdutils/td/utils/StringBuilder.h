@@ -30,6 +30,7 @@ class StringBuilder {
   void clear() {
     current_ptr_ = begin_ptr_;
     error_flag_ = false;
+    lost_size_ = 0;
   }
   MutableCSlice as_cslice() {
     if (current_ptr_ >= end_ptr_ + reserved_size) {
@@ -43,17 +44,22 @@ class StringBuilder {
     return error_flag_;
   }
 
+  // size of the whole output including the part, which didn't fit into the buffer
+  size_t get_required_size() const {
+    return static_cast<size_t>(current_ptr_ - begin_ptr_) + lost_size_;
+  }
+
   StringBuilder &operator<<(const char *str) {
     return *this << Slice(str);
   }
 
   StringBuilder &operator<<(Slice slice) {
     if (unlikely(end_ptr_ < current_ptr_)) {
-      return on_error();
+      return on_error(slice.size());
     }
     auto size = static_cast<size_t>(end_ptr_ + reserved_size - 1 - current_ptr_);
     if (unlikely(slice.size() > size)) {
-      error_flag_ = true;
+      on_error(slice.size() - size);
     } else {
       size = slice.size();
     }
@@ -68,7 +74,7 @@ class StringBuilder {
 
   StringBuilder &operator<<(char c) {
     if (unlikely(end_ptr_ < current_ptr_)) {
-      return on_error();
+      return on_error(1);
     }
     *current_ptr_++ = c;
     return *this;
@@ -84,61 +90,37 @@ class StringBuilder {
 
   // TODO: optimize
   StringBuilder &operator<<(int x) {
-    if (unlikely(end_ptr_ < current_ptr_)) {
-      return on_error();
-    }
-    current_ptr_ += std::snprintf(current_ptr_, reserved_size, "%d", x);
-    return *this;
+    return print("%d", x);
   }
 
   StringBuilder &operator<<(unsigned int x) {
-    if (unlikely(end_ptr_ < current_ptr_)) {
-      return on_error();
-    }
-    current_ptr_ += std::snprintf(current_ptr_, reserved_size, "%u", x);
-    return *this;
+    return print("%u", x);
   }
 
   StringBuilder &operator<<(long int x) {
-    if (unlikely(end_ptr_ < current_ptr_)) {
-      return on_error();
-    }
-    current_ptr_ += std::snprintf(current_ptr_, reserved_size, "%ld", x);
-    return *this;
+    return print("%ld", x);
   }
 
   StringBuilder &operator<<(long unsigned int x) {
-    if (unlikely(end_ptr_ < current_ptr_)) {
-      return on_error();
-    }
-    current_ptr_ += std::snprintf(current_ptr_, reserved_size, "%lu", x);
-    return *this;
+    return print("%lu", x);
   }
 
   StringBuilder &operator<<(long long int x) {
-    if (unlikely(end_ptr_ < current_ptr_)) {
-      return on_error();
-    }
-    current_ptr_ += std::snprintf(current_ptr_, reserved_size, "%lld", x);
-    return *this;
+    return print("%lld", x);
   }
 
   StringBuilder &operator<<(long long unsigned int x) {
-    if (unlikely(end_ptr_ < current_ptr_)) {
-      return on_error();
-    }
-    current_ptr_ += std::snprintf(current_ptr_, reserved_size, "%llu", x);
-    return *this;
+    return print("%llu", x);
   }
 
   StringBuilder &operator<<(double x) {
     if (unlikely(end_ptr_ < current_ptr_)) {
-      return on_error();
+      return on_error(static_cast<size_t>(std::snprintf(nullptr, 0, "%lf", x)));
     }
     auto left = end_ptr_ + reserved_size - current_ptr_;
     int len = std::snprintf(current_ptr_, left, "%lf", x);
     if (unlikely(len >= left)) {
-      error_flag_ = true;
+      on_error(static_cast<size_t>(len - (left - 1)));
       current_ptr_ += left - 1;
     } else {
       current_ptr_ += len;
@@ -148,23 +130,19 @@ class StringBuilder {
 
   template <class T>
   StringBuilder &operator<<(const T *ptr) {
-    if (unlikely(end_ptr_ < current_ptr_)) {
-      return on_error();
-    }
-    current_ptr_ += std::snprintf(current_ptr_, reserved_size, "%p", ptr);
-    return *this;
+    return print("%p", ptr);
   }
 
   void vprintf(const char *fmt, va_list list) {
     if (unlikely(end_ptr_ < current_ptr_)) {
-      on_error();
+      on_error(static_cast<size_t>(std::vsnprintf(nullptr, 0, fmt, list)));
       return;
     }
 
     auto left = end_ptr_ + reserved_size - current_ptr_;
     int len = std::vsnprintf(current_ptr_, left, fmt, list);
     if (unlikely(len >= left)) {
-      error_flag_ = true;
+      on_error(static_cast<size_t>(len - (left - 1)));
       current_ptr_ += left - 1;
     } else {
       current_ptr_ += len;
@@ -183,10 +161,21 @@ class StringBuilder {
   char *current_ptr_;
   char *end_ptr_;
   bool error_flag_ = false;
+  size_t lost_size_ = 0;
   static constexpr size_t reserved_size = 30;
 
-  StringBuilder &on_error() {
+  StringBuilder &on_error(size_t lost_size) {
     error_flag_ = true;
+    lost_size_ += lost_size;
+    return *this;
+  }
+
+  template <class T>
+  StringBuilder &print(const char *fmt, T x) {
+    if (unlikely(end_ptr_ < current_ptr_)) {
+      return on_error(static_cast<size_t>(std::snprintf(nullptr, 0, fmt, x)));
+    }
+    current_ptr_ += std::snprintf(current_ptr_, reserved_size, fmt, x);
     return *this;
   }
 };
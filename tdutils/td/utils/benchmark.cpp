@@ -0,0 +1,304 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2017
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/utils/benchmark.h"
+
+#include "td/utils/JsonBuilder.h"
+#include "td/utils/misc.h"
+#include "td/utils/StringBuilder.h"
+
+#if TD_PORT_POSIX
+#include <sys/resource.h>
+#include <sys/time.h>
+#endif
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <tuple>
+
+namespace td {
+
+namespace {
+
+struct BenchmarkState {
+  string current_suite;
+  vector<string> suite_filters;
+  vector<string> substr_filters;
+  bool is_csv_header_printed = false;
+};
+
+BenchmarkState &get_benchmark_state() {
+  static BenchmarkState state;
+  return state;
+}
+
+bool has_context_switch_count() {
+#if TD_PORT_POSIX
+  return true;
+#else
+  return false;
+#endif
+}
+
+uint64 get_context_switch_count() {
+#if TD_PORT_POSIX
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) == 0) {
+    return static_cast<uint64>(usage.ru_nvcsw) + static_cast<uint64>(usage.ru_nivcsw);
+  }
+#endif
+  return 0;
+}
+
+uint64 get_allocation_count() {
+  auto get_count = get_benchmark_options().get_allocation_count;
+  if (get_count == nullptr) {
+    return 0;
+  }
+  return get_count();
+}
+
+bool is_benchmark_filtered_out(const string &description) {
+  for (const auto &filter : get_benchmark_state().substr_filters) {
+    bool is_match = description.find(filter.substr(1)) != string::npos;
+    if (is_match != (filter[0] == '+')) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// nearest-rank percentile of sorted values
+double get_percentile(const vector<double> &sorted_values, double percentile) {
+  CHECK(!sorted_values.empty());
+  auto rank = static_cast<size_t>(std::ceil(percentile / 100.0 * static_cast<double>(sorted_values.size())));
+  if (rank == 0) {
+    rank = 1;
+  }
+  return sorted_values[std::min(rank, sorted_values.size()) - 1];
+}
+
+string escape_csv(const string &str) {
+  if (str.find_first_of(",\"\n") == string::npos) {
+    return str;
+  }
+  string result = "\"";
+  for (auto c : str) {
+    if (c == '"') {
+      result += '"';
+    }
+    result += c;
+  }
+  result += '"';
+  return result;
+}
+
+void print_benchmark_result(const BenchmarkResult &result) {
+  switch (get_benchmark_options().output_format) {
+    case BenchmarkOptions::OutputFormat::Text: {
+      string counters;
+      if (result.allocations_per_op >= 0) {
+        counters += PSTRING("[allocs = %.3lf]", result.allocations_per_op);
+      }
+      if (result.context_switches_per_op >= 0) {
+        counters += PSTRING("[cs = %.6lf]", result.context_switches_per_op);
+      }
+      LOG(ERROR, "Bench [%40s]:\t%.3lf[%.3lf-%.3lf] ops/sec,\t", result.description.c_str(), result.ops_per_sec,
+          result.min_ops_per_sec, result.max_ops_per_sec)
+          << format::as_time(1 / result.ops_per_sec) << (PSLICE(" [d = %.6lf]", result.ops_per_sec_deviation))
+          << "[run median = " << format::as_time(result.run_median_ns * 1e-9)
+          << "][run max = " << format::as_time(result.run_max_ns * 1e-9) << "]" << counters;
+      break;
+    }
+    case BenchmarkOptions::OutputFormat::Json: {
+      string buf(1 << 14, '\0');
+      JsonBuilder jb(StringBuilder{MutableSlice(buf)});
+      {
+        auto jo = jb.enter_object();
+        jo << ctie("suite", result.suite);
+        jo << ctie("name", result.description);
+        jo << ctie("n", result.n);
+        jo << ctie("runs", result.run_count);
+        jo << ctie("ops_per_sec", result.ops_per_sec);
+        jo << ctie("min_ops_per_sec", result.min_ops_per_sec);
+        jo << ctie("max_ops_per_sec", result.max_ops_per_sec);
+        jo << ctie("ops_per_sec_deviation", result.ops_per_sec_deviation);
+        jo << ctie("run_median_ns", result.run_median_ns);
+        jo << ctie("run_max_ns", result.run_max_ns);
+        if (result.allocations_per_op >= 0) {
+          jo << ctie("allocations_per_op", result.allocations_per_op);
+        }
+        if (result.context_switches_per_op >= 0) {
+          jo << ctie("context_switches_per_op", result.context_switches_per_op);
+        }
+      }
+      auto &sb = jb.string_builder();
+      LOG_IF(ERROR, sb.is_error()) << "Benchmark result is too big";
+      std::printf("%s\n", sb.as_cslice().c_str());
+      std::fflush(stdout);
+      break;
+    }
+    case BenchmarkOptions::OutputFormat::Csv: {
+      auto &state = get_benchmark_state();
+      if (!state.is_csv_header_printed) {
+        state.is_csv_header_printed = true;
+        std::printf(
+            "suite,name,n,runs,ops_per_sec,min_ops_per_sec,max_ops_per_sec,ops_per_sec_deviation,run_median_ns,run_max_ns,"
+            "allocations_per_op,context_switches_per_op\n");
+      }
+      auto optional_value = [](double value) { return value >= 0 ? PSTRING() << value : string(); };
+      string line = PSTRING() << escape_csv(result.suite) << ',' << escape_csv(result.description) << ','
+                              << result.n << ',' << result.run_count << ',' << result.ops_per_sec << ','
+                              << result.min_ops_per_sec << ',' << result.max_ops_per_sec << ','
+                              << result.ops_per_sec_deviation << ',' << result.run_median_ns << ',' << result.run_max_ns
+                              << ',' << optional_value(result.allocations_per_op) << ','
+                              << optional_value(result.context_switches_per_op);
+      std::printf("%s\n", line.c_str());
+      std::fflush(stdout);
+      break;
+    }
+    default:
+      UNREACHABLE();
+  }
+}
+
+}  // namespace
+
+BenchmarkOptions &get_benchmark_options() {
+  static BenchmarkOptions options;
+  return options;
+}
+
+BenchmarkPass bench_pass(Benchmark &b, int n) {
+  BenchmarkPass pass;
+  pass.total_time = -Clocks::monotonic();
+  b.start_up_n(n);
+  auto allocation_count = get_allocation_count();
+  auto context_switch_count = get_context_switch_count();
+  pass.run_time = -Clocks::monotonic();
+  b.run(n);
+  pass.run_time += Clocks::monotonic();
+  pass.allocation_count = get_allocation_count() - allocation_count;
+  pass.context_switch_count = get_context_switch_count() - context_switch_count;
+  b.tear_down();
+  pass.total_time += Clocks::monotonic();
+  return pass;
+}
+
+void bench(Benchmark &b, double max_time) {
+  const auto &options = get_benchmark_options();
+  auto description = b.get_description();
+  if (is_benchmark_filtered_out(description)) {
+    return;
+  }
+  if (options.list_only) {
+    std::printf("%s\n", description.c_str());
+    return;
+  }
+  if (options.max_time > 0) {
+    max_time = options.max_time;
+  }
+
+  // calibration passes also serve as a warm-up
+  int n = 1;
+  double pass_time = 0;
+  double total_pass_time = 0;
+  while (pass_time < max_time && total_pass_time < max_time * 3 && n < (1 << 30)) {
+    n *= 2;
+    std::tie(pass_time, total_pass_time) = bench_n(b, n);
+  }
+  for (int i = 0; i < options.warmup_count; i++) {
+    bench_pass(b, n);
+  }
+
+  int run_count = std::max(options.run_count, 1);
+  vector<double> op_times;
+  double sum = 0;
+  double square_sum = 0;
+  double min_ops_per_sec = 0;
+  double max_ops_per_sec = 0;
+  uint64 allocation_count = 0;
+  uint64 context_switch_count = 0;
+  for (int i = 0; i < run_count; i++) {
+    auto pass = bench_pass(b, n);
+    auto ops_per_sec = n / pass.run_time;
+    sum += ops_per_sec;
+    square_sum += ops_per_sec * ops_per_sec;
+    if (i == 0 || ops_per_sec < min_ops_per_sec) {
+      min_ops_per_sec = ops_per_sec;
+    }
+    if (i == 0 || ops_per_sec > max_ops_per_sec) {
+      max_ops_per_sec = ops_per_sec;
+    }
+    op_times.push_back(pass.run_time / n);
+    allocation_count += pass.allocation_count;
+    context_switch_count += pass.context_switch_count;
+  }
+  std::sort(op_times.begin(), op_times.end());
+
+  BenchmarkResult result;
+  result.suite = get_benchmark_state().current_suite;
+  result.description = std::move(description);
+  result.n = n;
+  result.run_count = run_count;
+  result.ops_per_sec = sum / run_count;
+  result.min_ops_per_sec = min_ops_per_sec;
+  result.max_ops_per_sec = max_ops_per_sec;
+  result.ops_per_sec_deviation =
+      std::sqrt(std::max(square_sum / run_count - result.ops_per_sec * result.ops_per_sec, 0.0));
+  result.run_median_ns = get_percentile(op_times, 50) * 1e9;
+  result.run_max_ns = op_times.back() * 1e9;
+  auto total_ops = static_cast<double>(n) * run_count;
+  if (options.get_allocation_count != nullptr) {
+    result.allocations_per_op = static_cast<double>(allocation_count) / total_ops;
+  }
+  if (has_context_switch_count()) {
+    result.context_switches_per_op = static_cast<double>(context_switch_count) / total_ops;
+  }
+  print_benchmark_result(result);
+}
+
+BenchmarkSuite::BenchmarkSuite(CSlice name, void (*run)()) : name_(name), run_(run) {
+  get_suites_list()->put_back(this);
+}
+
+void BenchmarkSuite::add_suite_filter(string str) {
+  get_benchmark_state().suite_filters.push_back(std::move(str));
+}
+
+void BenchmarkSuite::add_substr_filter(string str) {
+  if (str[0] != '+' && str[0] != '-') {
+    str = "+" + str;
+  }
+  get_benchmark_state().substr_filters.push_back(std::move(str));
+}
+
+void BenchmarkSuite::run_all() {
+  auto &state = get_benchmark_state();
+  auto end = get_suites_list();
+  for (auto it = end->next; it != end; it = it->next) {
+    auto suite = static_cast<BenchmarkSuite *>(it);
+    if (!state.suite_filters.empty() &&
+        std::find(state.suite_filters.begin(), state.suite_filters.end(), suite->name_.str()) ==
+            state.suite_filters.end()) {
+      continue;
+    }
+    state.current_suite = suite->name_.str();
+    // suites change verbosity level for themselves only
+    auto verbosity_level = GET_VERBOSITY_LEVEL();
+    suite->run_();
+    SET_VERBOSITY_LEVEL(verbosity_level);
+  }
+  state.current_suite.clear();
+}
+
+ListNode *BenchmarkSuite::get_suites_list() {
+  static ListNode root;
+  return &root;
+}
+
+}  // namespace td
@@ -6,9 +6,12 @@
 //
 #pragma once
 
+#include "td/utils/common.h"
 #include "td/utils/format.h"
+#include "td/utils/List.h"
 #include "td/utils/logging.h"
 #include "td/utils/port/Clocks.h"
+#include "td/utils/Slice.h"
 
 #include <cmath>
 #include <tuple>
@@ -24,6 +27,12 @@
   };                                               \
   void name##Bench::run(int n)
 
+#define BENCHMARK_SUITE(name)                                                                           \
+  static void TD_CONCAT(run_benchmark_suite_, name)();                                                  \
+  static ::td::BenchmarkSuite TD_CONCAT(benchmark_suite_, name)(TD_DEFINE_STR(name),                    \
+                                                                TD_CONCAT(run_benchmark_suite_, name)); \
+  static void TD_CONCAT(run_benchmark_suite_, name)()
+
 namespace td {
 
 #if TD_MSVC
@@ -67,59 +76,78 @@ class Benchmark {
   virtual void run(int n) = 0;
 };
 
+struct BenchmarkOptions {
+  enum class OutputFormat : int32 { Text, Json, Csv };
+  OutputFormat output_format = OutputFormat::Text;
+  double max_time = 0.0;  // overrides max_time passed to bench if positive
+  int32 warmup_count = 0;
+  int32 run_count = 5;
+  bool list_only = false;
+  // if set, it must return total number of memory allocations made by the process
+  uint64 (*get_allocation_count)() = nullptr;
+};
+
+struct BenchmarkResult {
+  string suite;
+  string description;
+  int n = 0;
+  int32 run_count = 0;
+  double ops_per_sec = 0.0;
+  double min_ops_per_sec = 0.0;
+  double max_ops_per_sec = 0.0;
+  double ops_per_sec_deviation = 0.0;
+  // operations aren't timed individually, so these are statistics across runs, not per-operation percentiles
+  double run_median_ns = 0.0;  // median of average operation times of the runs
+  double run_max_ns = 0.0;     // maximum of average operation times of the runs
+  double allocations_per_op = -1.0;       // negative if unknown
+  double context_switches_per_op = -1.0;  // negative if unknown
+};
+
+struct BenchmarkPass {
+  double run_time = 0.0;
+  double total_time = 0.0;
+  uint64 allocation_count = 0;
+  uint64 context_switch_count = 0;
+};
+
+BenchmarkOptions &get_benchmark_options();
+
+BenchmarkPass bench_pass(Benchmark &b, int n);
+
 inline std::pair<double, double> bench_n(Benchmark &b, int n) {
-  double total = -Clocks::monotonic();
-  b.start_up_n(n);
-  double t = -Clocks::monotonic();
-  b.run(n);
-  t += Clocks::monotonic();
-  b.tear_down();
-  total += Clocks::monotonic();
-
-  return std::make_pair(t, total);
+  auto pass = bench_pass(b, n);
+  return std::make_pair(pass.run_time, pass.total_time);
 }
 
 inline std::pair<double, double> bench_n(Benchmark &&b, int n) {
   return bench_n(b, n);
 }
 
-inline void bench(Benchmark &b, double max_time = 1.0) {
-  int n = 1;
-  double pass_time = 0;
-  double total_pass_time = 0;
-  while (pass_time < max_time && total_pass_time < max_time * 3 && n < (1 << 30)) {
-    n *= 2;
-    std::tie(pass_time, total_pass_time) = bench_n(b, n);
-  }
-  pass_time = n / pass_time;
-
-  int pass_cnt = 2;
-  double sum = pass_time;
-  double square_sum = pass_time * pass_time;
-  double min_pass_time = pass_time;
-  double max_pass_time = pass_time;
-
-  for (int i = 1; i < pass_cnt; i++) {
-    pass_time = n / bench_n(b, n).first;
-    sum += pass_time;
-    square_sum += pass_time * pass_time;
-    if (pass_time < min_pass_time) {
-      min_pass_time = pass_time;
-    }
-    if (pass_time > max_pass_time) {
-      max_pass_time = pass_time;
-    }
-  }
-  double avg = sum / pass_cnt;
-  double d = sqrt(square_sum / pass_cnt - avg * avg);
-
-  LOG(ERROR, "Bench [%40s]:\t%.3lf[%.3lf-%.3lf] ops/sec,\t", b.get_description().c_str(), avg, min_pass_time,
-      max_pass_time)
-      << format::as_time(1 / avg) << (PSLICE(" [d = %.6lf]", d));
-}
+void bench(Benchmark &b, double max_time = 1.0);
 
 inline void bench(Benchmark &&b, double max_time = 1.0) {
   bench(b, max_time);
 }
 
+// a named group of bench calls, which can be run from a common main
+class BenchmarkSuite : private ListNode {
+ public:
+  BenchmarkSuite(CSlice name, void (*run)());
+  BenchmarkSuite(const BenchmarkSuite &) = delete;
+  BenchmarkSuite &operator=(const BenchmarkSuite &) = delete;
+  BenchmarkSuite(BenchmarkSuite &&) = delete;
+  BenchmarkSuite &operator=(BenchmarkSuite &&) = delete;
+  ~BenchmarkSuite() = default;
+
+  static void add_suite_filter(string str);
+  static void add_substr_filter(string str);
+  static void run_all();
+
+ private:
+  CSlice name_;
+  void (*run_)();
+
+  static ListNode *get_suites_list();
+};
+
 }  // namespace td
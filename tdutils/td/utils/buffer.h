@@ -613,6 +613,7 @@ class ChainBufferWriter {
 
   void init(size_t size = 0) {
     writer_ = BufferWriter(size);
+    spare_writer_ = BufferWriter();
     tail_ = ChainBufferNodeAllocator::create(writer_.as_buffer_slice(), true);
     head_ = ChainBufferNodeAllocator::clone(tail_);
   }
@@ -631,14 +632,10 @@ class ChainBufferWriter {
   }
   MutableSlice prepare_append_alloc(size_t hint = 0) {
     CHECK(!empty());
-    if (hint < (1 << 10)) {
-      hint = 1 << 12;
+    if (spare_writer_.is_null() || spare_writer_.prepare_append().size() < hint) {
+      spare_writer_ = BufferWriter(get_alloc_size(hint));
     }
-    BufferWriter new_writer(hint);
-    auto new_tail = ChainBufferNodeAllocator::create(new_writer.as_buffer_slice(), true);
-    tail_->next_ = ChainBufferNodeAllocator::clone(new_tail);
-    writer_ = std::move(new_writer);
-    tail_ = std::move(new_tail);  // release tail_
+    append_spare_writer();
     return writer_.prepare_append();
   }
   void confirm_append(size_t size) {
@@ -646,6 +643,25 @@ class ChainBufferWriter {
     writer_.confirm_append(size);
   }
 
+  // Returns memory of the next buffer, which will be appended only after confirm_append_spare with non-zero size.
+  // Allows to fill the rest of the current buffer and the next buffer with a single readv.
+  MutableSlice prepare_append_spare(size_t hint = 0) {
+    CHECK(!empty());
+    if (spare_writer_.is_null()) {
+      spare_writer_ = BufferWriter(get_alloc_size(hint));
+    }
+    return spare_writer_.prepare_append();
+  }
+  void confirm_append_spare(size_t size) {
+    CHECK(!empty());
+    if (size == 0) {
+      return;
+    }
+    CHECK(!spare_writer_.is_null());
+    append_spare_writer();
+    writer_.confirm_append(size);
+  }
+
   void append(Slice slice) {
     while (!slice.empty()) {
       auto ready = prepare_append(slice.size());
@@ -691,9 +707,25 @@ class ChainBufferWriter {
     return !tail_;
   }
 
+  static size_t get_alloc_size(size_t hint) {
+    if (hint < (1 << 10)) {
+      return 1 << 12;
+    }
+    return hint;
+  }
+
+  void append_spare_writer() {
+    auto new_tail = ChainBufferNodeAllocator::create(spare_writer_.as_buffer_slice(), true);
+    tail_->next_ = ChainBufferNodeAllocator::clone(new_tail);
+    writer_ = std::move(spare_writer_);
+    spare_writer_ = BufferWriter();
+    tail_ = std::move(new_tail);  // release tail_
+  }
+
   ChainBufferNodeReaderPtr head_;
   ChainBufferNodeWriterPtr tail_;
   BufferWriter writer_;
+  BufferWriter spare_writer_;
 };
 
 }  // namespace td
@@ -22,6 +22,18 @@
 #include <openssl/sha.h>
 #endif
 
+#if (TD_GCC || TD_CLANG) && (defined(__x86_64__) || defined(__i386__))
+#define TD_HAVE_X86_SIMD 1
+#include <cpuid.h>
+#include <emmintrin.h>
+#include <nmmintrin.h>
+#include <wmmintrin.h>
+#endif
+
+#if TD_HAVE_OPENSSL && TD_HAVE_X86_SIMD
+#define TD_HAVE_AESNI 1
+#endif
+
 #if TD_HAVE_ZLIB
 #include <zlib.h>
 #endif
@@ -32,6 +44,22 @@
 
 namespace td {
 
+#if TD_HAVE_X86_SIMD
+static bool has_cpu_feature(unsigned int ecx_bit) {
+  static unsigned int cpuid_ecx = [] {
+    unsigned int eax = 0;
+    unsigned int ebx = 0;
+    unsigned int ecx = 0;
+    unsigned int edx = 0;
+    if (__get_cpuid(1, &eax, &ebx, &ecx, &edx) == 0) {
+      return 0u;
+    }
+    return ecx;
+  }();
+  return (cpuid_ecx & ecx_bit) != 0;
+}
+#endif
+
 static uint64 gcd(uint64 a, uint64 b) {
   if (a == 0) {
     return b;
@@ -237,17 +265,196 @@ int pq_factorize(Slice pq_str, string *p_str, string *q_str) {
 }
 
 /*** AES ***/
-static void aes_ige_xcrypt(const UInt256 &aes_key, UInt256 *aes_iv, Slice from, MutableSlice to, bool encrypt_flag) {
-  AES_KEY key;
-  int err;
-  if (encrypt_flag) {
-    err = AES_set_encrypt_key(aes_key.raw, 256, &key);
-  } else {
-    err = AES_set_decrypt_key(aes_key.raw, 256, &key);
+#if TD_HAVE_AESNI
+namespace {
+constexpr size_t AESNI_ROUND_KEY_COUNT = 15;
+
+template <int rcon>
+__attribute__((target("aes,sse2"))) void aesni_expand_key_pair(__m128i *first, __m128i *second) {
+  auto shift_xor = [](__m128i x) {
+    x = _mm_xor_si128(x, _mm_slli_si128(x, 4));
+    x = _mm_xor_si128(x, _mm_slli_si128(x, 4));
+    return _mm_xor_si128(x, _mm_slli_si128(x, 4));
+  };
+  *first = _mm_xor_si128(shift_xor(*first), _mm_shuffle_epi32(_mm_aeskeygenassist_si128(*second, rcon), 0xff));
+  *second = _mm_xor_si128(shift_xor(*second), _mm_shuffle_epi32(_mm_aeskeygenassist_si128(*first, 0), 0xaa));
+}
+
+__attribute__((target("aes,sse2"))) void aesni_set_key(const UInt256 &aes_key, bool encrypt_flag,
+                                                       uint8 round_keys[AESNI_ROUND_KEY_COUNT * 16]) {
+  __m128i keys[AESNI_ROUND_KEY_COUNT];
+  keys[0] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(aes_key.raw));
+  keys[1] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(aes_key.raw + 16));
+  __m128i first = keys[0];
+  __m128i second = keys[1];
+  aesni_expand_key_pair<0x01>(&first, &second);
+  keys[2] = first;
+  keys[3] = second;
+  aesni_expand_key_pair<0x02>(&first, &second);
+  keys[4] = first;
+  keys[5] = second;
+  aesni_expand_key_pair<0x04>(&first, &second);
+  keys[6] = first;
+  keys[7] = second;
+  aesni_expand_key_pair<0x08>(&first, &second);
+  keys[8] = first;
+  keys[9] = second;
+  aesni_expand_key_pair<0x10>(&first, &second);
+  keys[10] = first;
+  keys[11] = second;
+  aesni_expand_key_pair<0x20>(&first, &second);
+  keys[12] = first;
+  keys[13] = second;
+  aesni_expand_key_pair<0x40>(&first, &second);
+  keys[14] = first;  // the last second key isn't needed
+
+  if (!encrypt_flag) {
+    // keys for the Equivalent Inverse Cipher
+    for (size_t i = 0; i < AESNI_ROUND_KEY_COUNT / 2; i++) {
+      std::swap(keys[i], keys[AESNI_ROUND_KEY_COUNT - 1 - i]);
+    }
+    for (size_t i = 1; i + 1 < AESNI_ROUND_KEY_COUNT; i++) {
+      keys[i] = _mm_aesimc_si128(keys[i]);
+    }
+  }
+  // the Impl can be allocated without 16-byte alignment, so round keys are stored unaligned
+  auto *out = reinterpret_cast<__m128i *>(round_keys);
+  for (size_t i = 0; i < AESNI_ROUND_KEY_COUNT; i++) {
+    _mm_storeu_si128(out + i, keys[i]);
   }
-  LOG_IF(FATAL, err != 0);
-  CHECK(from.size() <= to.size());
-  AES_ige_encrypt(from.ubegin(), to.ubegin(), from.size(), &key, aes_iv->raw, encrypt_flag);
+}
+
+__attribute__((target("aes,sse2"))) void aesni_load_keys(const uint8 round_keys[AESNI_ROUND_KEY_COUNT * 16],
+                                                         __m128i keys[AESNI_ROUND_KEY_COUNT]) {
+  auto *in = reinterpret_cast<const __m128i *>(round_keys);
+  for (size_t i = 0; i < AESNI_ROUND_KEY_COUNT; i++) {
+    keys[i] = _mm_loadu_si128(in + i);
+  }
+}
+
+// IGE can't be parallelized, because input of each block cipher call depends on the output of the previous one,
+// so the win comes only from AES-NI rounds and from keeping the whole state in registers
+__attribute__((target("aes,sse2"))) void aesni_ige_encrypt(const uint8 round_keys[AESNI_ROUND_KEY_COUNT * 16],
+                                                           UInt256 *aes_iv, Slice from, MutableSlice to) {
+  __m128i keys[AESNI_ROUND_KEY_COUNT];
+  aesni_load_keys(round_keys, keys);
+  auto *iv = reinterpret_cast<__m128i *>(aes_iv->raw);
+  __m128i prev_encrypted = _mm_loadu_si128(iv);
+  __m128i prev_plain = _mm_loadu_si128(iv + 1);
+  auto *in = reinterpret_cast<const __m128i *>(from.ubegin());
+  auto *out = reinterpret_cast<__m128i *>(to.ubegin());
+  for (size_t i = 0; i < from.size() / 16; i++) {
+    __m128i plain = _mm_loadu_si128(in + i);
+    __m128i x = _mm_xor_si128(_mm_xor_si128(plain, prev_encrypted), keys[0]);
+    for (size_t j = 1; j + 1 < AESNI_ROUND_KEY_COUNT; j++) {
+      x = _mm_aesenc_si128(x, keys[j]);
+    }
+    x = _mm_aesenclast_si128(x, keys[AESNI_ROUND_KEY_COUNT - 1]);
+    prev_encrypted = _mm_xor_si128(x, prev_plain);
+    prev_plain = plain;
+    _mm_storeu_si128(out + i, prev_encrypted);
+  }
+  _mm_storeu_si128(iv, prev_encrypted);
+  _mm_storeu_si128(iv + 1, prev_plain);
+}
+
+__attribute__((target("aes,sse2"))) void aesni_ige_decrypt(const uint8 round_keys[AESNI_ROUND_KEY_COUNT * 16],
+                                                           UInt256 *aes_iv, Slice from, MutableSlice to) {
+  __m128i keys[AESNI_ROUND_KEY_COUNT];
+  aesni_load_keys(round_keys, keys);
+  auto *iv = reinterpret_cast<__m128i *>(aes_iv->raw);
+  __m128i prev_encrypted = _mm_loadu_si128(iv);
+  __m128i prev_plain = _mm_loadu_si128(iv + 1);
+  auto *in = reinterpret_cast<const __m128i *>(from.ubegin());
+  auto *out = reinterpret_cast<__m128i *>(to.ubegin());
+  for (size_t i = 0; i < from.size() / 16; i++) {
+    __m128i encrypted = _mm_loadu_si128(in + i);
+    __m128i x = _mm_xor_si128(_mm_xor_si128(encrypted, prev_plain), keys[0]);
+    for (size_t j = 1; j + 1 < AESNI_ROUND_KEY_COUNT; j++) {
+      x = _mm_aesdec_si128(x, keys[j]);
+    }
+    x = _mm_aesdeclast_si128(x, keys[AESNI_ROUND_KEY_COUNT - 1]);
+    prev_plain = _mm_xor_si128(x, prev_encrypted);
+    prev_encrypted = encrypted;
+    _mm_storeu_si128(out + i, prev_plain);
+  }
+  _mm_storeu_si128(iv, prev_encrypted);
+  _mm_storeu_si128(iv + 1, prev_plain);
+}
+}  // namespace
+#endif
+
+namespace {
+class AesIgeCipher {
+ public:
+  AesIgeCipher(const UInt256 &key, bool encrypt_flag) : encrypt_flag_(encrypt_flag) {
+#if TD_HAVE_AESNI
+    use_aesni_ = has_cpu_feature(bit_AES);
+    if (use_aesni_) {
+      aesni_set_key(key, encrypt_flag, round_keys_);
+      return;
+    }
+#endif
+    int err;
+    if (encrypt_flag) {
+      err = AES_set_encrypt_key(key.raw, 256, &aes_key_);
+    } else {
+      err = AES_set_decrypt_key(key.raw, 256, &aes_key_);
+    }
+    LOG_IF(FATAL, err != 0);
+  }
+
+  void xcrypt(bool encrypt_flag, UInt256 *iv, Slice from, MutableSlice to) {
+    CHECK(encrypt_flag == encrypt_flag_);
+    CHECK(from.size() <= to.size());
+    CHECK(from.size() % 16 == 0);
+#if TD_HAVE_AESNI
+    if (use_aesni_) {
+      if (encrypt_flag) {
+        aesni_ige_encrypt(round_keys_, iv, from, to);
+      } else {
+        aesni_ige_decrypt(round_keys_, iv, from, to);
+      }
+      return;
+    }
+#endif
+    AES_ige_encrypt(from.ubegin(), to.ubegin(), from.size(), &aes_key_, iv->raw, encrypt_flag);
+  }
+
+ private:
+  bool encrypt_flag_;
+#if TD_HAVE_AESNI
+  bool use_aesni_ = false;
+  uint8 round_keys_[AESNI_ROUND_KEY_COUNT * 16];
+#endif
+  AES_KEY aes_key_;
+};
+}  // namespace
+
+class AesIgeState::Impl : public AesIgeCipher {
+ public:
+  using AesIgeCipher::AesIgeCipher;
+};
+
+AesIgeState::AesIgeState() = default;
+AesIgeState::AesIgeState(AesIgeState &&from) = default;
+AesIgeState &AesIgeState::operator=(AesIgeState &&from) = default;
+AesIgeState::~AesIgeState() = default;
+
+void AesIgeState::init(const UInt256 &key, bool encrypt_flag) {
+  ctx_ = std::make_unique<AesIgeState::Impl>(key, encrypt_flag);
+}
+
+void AesIgeState::encrypt(UInt256 *iv, Slice from, MutableSlice to) {
+  ctx_->xcrypt(true, iv, from, to);
+}
+
+void AesIgeState::decrypt(UInt256 *iv, Slice from, MutableSlice to) {
+  ctx_->xcrypt(false, iv, from, to);
+}
+
+static void aes_ige_xcrypt(const UInt256 &aes_key, UInt256 *aes_iv, Slice from, MutableSlice to, bool encrypt_flag) {
+  AesIgeCipher(aes_key, encrypt_flag).xcrypt(encrypt_flag, aes_iv, from, to);
 }
 
 void aes_ige_encrypt(const UInt256 &aes_key, UInt256 *aes_iv, Slice from, MutableSlice to) {
@@ -526,16 +733,154 @@ static const uint64 crc64_table[256] = {
     0x28532e49984f3e05, 0x9b7d62f79be8616a, 0xa707db9acf80c06d, 0x14299724cc279f02, 0x5383edcd67c06036,
     0xe0ada17364673f59};
 
-static uint64 crc64_partial(Slice data, uint64 crc) {
-  const char *p = data.begin();
-  for (auto len = data.size(); len > 0; len--) {
-    crc = crc64_table[(crc ^ *p++) & 0xff] ^ (crc >> 8);
+template <class T>
+struct SlicedCrcTables {
+  T table[8][256];
+};
+
+// tables for slicing-by-8, table[k][i] is CRC of byte i followed by k zero bytes
+template <class T>
+static SlicedCrcTables<T> create_sliced_crc_tables(const T *base_table) {
+  SlicedCrcTables<T> result;
+  for (size_t i = 0; i < 256; i++) {
+    result.table[0][i] = base_table[i];
+  }
+  for (size_t k = 1; k < 8; k++) {
+    for (size_t i = 0; i < 256; i++) {
+      auto prev = result.table[k - 1][i];
+      result.table[k][i] = result.table[0][prev & 0xff] ^ (prev >> 8);
+    }
+  }
+  return result;
+}
+
+template <class T>
+static T crc_sliced_partial(const SlicedCrcTables<T> &tables, Slice data, T crc) {
+  auto *p = data.ubegin();
+  auto len = data.size();
+  for (; len >= 8; len -= 8, p += 8) {
+    uint64 value = crc ^ (static_cast<uint64>(p[0]) | (static_cast<uint64>(p[1]) << 8) |
+                          (static_cast<uint64>(p[2]) << 16) | (static_cast<uint64>(p[3]) << 24) |
+                          (static_cast<uint64>(p[4]) << 32) | (static_cast<uint64>(p[5]) << 40) |
+                          (static_cast<uint64>(p[6]) << 48) | (static_cast<uint64>(p[7]) << 56));
+    crc = static_cast<T>(tables.table[7][value & 0xff] ^ tables.table[6][(value >> 8) & 0xff] ^
+                         tables.table[5][(value >> 16) & 0xff] ^ tables.table[4][(value >> 24) & 0xff] ^
+                         tables.table[3][(value >> 32) & 0xff] ^ tables.table[2][(value >> 40) & 0xff] ^
+                         tables.table[1][(value >> 48) & 0xff] ^ tables.table[0][value >> 56]);
+  }
+  for (; len > 0; len--) {
+    crc = tables.table[0][(crc ^ *p++) & 0xff] ^ (crc >> 8);
   }
   return crc;
 }
 
+static uint64 crc64_partial(Slice data, uint64 crc) {
+  static const SlicedCrcTables<uint64> tables = create_sliced_crc_tables(crc64_table);
+  return crc_sliced_partial(tables, data, crc);
+}
+
+#if TD_HAVE_X86_SIMD
+// multiplies value by x^128 or x^512 modulo CRC-64 polynomial, constants are bit-reflected x^(n - 1) mod P
+__attribute__((target("pclmul,sse2"))) static __m128i crc64_fold(__m128i value, __m128i constants) {
+  return _mm_xor_si128(_mm_clmulepi64_si128(value, constants, 0x00), _mm_clmulepi64_si128(value, constants, 0x11));
+}
+
+__attribute__((target("pclmul,sse2"))) static uint64 crc64_clmul_partial(Slice data, uint64 crc) {
+  const __m128i fold_16 =
+      _mm_set_epi64x(static_cast<int64>(0xdabe95afc7875f40), static_cast<int64>(0xe05dd497ca393ae4));
+  const __m128i fold_64 =
+      _mm_set_epi64x(static_cast<int64>(0x081f6054a7842df4), static_cast<int64>(0x6ae3efbb9dd441f3));
+
+  auto *p = reinterpret_cast<const __m128i *>(data.ubegin());
+  auto block_count = data.size() / 16;
+  CHECK(block_count >= 4);
+
+  // the current CRC is equivalent to the same value xor-ed into the first 8 bytes of the data
+  __m128i x0 = _mm_xor_si128(_mm_loadu_si128(p), _mm_loadl_epi64(reinterpret_cast<const __m128i *>(&crc)));
+  __m128i x1 = _mm_loadu_si128(p + 1);
+  __m128i x2 = _mm_loadu_si128(p + 2);
+  __m128i x3 = _mm_loadu_si128(p + 3);
+  size_t i = 4;
+  for (; i + 4 <= block_count; i += 4) {
+    x0 = _mm_xor_si128(crc64_fold(x0, fold_64), _mm_loadu_si128(p + i));
+    x1 = _mm_xor_si128(crc64_fold(x1, fold_64), _mm_loadu_si128(p + i + 1));
+    x2 = _mm_xor_si128(crc64_fold(x2, fold_64), _mm_loadu_si128(p + i + 2));
+    x3 = _mm_xor_si128(crc64_fold(x3, fold_64), _mm_loadu_si128(p + i + 3));
+  }
+  __m128i x = _mm_xor_si128(crc64_fold(x0, fold_16), x1);
+  x = _mm_xor_si128(crc64_fold(x, fold_16), x2);
+  x = _mm_xor_si128(crc64_fold(x, fold_16), x3);
+  for (; i < block_count; i++) {
+    x = _mm_xor_si128(crc64_fold(x, fold_16), _mm_loadu_si128(p + i));
+  }
+
+  uint8 folded[16];
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(folded), x);
+  crc = crc64_partial(Slice(folded, sizeof(folded)), 0);
+  return crc64_partial(data.substr(block_count * 16), crc);
+}
+#endif
+
 uint64 crc64(Slice data) {
-  return crc64_partial(data, static_cast<uint64>(-1)) ^ static_cast<uint64>(-1);
+  auto crc = static_cast<uint64>(-1);
+#if TD_HAVE_X86_SIMD
+  if (data.size() >= 128 && has_cpu_feature(bit_PCLMUL)) {
+    return crc64_clmul_partial(data, crc) ^ static_cast<uint64>(-1);
+  }
+#endif
+  return crc64_partial(data, crc) ^ static_cast<uint64>(-1);
+}
+
+static SlicedCrcTables<uint32> create_crc32c_tables() {
+  uint32 table[256];
+  for (uint32 i = 0; i < 256; i++) {
+    uint32 crc = i;
+    for (int j = 0; j < 8; j++) {
+      crc = (crc >> 1) ^ ((crc & 1) != 0 ? 0x82f63b78 : 0);
+    }
+    table[i] = crc;
+  }
+  return create_sliced_crc_tables(table);
+}
+
+static uint32 crc32c_partial(Slice data, uint32 crc) {
+  static const SlicedCrcTables<uint32> tables = create_crc32c_tables();
+  return crc_sliced_partial(tables, data, crc);
+}
+
+#if TD_HAVE_X86_SIMD
+__attribute__((target("sse4.2"))) static uint32 crc32c_sse42_partial(Slice data, uint32 crc) {
+  auto *p = data.ubegin();
+  auto len = data.size();
+#if defined(__x86_64__)
+  uint64 crc64 = crc;
+  for (; len >= 8; len -= 8, p += 8) {
+    uint64 value;
+    std::memcpy(&value, p, sizeof(value));
+    crc64 = _mm_crc32_u64(crc64, value);
+  }
+  crc = static_cast<uint32>(crc64);
+#endif
+  for (; len >= 4; len -= 4, p += 4) {
+    uint32 value;
+    std::memcpy(&value, p, sizeof(value));
+    crc = _mm_crc32_u32(crc, value);
+  }
+  for (; len > 0; len--) {
+    crc = _mm_crc32_u8(crc, *p++);
+  }
+  return crc;
+}
+#endif
+
+uint32 crc32c(Slice data) {
+  auto crc = static_cast<uint32>(-1);
+#if TD_HAVE_X86_SIMD
+  if (has_cpu_feature(bit_SSE4_2)) {
+    return crc32c_sse42_partial(data, crc) ^ static_cast<uint32>(-1);
+  }
+#endif
+  return crc32c_partial(data, crc) ^ static_cast<uint32>(-1);
 }
 
 }  // namespace td
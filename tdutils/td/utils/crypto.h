@@ -21,6 +21,27 @@ int pq_factorize(Slice pq_str, string *p_str, string *q_str);
 void aes_ige_encrypt(const UInt256 &aes_key, UInt256 *aes_iv, Slice from, MutableSlice to);
 void aes_ige_decrypt(const UInt256 &aes_key, UInt256 *aes_iv, Slice from, MutableSlice to);
 
+// keeps expanded key to encrypt or decrypt many buffers with the same key
+class AesIgeState {
+ public:
+  AesIgeState();
+  AesIgeState(const AesIgeState &from) = delete;
+  AesIgeState &operator=(const AesIgeState &from) = delete;
+  AesIgeState(AesIgeState &&from);
+  AesIgeState &operator=(AesIgeState &&from);
+  ~AesIgeState();
+
+  void init(const UInt256 &key, bool encrypt_flag);
+
+  void encrypt(UInt256 *iv, Slice from, MutableSlice to);
+
+  void decrypt(UInt256 *iv, Slice from, MutableSlice to);
+
+ private:
+  class Impl;
+  std::unique_ptr<Impl> ctx_;
+};
+
 void aes_cbc_encrypt(const UInt256 &aes_key, UInt128 *aes_iv, Slice from, MutableSlice to);
 void aes_cbc_decrypt(const UInt256 &aes_key, UInt128 *aes_iv, Slice from, MutableSlice to);
 
@@ -76,4 +97,7 @@ uint32 crc32(Slice data);
 
 uint64 crc64(Slice data);
 
+// CRC-32C (Castagnoli), which uses SSE 4.2 instructions when they are available
+uint32 crc32c(Slice data);
+
 }  // namespace td
@@ -14,11 +14,14 @@
 
 #if TD_PORT_POSIX
 
+#include <algorithm>
 #include <atomic>
+#include <climits>
 
 #include <fcntl.h>
 #include <sys/socket.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
 #endif
@@ -293,10 +296,32 @@ Result<size_t> Fd::write(Slice slice) {
   int native_fd = get_native_fd();
   auto write_res = skip_eintr([&] { return ::write(native_fd, slice.begin(), slice.size()); });
   auto write_errno = errno;
+  return process_write_result(write_res, write_errno);
+}
+
+#ifdef IOV_MAX
+static_assert(Fd::MAX_IOVEC_COUNT <= IOV_MAX, "Too big MAX_IOVEC_COUNT");
+#endif
+
+Result<size_t> Fd::writev(const Slice *slices, size_t slice_count) {
+  CHECK(0 < slice_count && slice_count <= MAX_IOVEC_COUNT);
+  int native_fd = get_native_fd();
+  struct iovec vecs[MAX_IOVEC_COUNT];
+  for (size_t i = 0; i < slice_count; i++) {
+    vecs[i].iov_base = const_cast<char *>(slices[i].begin());
+    vecs[i].iov_len = slices[i].size();
+  }
+  auto write_res = skip_eintr([&] { return ::writev(native_fd, vecs, static_cast<int>(slice_count)); });
+  auto write_errno = errno;
+  return process_write_result(write_res, write_errno);
+}
+
+Result<size_t> Fd::process_write_result(int64 write_res, int write_errno) {
   if (write_res >= 0) {
     return narrow_cast<size_t>(write_res);
   }
 
+  int native_fd = get_native_fd();
   if (write_errno == EAGAIN
 #if EAGAIN != EWOULDBLOCK
       || write_errno == EWOULDBLOCK
@@ -336,6 +361,26 @@ Result<size_t> Fd::read(MutableSlice slice) {
   CHECK(slice.size() > 0);
   auto read_res = skip_eintr([&] { return ::read(native_fd, slice.begin(), slice.size()); });
   auto read_errno = errno;
+  return process_read_result(read_res, read_errno);
+}
+
+Result<size_t> Fd::readv(const MutableSlice *slices, size_t slice_count) {
+  CHECK(0 < slice_count && slice_count <= MAX_IOVEC_COUNT);
+  int native_fd = get_native_fd();
+  struct iovec vecs[MAX_IOVEC_COUNT];
+  size_t total_size = 0;
+  for (size_t i = 0; i < slice_count; i++) {
+    vecs[i].iov_base = slices[i].begin();
+    vecs[i].iov_len = slices[i].size();
+    total_size += slices[i].size();
+  }
+  CHECK(total_size > 0);
+  auto read_res = skip_eintr([&] { return ::readv(native_fd, vecs, static_cast<int>(slice_count)); });
+  auto read_errno = errno;
+  return process_read_result(read_res, read_errno);
+}
+
+Result<size_t> Fd::process_read_result(int64 read_res, int read_errno) {
   if (read_res >= 0) {
     if (read_res == 0) {
       errno = 0;
@@ -344,6 +389,7 @@ Result<size_t> Fd::read(MutableSlice slice) {
     }
     return narrow_cast<size_t>(read_res);
   }
+  int native_fd = get_native_fd();
   if (read_errno == EAGAIN
 #if EAGAIN != EWOULDBLOCK
       || read_errno == EWOULDBLOCK
@@ -941,6 +987,32 @@ Result<size_t> Fd::write(Slice slice) {
   return impl_->write(slice);
 }
 
+Result<size_t> Fd::writev(const Slice *slices, size_t slice_count) {
+  CHECK(slice_count > 0);
+  // writes are buffered by FdImpl, so there is no need in a real vectored write
+  size_t result = 0;
+  for (size_t i = 0; i < slice_count; i++) {
+    auto r_written = write(slices[i]);
+    if (r_written.is_error()) {
+      if (result == 0) {
+        return r_written.move_as_error();
+      }
+      break;
+    }
+    auto written = r_written.move_as_ok();
+    result += written;
+    if (written < slices[i].size()) {
+      break;
+    }
+  }
+  return result;
+}
+
+Result<size_t> Fd::readv(const MutableSlice *slices, size_t slice_count) {
+  CHECK(slice_count > 0);
+  return read(slices[0]);
+}
+
 bool Fd::empty() const {
   return !impl_;
 }
@@ -50,6 +50,9 @@ class Fd {
   using Flags = int32;
   enum class Mode { Reference, Owner };
 
+  // maximum number of slices, which can be passed to writev/readv at once
+  static constexpr size_t MAX_IOVEC_COUNT = 128;
+
   Fd();
   Fd(const Fd &) = delete;
   Fd &operator=(const Fd &) = delete;
@@ -98,6 +101,10 @@ class Fd {
   Result<size_t> write(Slice slice) TD_WARN_UNUSED_RESULT;
   Result<size_t> read(MutableSlice slice) TD_WARN_UNUSED_RESULT;
 
+  // vectored versions of write and read; slice_count must be in range [1, MAX_IOVEC_COUNT]
+  Result<size_t> writev(const Slice *slices, size_t slice_count) TD_WARN_UNUSED_RESULT;
+  Result<size_t> readv(const MutableSlice *slices, size_t slice_count) TD_WARN_UNUSED_RESULT;
+
   Status set_is_blocking(bool is_blocking);
 
 #if TD_PORT_POSIX
@@ -156,6 +163,9 @@ class Fd {
   void close_ref();
   void close_own();
 
+  Result<size_t> process_write_result(int64 write_res, int write_errno);
+  Result<size_t> process_read_result(int64 read_res, int read_errno);
+
   int fd_ = -1;
 #endif
 #if TD_PORT_WINDOWS
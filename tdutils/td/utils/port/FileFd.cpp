@@ -188,17 +188,97 @@ Result<FileFd> FileFd::open(CSlice filepath, int32 flags, int32 mode) {
   return std::move(result);
 }
 
+Result<FileFd> FileFd::duplicate() const {
+  CHECK(!empty());
+#if TD_PORT_POSIX
+  int native_fd = ::dup(fd_.get_native_fd());
+  if (native_fd < 0) {
+    return OS_ERROR("File descriptor can't be duplicated");
+  }
+  FileFd result;
+  result.fd_ = Fd(native_fd, Fd::Mode::Owner);
+#elif TD_PORT_WINDOWS
+  HANDLE process = GetCurrentProcess();
+  HANDLE handle;
+  if (DuplicateHandle(process, fd_.get_io_handle(), process, &handle, 0, FALSE, DUPLICATE_SAME_ACCESS) == 0) {
+    return OS_ERROR("File handle can't be duplicated");
+  }
+  FileFd result;
+  result.fd_ = Fd::create_file_fd(handle);
+#endif
+  result.fd_.update_flags(Fd::Flag::Write);
+  return std::move(result);
+}
+
 Result<size_t> FileFd::write(Slice slice) {
 #if TD_PORT_POSIX
   CHECK(!fd_.empty());
   int native_fd = get_native_fd();
   auto write_res = skip_eintr([&] { return ::write(native_fd, slice.begin(), slice.size()); });
+  auto write_errno = errno;
+  return process_write_result(write_res, write_errno);
+#elif TD_PORT_WINDOWS
+  return fd_.write(slice);
+#endif
+}
+
+Result<size_t> FileFd::read(MutableSlice slice) {
+#if TD_PORT_POSIX
+  CHECK(!fd_.empty());
+  int native_fd = get_native_fd();
+  auto read_res = skip_eintr([&] { return ::read(native_fd, slice.begin(), slice.size()); });
+  auto read_errno = errno;
+  return process_read_result(read_res, read_errno, slice.size());
+#elif TD_PORT_WINDOWS
+  return fd_.read(slice);
+#endif
+}
+
+Result<size_t> FileFd::writev(const Slice *slices, size_t slice_count) {
+#if TD_PORT_POSIX
+  CHECK(!fd_.empty());
+  CHECK(0 < slice_count && slice_count <= Fd::MAX_IOVEC_COUNT);
+  int native_fd = get_native_fd();
+  struct iovec vecs[Fd::MAX_IOVEC_COUNT];
+  for (size_t i = 0; i < slice_count; i++) {
+    vecs[i].iov_base = const_cast<char *>(slices[i].begin());
+    vecs[i].iov_len = slices[i].size();
+  }
+  auto write_res = skip_eintr([&] { return ::writev(native_fd, vecs, static_cast<int>(slice_count)); });
+  auto write_errno = errno;
+  return process_write_result(write_res, write_errno);
+#elif TD_PORT_WINDOWS
+  return fd_.writev(slices, slice_count);
+#endif
+}
+
+Result<size_t> FileFd::readv(const MutableSlice *slices, size_t slice_count) {
+#if TD_PORT_POSIX
+  CHECK(!fd_.empty());
+  CHECK(0 < slice_count && slice_count <= Fd::MAX_IOVEC_COUNT);
+  int native_fd = get_native_fd();
+  struct iovec vecs[Fd::MAX_IOVEC_COUNT];
+  size_t total_size = 0;
+  for (size_t i = 0; i < slice_count; i++) {
+    vecs[i].iov_base = slices[i].begin();
+    vecs[i].iov_len = slices[i].size();
+    total_size += slices[i].size();
+  }
+  auto read_res = skip_eintr([&] { return ::readv(native_fd, vecs, static_cast<int>(slice_count)); });
+  auto read_errno = errno;
+  return process_read_result(read_res, read_errno, total_size);
+#elif TD_PORT_WINDOWS
+  return fd_.readv(slices, slice_count);
+#endif
+}
+
+#if TD_PORT_POSIX
+Result<size_t> FileFd::process_write_result(int64 write_res, int write_errno) {
   if (write_res >= 0) {
     return narrow_cast<size_t>(write_res);
   }
 
-  auto write_errno = errno;
-  auto error = Status::PosixError(write_errno, PSLICE() << "Write to [fd = " << native_fd << "] has failed");
+  auto error = Status::PosixError(write_errno, PSLICE() << "Write to [fd = " << get_native_fd() << "] has failed");
   if (write_errno != EAGAIN
 #if EAGAIN != EWOULDBLOCK
       && write_errno != EWOULDBLOCK
@@ -207,26 +287,17 @@ Result<size_t> FileFd::write(Slice slice) {
     LOG(ERROR) << error;
   }
   return std::move(error);
-#elif TD_PORT_WINDOWS
-  return fd_.write(slice);
-#endif
 }
 
-Result<size_t> FileFd::read(MutableSlice slice) {
-#if TD_PORT_POSIX
-  CHECK(!fd_.empty());
-  int native_fd = get_native_fd();
-  auto read_res = skip_eintr([&] { return ::read(native_fd, slice.begin(), slice.size()); });
-  auto read_errno = errno;
-
+Result<size_t> FileFd::process_read_result(int64 read_res, int read_errno, size_t read_size) {
   if (read_res >= 0) {
-    if (narrow_cast<size_t>(read_res) < slice.size()) {
+    if (narrow_cast<size_t>(read_res) < read_size) {
       fd_.clear_flags(Read);
     }
     return static_cast<size_t>(read_res);
   }
 
-  auto error = Status::PosixError(read_errno, PSLICE() << "Read from [fd = " << native_fd << "] has failed");
+  auto error = Status::PosixError(read_errno, PSLICE() << "Read from [fd = " << get_native_fd() << "] has failed");
   if (read_errno != EAGAIN
 #if EAGAIN != EWOULDBLOCK
       && read_errno != EWOULDBLOCK
@@ -235,10 +306,8 @@ Result<size_t> FileFd::read(MutableSlice slice) {
     LOG(ERROR) << error;
   }
   return std::move(error);
-#elif TD_PORT_WINDOWS
-  return fd_.read(slice);
-#endif
 }
+#endif
 
 Result<size_t> FileFd::pwrite(Slice slice, int64 offset) {
   if (offset < 0) {
@@ -27,9 +27,15 @@ class FileFd {
 
   static Result<FileFd> open(CSlice filepath, int32 flags, int32 mode = 0600) TD_WARN_UNUSED_RESULT;
 
+  // returns an independent descriptor of the same open file; closing it releases the file locks held by the process
+  Result<FileFd> duplicate() const TD_WARN_UNUSED_RESULT;
+
   Result<size_t> write(Slice slice) TD_WARN_UNUSED_RESULT;
   Result<size_t> read(MutableSlice slice) TD_WARN_UNUSED_RESULT;
 
+  Result<size_t> writev(const Slice *slices, size_t slice_count) TD_WARN_UNUSED_RESULT;
+  Result<size_t> readv(const MutableSlice *slices, size_t slice_count) TD_WARN_UNUSED_RESULT;
+
   Result<size_t> pwrite(Slice slice, int64 offset) TD_WARN_UNUSED_RESULT;
   Result<size_t> pread(MutableSlice slice, int64 offset) TD_WARN_UNUSED_RESULT;
 
@@ -58,6 +64,11 @@ class FileFd {
 
  private:
   Fd fd_;
+
+#if TD_PORT_POSIX
+  Result<size_t> process_write_result(int64 write_res, int write_errno);
+  Result<size_t> process_read_result(int64 read_res, int read_errno, size_t read_size);
+#endif
 };
 
 }  // namespace td
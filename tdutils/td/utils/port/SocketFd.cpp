@@ -136,4 +136,12 @@ Result<size_t> SocketFd::read(MutableSlice slice) {
   return fd_.read(slice);
 }
 
+Result<size_t> SocketFd::writev(const Slice *slices, size_t slice_count) {
+  return fd_.writev(slices, slice_count);
+}
+
+Result<size_t> SocketFd::readv(const MutableSlice *slices, size_t slice_count) {
+  return fd_.readv(slices, slice_count);
+}
+
 }  // namespace td
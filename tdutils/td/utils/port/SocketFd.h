@@ -35,6 +35,9 @@ class SocketFd {
   Result<size_t> write(Slice slice) TD_WARN_UNUSED_RESULT;
   Result<size_t> read(MutableSlice slice) TD_WARN_UNUSED_RESULT;
 
+  Result<size_t> writev(const Slice *slices, size_t slice_count) TD_WARN_UNUSED_RESULT;
+  Result<size_t> readv(const MutableSlice *slices, size_t slice_count) TD_WARN_UNUSED_RESULT;
+
   void close();
   bool empty() const;
 
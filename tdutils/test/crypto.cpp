@@ -61,6 +61,54 @@ TEST(Crypto, AesCtrState) {
   }
 }
 
+TEST(Crypto, AesIgeState) {
+  td::vector<td::uint32> answers1{0u, 2045698207u, 2423540300u, 525522475u, 1545267325u, 724143417u};
+
+  std::size_t i = 0;
+  for (auto length : {0, 16, 32, 256, 1024, 65536}) {
+    td::uint32 seed = length;
+    td::string s(length, '\0');
+    for (auto &c : s) {
+      seed = seed * 123457567u + 987651241u;
+      c = static_cast<char>((seed >> 23) & 255);
+    }
+
+    td::UInt256 key;
+    for (auto &c : key.raw) {
+      seed = seed * 123457567u + 987651241u;
+      c = (seed >> 23) & 255;
+    }
+    td::UInt256 iv;
+    for (auto &c : iv.raw) {
+      seed = seed * 123457567u + 987651241u;
+      c = (seed >> 23) & 255;
+    }
+
+    td::AesIgeState state;
+    state.init(key, true);
+    td::UInt256 state_iv = iv;
+    td::string t(length, '\0');
+    auto half = length / 32 * 16;
+    state.encrypt(&state_iv, td::Slice(s).substr(0, half), td::MutableSlice(t).substr(0, half));
+    state.encrypt(&state_iv, td::Slice(s).substr(half), td::MutableSlice(t).substr(half));
+    ASSERT_EQ(answers1[i], td::crc32(t));
+
+    td::UInt256 function_iv = iv;
+    td::string u(length, '\0');
+    td::aes_ige_encrypt(key, &function_iv, s, u);
+    ASSERT_STREQ(t, u);
+    ASSERT_TRUE(state_iv == function_iv);
+
+    state.init(key, false);
+    state_iv = iv;
+    state.decrypt(&state_iv, t, t);
+    ASSERT_STREQ(s, t);
+    ASSERT_TRUE(state_iv == function_iv);
+
+    i++;
+  }
+}
+
 TEST(Crypto, Sha256State) {
   for (auto length : {0, 1, 31, 32, 33, 9999, 10000, 10001, 999999, 1000001}) {
     auto s = td::rand_string(std::numeric_limits<char>::min(), std::numeric_limits<char>::max(), length);
@@ -164,3 +212,39 @@ TEST(Crypto, crc64) {
     ASSERT_EQ(answers[i], td::crc64(strings[i]));
   }
 }
+
+TEST(Crypto, crc64_random) {
+  auto crc64_bitwise = [](td::Slice data) {
+    auto crc = static_cast<td::uint64>(-1);
+    for (auto c : data) {
+      crc ^= static_cast<td::uint8>(c);
+      for (int i = 0; i < 8; i++) {
+        crc = (crc >> 1) ^ ((crc & 1) != 0 ? 0xc96c5795d7870f42ull : 0);
+      }
+    }
+    return crc ^ static_cast<td::uint64>(-1);
+  };
+
+  td::uint32 seed = 12345;
+  td::string s(1048575 + 3, '\0');
+  for (auto &c : s) {
+    seed = seed * 123457567u + 987651241u;
+    c = static_cast<char>((seed >> 23) & 255);
+  }
+
+  // lengths aren't multiples of 64 to check both the folding of the remaining blocks and the tail
+  for (std::size_t length : {127, 128, 129, 143, 191, 200, 1001, 4097, 65599, 1048575}) {
+    for (std::size_t offset : {0, 1, 3}) {
+      auto data = td::Slice(s).substr(offset, length);
+      ASSERT_EQ(crc64_bitwise(data), td::crc64(data));
+    }
+  }
+}
+
+TEST(Crypto, crc32c) {
+  td::vector<td::uint32> answers{0u, 2432014819u, 1077264849u, 1131405888u};
+
+  for (std::size_t i = 0; i < strings.size(); i++) {
+    ASSERT_EQ(answers[i], td::crc32c(strings[i]));
+  }
+}
@@ -33,6 +33,10 @@ TEST(Gzip, gzencode_gzdecode) {
   encode_decode(str);
   str = td::string(1000000, 'a');
   encode_decode(str);
+
+  // the encoder is reused, so a failed compression must not affect next calls
+  ASSERT_TRUE(td::gzencode(td::rand_string(0, 127, 1000), 0.1).empty());
+  encode_decode(str);
 }
 
 TEST(Gzip, flow) {
@@ -69,6 +69,28 @@ TEST(JSON, nested) {
   decode_encode(encoded);
 }
 
+TEST(JSON, required_size) {
+  string full;
+  for (size_t buffer_size : {1000, 200, 40}) {
+    string buf(buffer_size, '\0');
+    JsonBuilder jb(StringBuilder(MutableSlice(&buf[0], buf.size())));
+    {
+      auto a = jb.enter_array();
+      for (int i = 0; i < 10; i++) {
+        a << -123456789 - i << "Hello\n" << 1.5;
+        a.enter_value().enter_object() << std::make_pair("key", i);
+      }
+    }
+    if (buffer_size == 1000) {
+      ASSERT_TRUE(!jb.string_builder().is_error());
+      full = jb.string_builder().as_cslice().str();
+    } else {
+      ASSERT_TRUE(jb.string_builder().is_error());
+    }
+    ASSERT_EQ(full.size(), jb.string_builder().get_required_size());
+  }
+}
+
 TEST(JSON, kphp) {
   decode_encode("[]");
   decode_encode("[[]]");
@@ -5,6 +5,10 @@
 // file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
 //
 #include "td/utils/base64.h"
+#include "td/utils/buffer.h"
+#include "td/utils/BufferedFd.h"
+#include "td/utils/ChunkedSortedMap.h"
+#include "td/utils/Hints.h"
 #include "td/utils/logging.h"
 #include "td/utils/misc.h"
 #include "td/utils/port/EventFd.h"
@@ -14,10 +18,14 @@
 #include "td/utils/port/Stat.h"
 #include "td/utils/port/thread.h"
 #include "td/utils/Random.h"
+#include "td/utils/SlabMap.h"
 #include "td/utils/tests.h"
 
+#include <algorithm>
 #include <atomic>
 #include <limits>
+#include <map>
+#include <set>
 
 using namespace td;
 
@@ -163,3 +171,248 @@ TEST(Misc, to_integer) {
   ASSERT_EQ(to_integer_safe<uint64>("12345678910111213").ok(), 12345678910111213ull);
   ASSERT_TRUE(to_integer_safe<uint64>("-12345678910111213").is_error());
 }
+
+TEST(Misc, ChunkedSortedMap) {
+  for (int test = 0; test < 100; test++) {
+    ChunkedSortedMap<int, int, 8> map;
+    std::map<int, int> expected;
+    int max_key = Random::fast(1, 1000);
+    for (int i = 0; i < 3000; i++) {
+      int key = Random::fast(0, max_key);
+      auto type = Random::fast(0, 9);
+      if (type < 5) {
+        auto result = map.insert(key, i);
+        auto expected_result = expected.emplace(key, i);
+        ASSERT_EQ(expected_result.second, result.second);
+        ASSERT_EQ(expected_result.first->second, *result.first);
+      } else if (type < 8) {
+        ASSERT_EQ(expected.count(key) ? expected[key] : 0, map.extract(key));
+        expected.erase(key);
+      } else if (type < 9) {
+        int end_key = key + Random::fast(0, 100);
+        auto expected_it = expected.lower_bound(key);
+        map.erase_range(key, end_key, [&](int erased_key, int value) {
+          ASSERT_TRUE(expected_it != expected.end());
+          ASSERT_EQ(expected_it->first, erased_key);
+          ASSERT_EQ(expected_it->second, value);
+          expected_it = expected.erase(expected_it);
+        });
+        ASSERT_TRUE(expected_it == expected.end() || expected_it->first >= end_key);
+      } else {
+        auto it = map.find_less_or_equal(key);
+        auto expected_it = expected.upper_bound(key);
+        if (expected_it == expected.begin()) {
+          ASSERT_TRUE(!it);
+        } else {
+          --expected_it;
+          for (int j = 0; j < 3 && expected_it != expected.end(); j++, ++it, ++expected_it) {
+            ASSERT_TRUE(static_cast<bool>(it));
+            ASSERT_EQ(expected_it->first, it.key());
+            ASSERT_EQ(expected_it->second, it.value());
+          }
+        }
+      }
+
+      ASSERT_EQ(expected.size(), map.size());
+      auto greater_it = static_cast<const ChunkedSortedMap<int, int, 8> &>(map).find_greater_or_equal(key);
+      auto expected_greater_it = expected.lower_bound(key);
+      ASSERT_EQ(expected_greater_it != expected.end(), static_cast<bool>(greater_it));
+      if (greater_it) {
+        ASSERT_EQ(expected_greater_it->first, greater_it.key());
+      }
+      auto find_result = map.find(key);
+      ASSERT_EQ(expected.count(key) != 0, find_result != nullptr);
+    }
+
+    auto expected_it = expected.begin();
+    map.for_each([&](int key, int value) {
+      ASSERT_EQ(expected_it->first, key);
+      ASSERT_EQ(expected_it->second, value);
+      ++expected_it;
+    });
+    ASSERT_TRUE(expected_it == expected.end());
+
+    auto it = map.get_last();
+    for (auto rit = expected.rbegin(); rit != expected.rend(); ++rit, --it) {
+      ASSERT_TRUE(static_cast<bool>(it));
+      ASSERT_EQ(rit->first, it.key());
+    }
+    ASSERT_TRUE(!it);
+  }
+}
+
+TEST(Misc, Hints) {
+  auto random_name = [] {
+    string name;
+    int word_count = Random::fast(0, 3);
+    for (int i = 0; i < word_count; i++) {
+      int length = Random::fast(1, 3);
+      for (int j = 0; j < length; j++) {
+        name += static_cast<char>(Random::fast('a', 'c'));
+      }
+      name += ' ';
+    }
+    return name;
+  };
+
+  for (int test = 0; test < 100; test++) {
+    Hints<int64, int32> hints;
+    std::map<int64, string> names;
+    std::map<int64, int32> ratings;
+    for (int i = 0; i < 1000; i++) {
+      int64 key = Random::fast(0, 50);
+      auto type = Random::fast(0, 9);
+      if (type < 5) {
+        auto name = random_name();
+        hints.add(key, name);
+        if (name.empty()) {
+          names.erase(key);
+          ratings.erase(key);
+        } else {
+          names[key] = name;
+        }
+      } else if (type < 6) {
+        hints.remove(key);
+        names.erase(key);
+        ratings.erase(key);
+      } else if (type < 8) {
+        auto rating = Random::fast(-10, 10);
+        hints.set_rating(key, rating);
+        ratings[key] = rating;
+      } else {
+        auto query = random_name();
+        int32 limit = Random::fast(0, 10);
+        auto query_words = detail::get_hints_words(query);
+        auto is_match = [&](const string &name) {
+          auto words = detail::get_hints_words(name);
+          for (auto &query_word : query_words) {
+            if (std::none_of(words.begin(), words.end(),
+                             [&](const string &word) { return begins_with(word, query_word); })) {
+              return false;
+            }
+          }
+          return true;
+        };
+        auto get_rating = [&](int64 key) {
+          return ratings.count(key) ? ratings[key] : 0;
+        };
+
+        vector<std::pair<int32, int64>> expected;
+        for (auto &it : names) {
+          if (!query_words.empty() && is_match(it.second)) {
+            expected.emplace_back(get_rating(it.first), it.first);
+          }
+        }
+        std::sort(expected.begin(), expected.end());
+
+        auto result = hints.search(query, limit);
+        ASSERT_EQ(expected.size(), result.first);
+        ASSERT_EQ(std::min(expected.size(), static_cast<size_t>(limit)), result.second.size());
+        for (size_t j = 0; j < result.second.size(); j++) {
+          ASSERT_EQ(expected[j].second, result.second[j]);
+        }
+
+        // the same search among random keys, including repeated and unknown ones
+        vector<int64> among_keys;
+        std::set<int64> among_key_set;
+        for (int j = Random::fast(0, 20); j > 0; j--) {
+          among_keys.push_back(Random::fast(0, 60));
+          among_key_set.insert(among_keys.back());
+        }
+        vector<std::pair<int32, int64>> expected_among;
+        for (auto among_key : among_key_set) {
+          auto it = names.find(among_key);
+          if (it != names.end() && is_match(it->second)) {
+            expected_among.emplace_back(get_rating(among_key), among_key);
+          }
+        }
+        std::sort(expected_among.begin(), expected_among.end());
+
+        auto result_among = hints.search_among(query, limit, among_keys);
+        ASSERT_EQ(expected_among.size(), result_among.first);
+        ASSERT_EQ(std::min(expected_among.size(), static_cast<size_t>(limit)), result_among.second.size());
+        for (size_t j = 0; j < result_among.second.size(); j++) {
+          ASSERT_EQ(expected_among[j].second, result_among.second[j]);
+        }
+      }
+      ASSERT_EQ(names.size(), hints.size());
+      ASSERT_EQ(names.count(key) != 0, hints.has_key(key));
+    }
+  }
+}
+
+TEST(Misc, SlabMap) {
+  for (int test = 0; test < 100; test++) {
+    SlabMap<uint64, std::pair<uint64, int>> map;
+    std::map<uint64, int> expected;
+    std::map<uint64, const std::pair<uint64, int> *> addresses;
+    uint64 max_key = Random::fast(1, 1000);
+    for (int i = 0; i < 3000; i++) {
+      uint64 key = Random::fast(1, static_cast<int>(max_key)) * 4;
+      if (Random::fast(0, 2) != 0) {
+        auto result = map.emplace(key, key, i);
+        auto expected_result = expected.emplace(key, i);
+        ASSERT_EQ(expected_result.second, result.second);
+        ASSERT_EQ(expected_result.first->second, result.first->second);
+        if (result.second) {
+          addresses[key] = result.first;
+        }
+      } else {
+        ASSERT_EQ(expected.erase(key) != 0, map.erase(key));
+        addresses.erase(key);
+      }
+
+      ASSERT_EQ(expected.size(), map.size());
+      auto find_result = map.find(key);
+      ASSERT_EQ(expected.count(key) != 0, find_result != nullptr);
+    }
+
+    size_t count = 0;
+    map.for_each([&](uint64 key, std::pair<uint64, int> &value) {
+      ASSERT_EQ(key, value.first);
+      ASSERT_EQ(expected[key], value.second);
+      ASSERT_TRUE(addresses[key] == &value);
+      count++;
+    });
+    ASSERT_EQ(expected.size(), count);
+    ASSERT_TRUE(map.find(0) == nullptr);
+  }
+}
+
+TEST(Misc, BufferedFd) {
+  SET_VERBOSITY_LEVEL(VERBOSITY_NAME(ERROR));
+  std::string name = "test_buffered_fd";
+  unlink(name).ignore();
+  string expected;
+  {
+    BufferedFd<FileFd> fd(FileFd::open(name, FileFd::Write | FileFd::Create | FileFd::Truncate).move_as_ok());
+    for (int i = 0; i < 1000; i++) {
+      auto part = rand_string('a', 'z', Random::fast(1, 1000));
+      expected += part;
+      if (Random::fast(0, 1) == 0) {
+        fd.output_buffer().append(part);
+      } else {
+        fd.output_buffer().append(BufferSlice(part));
+      }
+      if (Random::fast(0, 99) == 0) {
+        fd.flush_write().ensure();
+      }
+    }
+    while (fd.need_flush_write()) {
+      fd.flush_write().ensure();
+    }
+  }
+  {
+    BufferedFd<FileFd> fd(FileFd::open(name, FileFd::Read).move_as_ok());
+    fd.update_flags(Fd::Flag::Read);
+    string result;
+    while (can_read(fd)) {
+      fd.flush_read(Random::fast(1, 10000)).ensure();
+      auto &input = fd.input_buffer();
+      result += input.cut_head(input.size()).move_as_buffer_slice().as_slice().str();
+    }
+    ASSERT_EQ(expected.size(), result.size());
+    ASSERT_TRUE(expected == result);
+  }
+  unlink(name).ensure();
+}
@@ -17,12 +17,15 @@
 
 DESC_TESTS(string_cleaning);
 DESC_TESTS(message_entities);
+DESC_TESTS(message_cache);
 DESC_TESTS(variant);
 DESC_TESTS(secret);
 DESC_TESTS(actors_main);
 DESC_TESTS(actors_simple);
 DESC_TESTS(actors_workers);
 DESC_TESTS(db);
+DESC_TESTS(client_json);
+DESC_TESTS(file_stats);
 DESC_TESTS(json);
 DESC_TESTS(http);
 DESC_TESTS(heap);
@@ -34,12 +37,15 @@ namespace td {
 void TestsRunner::run_all_tests() {
   LOAD_TESTS(string_cleaning);
   LOAD_TESTS(message_entities);
+  LOAD_TESTS(message_cache);
   LOAD_TESTS(variant);
   LOAD_TESTS(secret);
   LOAD_TESTS(actors_main);
   LOAD_TESTS(actors_simple);
   LOAD_TESTS(actors_workers);
   LOAD_TESTS(db);
+  LOAD_TESTS(client_json);
+  LOAD_TESTS(file_stats);
   LOAD_TESTS(json);
   LOAD_TESTS(http);
   LOAD_TESTS(heap);
@@ -0,0 +1,88 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2017
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/telegram/ClientJson.h"
+
+#include "td/utils/common.h"
+#include "td/utils/JsonBuilder.h"
+#include "td/utils/logging.h"
+#include "td/utils/port/path.h"
+#include "td/utils/Slice.h"
+#include "td/utils/tests.h"
+
+#include <memory>
+
+REGISTER_TESTS(client_json);
+
+using namespace td;
+
+static JsonValue decode_response(CSlice response, string &buf) {
+  buf = response.str();
+  auto r_value = json_decode(buf);
+  ASSERT_TRUE(r_value.is_ok());
+  auto value = r_value.move_as_ok();
+  ASSERT_TRUE(value.type() == JsonValue::Type::Object);
+  return value;
+}
+
+TEST(ClientJson, execute) {
+  string database_directory = "test_client_json_db";
+  auto client = std::make_unique<ClientJson>();
+
+  string text;
+  for (int i = 0; i < 12000; i++) {
+    text += PSTRING() << "@user" << i << ' ';
+  }
+  auto big_request = PSTRING() << "{\"@type\":\"getTextEntities\",\"text\":\"" << text
+                               << "\",\"@extra\":{\"list\":[1,\"2\"]}}";
+  auto small_request = string("{\"@extra\":5,\"@type\":\"getTextEntities\",\"text\":\"@user0\"}");
+
+  // the big response doesn't fit into the initial buffer, and the buffer is shrunk after it
+  for (auto is_big : {true, false, true, true, false}) {
+    auto &request = is_big ? big_request : small_request;
+    string buf;
+    auto response = decode_response(client->execute(request), buf);
+    auto &object = response.get_object();
+    auto r_type = get_json_object_string_field(object, "@type", false);
+    ASSERT_TRUE(r_type.is_ok());
+    auto r_extra = get_json_object_field(object, "@extra", JsonValue::Type::Null, false);
+    ASSERT_TRUE(r_extra.is_ok());
+    auto extra = json_encode<string>(r_extra.ok());
+    ASSERT_EQ("textEntities", r_type.ok());
+    ASSERT_EQ(is_big ? "{\"list\":[1,\"2\"]}" : "5", extra);
+    auto r_entities = get_json_object_field(object, "entities", JsonValue::Type::Array, false);
+    ASSERT_TRUE(r_entities.is_ok());
+    ASSERT_EQ(is_big ? 12000u : 1u, r_entities.ok().get_array().size());
+  }
+
+  // a response to a request without "@extra" has "@extra":null
+  {
+    string buf;
+    auto response = decode_response(client->execute("{\"@type\":\"getTextEntities\",\"text\":\"@user0\"}"), buf);
+    auto r_extra = get_json_object_field(response.get_object(), "@extra", JsonValue::Type::Null, false);
+    ASSERT_TRUE(r_extra.is_ok());
+    ASSERT_TRUE(r_extra.ok().type() == JsonValue::Type::Null);
+  }
+
+  // Td can't be closed before it receives the parameters
+  client->send(PSLICE() << "{\"@type\":\"setTdlibParameters\",\"@extra\":6,\"parameters\":{\"database_directory\":\""
+                        << database_directory << "\",\"api_id\":1,\"api_hash\":\"hash\"}}");
+  while (true) {
+    auto response = client->receive(10.0);
+    ASSERT_TRUE(!response.empty());
+    string buf;
+    auto value = decode_response(response, buf);
+    auto &object = value.get_object();
+    auto r_extra = get_json_object_field(object, "@extra", JsonValue::Type::Null, true);
+    if (r_extra.is_ok() && json_encode<string>(r_extra.ok()) == "6") {
+      ASSERT_EQ("ok", get_json_object_string_field(object, "@type", false).move_as_ok());
+      break;
+    }
+  }
+  client.reset();
+  unlink(database_directory + "/td.binlog").ignore();
+  rmdir(database_directory).ignore();
+}
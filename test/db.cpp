@@ -4,22 +4,33 @@
 // Distributed under the Boost Software License, Version 1.0. (See accompanying
 // file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
 //
+#include "td/db/AdaptiveBatcher.h"
 #include "td/db/binlog/BinlogHelper.h"
 #include "td/db/BinlogKeyValue.h"
 #include "td/db/SeqKeyValue.h"
+#include "td/db/SqliteCheckpointer.h"
+#include "td/db/SqliteConnectionSafe.h"
 #include "td/db/SqliteKeyValue.h"
 #include "td/db/SqliteKeyValueSafe.h"
 #include "td/db/TsSeqKeyValue.h"
 
+#include "td/telegram/DialogId.h"
+#include "td/telegram/MessageId.h"
+#include "td/telegram/MessagesDb.h"
+#include "td/telegram/UserId.h"
+#include "td/telegram/Version.h"
+
 #include "td/utils/common.h"
 #include "td/utils/logging.h"
 #include "td/utils/port/FileFd.h"
+#include "td/utils/port/Stat.h"
 #include "td/utils/port/thread.h"
 #include "td/utils/Random.h"
 #include "td/utils/Slice.h"
 #include "td/utils/Status.h"
 #include "td/utils/tests.h"
 
+#include <algorithm>
 #include <limits>
 #include <map>
 #include <memory>
@@ -93,6 +104,320 @@ TEST(DB, binlog_encryption) {
   }
 };
 
+TEST(DB, binlog_crc32c) {
+  CSlice binlog_name = "test_binlog";
+  Binlog::destroy(binlog_name).ignore();
+
+  {
+    Binlog binlog;
+    binlog.init(binlog_name.str(), [](const BinlogEvent &x) {}).ensure();
+    binlog.add_raw_event(BinlogEvent::create_raw(binlog.next_id(), 1, 0, create_storer("AAAA")));
+    binlog.add_raw_event(
+        BinlogEvent::create_raw(binlog.next_id(), 1, BinlogEvent::Flags::Crc32c, create_storer("BBBB")));
+    binlog.add_raw_event(BinlogEvent::create_raw(
+        binlog.next_id(), 1, BinlogEvent::Flags::Rewrite | BinlogEvent::Flags::Crc32c, create_storer("CCCC")));
+    binlog.close().ensure();
+  }
+
+  {
+    std::vector<string> v;
+    Binlog binlog;
+    binlog.init(binlog_name.str(), [&](const BinlogEvent &x) { v.push_back(x.data_.str()); }).ensure();
+    CHECK(v == std::vector<string>({"AAAA", "BBBB", "CCCC"}));
+  }
+
+  // new events are written with Crc32c flag only after an explicit opt-in
+  for (auto use_crc32c : {false, true}) {
+    Binlog::destroy(binlog_name).ignore();
+    {
+      Binlog binlog;
+      binlog.set_use_crc32c(use_crc32c);
+      binlog.init(binlog_name.str(), [](const BinlogEvent &x) {}).ensure();
+      binlog.add_raw_event(BinlogEvent::create_raw(binlog.next_id(), 1, 0, create_storer("EEEE")));
+      binlog.add_raw_event(
+          BinlogEvent::create_raw(binlog.next_id(), 1, BinlogEvent::Flags::Rewrite, create_storer("FFFF")));
+      binlog.close().ensure();
+    }
+
+    std::vector<string> v;
+    Binlog binlog;
+    binlog.init(binlog_name.str(), [&](const BinlogEvent &x) {
+                   CHECK(((x.flags_ & BinlogEvent::Flags::Crc32c) != 0) == use_crc32c);
+                   v.push_back(x.data_.str());
+                 })
+        .ensure();
+    CHECK(v == std::vector<string>({"EEEE", "FFFF"}));
+  }
+
+  auto raw_event = BinlogEvent::create_raw(1, 1, BinlogEvent::Flags::Crc32c, create_storer("DDDD"));
+  auto data = raw_event.as_slice().truncate(raw_event.size() - EVENT_TAIL_SIZE);
+  CHECK(crc32c(data) != crc32(data));
+  // the same event with cleared Crc32c flag must not pass the check
+  raw_event.as_slice()[4 + 8 + 4] = 0;
+  BinlogEvent event;
+  CHECK(event.init(std::move(raw_event)).is_error());
+  Binlog::destroy(binlog_name).ignore();
+}
+
+TEST(DB, binlog_compaction) {
+  CSlice binlog_name = "test_binlog";
+
+  auto get_file_size = [&] { return stat(binlog_name).ok().size_; };
+
+  for (auto db_key : {DbKey::empty(), DbKey::raw_key(std::string(32, 'A'))}) {
+    Binlog::destroy(binlog_name).ignore();
+
+    std::map<uint64, string> expected;
+    int64 live_size = 0;
+    int64 max_size = 0;
+    {
+      Binlog binlog;
+      binlog.init(binlog_name.str(), [](const BinlogEvent &x) {}, db_key).ensure();
+
+      auto add = [&](uint64 id, int32 flags, string data) {
+        binlog.add_raw_event(BinlogEvent::create_raw(id, 1, flags, create_storer(data)));
+        expected[id] = std::move(data);
+        max_size = std::max(max_size, get_file_size());
+      };
+
+      auto get_data = [](int round, int i) {
+        return PSTRING() << string(95, static_cast<char>('a' + round % 26)) << ' ' << 1000 + i;
+      };
+
+      std::vector<uint64> ids;
+      for (int i = 0; i < 1000; i++) {
+        ids.push_back(binlog.next_id());
+        add(ids.back(), 0, get_data(0, i));
+      }
+      for (int round = 1; round <= 30; round++) {
+        for (int i = 0; i < 1000; i++) {
+          if (i % 7 == round % 7) {
+            binlog.add_raw_event(BinlogEvent::create_raw(ids[i], BinlogEvent::ServiceTypes::Empty,
+                                                         BinlogEvent::Flags::Rewrite, EmptyStorer()));
+            expected.erase(ids[i]);
+            ids[i] = binlog.next_id();
+            add(ids[i], 0, get_data(round, i));
+          } else {
+            add(ids[i], BinlogEvent::Flags::Rewrite, get_data(round, i));
+          }
+        }
+      }
+      binlog.close().ensure();
+    }
+    for (auto &it : expected) {
+      live_size += static_cast<int64>(BinlogEvent::create_raw(it.first, 1, 0, create_storer(it.second)).size());
+    }
+    CHECK(max_size < 7 * live_size);
+
+    std::map<uint64, string> loaded;
+    Binlog binlog;
+    binlog.init(binlog_name.str(), [&](const BinlogEvent &x) { loaded[x.id_] = x.data_.str(); }, db_key).ensure();
+    CHECK(loaded == expected);
+    binlog.close().ensure();
+  }
+  Binlog::destroy(binlog_name).ignore();
+}
+
+TEST(DB, binlog_idle_compaction) {
+  CSlice binlog_name = "test_binlog";
+  Binlog::destroy(binlog_name).ignore();
+
+  std::map<uint64, string> expected;
+  {
+    Binlog binlog;
+    binlog.init(binlog_name.str(), [](const BinlogEvent &x) {}).ensure();
+    for (int i = 0; i < 200; i++) {
+      auto id = binlog.next_id();
+      expected[id] = string(1000, static_cast<char>('a' + i % 26));
+      binlog.add_raw_event(BinlogEvent::create_raw(id, 1, 0, create_storer(expected[id])));
+    }
+    auto rewritten_id = expected.begin()->first;
+    for (int i = 0; !binlog.need_compaction_step(); i++) {
+      ASSERT_TRUE(i < 10000);
+      expected[rewritten_id] = string(1000, static_cast<char>('A' + i % 26));
+      binlog.add_raw_event(
+          BinlogEvent::create_raw(rewritten_id, 1, BinlogEvent::Flags::Rewrite, create_storer(expected[rewritten_id])));
+    }
+    auto new_binlog_name = PSTRING() << binlog_name << ".new";
+    ASSERT_TRUE(stat(new_binlog_name).is_ok());
+
+    // no new events are added, but the compaction must be finished anyway
+    int steps = 0;
+    while (binlog.need_compaction_step()) {
+      binlog.continue_compaction();
+      steps++;
+    }
+    ASSERT_TRUE(steps > 1);
+    ASSERT_TRUE(stat(new_binlog_name).is_error());
+    ASSERT_TRUE(stat(binlog_name).ok().size_ < 300000);
+    binlog.close().ensure();
+  }
+
+  std::map<uint64, string> loaded;
+  Binlog binlog;
+  binlog.init(binlog_name.str(), [&](const BinlogEvent &x) { loaded[x.id_] = x.data_.str(); }).ensure();
+  ASSERT_TRUE(loaded == expected);
+  binlog.close().ensure();
+  Binlog::destroy(binlog_name).ignore();
+}
+
+TEST(DB, binlog_parallel_load) {
+  CSlice binlog_name = "test_binlog";
+
+  auto create_binlog = [&](const DbKey &db_key) {
+    Binlog::destroy(binlog_name).ignore();
+    Binlog binlog;
+    binlog.init(binlog_name.str(), [](const BinlogEvent &x) {}, db_key).ensure();
+    for (int i = 0; i < 2000; i++) {
+      auto data = string(i % 10 == 0 ? 20000 : 100, static_cast<char>('a' + i % 26));
+      auto id = binlog.next_id();
+      binlog.add_raw_event(BinlogEvent::create_raw(id, 1, 0, create_storer(data)));
+      if (i % 7 == 0) {
+        binlog.add_raw_event(BinlogEvent::create_raw(id, 2, BinlogEvent::Flags::Rewrite, create_storer("BBBB")));
+      }
+      if (i % 11 == 0) {
+        binlog.add_raw_event(
+            BinlogEvent::create_raw(id, BinlogEvent::ServiceTypes::Empty, BinlogEvent::Flags::Rewrite, EmptyStorer()));
+      }
+    }
+    binlog.close().ensure();
+
+    auto fd = FileFd::open(binlog_name, FileFd::Flags::Write | FileFd::Flags::Append).move_as_ok();
+    fd.write("abacabadaba").ensure();
+  };
+
+  auto load_binlog = [&](const DbKey &db_key, int32 load_threads_n, bool need_add_event) {
+    std::vector<std::pair<uint64, string>> events;
+    Binlog binlog;
+    binlog.set_load_threads_n(load_threads_n);
+    binlog
+        .init(binlog_name.str(),
+              [&](const BinlogEvent &x) {
+                events.emplace_back(x.id_, PSTRING() << x.type_ << ' ' << x.data_);
+              },
+              db_key)
+        .ensure();
+    if (need_add_event) {
+      binlog.add_raw_event(BinlogEvent::create_raw(binlog.next_id(), 1, 0, create_storer("CCCC")));
+    }
+    binlog.close().ensure();
+    return events;
+  };
+
+  auto corrupt_binlog = [&] {
+    auto fd = FileFd::open(binlog_name, FileFd::Flags::Write).move_as_ok();
+    fd.pwrite("X", fd.get_size() / 2).ensure();
+  };
+
+  for (auto db_key : {DbKey::empty(), DbKey::raw_key(std::string(32, 'A'))}) {
+    create_binlog(db_key);
+    auto events = load_binlog(db_key, 1, false);
+    CHECK(events.size() == 2000 - 182);
+    create_binlog(db_key);
+    CHECK(load_binlog(db_key, 4, false) == events);
+
+    // new events must be correctly written after parallel load
+    CHECK(load_binlog(db_key, 3, true) == events);
+    events.emplace_back(events.back().first + 1, "1 CCCC");
+    CHECK(load_binlog(db_key, 1, false) == events);
+  }
+
+  create_binlog(DbKey::empty());
+  corrupt_binlog();
+  auto events = load_binlog(DbKey::empty(), 1, false);
+  CHECK(events.size() < 2000 - 182);
+  create_binlog(DbKey::empty());
+  corrupt_binlog();
+  CHECK(load_binlog(DbKey::empty(), 4, false) == events);
+
+  Binlog::destroy(binlog_name).ignore();
+}
+
+TEST(DB, binlog_group_commit) {
+  CSlice binlog_name = "test_binlog";
+  Binlog::destroy(binlog_name).ignore();
+
+  static constexpr int events_n = 1000;
+  class Main : public Actor {
+   public:
+    explicit Main(string binlog_name) : binlog_name_(std::move(binlog_name)) {
+    }
+
+    void start_up() override {
+      binlog_.init(binlog_name_, [](const BinlogEvent &x) {}).ensure();
+      for (int i = 0; i < events_n; i++) {
+        BinlogHelper::add(&binlog_, 1, create_storer("AAAA"), i % 3 == 0 ? create_sync_promise() : Promise<>());
+        if (i % 10 == 0) {
+          binlog_.force_sync(create_sync_promise());
+        }
+      }
+    }
+
+   private:
+    string binlog_name_;
+    ConcurrentBinlog binlog_;
+    int pending_syncs_ = 0;
+
+    Promise<> create_sync_promise() {
+      pending_syncs_++;
+      return PromiseCreator::lambda([actor_id = actor_id(this)](Result<> result) {
+        result.ensure();
+        send_closure(actor_id, &Main::on_synced);
+      });
+    }
+
+    void on_synced() {
+      if (--pending_syncs_ == 0) {
+        binlog_.close(PromiseCreator::lambda([](Unit) { Scheduler::instance()->finish(); }));
+      }
+    }
+  };
+
+  ConcurrentScheduler sched;
+  sched.init(0);
+  sched.create_actor_unsafe<Main>(0, "Main", binlog_name.str()).release();
+  sched.start();
+  while (sched.run_main(10)) {
+    // empty
+  }
+  sched.finish();
+
+  int loaded_events_n = 0;
+  Binlog binlog;
+  binlog.init(binlog_name.str(), [&](const BinlogEvent &x) { loaded_events_n++; }).ensure();
+  CHECK(loaded_events_n == events_n);
+  binlog.close().ensure();
+  Binlog::destroy(binlog_name).ignore();
+}
+
+TEST(DB, adaptive_batcher) {
+  AdaptiveBatcher batcher(10, 100, 1.0);
+  ASSERT_EQ(10u, batcher.get_batch_size());
+  ASSERT_TRUE(!batcher.need_flush(9));
+  ASSERT_TRUE(batcher.need_flush(10));
+
+  // writes are queued faster than they are committed
+  for (int i = 0; i < 10; i++) {
+    batcher.on_flushed(batcher.get_batch_size(), 0.001, AdaptiveBatcher::FlushReason::Size);
+  }
+  ASSERT_EQ(100u, batcher.get_batch_size());
+  ASSERT_TRUE(batcher.get_delay() < 0.2);
+
+  // commits became expensive
+  for (int i = 0; i < 20; i++) {
+    batcher.on_flushed(100, 1.0, AdaptiveBatcher::FlushReason::Force);
+  }
+  ASSERT_EQ(100u, batcher.get_batch_size());
+  ASSERT_EQ(1.0, batcher.get_delay());
+
+  // rare writes
+  for (int i = 0; i < 30; i++) {
+    batcher.on_flushed(1, 0.0001, AdaptiveBatcher::FlushReason::Timeout);
+  }
+  ASSERT_EQ(10u, batcher.get_batch_size());
+  ASSERT_TRUE(batcher.get_delay() < 0.2);
+}
+
 TEST(DB, sqlite_lfs) {
   string path = "test_sqlite_db";
   SqliteDb::destroy(path).ignore();
@@ -155,6 +480,396 @@ TEST(DB, sqlite_encryption) {
   SqliteDb::open_with_key(path, cucumber).ensure_error();
 }
 
+TEST(DB, messages_db_readers) {
+  string path = "test_messages_db";
+  SqliteDb::destroy(path).ignore();
+  {
+    auto db = SqliteDb::open_with_key(path, DbKey::empty()).move_as_ok();
+    db.exec("PRAGMA journal_mode=WAL").ensure();
+    init_messages_db(db, 0).ensure();
+  }
+
+  static constexpr int32 messages_n = 20;
+  static constexpr int32 call_index_mask = 1 << (static_cast<int32>(SearchMessagesFilter::Call) - 1);
+  class Main : public Actor {
+   public:
+    Main(std::shared_ptr<SqliteConnectionSafe> connection, std::vector<int32> reader_scheduler_ids)
+        : connection_(std::move(connection)), reader_scheduler_ids_(std::move(reader_scheduler_ids)) {
+    }
+
+    void start_up() override {
+      messages_db_ = create_messages_db_async(create_messages_db_sync(connection_), 1, reader_scheduler_ids_);
+
+      // every read is sent right after a write and must see it; it may also see some of the later writes
+      for (int32 i = 1; i <= messages_n; i++) {
+        auto data = PSTRING() << "data " << i;
+        FullMessageId full_message_id(dialog_id_, MessageId(ServerMessageId(i)));
+        pending_queries_ += 4;
+        messages_db_->add_message(full_message_id, ServerMessageId(i), UserId(1), 0, 0, call_index_mask, i,
+                                  PSTRING() << "hello " << i, BufferSlice(data),
+                                  PromiseCreator::lambda([actor_id = actor_id(this)](Result<> result) {
+                                    result.ensure();
+                                    send_closure(actor_id, &Main::on_query_finished);
+                                  }));
+
+        messages_db_->get_message(
+            full_message_id, PromiseCreator::lambda([actor_id = actor_id(this), data](Result<BufferSlice> r_message) {
+              ASSERT_EQ(data, r_message.ok().as_slice().str());
+              send_closure(actor_id, &Main::on_query_finished);
+            }));
+
+        MessagesDbFtsQuery fts_query;
+        fts_query.query = "hello";
+        fts_query.dialog_id = dialog_id_;
+        messages_db_->get_messages_fts(
+            std::move(fts_query),
+            PromiseCreator::lambda([actor_id = actor_id(this), i, data](Result<MessagesDbFtsResult> r_result) {
+              auto &messages = r_result.ok().messages;
+              ASSERT_TRUE(messages.size() >= static_cast<size_t>(i));
+              ASSERT_EQ(data, messages[messages.size() - i].data.as_slice().str());
+              send_closure(actor_id, &Main::on_query_finished);
+            }));
+
+        MessagesDbCallsQuery calls_query;
+        calls_query.index_mask = call_index_mask;
+        calls_query.from_unique_message_id = messages_n + 1;
+        messages_db_->get_calls(
+            std::move(calls_query),
+            PromiseCreator::lambda([actor_id = actor_id(this), i, data](Result<MessagesDbCallsResult> r_result) {
+              auto &messages = r_result.ok().messages;
+              ASSERT_TRUE(messages.size() >= static_cast<size_t>(i));
+              ASSERT_EQ(data, messages[messages.size() - i].data.as_slice().str());
+              send_closure(actor_id, &Main::on_query_finished);
+            }));
+      }
+    }
+
+   private:
+    std::shared_ptr<SqliteConnectionSafe> connection_;
+    std::vector<int32> reader_scheduler_ids_;
+    std::shared_ptr<MessagesDbAsyncInterface> messages_db_;
+    DialogId dialog_id_{static_cast<int64>(1)};
+    int pending_queries_ = 0;
+
+    void on_query_finished() {
+      if (--pending_queries_ == 0) {
+        messages_db_->close(
+            PromiseCreator::lambda([actor_id = actor_id(this)](Unit) { send_closure(actor_id, &Main::on_closed); }));
+      }
+    }
+
+    void on_closed() {
+      messages_db_.reset();
+      Scheduler::instance()->finish();
+      stop();
+    }
+  };
+
+  ConcurrentScheduler sched;
+  sched.init(3);
+  std::shared_ptr<SqliteConnectionSafe> connection;
+  {
+    auto guard = sched.get_current_guard();
+    connection = std::make_shared<SqliteConnectionSafe>(path);
+  }
+  sched.create_actor_unsafe<Main>(0, "Main", connection, std::vector<int32>{2, 3}).release();
+  sched.start();
+  while (sched.run_main(10)) {
+    // empty
+  }
+  sched.finish();
+  connection->close_and_destroy();
+}
+
+TEST(DB, messages_db_media_index_migration) {
+  string path = "test_messages_db_migration";
+  SqliteDb::destroy(path).ignore();
+
+  static constexpr int32 index_count = 30;
+  static constexpr int32 messages_n = 60;
+  auto get_index_mask = [](int32 dialog_n, int32 i) {
+    if (i % 7 == 0) {
+      return 0;
+    }
+    return ((i * 37 + dialog_n) & 0x3f) | (i % 5 == 0 ? 1 << (index_count - 1) : 0);
+  };
+  auto get_data = [](int32 dialog_n, int32 i) {
+    return PSTRING() << "data " << dialog_n << ' ' << i;
+  };
+
+  struct Query {
+    int32 dialog_n;
+    int32 index_i;
+    int32 from_n;
+    int32 offset;
+    int32 limit;
+  };
+  std::vector<Query> queries;
+  for (int32 dialog_n = 1; dialog_n <= 2; dialog_n++) {
+    for (auto index_i : {0, 1, 3, 5, index_count - 1}) {
+      for (auto from_n : {1, 20, 35, messages_n + 1}) {
+        queries.push_back(Query{dialog_n, index_i, from_n, 0, 10});
+        queries.push_back(Query{dialog_n, index_i, from_n, -5, 10});
+        queries.push_back(Query{dialog_n, index_i, from_n, -20, 20});
+      }
+    }
+  }
+  auto get_message_id = [](int32 n) {
+    return MessageId(ServerMessageId(n));
+  };
+
+  // results of the per-bit indices of the previous schema
+  auto get_old_messages = [&](SqliteDb &db, const Query &query) {
+    auto select_messages = [&](bool is_desc, int64 from_message_id, int32 limit) {
+      auto stmt = db.get_statement(PSLICE() << "SELECT data FROM messages WHERE dialog_id = ?1 AND (index_mask & "
+                                            << (1 << query.index_i) << ") != 0 AND message_id "
+                                            << (is_desc ? "< ?2 ORDER BY message_id DESC" : "> ?2 ORDER BY message_id")
+                                            << " LIMIT ?3")
+                      .move_as_ok();
+      stmt.bind_int64(1, query.dialog_n).ensure();
+      stmt.bind_int64(2, from_message_id).ensure();
+      stmt.bind_int32(3, limit).ensure();
+      std::vector<string> result;
+      stmt.step().ensure();
+      while (stmt.has_row()) {
+        result.push_back(stmt.view_blob(0).str());
+        stmt.step().ensure();
+      }
+      return result;
+    };
+    auto from_message_id = get_message_id(query.from_n).get();
+    std::vector<string> result;
+    if (query.offset < 0) {
+      result = select_messages(false, from_message_id - 1, -query.offset);
+      std::reverse(result.begin(), result.end());
+    }
+    auto left = select_messages(true, from_message_id, query.limit + query.offset);
+    result.insert(result.end(), left.begin(), left.end());
+    return result;
+  };
+
+  auto get_new_messages = [&](MessagesDbSyncInterface &messages_db, const Query &query) {
+    MessagesDbMessagesQuery db_query;
+    db_query.dialog_id = DialogId(static_cast<int64>(query.dialog_n));
+    db_query.index_mask = 1 << query.index_i;
+    db_query.from_message_id = get_message_id(query.from_n);
+    db_query.offset = query.offset;
+    db_query.limit = query.limit;
+    std::vector<string> result;
+    for (auto &message : messages_db.get_messages(db_query).move_as_ok().messages) {
+      result.push_back(message.as_slice().str());
+    }
+    return result;
+  };
+
+  std::vector<std::vector<string>> old_results;
+  {
+    // the schema before DbVersion::MessagesDbMediaIndexTable with a partial index per bit of index_mask
+    auto db = SqliteDb::open_with_key(path, DbKey::empty()).move_as_ok();
+    db.exec("PRAGMA journal_mode=WAL").ensure();
+    db.exec(
+          "CREATE TABLE messages (dialog_id INT8, message_id INT8, unique_message_id INT4, sender_user_id INT4, "
+          "random_id INT8, data BLOB, ttl_expires_at INT4, index_mask INT4, search_id INT8, text STRING, PRIMARY KEY "
+          "(dialog_id, message_id))")
+        .ensure();
+    for (int32 i = 0; i < index_count; i++) {
+      db.exec(PSLICE() << "CREATE INDEX message_index_" << i
+                       << " ON messages (dialog_id, message_id) WHERE (index_mask & " << (1 << i) << ") != 0")
+          .ensure();
+    }
+    db.exec("BEGIN TRANSACTION").ensure();
+    for (int32 dialog_n = 1; dialog_n <= 2; dialog_n++) {
+      for (int32 i = 1; i <= messages_n; i++) {
+        auto index_mask = get_index_mask(dialog_n, i);
+        auto index_mask_str = index_mask == 0 ? string("NULL") : to_string(index_mask);
+        db.exec(PSLICE() << "INSERT INTO messages (dialog_id, message_id, unique_message_id, data, index_mask) VALUES ("
+                         << dialog_n << ", " << get_message_id(i).get() << ", " << i << ", CAST('"
+                         << get_data(dialog_n, i) << "' AS BLOB), " << index_mask_str << ")")
+            .ensure();
+      }
+    }
+    db.exec("COMMIT TRANSACTION").ensure();
+
+    for (auto &query : queries) {
+      old_results.push_back(get_old_messages(db, query));
+    }
+    ASSERT_TRUE(!old_results[0].empty() || !old_results[1].empty());
+
+    db.exec("BEGIN TRANSACTION").ensure();
+    init_messages_db(db, static_cast<int32>(DbVersion::MessagesDbMediaIndexTable) - 1).ensure();
+    db.exec("COMMIT TRANSACTION").ensure();
+
+    // the old indices are dropped together with the old table
+    auto stmt =
+        db.get_statement("SELECT COUNT(*) FROM sqlite_master WHERE type = 'index' AND name LIKE 'message_index_%'")
+            .move_as_ok();
+    stmt.step().ensure();
+    ASSERT_EQ(0, stmt.view_int32(0));
+    ASSERT_TRUE(db.has_table("message_media_index").move_as_ok());
+  }
+
+  ConcurrentScheduler sched;
+  sched.init(0);
+  {
+    auto guard = sched.get_current_guard();
+    auto connection = std::make_shared<SqliteConnectionSafe>(path);
+    auto messages_db_safe = create_messages_db_sync(connection);
+    auto &messages_db = messages_db_safe->get();
+    for (size_t i = 0; i < queries.size(); i++) {
+      ASSERT_EQ(old_results[i], get_new_messages(messages_db, queries[i]));
+    }
+
+    auto get_media_index_size = [&] {
+      auto stmt = connection->get().get_statement("SELECT COUNT(*) FROM message_media_index").move_as_ok();
+      stmt.step().ensure();
+      return stmt.view_int32(0);
+    };
+    auto get_index_size = [&](int32 dialog_n, int32 index_i) {
+      MessagesDbMessagesQuery db_query;
+      db_query.dialog_id = DialogId(static_cast<int64>(dialog_n));
+      db_query.index_mask = 1 << index_i;
+      db_query.from_message_id = MessageId::max();
+      db_query.limit = 1000;
+      return messages_db.get_messages(db_query).move_as_ok().messages.size();
+    };
+    int32 expected_media_index_size = 0;
+    for (int32 dialog_n = 1; dialog_n <= 2; dialog_n++) {
+      for (int32 i = 1; i <= messages_n; i++) {
+        auto index_mask = get_index_mask(dialog_n, i);
+        for (int32 index_i = 0; index_i < index_count; index_i++) {
+          if ((index_mask >> index_i) & 1) {
+            expected_media_index_size++;
+          }
+        }
+      }
+    }
+    ASSERT_EQ(expected_media_index_size, get_media_index_size());
+
+    // update of a message replaces its index entries
+    FullMessageId full_message_id(DialogId(static_cast<int64>(1)), get_message_id(1));
+    auto old_index_mask = get_index_mask(1, 1);
+    ASSERT_TRUE((old_index_mask & 1) == 0 && (old_index_mask & (1 << 2)) != 0);
+    auto size_0 = get_index_size(1, 0);
+    auto size_2 = get_index_size(1, 2);
+    auto old_bit_count = get_media_index_size();
+    messages_db.add_message(full_message_id, ServerMessageId(1), UserId(), 0, 0, 1, 0, "", BufferSlice("new"))
+        .ensure();
+    ASSERT_EQ(size_0 + 1, get_index_size(1, 0));
+    ASSERT_EQ(size_2 - 1, get_index_size(1, 2));
+    int32 old_mask_bit_count = 0;
+    for (int32 index_i = 0; index_i < index_count; index_i++) {
+      old_mask_bit_count += (old_index_mask >> index_i) & 1;
+    }
+    ASSERT_EQ(old_bit_count - old_mask_bit_count + 1, get_media_index_size());
+
+    // deletion of messages removes their index entries
+    messages_db.delete_message(full_message_id).ensure();
+    ASSERT_EQ(size_0, get_index_size(1, 0));
+    messages_db.delete_all_dialog_messages(DialogId(static_cast<int64>(2)), MessageId::max()).ensure();
+    for (int32 index_i = 0; index_i < index_count; index_i++) {
+      ASSERT_EQ(0u, get_index_size(2, index_i));
+    }
+    {
+      auto stmt = connection->get()
+                      .get_statement("SELECT COUNT(*) FROM message_media_index WHERE dialog_id = 2 OR row_id NOT IN "
+                                     "(SELECT row_id FROM messages)")
+                      .move_as_ok();
+      stmt.step().ensure();
+      ASSERT_EQ(0, stmt.view_int32(0));
+    }
+
+    messages_db_safe.reset();
+    connection->close_and_destroy();
+  }
+}
+
+TEST(DB, sqlite_checkpointer) {
+  string path = "test_sqlite_checkpointer";
+  SqliteDb::destroy(path).ignore();
+
+  class Main : public Actor {
+   public:
+    explicit Main(string path) : path_(std::move(path)) {
+    }
+
+    void start_up() override {
+      SqliteConnectionOptions options;
+      options.wal_autocheckpoint = 0;
+      connection_ = std::make_shared<SqliteConnectionSafe>(path_, DbKey::empty(), options);
+      auto &db = connection_->get();
+      db.exec("PRAGMA journal_mode=WAL").ensure();
+      db.exec("CREATE TABLE test (data BLOB)").ensure();
+      write_data();
+
+      // all changes are in the write-ahead log
+      db_size_ = stat(path_).ok().size_;
+      ASSERT_TRUE(db_size_ < 100000);
+      wal_size_ = get_wal_size();
+      ASSERT_TRUE(wal_size_ > 1000000);
+
+      // the period is long enough for the checkpoint to be made only explicitly
+      checkpointer_ = std::make_unique<SqliteCheckpointer>(connection_, 1e6, 1);
+      checkpointer_->checkpoint(PromiseCreator::lambda([actor_id = actor_id(this)](Result<Unit> result) {
+        result.ensure();
+        send_closure(actor_id, &Main::on_checkpoint);
+      }));
+    }
+
+    void on_checkpoint() {
+      // the pages are moved to the database
+      ASSERT_TRUE(stat(path_).ok().size_ > db_size_ + 1000000);
+      ASSERT_EQ(wal_size_, get_wal_size());
+
+      // the checkpointed write-ahead log is reused from the beginning instead of growing
+      write_data();
+      ASSERT_TRUE(get_wal_size() < wal_size_ + wal_size_ / 2);
+
+      checkpointer_->close(PromiseCreator::lambda([actor_id = actor_id(this)](Unit) {
+        send_closure(actor_id, &Main::on_closed);
+      }));
+    }
+
+    void on_closed() {
+      checkpointer_.reset();
+      Scheduler::instance()->finish();
+      stop();
+    }
+
+    void tear_down() override {
+      connection_->close_and_destroy();
+    }
+
+   private:
+    string path_;
+    std::shared_ptr<SqliteConnectionSafe> connection_;
+    std::unique_ptr<SqliteCheckpointer> checkpointer_;
+    int64 db_size_ = 0;
+    int64 wal_size_ = 0;
+
+    void write_data() {
+      auto &db = connection_->get();
+      db.exec("BEGIN TRANSACTION").ensure();
+      for (int i = 0; i < 100; i++) {
+        db.exec("INSERT INTO test VALUES (zeroblob(10000))").ensure();
+      }
+      db.exec("COMMIT TRANSACTION").ensure();
+    }
+
+    int64 get_wal_size() const {
+      return stat(path_ + "-wal").ok().size_;
+    }
+  };
+
+  ConcurrentScheduler sched;
+  sched.init(1);
+  sched.create_actor_unsafe<Main>(0, "Main", path).release();
+  sched.start();
+  while (sched.run_main(10)) {
+    // empty
+  }
+  sched.finish();
+}
+
 using SeqNo = uint64;
 struct DbQuery {
   enum Type { Get, Set, Erase } type;
@@ -300,6 +1015,81 @@ TEST(DB, key_value) {
   }
 }
 
+TEST(DB, binlog_key_value_prefix) {
+  CSlice name = "test_binlog_kv";
+  BinlogKeyValue<Binlog>::destroy(name).ignore();
+
+  std::map<string, string> expected;
+  auto check_prefix = [&](BinlogKeyValue<Binlog> &kv, Slice prefix) {
+    std::vector<std::pair<string, string>> found;
+    kv.prefix_for_each(prefix, [&](Slice key, Slice value) { found.emplace_back(key.str(), value.str()); });
+    std::vector<std::pair<string, string>> expected_found;
+    for (auto &it : expected) {
+      if (begins_with(it.first, prefix)) {
+        expected_found.push_back(it);
+      }
+    }
+    ASSERT_TRUE(found == expected_found);
+    auto prefix_map = kv.prefix_get(prefix);
+    ASSERT_EQ(expected_found.size(), prefix_map.size());
+  };
+
+  {
+    BinlogKeyValue<Binlog> kv;
+    kv.init(name.str()).ensure();
+    for (int i = 0; i < 100; i++) {
+      auto key = PSTRING() << (i % 3 == 0 ? "a" : i % 3 == 1 ? "ab" : "b") << i;
+      auto value = PSTRING() << "value" << i;
+      kv.set(key, value);
+      expected[key] = value;
+    }
+    kv.set("", "empty");
+    expected[""] = "empty";
+
+    auto view = kv.get_view("ab1");
+    ASSERT_EQ("value1", view.as_slice());
+    kv.set("ab1", "new_value");
+    expected["ab1"] = "new_value";
+    ASSERT_EQ("value1", view.as_slice());
+    ASSERT_EQ("new_value", kv.get("ab1"));
+    ASSERT_TRUE(kv.get_view("c").empty());
+
+    check_prefix(kv, "");
+    check_prefix(kv, "a");
+    check_prefix(kv, "ab");
+    check_prefix(kv, "b");
+    check_prefix(kv, "c");
+    kv.close();
+  }
+
+  {
+    BinlogKeyValue<Binlog> kv;
+    kv.init(name.str()).ensure();
+    ASSERT_EQ("new_value", kv.get_view("ab1").as_slice());
+    check_prefix(kv, "a");
+
+    kv.erase_by_prefix("ab");
+    for (auto it = expected.begin(); it != expected.end();) {
+      if (begins_with(it->first, "ab")) {
+        it = expected.erase(it);
+      } else {
+        ++it;
+      }
+    }
+    check_prefix(kv, "");
+    check_prefix(kv, "a");
+    kv.close();
+  }
+
+  {
+    BinlogKeyValue<Binlog> kv;
+    kv.init(name.str()).ensure();
+    check_prefix(kv, "");
+    kv.close();
+  }
+  BinlogKeyValue<Binlog>::destroy(name).ignore();
+}
+
 TEST(DB, thread_key_value) {
 #if !TD_THREAD_UNSUPPORTED
   std::vector<std::string> keys;
@@ -0,0 +1,204 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2017
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/actor/actor.h"
+#include "td/actor/PromiseFuture.h"
+
+#include "td/telegram/DialogId.h"
+#include "td/telegram/files/FileLocation.h"
+#include "td/telegram/files/FileStats.h"
+#include "td/telegram/files/FileStatsWorker.h"
+
+#include "td/utils/CancellationToken.h"
+#include "td/utils/common.h"
+#include "td/utils/logging.h"
+#include "td/utils/port/FileFd.h"
+#include "td/utils/port/path.h"
+#include "td/utils/Slice.h"
+#include "td/utils/Status.h"
+#include "td/utils/tests.h"
+
+#include <utility>
+
+REGISTER_TESTS(file_stats);
+
+using namespace td;
+
+static FullFileInfo get_file_info(DialogId owner_dialog_id, FileType file_type, int64 size) {
+  FullFileInfo info;
+  info.file_type = file_type;
+  info.owner_dialog_id = owner_dialog_id;
+  info.size = size;
+  info.atime_nsec = 0;
+  info.mtime_nsec = 0;
+  return info;
+}
+
+static FileTypeStat get_stat(const FileStats &stats, DialogId owner_dialog_id, FileType file_type) {
+  auto it = stats.stat_by_owner_dialog_id.find(owner_dialog_id);
+  if (it == stats.stat_by_owner_dialog_id.end()) {
+    return FileTypeStat();
+  }
+  return it->second[static_cast<size_t>(file_type)];
+}
+
+TEST(FileStats, counter_download_gc) {
+  DialogId first_dialog_id(static_cast<int64>(1));
+  DialogId second_dialog_id(static_cast<int64>(2));
+
+  FileStatsCounter counter;
+  ASSERT_TRUE(!counter.is_inited());
+  // there are no stats to update before the first full scan
+  ASSERT_TRUE(counter.add_file(first_dialog_id, FileType::Photo, 100));
+  ASSERT_TRUE(!counter.is_inited());
+
+  FileStats scan;
+  scan.split_by_owner_dialog_id = true;
+  scan.add(get_file_info(first_dialog_id, FileType::Photo, 100));
+  scan.add(get_file_info(first_dialog_id, FileType::Photo, 200));
+  scan.add(get_file_info(first_dialog_id, FileType::Temp, 50));
+  scan.add(get_file_info(second_dialog_id, FileType::Video, 1000));
+  counter.on_full_file_stats(scan);
+  ASSERT_TRUE(counter.is_inited());
+
+  auto stats = counter.get_file_stats(true);
+  ASSERT_EQ(2, get_stat(stats, first_dialog_id, FileType::Photo).cnt);
+  ASSERT_EQ(300, get_stat(stats, first_dialog_id, FileType::Photo).size);
+  // partial files aren't accounted
+  ASSERT_EQ(0, get_stat(stats, first_dialog_id, FileType::Temp).cnt);
+  ASSERT_EQ(1000, get_stat(stats, second_dialog_id, FileType::Video).size);
+
+  // download
+  ASSERT_TRUE(counter.add_file(first_dialog_id, FileType::Photo, 400));
+  ASSERT_TRUE(counter.add_file(first_dialog_id, FileType::Temp, 400));
+  stats = counter.get_file_stats(true);
+  ASSERT_EQ(3, get_stat(stats, first_dialog_id, FileType::Photo).cnt);
+  ASSERT_EQ(700, get_stat(stats, first_dialog_id, FileType::Photo).size);
+
+  // GC removes the photos of 100 and 400 bytes and the video; its result replaces the stats
+  FileStats gc_result;
+  gc_result.split_by_owner_dialog_id = true;
+  gc_result.add(get_file_info(first_dialog_id, FileType::Photo, 200));
+  gc_result.add(get_file_info(first_dialog_id, FileType::Temp, 50));
+  counter.on_full_file_stats(gc_result);
+
+  stats = counter.get_file_stats(true);
+  ASSERT_EQ(1, get_stat(stats, first_dialog_id, FileType::Photo).cnt);
+  ASSERT_EQ(200, get_stat(stats, first_dialog_id, FileType::Photo).size);
+  ASSERT_TRUE(stats.stat_by_owner_dialog_id.count(second_dialog_id) == 0);
+  ASSERT_EQ(1, stats.get_total_nontemp_stat().cnt);
+  ASSERT_EQ(200, stats.get_total_nontemp_stat().size);
+
+  // next download after GC
+  ASSERT_TRUE(counter.add_file(second_dialog_id, FileType::Video, 10));
+  stats = counter.get_file_stats(false);
+  ASSERT_TRUE(!stats.split_by_owner_dialog_id);
+  ASSERT_EQ(1, stats.stat_by_type[static_cast<size_t>(FileType::Photo)].cnt);
+  ASSERT_EQ(10, stats.stat_by_type[static_cast<size_t>(FileType::Video)].size);
+  ASSERT_EQ(2, stats.get_total_nontemp_stat().cnt);
+  ASSERT_EQ(210, stats.get_total_nontemp_stat().size);
+
+  // deletion of an unknown file makes the stats wrong
+  ASSERT_TRUE(counter.add_file(second_dialog_id, FileType::Video, -10));
+  ASSERT_TRUE(!counter.add_file(second_dialog_id, FileType::Video, -10));
+  ASSERT_TRUE(!counter.is_inited());
+  ASSERT_TRUE(counter.get_stat_by_owner_dialog_id().empty());
+}
+
+TEST(FileStats, merge_owner_dialog_stats) {
+  FileStats stats;
+  stats.split_by_owner_dialog_id = true;
+  stats.add(get_file_info(DialogId(static_cast<int64>(1)), FileType::Photo, 100));
+  stats.add(get_file_info(DialogId(static_cast<int64>(2)), FileType::Photo, 200));
+  stats.add(get_file_info(DialogId(), FileType::Document, 300));
+  stats.merge_owner_dialog_stats();
+  ASSERT_TRUE(!stats.split_by_owner_dialog_id);
+  ASSERT_TRUE(stats.stat_by_owner_dialog_id.empty());
+  ASSERT_EQ(2, stats.stat_by_type[static_cast<size_t>(FileType::Photo)].cnt);
+  ASSERT_EQ(300, stats.stat_by_type[static_cast<size_t>(FileType::Photo)].size);
+  ASSERT_EQ(300, stats.stat_by_type[static_cast<size_t>(FileType::Document)].size);
+}
+
+static void rmrf(CSlice path) {
+  walk_path(path, [](CSlice path, bool is_dir) {
+    if (is_dir) {
+      rmdir(path).ignore();
+    } else {
+      unlink(path).ignore();
+    }
+  }).ignore();
+}
+
+TEST(FileStats, parallel_dir_scan) {
+  string root = "test_file_stats_dir";
+  rmrf(root);
+  mkdir(root).ensure();
+
+  std::vector<std::pair<FileType, string>> dirs{{FileType::Photo, root + "/photos/"},
+                                                {FileType::Video, root + "/videos/"}};
+  FileStats expected;
+  expected.need_all_files = true;
+  for (auto &dir : dirs) {
+    mkdir(dir.second).ensure();
+  }
+  // more files than fit in several batches, so they are checked by all stat workers
+  for (int i = 0; i < 2000; i++) {
+    auto &dir = dirs[i % 3 == 0 ? 1 : 0];
+    auto fd = FileFd::open(PSLICE() << dir.second << i, FileFd::Write | FileFd::Create).move_as_ok();
+    fd.write(string(i % 17 + 1, 'a')).ensure();
+    fd.close();
+
+    FullFileInfo info;
+    info.file_type = dir.first;
+    info.size = i % 17 + 1;
+    expected.add(std::move(info));
+  }
+
+  class Main : public Actor {
+   public:
+    Main(std::vector<std::pair<FileType, string>> dirs, FileStats expected)
+        : dirs_(std::move(dirs)), expected_(std::move(expected)) {
+    }
+
+    void start_up() override {
+      worker_ = create_actor<FileStatsWorker>("FileStatsWorker", actor_shared(), std::vector<int32>{1, 2});
+      send_closure(worker_, &FileStatsWorker::get_dir_stats, std::move(dirs_), true, CancellationToken(),
+                   PromiseCreator::lambda([actor_id = actor_id(this)](Result<FileStats> r_stats) {
+                     send_closure(actor_id, &Main::on_stats, r_stats.move_as_ok());
+                   }));
+    }
+
+    void on_stats(FileStats stats) {
+      ASSERT_TRUE(!stats.split_by_owner_dialog_id);
+      ASSERT_EQ(expected_.all_files.size(), stats.all_files.size());
+      for (size_t i = 0; i < file_type_size; i++) {
+        ASSERT_EQ(expected_.stat_by_type[i].cnt, stats.stat_by_type[i].cnt);
+        ASSERT_EQ(expected_.stat_by_type[i].size, stats.stat_by_type[i].size);
+      }
+      for (auto &info : stats.all_files) {
+        ASSERT_TRUE(!info.path.empty());
+      }
+      worker_.reset();
+      Scheduler::instance()->finish();
+      stop();
+    }
+
+   private:
+    std::vector<std::pair<FileType, string>> dirs_;
+    FileStats expected_;
+    ActorOwn<FileStatsWorker> worker_;
+  };
+
+  ConcurrentScheduler sched;
+  sched.init(2);
+  sched.create_actor_unsafe<Main>(0, "Main", std::move(dirs), std::move(expected)).release();
+  sched.start();
+  while (sched.run_main(10)) {
+    // empty
+  }
+  sched.finish();
+  rmrf(root);
+}
@@ -0,0 +1,224 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2017
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/telegram/MessageCache.h"
+
+#include "td/utils/common.h"
+#include "td/utils/tests.h"
+
+#include <map>
+#include <memory>
+#include <set>
+#include <utility>
+
+REGISTER_TESTS(message_cache);
+
+using namespace td;
+
+TEST(MessageCache, unload_least_recently_used) {
+  struct Chat {
+    int32 loaded_message_count;
+    int32 unloadable_message_count;
+    bool is_unloaded;
+  };
+  // chats are identified by their index; last access dates aren't sorted and chat 3 has the same date as chat 0
+  std::vector<Chat> chats{{100, 100, false}, {50, 50, false}, {300, 250, false}, {70, 70, false}, {10, 10, false}};
+  std::vector<std::pair<int32, size_t>> items{{20, 0}, {40, 1}, {10, 2}, {20, 3}, {30, 4}};
+  int32 size = 0;
+  for (auto &chat : chats) {
+    size += chat.loaded_message_count;
+  }
+  ASSERT_EQ(530, size);
+
+  auto unload_chat = [&](size_t i) {
+    auto &chat = chats[i];
+    ASSERT_TRUE(!chat.is_unloaded);
+    chat.is_unloaded = true;
+    chat.loaded_message_count -= chat.unloadable_message_count;
+    return chat.unloadable_message_count;
+  };
+
+  // nothing is unloaded, if the budget isn't exceeded
+  ASSERT_EQ(size, detail::unload_least_recently_used(items, size, size, unload_chat));
+  for (auto &chat : chats) {
+    ASSERT_TRUE(!chat.is_unloaded);
+  }
+
+  // not all messages of the least recently used chat can be unloaded, so more chats are unloaded
+  size = detail::unload_least_recently_used(items, size, 250, unload_chat);
+  ASSERT_EQ(180, size);
+  ASSERT_TRUE(chats[2].is_unloaded);
+  ASSERT_TRUE(chats[0].is_unloaded);
+  ASSERT_TRUE(!chats[3].is_unloaded);
+  ASSERT_TRUE(!chats[4].is_unloaded);
+  ASSERT_TRUE(!chats[1].is_unloaded);
+
+  // the budget can't be reached, so all chats are unloaded
+  items = {{20, 3}, {30, 4}, {40, 1}};
+  size = detail::unload_least_recently_used(items, size, 0, unload_chat);
+  ASSERT_EQ(50, size);
+  for (auto &chat : chats) {
+    ASSERT_TRUE(chat.is_unloaded);
+  }
+}
+
+namespace {
+// a chat, whose messages are kept in memory and in the database like in MessagesManager
+struct TestDialog {
+  bool is_opened = false;
+  int32 loaded_message_count = 0;
+  int32 last_access_date = 0;
+  std::set<int32> messages;
+  std::set<int32> database_messages;
+  int32 unload_count = 0;
+};
+
+class TestMessagesManager {
+ public:
+  MessageCache message_cache;
+  std::map<int32, std::unique_ptr<TestDialog>> dialogs;
+  bool is_reduce_scheduled = false;
+  int32 now = 0;
+  int32 hit_count = 0;
+  int32 miss_count = 0;
+
+  TestDialog *get_dialog(int32 dialog_id) {
+    auto &d = dialogs[dialog_id];
+    if (d == nullptr) {
+      d = std::make_unique<TestDialog>();
+    }
+    return d.get();
+  }
+
+  void add_message(int32 dialog_id, int32 message_id) {
+    auto d = get_dialog(dialog_id);
+    d->database_messages.insert(message_id);
+    load_message(d, message_id);
+  }
+
+  bool get_message_force(int32 dialog_id, int32 message_id) {
+    auto d = get_dialog(dialog_id);
+    d->last_access_date = ++now;
+    if (d->messages.count(message_id) != 0) {
+      hit_count++;
+      return true;
+    }
+    if (d->database_messages.count(message_id) == 0) {
+      return false;
+    }
+    miss_count++;
+    load_message(d, message_id);
+    return true;
+  }
+
+  void set_max_size(int32 max_size) {
+    if (message_cache.set_max_size(max_size)) {
+      is_reduce_scheduled = true;
+    }
+  }
+
+  void reduce() {
+    ASSERT_TRUE(is_reduce_scheduled);
+    is_reduce_scheduled = false;
+    message_cache.reduce(dialogs, [&](TestDialog *d) {
+      d->unload_count++;
+      on_loaded_message_count_changed(d, -static_cast<int32>(d->messages.size()));
+      d->messages.clear();
+    });
+  }
+
+ private:
+  void load_message(TestDialog *d, int32 message_id) {
+    d->last_access_date = ++now;
+    if (d->messages.insert(message_id).second) {
+      on_loaded_message_count_changed(d, 1);
+    }
+  }
+
+  void on_loaded_message_count_changed(TestDialog *d, int32 diff) {
+    d->loaded_message_count += diff;
+    if (message_cache.on_loaded_message_count_changed(diff)) {
+      is_reduce_scheduled = true;
+    }
+  }
+};
+}  // namespace
+
+TEST(MessageCache, evict_and_reload) {
+  TestMessagesManager manager;
+  auto &cache = manager.message_cache;
+
+  // too small limits are increased to the minimum cache size
+  manager.set_max_size(1);
+  ASSERT_EQ(100, cache.get_max_size());
+  ASSERT_TRUE(!manager.is_reduce_scheduled);
+
+  // 5 chats with 30 messages each; the third chat is opened
+  for (int32 dialog_id = 0; dialog_id < 5; dialog_id++) {
+    for (int32 message_id = 1; message_id <= 30; message_id++) {
+      manager.add_message(dialog_id, message_id);
+    }
+  }
+  manager.get_dialog(2)->is_opened = true;
+  ASSERT_EQ(150, cache.get_size());
+  ASSERT_TRUE(cache.need_reduce());
+  ASSERT_TRUE(manager.is_reduce_scheduled);
+
+  // make the opened chat the least recently used one
+  manager.get_dialog(2)->last_access_date = 0;
+  manager.reduce();
+  // the cache is reduced to 3/4 of the limit by unloading the least recently used chats, which aren't opened
+  ASSERT_EQ(60, cache.get_size());
+  ASSERT_EQ(1, manager.get_dialog(0)->unload_count);
+  ASSERT_EQ(1, manager.get_dialog(1)->unload_count);
+  ASSERT_EQ(0, manager.get_dialog(2)->unload_count);
+  ASSERT_EQ(1, manager.get_dialog(3)->unload_count);
+  ASSERT_EQ(0, manager.get_dialog(4)->unload_count);
+  int32 size = 0;
+  for (auto &it : manager.dialogs) {
+    ASSERT_EQ(static_cast<int32>(it.second->messages.size()), it.second->loaded_message_count);
+    size += it.second->loaded_message_count;
+  }
+  ASSERT_EQ(size, cache.get_size());
+
+  // unloaded messages are loaded again from the database
+  ASSERT_TRUE(manager.get_message_force(4, 1));
+  ASSERT_TRUE(manager.get_message_force(0, 1));
+  ASSERT_TRUE(!manager.get_message_force(0, 31));
+  ASSERT_EQ(1, manager.hit_count);
+  ASSERT_EQ(1, manager.miss_count);
+  ASSERT_EQ(61, cache.get_size());
+  ASSERT_EQ(1, manager.get_dialog(0)->loaded_message_count);
+  ASSERT_TRUE(!manager.is_reduce_scheduled);
+
+  // reducing the limit schedules unloading; increasing or removing it doesn't
+  manager.set_max_size(0);
+  ASSERT_TRUE(!manager.is_reduce_scheduled);
+  manager.set_max_size(60);
+  ASSERT_EQ(100, cache.get_max_size());
+  ASSERT_TRUE(!manager.is_reduce_scheduled);
+  for (int32 message_id = 1; message_id <= 30; message_id++) {
+    ASSERT_TRUE(manager.get_message_force(1, message_id));
+  }
+  ASSERT_EQ(91, cache.get_size());
+  ASSERT_TRUE(!manager.is_reduce_scheduled);
+  manager.set_max_size(MessageCache::MIN_MAX_SIZE);
+  ASSERT_TRUE(!manager.is_reduce_scheduled);
+  for (int32 message_id = 1; message_id <= 10; message_id++) {
+    ASSERT_TRUE(manager.get_message_force(3, message_id));
+  }
+  ASSERT_EQ(101, cache.get_size());
+  ASSERT_TRUE(manager.is_reduce_scheduled);
+
+  // the opened chat is never unloaded, so the size can stay above the limit
+  manager.get_dialog(4)->is_opened = true;
+  manager.get_dialog(0)->is_opened = true;
+  manager.get_dialog(1)->is_opened = true;
+  manager.get_dialog(3)->is_opened = true;
+  manager.reduce();
+  ASSERT_EQ(101, cache.get_size());
+  ASSERT_TRUE(cache.need_reduce());
+}
@@ -9,6 +9,7 @@
 #include "td/actor/actor.h"
 #include "td/actor/PromiseFuture.h"
 
+#include "td/mtproto/AuthKey.h"
 #include "td/mtproto/crypto.h"
 #include "td/mtproto/Handshake.h"
 #include "td/mtproto/HandshakeActor.h"
@@ -25,12 +26,38 @@
 #include "td/utils/port/IPAddress.h"
 #include "td/utils/port/SocketFd.h"
 #include "td/utils/Status.h"
+#include "td/utils/tl_helpers.h"
 
 REGISTER_TESTS(mtproto);
 
 using namespace td;
 using namespace mtproto;
 
+TEST(Mtproto, auth_key_serialization) {
+  AuthKey auth_key(12345, string(256, 'k'));
+  auth_key.set_auth_flag(true);
+  auth_key.set_need_header(false);
+  auth_key.set_expire_at(100.0);
+
+  auto serialized = serialize(auth_key);
+  AuthKey restored;
+  unserialize(restored, serialized).ensure();
+  ASSERT_EQ(auth_key.id(), restored.id());
+  ASSERT_EQ(auth_key.key(), restored.key());
+  ASSERT_TRUE(restored.auth_flag());
+  ASSERT_TRUE(restored.was_auth_flag());
+  // the transient state isn't stored
+  ASSERT_TRUE(restored.need_header());
+  ASSERT_EQ(0.0, restored.expire_at());
+  ASSERT_EQ(serialized, serialize(restored));
+
+  auth_key.set_auth_flag(false);
+  unserialize(restored, serialize(auth_key)).ensure();
+  ASSERT_TRUE(!restored.auth_flag());
+  ASSERT_TRUE(restored.was_auth_flag());
+  ASSERT_TRUE(restored.empty());
+}
+
 #if !TD_WINDOWS && !TD_EMSCRIPTEN  // TODO
 TEST(Mtproto, config) {
   ConcurrentScheduler sched;